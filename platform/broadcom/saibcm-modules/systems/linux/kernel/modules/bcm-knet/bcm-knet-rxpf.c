@@ -0,0 +1,567 @@
+/*
+ * Copyright 2017 Broadcom
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation (the "GPL").
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 (GPLv2) for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 (GPLv2) along with this source code.
+ */
+
+/*
+ * Compiled Rx packet filter classifier.
+ *
+ * A KNET Rx filter compares the masked concatenation of an OOB (DCB or
+ * SAND header) byte range and a packet byte range against the filter
+ * data. Only the bytes with a nonzero mask take part in the compare,
+ * so each filter is reduced to its effective shape:
+ *
+ *   - the OOB span from the first to the last nonzero OOB mask byte
+ *   - the packet span from the first to the last nonzero packet mask byte
+ *   - the mask bytes within the two spans
+ *
+ * Filters with identical shapes share a hash table keyed by the masked
+ * span bytes. Tables are ordered by the list position of their first
+ * filter, and each table entry keeps its filters in list order. A
+ * lookup stops as soon as no remaining table or filter can precede the
+ * best unconditional (non call-back) match, so the result is the same
+ * as that of a linear walk of the filter list.
+ *
+ * Filters whose data has bits set outside the mask can never match and
+ * are left out. Mask bytes beyond the filter data size are ignored.
+ */
+
+#ifdef __KERNEL__
+#include <gmodule.h> /* Must be included first */
+#include <kcom.h>
+#define RXPF_ALLOC(_sz)         kmalloc(_sz, GFP_ATOMIC)
+#define RXPF_FREE(_p)           kfree(_p)
+#else
+#include <stdlib.h>
+#include <string.h>
+#include <kcom.h>
+#define RXPF_ALLOC(_sz)         malloc(_sz)
+#define RXPF_FREE(_p)           free(_p)
+#endif
+
+#include "bcm-knet-rxpf.h"
+
+#define RXPF_SLOT_FREE          0xffff
+
+#define RXPF_FNV_BASIS          2166136261U
+#define RXPF_FNV_PRIME          16777619U
+
+typedef struct rxpf_rule_s {
+    const kcom_filter_t *kf;
+    void *cookie;
+    int table;                  /* Table index (-1 if filter never matches) */
+    int entry;                  /* Entry index */
+    int entry_first;            /* First filter of its entry */
+    uint16 oob_off;             /* Effective OOB span */
+    uint16 oob_len;
+    uint16 oob_idx;             /* Start of OOB span in filter data/mask */
+    uint16 pkt_off;             /* Effective packet span */
+    uint16 pkt_len;
+    uint16 pkt_idx;             /* Start of packet span in filter data/mask */
+    uint16 min_pktlen;          /* Packet must cover entire filter data */
+    uint8 priority;
+    uint8 is_cb;
+} rxpf_rule_t;
+
+typedef struct rxpf_entry_s {
+    uint8 *key;                 /* Masked key bytes */
+    uint32 hash;
+    uint16 first;               /* First filter in rule index */
+    uint16 count;               /* Number of filters */
+} rxpf_entry_t;
+
+typedef struct rxpf_table_s {
+    uint8 *mask;                /* Key mask bytes */
+    uint16 *slots;              /* Open addressed entry index */
+    uint32 slot_mask;
+    int min_rank;               /* List position of first filter */
+    uint16 oob_off;
+    uint16 oob_len;
+    uint16 pkt_off;
+    uint16 pkt_len;
+    uint16 key_len;
+} rxpf_table_t;
+
+struct bkn_rxpf_s {
+    int max_rules;              /* Filters allocated */
+    int num_rules;              /* Filters added */
+    int num_live;               /* Filters which can match */
+    int num_tables;
+    int num_entries;
+    rxpf_rule_t *rules;         /* Filters in list order */
+    rxpf_rule_t **cand;         /* Lookup candidates */
+    void **out;                 /* Lookup result (cookies) */
+    void *block;                /* Tables, entries, index, slots and keys */
+    rxpf_table_t *tables;
+    rxpf_entry_t *entries;
+    uint16 *rule_idx;
+    uint8 key[KCOM_FILTER_BYTES_MAX];
+};
+
+void
+bkn_rxpf_chan_init(bkn_rxpf_chan_t *ch, int chan, int num_rx_prio,
+                   int rx_chans, int prio0_any)
+{
+    ch->lo = num_rx_prio * chan;
+    ch->hi = num_rx_prio * (chan + 1);
+    ch->all = num_rx_prio * rx_chans;
+    ch->prio0_any = prio0_any;
+}
+
+static inline int
+rxpf_chan_match(const bkn_rxpf_chan_t *ch, int prio)
+{
+    if (prio >= ch->all) {
+        return 1;
+    }
+    if (prio == 0 && ch->prio0_any) {
+        return 1;
+    }
+    return (prio >= ch->lo && prio < ch->hi);
+}
+
+bkn_rxpf_t *
+bkn_rxpf_alloc(int count)
+{
+    bkn_rxpf_t *pf;
+    int max = count > 0 ? count : 1;
+    int size;
+
+    size = sizeof(*pf) + max * (sizeof(rxpf_rule_t) +
+                                sizeof(rxpf_rule_t *) + sizeof(void *));
+    pf = RXPF_ALLOC(size);
+    if (pf == NULL) {
+        return NULL;
+    }
+    memset(pf, 0, size);
+    pf->max_rules = max;
+    pf->rules = (rxpf_rule_t *)(pf + 1);
+    pf->cand = (rxpf_rule_t **)(pf->rules + max);
+    pf->out = (void **)(pf->cand + max);
+
+    return pf;
+}
+
+void
+bkn_rxpf_free(bkn_rxpf_t *pf)
+{
+    if (pf == NULL) {
+        return;
+    }
+    if (pf->block) {
+        RXPF_FREE(pf->block);
+    }
+    RXPF_FREE(pf);
+}
+
+/*
+ * Find the span of nonzero mask bytes in mask[base..base+size).
+ * Returns the span length and sets *first to its start index.
+ */
+static int
+rxpf_mask_span(const kcom_filter_t *kf, int base, int size, int *first)
+{
+    int idx, lo = -1, hi = -1;
+
+    for (idx = base; idx < base + size; idx++) {
+        if (kf->mask.b[idx]) {
+            if (lo < 0) {
+                lo = idx;
+            }
+            hi = idx;
+        }
+    }
+    if (lo < 0) {
+        *first = 0;
+        return 0;
+    }
+    *first = lo;
+    return hi - lo + 1;
+}
+
+int
+bkn_rxpf_add(bkn_rxpf_t *pf, const kcom_filter_t *kf, void *cookie)
+{
+    rxpf_rule_t *r;
+    int size, wsize, idx, first, len;
+
+    if (pf->num_rules >= pf->max_rules || pf->block) {
+        return -1;
+    }
+    size = kf->oob_data_size + kf->pkt_data_size;
+    if (size > KCOM_FILTER_BYTES_MAX) {
+        return -1;
+    }
+
+    r = &pf->rules[pf->num_rules++];
+    r->kf = kf;
+    r->cookie = cookie;
+    r->priority = kf->priority;
+    r->is_cb = (kf->dest_type == KCOM_DEST_T_CB);
+    r->min_pktlen = kf->pkt_data_offset + kf->pkt_data_size;
+
+    /* Data bits outside the mask never compare equal */
+    wsize = BYTES2WORDS(size);
+    for (idx = 0; idx < wsize * 4; idx++) {
+        if (kf->data.b[idx] & ~kf->mask.b[idx]) {
+            r->table = -1;
+            return 0;
+        }
+    }
+
+    len = rxpf_mask_span(kf, 0, kf->oob_data_size, &first);
+    r->oob_idx = first;
+    r->oob_len = len;
+    r->oob_off = len ? kf->oob_data_offset + first : 0;
+
+    len = rxpf_mask_span(kf, kf->oob_data_size, kf->pkt_data_size, &first);
+    r->pkt_idx = first;
+    r->pkt_len = len;
+    r->pkt_off = len ? kf->pkt_data_offset + (first - kf->oob_data_size) : 0;
+
+    pf->num_live++;
+
+    return 0;
+}
+
+static int
+rxpf_shape_equal(const rxpf_rule_t *a, const rxpf_rule_t *b)
+{
+    if (a->oob_off != b->oob_off || a->oob_len != b->oob_len ||
+        a->pkt_off != b->pkt_off || a->pkt_len != b->pkt_len) {
+        return 0;
+    }
+    if (memcmp(&a->kf->mask.b[a->oob_idx],
+               &b->kf->mask.b[b->oob_idx], a->oob_len) != 0) {
+        return 0;
+    }
+    return memcmp(&a->kf->mask.b[a->pkt_idx],
+                  &b->kf->mask.b[b->pkt_idx], a->pkt_len) == 0;
+}
+
+/* Filter data never has bits outside the mask, so it is the masked key. */
+static int
+rxpf_key_equal(const rxpf_rule_t *a, const rxpf_rule_t *b)
+{
+    if (memcmp(&a->kf->data.b[a->oob_idx],
+               &b->kf->data.b[b->oob_idx], a->oob_len) != 0) {
+        return 0;
+    }
+    return memcmp(&a->kf->data.b[a->pkt_idx],
+                  &b->kf->data.b[b->pkt_idx], a->pkt_len) == 0;
+}
+
+static uint32
+rxpf_hash(const uint8 *key, int len)
+{
+    uint32 hash = RXPF_FNV_BASIS;
+    int idx;
+
+    for (idx = 0; idx < len; idx++) {
+        hash = (hash ^ key[idx]) * RXPF_FNV_PRIME;
+    }
+    return hash;
+}
+
+static int
+rxpf_num_slots(int entries)
+{
+    int slots = 2;
+
+    while (slots < 2 * entries) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+/*
+ * Assign each filter to a table and an entry. Filters are visited in
+ * list order, so table and entry indexes are ordered by their first
+ * filter.
+ */
+static void
+rxpf_group(bkn_rxpf_t *pf)
+{
+    rxpf_rule_t *r, *p;
+    int idx, pidx;
+
+    for (idx = 0; idx < pf->num_rules; idx++) {
+        r = &pf->rules[idx];
+        if (r->table < 0) {
+            continue;
+        }
+        r->table = -1;
+        for (pidx = 0; pidx < idx; pidx++) {
+            p = &pf->rules[pidx];
+            if (p->table >= 0 && p->entry_first &&
+                rxpf_shape_equal(r, p)) {
+                r->table = p->table;
+                break;
+            }
+        }
+        if (r->table < 0) {
+            r->table = pf->num_tables++;
+        }
+        r->entry = -1;
+        for (; pidx < idx; pidx++) {
+            p = &pf->rules[pidx];
+            if (p->table == r->table && p->entry_first &&
+                rxpf_key_equal(r, p)) {
+                r->entry = p->entry;
+                break;
+            }
+        }
+        if (r->entry < 0) {
+            r->entry = pf->num_entries++;
+            r->entry_first = 1;
+        }
+    }
+}
+
+int
+bkn_rxpf_build(bkn_rxpf_t *pf)
+{
+    rxpf_rule_t *r;
+    rxpf_table_t *t;
+    rxpf_entry_t *e;
+    uint16 *slots;
+    uint8 *bytes;
+    int idx, tidx, num, key_len;
+    int num_slots, num_bytes, size;
+    uint32 slot;
+
+    if (pf->block) {
+        return -1;
+    }
+
+    rxpf_group(pf);
+
+    /* Size the block */
+    num_slots = 0;
+    num_bytes = 0;
+    for (tidx = 0; tidx < pf->num_tables; tidx++) {
+        num = 0;
+        key_len = 0;
+        for (idx = 0; idx < pf->num_rules; idx++) {
+            r = &pf->rules[idx];
+            if (r->table == tidx && r->entry_first) {
+                key_len = r->oob_len + r->pkt_len;
+                num++;
+            }
+        }
+        num_slots += rxpf_num_slots(num);
+        num_bytes += key_len * (num + 1);
+    }
+    size = pf->num_tables * sizeof(rxpf_table_t) +
+           pf->num_entries * sizeof(rxpf_entry_t) +
+           (pf->num_live + num_slots) * sizeof(uint16) + num_bytes;
+    pf->block = RXPF_ALLOC(size > 0 ? size : 1);
+    if (pf->block == NULL) {
+        return -1;
+    }
+    memset(pf->block, 0, size > 0 ? size : 1);
+    pf->tables = (rxpf_table_t *)pf->block;
+    pf->entries = (rxpf_entry_t *)(pf->tables + pf->num_tables);
+    pf->rule_idx = (uint16 *)(pf->entries + pf->num_entries);
+    slots = pf->rule_idx + pf->num_live;
+    bytes = (uint8 *)(slots + num_slots);
+
+    /* Tables: shape of first filter, slots and mask */
+    for (idx = 0; idx < pf->num_rules; idx++) {
+        r = &pf->rules[idx];
+        if (r->table < 0 || !r->entry_first) {
+            continue;
+        }
+        t = &pf->tables[r->table];
+        if (t->slots) {
+            continue;
+        }
+        t->min_rank = idx;
+        t->oob_off = r->oob_off;
+        t->oob_len = r->oob_len;
+        t->pkt_off = r->pkt_off;
+        t->pkt_len = r->pkt_len;
+        t->key_len = r->oob_len + r->pkt_len;
+        num = 0;
+        for (tidx = idx; tidx < pf->num_rules; tidx++) {
+            if (pf->rules[tidx].table == r->table &&
+                pf->rules[tidx].entry_first) {
+                num++;
+            }
+        }
+        t->slots = slots;
+        t->slot_mask = rxpf_num_slots(num) - 1;
+        for (slot = 0; slot <= t->slot_mask; slot++) {
+            t->slots[slot] = RXPF_SLOT_FREE;
+        }
+        slots += t->slot_mask + 1;
+        t->mask = bytes;
+        memcpy(bytes, &r->kf->mask.b[r->oob_idx], r->oob_len);
+        memcpy(bytes + r->oob_len, &r->kf->mask.b[r->pkt_idx], r->pkt_len);
+        bytes += t->key_len;
+    }
+
+    /* Entries: key, hash and slot */
+    for (idx = 0; idx < pf->num_rules; idx++) {
+        r = &pf->rules[idx];
+        if (r->table < 0) {
+            continue;
+        }
+        e = &pf->entries[r->entry];
+        e->count++;
+        if (!r->entry_first) {
+            continue;
+        }
+        t = &pf->tables[r->table];
+        e->key = bytes;
+        memcpy(bytes, &r->kf->data.b[r->oob_idx], r->oob_len);
+        memcpy(bytes + r->oob_len, &r->kf->data.b[r->pkt_idx], r->pkt_len);
+        bytes += t->key_len;
+        e->hash = rxpf_hash(e->key, t->key_len);
+        slot = e->hash & t->slot_mask;
+        while (t->slots[slot] != RXPF_SLOT_FREE) {
+            slot = (slot + 1) & t->slot_mask;
+        }
+        t->slots[slot] = r->entry;
+    }
+
+    /* Rule index: filters of each entry in list order */
+    num = 0;
+    for (idx = 0; idx < pf->num_entries; idx++) {
+        e = &pf->entries[idx];
+        e->first = num;
+        num += e->count;
+        e->count = 0;
+    }
+    for (idx = 0; idx < pf->num_rules; idx++) {
+        r = &pf->rules[idx];
+        if (r->table < 0) {
+            continue;
+        }
+        e = &pf->entries[r->entry];
+        pf->rule_idx[e->first + e->count++] = idx;
+    }
+
+    return 0;
+}
+
+static rxpf_entry_t *
+rxpf_table_lookup(bkn_rxpf_t *pf, const rxpf_table_t *t,
+                  const uint8 *oob, const uint8 *pkt, int *cost)
+{
+    const uint8 *mask = t->mask;
+    uint8 *key = pf->key;
+    rxpf_entry_t *e;
+    uint32 hash = RXPF_FNV_BASIS;
+    uint32 slot;
+    int idx;
+
+    for (idx = 0; idx < t->oob_len; idx++) {
+        key[idx] = oob[t->oob_off + idx] & mask[idx];
+        hash = (hash ^ key[idx]) * RXPF_FNV_PRIME;
+    }
+    key += t->oob_len;
+    mask += t->oob_len;
+    for (idx = 0; idx < t->pkt_len; idx++) {
+        key[idx] = pkt[t->pkt_off + idx] & mask[idx];
+        hash = (hash ^ key[idx]) * RXPF_FNV_PRIME;
+    }
+
+    slot = hash & t->slot_mask;
+    while (t->slots[slot] != RXPF_SLOT_FREE) {
+        (*cost)++;
+        e = &pf->entries[t->slots[slot]];
+        if (e->hash == hash &&
+            memcmp(e->key, pf->key, t->key_len) == 0) {
+            return e;
+        }
+        slot = (slot + 1) & t->slot_mask;
+    }
+    return NULL;
+}
+
+int
+bkn_rxpf_lookup(bkn_rxpf_t *pf, const uint8 *oob, const uint8 *pkt,
+                int pktlen, const bkn_rxpf_chan_t *ch,
+                void ***cand, int *cost)
+{
+    const rxpf_table_t *t;
+    const rxpf_entry_t *e;
+    rxpf_rule_t *r;
+    int best = pf->num_rules;   /* Rank of best unconditional match */
+    int num = 0;
+    int tidx, idx, pos, rank;
+
+    *cost = 0;
+    for (tidx = 0; tidx < pf->num_tables; tidx++) {
+        t = &pf->tables[tidx];
+        if (t->min_rank >= best) {
+            break;
+        }
+        (*cost)++;
+        if (t->pkt_off + t->pkt_len > pktlen) {
+            continue;
+        }
+        e = rxpf_table_lookup(pf, t, oob, pkt, cost);
+        if (e == NULL) {
+            continue;
+        }
+        for (idx = e->first; idx < e->first + e->count; idx++) {
+            rank = pf->rule_idx[idx];
+            if (rank >= best) {
+                break;
+            }
+            (*cost)++;
+            r = &pf->rules[rank];
+            if (r->min_pktlen > pktlen ||
+                !rxpf_chan_match(ch, r->priority)) {
+                continue;
+            }
+            /* Insert in list order */
+            for (pos = num; pos > 0 && pf->cand[pos - 1] - pf->rules > rank;
+                 pos--) {
+                pf->cand[pos] = pf->cand[pos - 1];
+            }
+            pf->cand[pos] = r;
+            num++;
+            if (!r->is_cb) {
+                best = rank;
+                break;
+            }
+        }
+    }
+
+    /* Drop candidates behind the unconditional match */
+    while (num > 0 && pf->cand[num - 1] - pf->rules > best) {
+        num--;
+    }
+    for (idx = 0; idx < num; idx++) {
+        pf->out[idx] = pf->cand[idx]->cookie;
+    }
+    *cand = pf->out;
+
+    return num;
+}
+
+int
+bkn_rxpf_num_tables(bkn_rxpf_t *pf)
+{
+    return pf->num_tables;
+}
+
+int
+bkn_rxpf_num_rules(bkn_rxpf_t *pf)
+{
+    return pf->num_live;
+}
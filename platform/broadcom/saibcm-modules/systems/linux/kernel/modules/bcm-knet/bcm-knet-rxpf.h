@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017 Broadcom
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation (the "GPL").
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 (GPLv2) for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 (GPLv2) along with this source code.
+ */
+/*
+ * Compiled Rx packet filter classifier for the KNET driver.
+ *
+ * The Rx filter list is compiled into a set of hash tables, one per
+ * distinct filter shape (OOB span, packet span and mask bytes). A
+ * lookup extracts the masked key once per table instead of once per
+ * filter, and returns the matching filters in the same order as a
+ * linear walk of the filter list would have visited them.
+ *
+ * The classifier does not depend on any kernel facilities apart from
+ * memory allocation, and it can be built as part of a user mode test
+ * program (see tools/knet-rxpf).
+ */
+#ifndef __BCM_KNET_RXPF_H__
+#define __BCM_KNET_RXPF_H__
+
+#include <kcom.h>
+
+typedef struct bkn_rxpf_s bkn_rxpf_t;
+
+/*
+ * Rx channel binding of filter priorities.
+ *
+ * A filter with priority below 'all' only matches packets on the
+ * channel owning the priority range [lo, hi). If 'prio0_any' is set,
+ * priority 0 matches on all channels (DNX devices).
+ */
+typedef struct bkn_rxpf_chan_s {
+    int lo;
+    int hi;
+    int all;
+    int prio0_any;
+} bkn_rxpf_chan_t;
+
+extern void
+bkn_rxpf_chan_init(bkn_rxpf_chan_t *ch, int chan, int num_rx_prio,
+                   int rx_chans, int prio0_any);
+
+/*
+ * Building a classifier:
+ *
+ *   pf = bkn_rxpf_alloc(count);
+ *   bkn_rxpf_add(pf, kf, cookie);   (once per filter, in list order)
+ *   bkn_rxpf_build(pf);
+ *
+ * The filters must not change while the classifier is in use. The
+ * cookie is returned by bkn_rxpf_lookup for each matching filter.
+ */
+extern bkn_rxpf_t *
+bkn_rxpf_alloc(int count);
+
+extern int
+bkn_rxpf_add(bkn_rxpf_t *pf, const kcom_filter_t *kf, void *cookie);
+
+extern int
+bkn_rxpf_build(bkn_rxpf_t *pf);
+
+extern void
+bkn_rxpf_free(bkn_rxpf_t *pf);
+
+/*
+ * Look up a packet. Returns the number of candidate filters and sets
+ * *cand to an array of their cookies in list order. The array is owned
+ * by the classifier and is only valid until the next lookup, so callers
+ * must serialize lookups. All candidates except possibly the last one
+ * are call-back filters. *cost is set to the number of table probes, hash
+ * slot compares and filter checks spent on the packet.
+ */
+extern int
+bkn_rxpf_lookup(bkn_rxpf_t *pf, const uint8 *oob, const uint8 *pkt,
+                int pktlen, const bkn_rxpf_chan_t *ch,
+                void ***cand, int *cost);
+
+extern int
+bkn_rxpf_num_tables(bkn_rxpf_t *pf);
+
+extern int
+bkn_rxpf_num_rules(bkn_rxpf_t *pf);
+
+#endif /* __BCM_KNET_RXPF_H__ */
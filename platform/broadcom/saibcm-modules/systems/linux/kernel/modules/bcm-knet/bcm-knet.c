@@ -59,6 +59,7 @@
 #include <linux-bde.h>
 #include <kcom.h>
 #include <bcm-knet.h>
+#include "bcm-knet-rxpf.h"
 
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
@@ -143,6 +144,11 @@ LKM_MOD_PARAM(num_rx_prio, "i", int, 0);
 MODULE_PARM_DESC(num_rx_prio,
 "Number of filter priorities per Rx DMA channel");
 
+static int rx_filter_compile = 1;
+LKM_MOD_PARAM(rx_filter_compile, "i", int, 0);
+MODULE_PARM_DESC(rx_filter_compile,
+"Match Rx packets against compiled filter tables (default 1)");
+
 static int rx_rate[8] = { 100000, 100000, 100000, 100000, 100000, 100000, 100000, 0 };
 LKM_MOD_PARAM_ARRAY(rx_rate, "1-4i", int, NULL, 0);
 MODULE_PARM_DESC(rx_rate,
@@ -575,6 +581,9 @@ typedef struct bkn_switch_info_s {
     struct net_device **ndevs;  /* Indexed array of ndev_list */
     int ndev_max;               /* Size of indexed array */
     struct list_head rxpf_list; /* Associated Rx packet filters */
+    bkn_rxpf_t *rxpf;           /* Compiled Rx packet filters */
+    unsigned long rxpf_misses;  /* Rx packets matching no filter */
+    unsigned long rxpf_miss_probes; /* Lookup cost of unmatched packets */
     volatile void *base_addr;   /* Base address for PCI register access */
     struct BKN_DMA_DEV *dma_dev;    /* Required for DMA memory control */
     struct pci_dev *pdev;       /* Required for DMA memory control */
@@ -971,6 +980,7 @@ typedef struct bkn_filter_s {
     struct list_head list;
     int dev_no;
     unsigned long hits;
+    unsigned long probes;       /* Lookup cost of matched packets */
     kcom_filter_t kf;
 } bkn_filter_t;
 
@@ -2566,9 +2576,102 @@ device_is_sand(bkn_switch_info_t *sinfo)
     return (is_dpp | is_dnx);
 }
 
+/*
+ * Rebuild the compiled Rx filter tables after the filter list changed.
+ * Must be called with the device lock held. If the tables cannot be
+ * allocated, Rx packets are matched by walking the filter list.
+ */
+static void
+bkn_rxpf_rebuild(bkn_switch_info_t *sinfo)
+{
+    struct list_head *list;
+    bkn_filter_t *filter;
+    bkn_rxpf_t *rxpf;
+    int count;
+
+    bkn_rxpf_free(sinfo->rxpf);
+    sinfo->rxpf = NULL;
+
+    count = 0;
+    list_for_each(list, &sinfo->rxpf_list) {
+        count++;
+    }
+    if (!rx_filter_compile || count == 0) {
+        return;
+    }
+
+    rxpf = bkn_rxpf_alloc(count);
+    if (rxpf == NULL) {
+        DBG_WARN(("Rx filter tables not allocated, using filter list\n"));
+        return;
+    }
+    list_for_each(list, &sinfo->rxpf_list) {
+        filter = (bkn_filter_t *)list;
+        bkn_rxpf_add(rxpf, &filter->kf, filter);
+    }
+    if (bkn_rxpf_build(rxpf) < 0) {
+        DBG_WARN(("Rx filter tables not allocated, using filter list\n"));
+        bkn_rxpf_free(rxpf);
+        return;
+    }
+    sinfo->rxpf = rxpf;
+
+    DBG_FLTR(("Compiled %d Rx filters into %d tables\n",
+              bkn_rxpf_num_rules(rxpf), bkn_rxpf_num_tables(rxpf)));
+}
+
+/* Returns nonzero if the filter call-back accepts the packet. */
+static int
+bkn_match_rx_cb(bkn_switch_info_t *sinfo, bkn_filter_t *filter,
+                uint8_t *pkt, int pktlen, void *meta, int chan,
+                bkn_filter_t *cbf)
+{
+    if (knet_filter_cb != NULL && cbf != NULL) {
+        memset(cbf, 0, sizeof(*cbf));
+        memcpy(&cbf->kf, &filter->kf, sizeof(cbf->kf));
+        return knet_filter_cb(pkt, pktlen, sinfo->dev_no,
+                              meta, chan, &cbf->kf);
+    }
+    DBG_FLTR(("Match, but not filter callback\n"));
+    return 0;
+}
+
 static bkn_filter_t *
-bkn_match_rx_pkt(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
-                 void *meta, int chan, bkn_filter_t *cbf)
+bkn_match_rx_pkt_compiled(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
+                          void *meta, int chan, bkn_filter_t *cbf, int *cost)
+{
+    bkn_filter_t *filter;
+    bkn_rxpf_chan_t ch;
+    void **cand;
+    int idx, num;
+
+    bkn_rxpf_chan_init(&ch, chan, num_rx_prio, sinfo->rx_chans,
+                       device_is_dnx(sinfo));
+    num = bkn_rxpf_lookup(sinfo->rxpf, (uint8_t *)meta, pkt, pktlen,
+                          &ch, &cand, cost);
+    for (idx = 0; idx < num; idx++) {
+        filter = (bkn_filter_t *)cand[idx];
+        if (filter->kf.dest_type == KCOM_DEST_T_CB) {
+            /* Check for custom filters */
+            if (bkn_match_rx_cb(sinfo, filter, pkt, pktlen,
+                                meta, chan, cbf)) {
+                filter->hits++;
+                filter->probes += *cost;
+                return cbf;
+            }
+        } else {
+            filter->hits++;
+            filter->probes += *cost;
+            return filter;
+        }
+    }
+
+    return NULL;
+}
+
+static bkn_filter_t *
+bkn_match_rx_pkt_linear(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
+                        void *meta, int chan, bkn_filter_t *cbf, int *cost)
 {
     struct list_head *list;
     bkn_filter_t *filter;
@@ -2577,9 +2680,11 @@ bkn_match_rx_pkt(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
     int size, wsize;
     int idx, match;
 
+    *cost = 0;
     list_for_each(list, &sinfo->rxpf_list) {
         filter = (bkn_filter_t *)list;
         kf = &filter->kf;
+        (*cost)++;
         if (kf->pkt_data_offset + kf->pkt_data_size > pktlen) {
             continue;
         }
@@ -2641,19 +2746,15 @@ bkn_match_rx_pkt(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
         if (match) {
             if (kf->dest_type == KCOM_DEST_T_CB) {
                 /* Check for custom filters */
-                if (knet_filter_cb != NULL && cbf != NULL) {
-                    memset(cbf, 0, sizeof(*cbf));
-                    memcpy(&cbf->kf, kf, sizeof(cbf->kf));
-                    if (knet_filter_cb(pkt, pktlen, sinfo->dev_no,
-                                       meta, chan, &cbf->kf)) {
-                        filter->hits++;
-                        return cbf;
-                    }
-                } else {
-                    DBG_FLTR(("Match, but not filter callback\n"));
+                if (bkn_match_rx_cb(sinfo, filter, pkt, pktlen,
+                                    meta, chan, cbf)) {
+                    filter->hits++;
+                    filter->probes += *cost;
+                    return cbf;
                 }
             } else {
                 filter->hits++;
+                filter->probes += *cost;
                 return filter;
             }
         }
@@ -2662,6 +2763,33 @@ bkn_match_rx_pkt(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
     return NULL;
 }
 
+/*
+ * Match an Rx packet against the filter list. The compiled filter
+ * tables are bypassed while Dune debug output is enabled, since only
+ * the list walk dumps the per-filter match data.
+ */
+static bkn_filter_t *
+bkn_match_rx_pkt(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
+                 void *meta, int chan, bkn_filter_t *cbf)
+{
+    bkn_filter_t *filter;
+    int cost;
+
+    if (sinfo->rxpf != NULL && !(debug & DBG_LVL_DUNE)) {
+        filter = bkn_match_rx_pkt_compiled(sinfo, pkt, pktlen, meta,
+                                           chan, cbf, &cost);
+    } else {
+        filter = bkn_match_rx_pkt_linear(sinfo, pkt, pktlen, meta,
+                                         chan, cbf, &cost);
+    }
+    if (filter == NULL) {
+        sinfo->rxpf_misses++;
+        sinfo->rxpf_miss_probes += cost;
+    }
+
+    return filter;
+}
+
 static bkn_priv_t *
 bkn_netif_lookup(bkn_switch_info_t *sinfo, int id)
 {
@@ -7423,6 +7551,8 @@ bkn_proc_stats_show(struct seq_file *m, void *v)
     struct list_head *list, *flist;
     bkn_switch_info_t *sinfo;
     bkn_filter_t *filter;
+    unsigned long flags;
+    int tables, rules;
     int chan;
 
 
@@ -7446,12 +7576,29 @@ bkn_proc_stats_show(struct seq_file *m, void *v)
         }
         seq_printf(m, "  Timer runs  %10u\n", sinfo->timer_runs);
         seq_printf(m, "  NAPI reruns %10u\n", sinfo->napi_not_done);
+        spin_lock_irqsave(&sinfo->lock, flags);
+        tables = rules = -1;
+        if (sinfo->rxpf) {
+            tables = bkn_rxpf_num_tables(sinfo->rxpf);
+            rules = bkn_rxpf_num_rules(sinfo->rxpf);
+        }
+        spin_unlock_irqrestore(&sinfo->lock, flags);
+        if (tables >= 0) {
+            seq_printf(m, "  Rx filter tables %5d (%d filters)\n",
+                       tables, rules);
+        } else {
+            seq_printf(m, "  Rx filter tables     - (filter list)\n");
+        }
+        seq_printf(m, "  Rx filter misses %10lu\n", sinfo->rxpf_misses);
+        seq_printf(m, "  Rx filter miss probes %10lu\n",
+                   sinfo->rxpf_miss_probes);
 
         list_for_each(flist, &sinfo->rxpf_list) {
             filter = (bkn_filter_t *)flist;
 
             seq_printf(m, "  Filter %d stats:\n", filter->kf.id);
             seq_printf(m, "    Hits      %10lu\n", filter->hits);
+            seq_printf(m, "    Probes    %10lu\n", filter->probes);
         }
 
         unit++;
@@ -7524,9 +7671,12 @@ bkn_proc_stats_write(struct file *file, const char *buf,
         sinfo->interrupts = 0;
         sinfo->timer_runs = 0;
         sinfo->napi_not_done = 0;
+        sinfo->rxpf_misses = 0;
+        sinfo->rxpf_miss_probes = 0;
         list_for_each(flist, &sinfo->rxpf_list) {
             filter = (bkn_filter_t *)flist;
             filter->hits = 0;
+            filter->probes = 0;
         }
     }
 
@@ -8833,6 +8983,7 @@ bkn_knet_filter_create(kcom_msg_filter_create_t *kmsg, int len)
     if (!found) {
         list_add_tail(&filter->list, &sinfo->rxpf_list);
     }
+    bkn_rxpf_rebuild(sinfo);
 
     kmsg->filter.id = filter->kf.id;
 
@@ -8896,6 +9047,7 @@ bkn_knet_filter_destroy(kcom_msg_filter_destroy_t *kmsg, int len)
     }
 
     list_del(&filter->list);
+    bkn_rxpf_rebuild(sinfo);
 
     cfg_api_unlock(sinfo, &flags);
 
@@ -9298,6 +9450,8 @@ _cleanup(void)
             DBG_VERB(("Removing filter ID %d.\n", filter->kf.id));
             kfree(filter);
         }
+        bkn_rxpf_free(sinfo->rxpf);
+        sinfo->rxpf = NULL;
 
         /* Destroy all associated virtual net devices */
         while (!list_empty(&sinfo->ndev_list)) {
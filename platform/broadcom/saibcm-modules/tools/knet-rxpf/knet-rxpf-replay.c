@@ -0,0 +1,509 @@
+/*
+ * Copyright 2017 Broadcom
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation (the "GPL").
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 (GPLv2) for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 (GPLv2) along with this source code.
+ */
+
+/*
+ * User mode replay harness for the KNET compiled Rx filter classifier.
+ *
+ * Loads a KNET filter set and a capture of Rx packets with their DCB
+ * (or SAND header) meta data, and matches every packet both with the
+ * compiled classifier and with a walk of the filter list that follows
+ * bkn_match_rx_pkt. Any difference in the result is reported, along
+ * with per-filter hits and lookup cost and the time spent per packet.
+ *
+ * Usage:
+ *
+ *   knet-rxpf-replay [-v] [-x] [-r] [-n <loops>] [-p <num_rx_prio>]
+ *                    [-c <rx_chans>] <filter-file> <capture-file>
+ *
+ *   -v  Print the result of each packet
+ *   -x  DNX device (priority 0 filters match on all Rx channels)
+ *   -r  Call-back filters reject packets (default is to accept)
+ *   -n  Number of timed replay loops (default 100)
+ *   -p  Number of filter priorities per Rx channel (default 1)
+ *   -c  Number of Rx channels (default 7)
+ *
+ * Filter file, one filter per line, data and mask in hex covering the
+ * OOB bytes followed by the packet bytes ("-" if both sizes are zero):
+ *
+ *   <id> <priority> <api|netif|cb|null> <oob-offset> <oob-size>
+ *        <pkt-offset> <pkt-size> <data> <mask>
+ *
+ * Capture file, one packet per line, meta data and packet in hex:
+ *
+ *   <rx-chan> <meta> <packet>
+ *
+ * Filters are ordered by priority the same way bkn_knet_filter_create
+ * inserts them. Lines starting with '#' are ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <kcom.h>
+
+#include "bcm-knet-rxpf.h"
+
+#define REPLAY_LINE_MAX         2048
+#define REPLAY_META_MAX         256
+#define REPLAY_PKT_MAX          (16 * 1024)
+
+typedef struct replay_filter_s {
+    kcom_filter_t kf;
+    unsigned long hits[2];
+    unsigned long probes[2];
+} replay_filter_t;
+
+typedef struct replay_pkt_s {
+    int chan;
+    int metalen;
+    int pktlen;
+    uint8 *meta;
+    uint8 *pkt;
+} replay_pkt_t;
+
+static replay_filter_t *filters;
+static int num_filters;
+static replay_pkt_t *pkts;
+static int num_pkts;
+
+static int verbose;
+static int is_dnx;
+static int cb_reject;
+static int num_rx_prio = 1;
+static int rx_chans = 7;
+
+static int
+parse_hex(const char *str, uint8 *buf, int max)
+{
+    int len = 0;
+    unsigned int val;
+
+    if (strcmp(str, "-") == 0) {
+        return 0;
+    }
+    if (strncmp(str, "0x", 2) == 0) {
+        str += 2;
+    }
+    while (isxdigit((unsigned char)str[0]) &&
+           isxdigit((unsigned char)str[1])) {
+        if (len >= max || sscanf(str, "%2x", &val) != 1) {
+            return -1;
+        }
+        buf[len++] = val;
+        str += 2;
+    }
+    return *str ? -1 : len;
+}
+
+static int
+parse_dest(const char *str)
+{
+    if (strcmp(str, "api") == 0) {
+        return KCOM_DEST_T_API;
+    } else if (strcmp(str, "netif") == 0) {
+        return KCOM_DEST_T_NETIF;
+    } else if (strcmp(str, "cb") == 0) {
+        return KCOM_DEST_T_CB;
+    } else if (strcmp(str, "null") == 0) {
+        return KCOM_DEST_T_NULL;
+    }
+    return -1;
+}
+
+static int
+load_filters(const char *file)
+{
+    FILE *fp;
+    char line[REPLAY_LINE_MAX];
+    char dest[16], data[2 * KCOM_FILTER_BYTES_MAX + 16];
+    char mask[2 * KCOM_FILTER_BYTES_MAX + 16];
+    replay_filter_t *rf;
+    kcom_filter_t *kf;
+    unsigned int id, prio, oob_off, oob_size, pkt_off, pkt_size;
+    int lineno = 0, size, pos, dest_type;
+
+    if ((fp = fopen(file, "r")) == NULL) {
+        perror(file);
+        return -1;
+    }
+    filters = calloc(KCOM_FILTER_MAX, sizeof(*filters));
+    if (filters == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        if (sscanf(line, "%u %u %15s %u %u %u %u %520s %520s",
+                   &id, &prio, dest, &oob_off, &oob_size,
+                   &pkt_off, &pkt_size, data, mask) != 9) {
+            fprintf(stderr, "%s:%d: bad filter\n", file, lineno);
+            goto error;
+        }
+        if (num_filters >= KCOM_FILTER_MAX - 1) {
+            fprintf(stderr, "%s:%d: too many filters\n", file, lineno);
+            goto error;
+        }
+        size = oob_size + pkt_size;
+        dest_type = parse_dest(dest);
+        if (dest_type < 0) {
+            fprintf(stderr, "%s:%d: bad filter destination\n", file, lineno);
+            goto error;
+        }
+        if (size > KCOM_FILTER_BYTES_MAX || prio > 255 ||
+            oob_off + oob_size > REPLAY_META_MAX ||
+            pkt_off + pkt_size > REPLAY_PKT_MAX) {
+            fprintf(stderr, "%s:%d: bad filter size\n", file, lineno);
+            goto error;
+        }
+
+        /* Add according to priority */
+        for (pos = num_filters; pos > 0; pos--) {
+            if (filters[pos - 1].kf.priority <= prio) {
+                break;
+            }
+            filters[pos] = filters[pos - 1];
+        }
+        rf = &filters[pos];
+        memset(rf, 0, sizeof(*rf));
+        num_filters++;
+
+        kf = &rf->kf;
+        kf->id = id;
+        kf->type = KCOM_FILTER_T_RX_PKT;
+        kf->priority = prio;
+        kf->dest_type = dest_type;
+        kf->oob_data_offset = oob_off;
+        kf->oob_data_size = oob_size;
+        kf->pkt_data_offset = pkt_off;
+        kf->pkt_data_size = pkt_size;
+        if (parse_hex(data, kf->data.b, KCOM_FILTER_BYTES_MAX) != size ||
+            parse_hex(mask, kf->mask.b, KCOM_FILTER_BYTES_MAX) != size) {
+            fprintf(stderr, "%s:%d: bad filter data\n", file, lineno);
+            goto error;
+        }
+    }
+    fclose(fp);
+    return 0;
+
+error:
+    fclose(fp);
+    return -1;
+}
+
+static int
+load_capture(const char *file)
+{
+    FILE *fp;
+    char *line, *meta, *pkt;
+    replay_pkt_t *rp;
+    uint8 buf[REPLAY_PKT_MAX];
+    int lineno = 0, max = 0, chan, len;
+    size_t line_max = 0;
+
+    if ((fp = fopen(file, "r")) == NULL) {
+        perror(file);
+        return -1;
+    }
+    line = NULL;
+    while (getline(&line, &line_max, fp) > 0) {
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        chan = strtol(strtok(line, " \t\r\n"), NULL, 0);
+        meta = strtok(NULL, " \t\r\n");
+        pkt = strtok(NULL, " \t\r\n");
+        if (meta == NULL || pkt == NULL) {
+            fprintf(stderr, "%s:%d: bad packet\n", file, lineno);
+            goto error;
+        }
+        if (num_pkts == max) {
+            max = max ? 2 * max : 1024;
+            rp = realloc(pkts, max * sizeof(*pkts));
+            if (rp == NULL) {
+                goto error;
+            }
+            pkts = rp;
+        }
+        rp = &pkts[num_pkts];
+        rp->chan = chan;
+
+        /* Filters may address the full OOB area, so pad the meta data */
+        if ((len = parse_hex(meta, buf, REPLAY_META_MAX)) < 0) {
+            fprintf(stderr, "%s:%d: bad meta data\n", file, lineno);
+            goto error;
+        }
+        rp->metalen = len;
+        rp->meta = calloc(1, REPLAY_META_MAX);
+        if (rp->meta == NULL) {
+            goto error;
+        }
+        memcpy(rp->meta, buf, len);
+
+        if ((len = parse_hex(pkt, buf, REPLAY_PKT_MAX)) < 0) {
+            fprintf(stderr, "%s:%d: bad packet data\n", file, lineno);
+            free(rp->meta);
+            goto error;
+        }
+        rp->pktlen = len;
+        rp->pkt = malloc(len ? len : 1);
+        if (rp->pkt == NULL) {
+            free(rp->meta);
+            goto error;
+        }
+        memcpy(rp->pkt, buf, len);
+        num_pkts++;
+    }
+    free(line);
+    fclose(fp);
+    return 0;
+
+error:
+    free(line);
+    fclose(fp);
+    return -1;
+}
+
+/*
+ * Reference match, following the filter list walk in bkn_match_rx_pkt.
+ * Filter bytes beyond the data size, which the driver compares against
+ * stale scratch data, only match if the filter data has no bits outside
+ * the mask there.
+ */
+static int
+match_linear(replay_pkt_t *rp, int *cost)
+{
+    replay_filter_t *rf;
+    kcom_filter_t *kf;
+    uint8 scratch[KCOM_FILTER_BYTES_MAX];
+    int idx, fidx, size, match, prio;
+
+    *cost = 0;
+    for (fidx = 0; fidx < num_filters; fidx++) {
+        rf = &filters[fidx];
+        kf = &rf->kf;
+        (*cost)++;
+        if (kf->pkt_data_offset + kf->pkt_data_size > rp->pktlen) {
+            continue;
+        }
+        memcpy(&scratch[0], &rp->meta[kf->oob_data_offset],
+               kf->oob_data_size);
+        memcpy(&scratch[kf->oob_data_size], &rp->pkt[kf->pkt_data_offset],
+               kf->pkt_data_size);
+        size = kf->oob_data_size + kf->pkt_data_size;
+
+        match = 1;
+        prio = kf->priority;
+        if ((prio || !is_dnx) && prio < num_rx_prio * rx_chans) {
+            if (prio < num_rx_prio * rp->chan ||
+                prio >= num_rx_prio * (rp->chan + 1)) {
+                match = 0;
+            }
+        }
+        for (idx = 0; match && idx < BYTES2WORDS(size) * 4; idx++) {
+            if (idx < size) {
+                match = ((scratch[idx] & kf->mask.b[idx]) == kf->data.b[idx]);
+            } else {
+                match = ((kf->data.b[idx] & ~kf->mask.b[idx]) == 0);
+            }
+        }
+        if (!match) {
+            continue;
+        }
+        if (kf->dest_type == KCOM_DEST_T_CB && cb_reject) {
+            continue;
+        }
+        return fidx;
+    }
+    return -1;
+}
+
+static int
+match_compiled(bkn_rxpf_t *pf, replay_pkt_t *rp, int *cost)
+{
+    bkn_rxpf_chan_t ch;
+    replay_filter_t *rf;
+    void **cand;
+    int idx, num;
+
+    bkn_rxpf_chan_init(&ch, rp->chan, num_rx_prio, rx_chans, is_dnx);
+    num = bkn_rxpf_lookup(pf, rp->meta, rp->pkt, rp->pktlen,
+                          &ch, &cand, cost);
+    for (idx = 0; idx < num; idx++) {
+        rf = (replay_filter_t *)cand[idx];
+        if (rf->kf.dest_type == KCOM_DEST_T_CB && cb_reject) {
+            continue;
+        }
+        return rf - filters;
+    }
+    return -1;
+}
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-v] [-x] [-r] [-n <loops>] [-p <num_rx_prio>]\n"
+            "       %*s [-c <rx_chans>] <filter-file> <capture-file>\n",
+            prog, (int)strlen(prog), "");
+}
+
+int
+main(int argc, char *argv[])
+{
+    bkn_rxpf_t *pf;
+    replay_pkt_t *rp;
+    unsigned long misses[2] = { 0, 0 };
+    unsigned long miss_probes[2] = { 0, 0 };
+    unsigned long cost_sum[2] = { 0, 0 };
+    double elapsed[2];
+    double start;
+    int loops = 100;
+    int opt, idx, loop, mismatch = 0;
+    int res[2], cost[2];
+    volatile int sink = 0;
+
+    while ((opt = getopt(argc, argv, "vxrn:p:c:")) != -1) {
+        switch (opt) {
+        case 'v':
+            verbose = 1;
+            break;
+        case 'x':
+            is_dnx = 1;
+            break;
+        case 'r':
+            cb_reject = 1;
+            break;
+        case 'n':
+            loops = atoi(optarg);
+            break;
+        case 'p':
+            num_rx_prio = atoi(optarg);
+            break;
+        case 'c':
+            rx_chans = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind != 2 || loops < 1 || num_rx_prio < 1 || rx_chans < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (load_filters(argv[optind]) < 0 || load_capture(argv[optind + 1]) < 0) {
+        return 2;
+    }
+
+    pf = bkn_rxpf_alloc(num_filters);
+    if (pf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+    for (idx = 0; idx < num_filters; idx++) {
+        bkn_rxpf_add(pf, &filters[idx].kf, &filters[idx]);
+    }
+    if (bkn_rxpf_build(pf) < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+    printf("%d filters (%d can match) in %d tables, %d packets\n",
+           num_filters, bkn_rxpf_num_rules(pf), bkn_rxpf_num_tables(pf),
+           num_pkts);
+
+    /* Verify and collect stats */
+    for (idx = 0; idx < num_pkts; idx++) {
+        rp = &pkts[idx];
+        res[0] = match_linear(rp, &cost[0]);
+        res[1] = match_compiled(pf, rp, &cost[1]);
+        for (loop = 0; loop < 2; loop++) {
+            cost_sum[loop] += cost[loop];
+            if (res[loop] < 0) {
+                misses[loop]++;
+                miss_probes[loop] += cost[loop];
+            } else {
+                filters[res[loop]].hits[loop]++;
+                filters[res[loop]].probes[loop] += cost[loop];
+            }
+        }
+        if (res[0] != res[1]) {
+            mismatch++;
+        }
+        if (verbose || res[0] != res[1]) {
+            printf("Packet %d (chan %d, len %d): list %d, compiled %d%s\n",
+                   idx, rp->chan, rp->pktlen,
+                   res[0] < 0 ? -1 : filters[res[0]].kf.id,
+                   res[1] < 0 ? -1 : filters[res[1]].kf.id,
+                   res[0] != res[1] ? " MISMATCH" : "");
+        }
+    }
+
+    /* Timed replay */
+    start = now_ns();
+    for (loop = 0; loop < loops; loop++) {
+        for (idx = 0; idx < num_pkts; idx++) {
+            sink += match_linear(&pkts[idx], &cost[0]);
+        }
+    }
+    elapsed[0] = now_ns() - start;
+    start = now_ns();
+    for (loop = 0; loop < loops; loop++) {
+        for (idx = 0; idx < num_pkts; idx++) {
+            sink += match_compiled(pf, &pkts[idx], &cost[1]);
+        }
+    }
+    elapsed[1] = now_ns() - start;
+
+    printf("\n%-10s %10s %10s %10s %10s\n",
+           "Filter", "Hits", "Probes", "Hits", "Probes");
+    printf("%-10s %21s %21s\n", "", "(list)", "(compiled)");
+    for (idx = 0; idx < num_filters; idx++) {
+        printf("%-10d %10lu %10lu %10lu %10lu\n", filters[idx].kf.id,
+               filters[idx].hits[0], filters[idx].probes[0],
+               filters[idx].hits[1], filters[idx].probes[1]);
+    }
+    printf("%-10s %10lu %10lu %10lu %10lu\n", "miss",
+           misses[0], miss_probes[0], misses[1], miss_probes[1]);
+    if (num_pkts) {
+        printf("\nProbes/pkt   list %8.2f   compiled %8.2f\n",
+               (double)cost_sum[0] / num_pkts,
+               (double)cost_sum[1] / num_pkts);
+        printf("ns/pkt       list %8.1f   compiled %8.1f\n",
+               elapsed[0] / loops / num_pkts,
+               elapsed[1] / loops / num_pkts);
+    }
+    printf("Mismatches %d\n", mismatch);
+
+    bkn_rxpf_free(pf);
+
+    return mismatch ? 1 : 0;
+}
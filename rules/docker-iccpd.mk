@@ -24,6 +24,7 @@ $(DOCKER_ICCPD)_CONTAINER_NAME = iccpd
 $(DOCKER_ICCPD)_RUN_OPT += --privileged -t
 $(DOCKER_ICCPD)_RUN_OPT += -v /etc/sonic:/etc/sonic:ro
 $(DOCKER_ICCPD)_RUN_OPT += -v /etc/timezone:/etc/timezone:ro 
+$(DOCKER_ICCPD)_RUN_OPT += -v /host/warmboot:/var/warmboot
 
 $(DOCKER_ICCPD)_BASE_IMAGE_FILES += mclagdctl:/usr/bin/mclagdctl
 
@@ -41,6 +41,7 @@
         .cmd_file_path = "/var/run/iccpd/iccpd.vty", \
         .config_file_path = "/etc/iccpd/iccpd.conf", \
         .mclagdctl_file_path = "/var/run/iccpd/mclagdctl.sock", \
+        .fdb_trace_file_path = NULL, \
         .console_log = 0, \
         .telnet_port = 2015, \
         .init = cmd_option_parser_init, \
@@ -64,6 +65,7 @@ struct CmdOptionParser
     char* cmd_file_path;
     char* config_file_path;
     char *mclagdctl_file_path;
+    char* fdb_trace_file_path;
     uint8_t console_log;
     uint16_t telnet_port;
     LIST_HEAD(option_list, CmdOption) option_list;
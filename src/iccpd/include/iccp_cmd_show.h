@@ -27,10 +27,14 @@
 #define ICCP_MAX_PORT_NAME 20
 #define ICCP_MAX_IP_STR_LEN 16
 
+struct mclagdctl_dump_cursor;
+
 extern int iccp_mclag_config_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_arp_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_ndisc_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_mac_dump(char * *buf, int *num, int mclag_id);
+extern int iccp_arp_dump_page(char * *buf, int *num, int mclag_id, struct mclagdctl_dump_cursor *cursor);
+extern int iccp_mac_dump_page(char * *buf, int *num, int mclag_id, struct mclagdctl_dump_cursor *cursor);
 extern int iccp_local_if_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_peer_if_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_cmd_dbg_counter_dump(char * *buf, int *data_len, int mclag_id);
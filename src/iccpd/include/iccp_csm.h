@@ -34,10 +34,14 @@
 #include <pthread.h>
 
 #include "../include/app_csm.h"
+#include "../include/iccp_timer.h"
 #include "../include/msg_format.h"
 #include "../include/port.h"
+#include "../include/scheduler.h"
 
 #define CSM_BUFFER_SIZE 65536
+/* Peer receive buffer, always has room for one more full LDP message */
+#define CSM_RX_BUFFER_SIZE (CSM_BUFFER_SIZE * 4)
 
 #ifndef IFNAMSIZ
 #define IFNAMSIZ 16
@@ -77,6 +81,8 @@ struct Msg
     char* buf;
     size_t len;
     TAILQ_ENTRY(Msg) tail;
+    LIST_ENTRY(Msg) neigh_next; /* mLACP arp_hash or ndisc_hash */
+    uint8_t restored;           /* neighbor from the warm restart state, not reported since */
 };
 
 /* Connection state */
@@ -118,6 +124,18 @@ struct CSM
     char sender_ip[INET_ADDRSTRLEN];
     void* sock_read_event_ptr;
 
+    /* Bytes read from sock_fd that do not make a full message yet */
+    char* rx_buf;
+    size_t rx_len;
+    /* Messages the socket did not take yet */
+    struct sock_tx_queue tx_queue;
+
+    /* Periodic FSM run and peer heartbeat deadline */
+    struct iccp_timer transit_timer;
+    struct iccp_timer heartbeat_timer;
+    /* Something happened that the FSMs have not looked at yet */
+    int transit_pending;
+
     int keepalive_time;
     int session_timeout;
     int peer_link_learning_enable;
@@ -148,6 +166,7 @@ struct CSM
 };
 int iccp_csm_send(struct CSM*, char*, int);
 int iccp_csm_init_msg(struct Msg**, char*, int);
+void iccp_csm_free_msg(struct Msg* msg);
 int iccp_csm_prepare_nak_msg(struct CSM*, char*, size_t);
 int iccp_csm_prepare_iccp_msg(struct CSM*, char*, size_t);
 int iccp_csm_prepare_capability_msg(struct CSM*, char*, size_t);
@@ -170,4 +189,5 @@ void iccp_csm_correspond_from_rg_disconnect_msg(struct CSM*, struct Msg*);
 
 int mlacp_bind_port_channel_to_csm(struct CSM* csm, const char *ifname);
 int iccp_csm_init_mac_msg(struct MACMsg **mac_msg, char* data, int len);
+void iccp_csm_free_mac_msg(struct MACMsg* mac_msg);
 #endif /* ICCP_CSM_H_ */
@@ -25,6 +25,7 @@
 #define ICCP_IFM_H
 
 #include <netlink/netlink.h>
+#include <linux/rtnetlink.h>
 
 int iccp_sys_local_if_list_get_init();
 
@@ -33,6 +34,19 @@ int iccp_neigh_get_init();
 void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, uint8_t mac_addr[ETHER_ADDR_LEN]);
 void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, uint8_t mac_addr[ETHER_ADDR_LEN]);
 
+/* Neighbor update decoded from a RTM_NEWNEIGH/RTM_DELNEIGH message */
+struct iccp_neigh_info
+{
+    struct ndmsg ndm;
+    int msgtype;
+    int is_del;
+    int has_lladdr;
+    uint8_t dst[16];
+    uint8_t lladdr[ETHER_ADDR_LEN];
+};
+
+int iccp_neigh_msg_decode(struct nlmsghdr *n, struct iccp_neigh_info *info);
+void do_one_neigh_info(struct iccp_neigh_info *info);
 int do_one_neigh_request(struct nlmsghdr *n);
 
 void iccp_from_netlink_port_state_handler( char * ifname, int state);
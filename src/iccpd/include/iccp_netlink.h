@@ -44,11 +44,13 @@ struct nd_msg
     __u8 opt[0];
 };
 
+#ifndef _GNU_SOURCE /* netinet/in.h has it then */
 struct in6_pktinfo
 {
     struct in6_addr ipi6_addr;  /* src/dst IPv6 address */
     unsigned int ipi6_ifindex;  /* send/recv interface index */
 };
+#endif
 
 int iccp_get_port_member_list(struct LocalInterface *lif);
 void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg);
@@ -56,7 +58,13 @@ void iccp_event_handler_obj_input_dellink(struct nl_object *obj, void *arg);
 int iccp_system_init_netlink_socket();
 void iccp_system_dinit_netlink_socket();
 int iccp_init_netlink_event_fd(struct System *sys);
-int iccp_handle_events(struct System *sys);
+int iccp_handle_events(struct System *sys, int timeout);
+void iccp_netlink_sync_again();
+void iccp_netlink_obj_event_handler(int msgtype, struct nl_object *obj);
+int iccp_netlink_replay(char *buf, int len);
+int iccp_netlink_route_sock_event_handler(struct System *sys);
+int iccp_receive_arp_packet_handler(struct System *sys);
+int iccp_receive_ndisc_packet_handler(struct System *sys);
 void update_if_ipmac_on_standby(struct LocalInterface *lif_po, int dir);
 int iccp_sys_local_if_list_get_addr();
 int iccp_netlink_neighbor_request(int family, uint8_t *addr, int add, uint8_t *mac, char *portname, int permanent, int dir);
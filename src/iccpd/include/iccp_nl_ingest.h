@@ -0,0 +1,74 @@
+/*
+ * iccp_nl_ingest.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef ICCP_NL_INGEST_H_
+#define ICCP_NL_INGEST_H_
+
+#include <stdint.h>
+#include <netlink/object.h>
+
+struct System;
+
+#include "../include/iccp_ifm.h"
+
+/* Kernel events are received and decoded on their own thread and handed
+ * to the scheduler thread through a single producer/single consumer ring.
+ * Updates of the same key still waiting in the current batch are merged.
+ */
+#define ICCP_NL_RING_SIZE           8192    /* power of 2 */
+#define ICCP_NL_BATCH_SIZE          256
+#define ICCP_NL_READ_BUDGET         64      /* reads of one socket per wakeup */
+#define ICCP_NL_DRAIN_BUDGET        2048    /* events handled per scheduler pass */
+#define ICCP_PKT_RX_BATCH           32      /* ARP/ND packets per recvmmsg */
+
+typedef enum iccp_nl_event_type_e
+{
+    ICCP_NL_EVENT_NEIGH = 1,        /* RTM_NEWNEIGH/RTM_DELNEIGH */
+    ICCP_NL_EVENT_ARP_REPLY,        /* ARP reply seen on the wire */
+    ICCP_NL_EVENT_ND_REPLY,         /* neighbor advertisement seen on the wire */
+    ICCP_NL_EVENT_OBJ,              /* parsed link or address message */
+} ICCP_NL_EVENT_TYPE_E;
+
+struct iccp_nl_event
+{
+    uint16_t type;
+    uint16_t msgtype;               /* ICCP_NL_EVENT_OBJ, the RTM_ type */
+    union
+    {
+        struct iccp_neigh_info neigh;
+        struct
+        {
+            uint32_t ifindex;
+            uint8_t addr[16];       /* IPv4 in the first 4 bytes for ARP */
+            uint8_t mac[ETHER_ADDR_LEN];
+        } reply;
+        struct nl_object* obj;      /* reference owned by the event */
+    } u;
+};
+
+int iccp_nl_ingest_init(struct System* sys);
+int iccp_nl_ingest_start(struct System* sys);
+void iccp_nl_ingest_stop(struct System* sys);
+void iccp_nl_ingest_add(struct iccp_nl_event* event);
+void iccp_nl_ingest_flush(void);
+void iccp_nl_ingest_resync(void);
+int iccp_nl_ingest_get_fd(struct System* sys);
+int iccp_nl_ingest_event_handler(struct System* sys);
+
+#endif /* ICCP_NL_INGEST_H_ */
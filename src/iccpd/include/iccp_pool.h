@@ -0,0 +1,65 @@
+/*
+ * iccp_pool.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef ICCP_POOL_H_
+#define ICCP_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Fixed size object pools for the message structures that are allocated
+ * and freed at the rate of MAC/ARP churn. Objects are carved from chunks
+ * that are never given back, so a pool stays at its peak size and the
+ * malloc heap is not fragmented by the churn. Not thread safe.
+ */
+#define ICCP_POOL_CHUNK_SIZE    (64 * 1024)
+
+typedef enum iccp_pool_id_e
+{
+    ICCP_POOL_MSG = 0,          /* struct Msg */
+    ICCP_POOL_MAC_MSG,          /* struct MACMsg */
+    ICCP_POOL_ARP_MSG,          /* struct ARPMsg message buffers */
+    ICCP_POOL_NDISC_MSG,        /* struct NDISCMsg message buffers */
+    ICCP_POOL_BUF_128,          /* other message buffers by size */
+    ICCP_POOL_BUF_512,
+    ICCP_POOL_BUF_2K,
+    ICCP_POOL_BUF_8K,
+    ICCP_POOL_LARGE,            /* larger buffers, straight from malloc */
+    ICCP_POOL_MAX
+} ICCP_POOL_ID_E;
+
+typedef struct iccp_pool_stats
+{
+    uint64_t alloc_counter;
+    uint64_t free_counter;
+    uint32_t alloc_fail_counter;
+    uint32_t in_use;
+    uint32_t in_use_max;
+    uint32_t cached;            /* free objects kept for reuse */
+    uint32_t chunks;
+} iccp_pool_stats_t;
+
+void iccp_pool_create(ICCP_POOL_ID_E id, size_t size);
+void* iccp_pool_alloc(ICCP_POOL_ID_E id);
+void* iccp_pool_buf_alloc(size_t len);
+void iccp_pool_free(void* ptr);
+void iccp_pool_get_stats(iccp_pool_stats_t* stats);
+void iccp_pool_finalize(void);
+
+#endif /* ICCP_POOL_H_ */
@@ -0,0 +1,55 @@
+/*
+ * iccp_timer.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef ICCP_TIMER_H_
+#define ICCP_TIMER_H_
+
+#include <stdint.h>
+#include <sys/queue.h>
+
+/* Hierarchical timer wheel, run by the scheduler thread only.
+ * Level 0 has one slot per tick; each upper level slot covers a whole
+ * turn of the level below and is cascaded down when that turn starts.
+ */
+#define ICCP_TIMER_TICK_MSEC        10
+#define ICCP_TIMER_ROOT_BITS        8
+#define ICCP_TIMER_LEVEL_BITS       6
+#define ICCP_TIMER_LEVELS           4   /* root + 3 upper, 2^26 ticks ~ 7.7 days */
+#define ICCP_TIMER_ROOT_SIZE        (1 << ICCP_TIMER_ROOT_BITS)
+#define ICCP_TIMER_LEVEL_SIZE       (1 << ICCP_TIMER_LEVEL_BITS)
+
+struct iccp_timer
+{
+    LIST_ENTRY(iccp_timer) next;
+    uint64_t expire;                /* in ticks */
+    void (*handler)(void* arg);
+    void* arg;
+    int armed;
+};
+
+LIST_HEAD(iccp_timer_list, iccp_timer);
+
+uint64_t iccp_timer_now_msec(void);
+void iccp_timer_init(struct iccp_timer* timer, void (*handler)(void*), void* arg);
+void iccp_timer_start(struct iccp_timer* timer, uint32_t msec);
+void iccp_timer_stop(struct iccp_timer* timer);
+int iccp_timer_next_msec(void);
+void iccp_timer_expire(void);
+
+#endif /* ICCP_TIMER_H_ */
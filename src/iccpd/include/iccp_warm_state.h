@@ -0,0 +1,114 @@
+/*
+ * iccp_warm_state.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef ICCP_WARM_STATE_H_
+#define ICCP_WARM_STATE_H_
+
+#include <stdint.h>
+
+#include "../include/port.h"
+
+struct System;
+struct CSM;
+
+/* State kept across a warm restart. On the way down the MAC table, the
+ * ARP/ND lists and the peer interfaces of every CSM are written to a file;
+ * on the way up the file is mapped and each CSM is filled from it when the
+ * CSM is configured. Entries owned by the peer or by the kernel are marked
+ * until their owner reports them again; whatever is still marked once the
+ * peer has finished its sync is removed the way a delete from the owner
+ * would remove it. MACs learned through mclagsyncd are not marked, the ASIC
+ * keeps its FDB over a warm reboot and ages them out as usual.
+ *
+ * File layout, host byte order, records in the order below:
+ *   struct iccp_warm_state_hdr
+ *   per CSM: struct iccp_warm_state_csm
+ *            struct iccp_warm_state_mac   [num_mac]
+ *            struct ARPMsg                [num_arp]
+ *            struct NDISCMsg              [num_ndisc]
+ *            struct iccp_warm_state_pif   [num_pif], each followed by
+ *                                         num_vlan uint16_t, padded to 4
+ */
+#define ICCP_WARM_STATE_MAGIC           0x49435753      /* "ICWS" */
+#define ICCP_WARM_STATE_VERSION         1
+
+#define ICCP_WARM_STATE_RECONCILE_SEC   180     /* no peer sync after start */
+#define ICCP_WARM_STATE_SETTLE_SEC      30      /* after the peer sync */
+
+struct iccp_warm_state_hdr
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_len;
+    uint32_t total_len;         /* whole file */
+    uint32_t crc;               /* CRC-32 of everything after the header */
+    uint64_t save_time;
+    uint32_t num_csm;
+    uint16_t mac_size;          /* record sizes of this build */
+    uint16_t arp_size;
+    uint16_t ndisc_size;
+    uint16_t pif_size;
+    uint32_t reserved;
+};
+
+struct iccp_warm_state_csm
+{
+    uint32_t mlag_id;
+    uint32_t len;               /* section, this header included */
+    uint32_t num_mac;
+    uint32_t num_arp;
+    uint32_t num_ndisc;
+    uint32_t num_pif;
+};
+
+struct iccp_warm_state_mac
+{
+    uint16_t vid;
+    uint8_t mac_addr[6];
+    uint8_t op_type;
+    uint8_t fdb_type;
+    uint8_t age_flag;
+    uint8_t pending_local_del;
+    uint8_t add_to_syncd;
+    uint8_t reserved[3];
+    char ifname[MAX_L_PORT_NAME];
+    char origin_ifname[MAX_L_PORT_NAME];
+};
+
+struct iccp_warm_state_pif
+{
+    int32_t ifindex;
+    int32_t type;
+    int32_t po_id;
+    uint32_t ipv4_addr;
+    char name[MAX_L_PORT_NAME];
+    uint8_t mac_addr[6];
+    uint8_t state;
+    uint8_t l3_mode;
+    uint8_t is_peer_link;
+    uint8_t po_active;
+    uint16_t num_vlan;
+};
+
+int iccp_warm_state_save(struct System* sys);
+int iccp_warm_state_load(struct System* sys);
+void iccp_warm_state_restore_csm(struct CSM* csm);
+void iccp_warm_state_peer_up(struct CSM* csm);
+
+#endif /* ICCP_WARM_STATE_H_ */
@@ -43,18 +43,67 @@ typedef enum _iccpd_log_level_t
 #define LOGBUF_SIZE 1024
 #define ICCPD_UTILS_SYSLOG    (syslog)
 
+/* Messages are formatted on the calling thread into a ring of its own and
+ * written to syslog by the logger thread. A full ring drops the message and
+ * counts it; NOTICE and lower levels are also limited per tag and second.
+ * The logger thread reports suppressed counts of tags that went quiet.
+ */
+#define LOG_RING_SIZE           512     /* messages per thread, power of 2 */
+#define LOG_RING_MAX            8       /* threads that log */
+#define LOG_RATE_LIMIT          200     /* per tag and second, NOTICE and lower */
+#define LOG_RATE_HASH_SIZE      64      /* power of 2 */
+#define LOG_RATE_PROBE          4       /* slots tried per tag */
+#define LOG_RATE_FLUSH_MSEC     1000
+
+/* Binary trace of FDB events, written by the logger thread to the file
+ * given with -t and decoded with "mclagdctl -t <file>". Independent of
+ * the log level and never rate limited.
+ */
+#define ICCP_FDB_TRACE_MAGIC        0x49434654      /* "ICFT" */
+#define ICCP_FDB_TRACE_VERSION      1
+#define ICCP_FDB_TRACE_IFNAME_LEN   20
+
+typedef enum _iccp_fdb_trace_event_t
+{
+    ICCP_FDB_TRACE_SYNCD    = 1,    /* learned or aged, from mclagsyncd */
+    ICCP_FDB_TRACE_PEER     = 2,    /* received from the peer */
+    ICCP_FDB_TRACE_CHIP     = 3,    /* sent to mclagsyncd */
+} _iccp_fdb_trace_event_t;
+
+struct iccp_fdb_trace_hdr
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_size;
+};
+
+struct iccp_fdb_trace
+{
+    uint64_t time_ns;               /* CLOCK_REALTIME */
+    uint16_t vid;
+    uint8_t mac_addr[6];
+    uint8_t event;
+    uint8_t op_type;                /* MAC_SYNC_ADD or MAC_SYNC_DEL */
+    uint8_t fdb_type;
+    uint8_t reserved;
+    char ifname[ICCP_FDB_TRACE_IFNAME_LEN];
+};
+
 #define ICCPD_LOG_CRITICAL(tag, format, args ...) write_log(CRITICAL_LOG_LEVEL, tag, format, ## args)
 #define ICCPD_LOG_ERR(tag, format, args ...) write_log(ERR_LOG_LEVEL, tag, format, ## args)
 #define ICCPD_LOG_WARN(tag, format, args ...) write_log(WARN_LOG_LEVEL, tag, format, ## args)
 #define ICCPD_LOG_NOTICE(tag, format, args ...) write_log(NOTICE_LOG_LEVEL, tag, format, ## args)
 #define ICCPD_LOG_INFO(tag, format, args ...) write_log(INFO_LOG_LEVEL, tag, format, ## args)
 #define ICCPD_LOG_DEBUG(tag, format, args ...) write_log(DEBUG_LOG_LEVEL, tag, format, ## args)
+#define ICCPD_TRACE_FDB(event, op, type, vid, mac, ifname) \
+    do { if (logger_get_configuration()->fdb_trace_enabled) write_fdb_trace(event, op, type, vid, mac, ifname); } while (0)
 
 struct LoggerConfig
 {
     uint8_t console_log_enabled;
     uint8_t log_level;
     uint8_t init;
+    uint8_t fdb_trace_enabled;
 };
 
 struct LoggerConfig* logger_get_configuration();
@@ -64,6 +113,9 @@ void log_setup(char* progname, char* path);
 void log_finalize();
 void log_init(struct CmdOptionParser* parser);
 void write_log(const int level, const char* tag, const char *format, ...);
+void write_fdb_trace(uint8_t event, uint8_t op_type, uint8_t fdb_type, uint16_t vid,
+                     const uint8_t* mac_addr, const char* ifname);
+uint64_t log_get_dropped(void);
 
 #endif /* LOGGER_H_ */
 
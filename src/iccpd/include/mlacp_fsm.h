@@ -121,6 +121,9 @@ enum ICCP_DBG_CNTR_MSG
     ICCP_DBG_CNTR_MSG_STP_PO_PORT_MAP  = 26,
     ICCP_DBG_CNTR_MSG_STP_AGE_OUT      = 27,
     ICCP_DBG_CNTR_MSG_STP_COMMON_MSG   = 28,
+    ICCP_DBG_CNTR_MSG_CAPABILITY       = 29,
+    ICCP_DBG_CNTR_MSG_MAC_BULK_INFO    = 30,
+    ICCP_DBG_CNTR_MSG_ARP_BULK_INFO    = 31,
     ICCP_DBG_CNTR_MSG_MAX
 };
 typedef enum ICCP_DBG_CNTR_MSG ICCP_DBG_CNTR_MSG_e;
@@ -143,6 +146,11 @@ do{\
         ++MLACP(csm).dbg_counters.iccp_counters[dbg_type][ICCP_DBG_CNTR_DIR_RX][status];\
 }while(0);
 
+/* Buckets of the mLACP ARP & ND tables, power of 2 */
+#define MLACP_NEIGH_HASH_SIZE 16384
+
+LIST_HEAD(neigh_hash_head, Msg);
+
 typedef struct mlacp_dbg_counter_info
 {
     uint64_t iccp_counters[ICCP_DBG_CNTR_MSG_MAX][ICCP_DBG_CNTR_DIR_MAX][ICCP_DBG_CNTR_STS_MAX];
@@ -162,14 +170,18 @@ struct mLACP
     uint8_t system_id[ETHER_ADDR_LEN];
     uint16_t system_priority;
     uint8_t system_config_changed;
+    uint32_t peer_capability;   /* MLACP_PEER_CAP_* both sides support */
+    uint64_t sync_start_msec;   /* stage 1 entered, for the peer sync time */
 
     struct Remote_System remote_system;
     const char* error_msg;
     TAILQ_HEAD(mlacp_msg_list, Msg) mlacp_msg_list;
     TAILQ_HEAD(arp_msg_list, Msg) arp_msg_list;
     TAILQ_HEAD(arp_info_list, Msg) arp_list;
+    struct neigh_hash_head arp_hash[MLACP_NEIGH_HASH_SIZE];     /* arp_list by ipv4_addr */
     TAILQ_HEAD(ndisc_msg_list, Msg) ndisc_msg_list;
     TAILQ_HEAD(ndisc_info_list, Msg) ndisc_list;
+    struct neigh_hash_head ndisc_hash[MLACP_NEIGH_HASH_SIZE];   /* ndisc_list by ipv6_addr */
     TAILQ_HEAD(mac_msg_list, MACMsg) mac_msg_list;
 
     struct mac_rb_tree mac_rb;
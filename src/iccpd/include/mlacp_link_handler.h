@@ -51,6 +51,7 @@ void peerlink_port_isolate_cleanup(struct CSM* csm);
 void update_peerlink_isolate_from_all_csm_lif(struct CSM* csm);
 
 ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t send_len);
+void iccp_flush_fdb_to_syncd(void);
 
 void del_mac_from_chip(struct MACMsg* mac_msg);
 void add_mac_to_chip(struct MACMsg* mac_msg, uint8_t mac_type);
@@ -66,6 +67,7 @@ char *show_ipv6_str(char *ipv6_addr);
 
 void syncd_info_close();
 int iccp_connect_syncd();
+int iccp_syncd_sock_attach(int fd);
 
 void mlacp_link_disable_traffic_distribution(struct LocalInterface *lif);
 void mlacp_link_enable_traffic_distribution(struct LocalInterface *lif);
@@ -81,6 +83,7 @@ void mlacp_mlag_intf_detach_handler(struct CSM* csm, struct LocalInterface* loca
 void mlacp_peer_mlag_intf_delete_handler(struct CSM* csm, char *mlag_if_name);
 
 int iccp_mclagsyncd_msg_handler(struct System *sys);
+int iccp_mclagsyncd_write_handler(struct System *sys);
 int syn_local_neigh_mac_info_to_peer(struct LocalInterface *local_if, int sync_add,
         int is_v4, int is_v6, int sync_mac, int ack, int is_ipv6_ll, int dir);
 int syn_local_mac_info_to_peer(struct CSM* csm, struct LocalInterface *local_if, int sync_add, int is_sag);
@@ -469,6 +469,44 @@ struct mLACPIfUpAckTLV {
     uint16_t        if_id;                   /* LAG: agg_id */
 }__attribute__ ((packed));
 
+/*
+ * NOS: optional features, sent after the System Config TLV.
+ * Peers that do not send it get the original TLVs only. A peer that
+ * does not know the TLV logs it as an unsupported message, once per
+ * sync, and otherwise ignores it.
+ */
+#define MLACP_PEER_CAP_MAC_BULK     0x00000001
+#define MLACP_PEER_CAP_ARP_BULK     0x00000002
+#define MLACP_PEER_CAP_ALL          (MLACP_PEER_CAP_MAC_BULK | MLACP_PEER_CAP_ARP_BULK)
+
+struct mLACPCapabilityTLV
+{
+    ICCParameter    icc_parameter;
+    uint32_t        flags;                   /* MLACP_PEER_CAP_* */
+} __attribute__ ((packed));
+
+/*
+ * NOS: bulk MAC/ARP information
+ * data[] starts with num_of_ifname interface names, each a length byte
+ * followed by the name, then the entries. MAC entries are sorted by
+ * VLAN and MAC:
+ *   op_type, mac_type, ifname index, VLAN delta, MAC delta
+ * where the MAC delta is the full MAC when the VLAN changed. ARP
+ * entries are sorted by address:
+ *   op_type, flag, ifname index, IPv4 delta, MAC
+ * Deltas are unsigned LEB128 and relative to the previous entry.
+ */
+struct mLACPBulkInfoTLV
+{
+    ICCParameter    icc_parameter;
+    uint16_t        num_of_entry;
+    uint8_t         num_of_ifname;
+    uint8_t         reserved;
+    uint8_t         data[0];
+} __attribute__ ((packed));
+
+#define MLACP_BULK_MAX_IFNAME       255
+
 enum NEIGH_OP_TYPE
 {
     NEIGH_SYNC_LIF = 0,
@@ -525,6 +563,7 @@ struct MACMsg
     uint8_t age_flag;/*local or peer is age?*/
     uint8_t pending_local_del;
     uint8_t add_to_syncd;
+    uint8_t restored;   /*from the warm restart state, not sent by peer yet*/
 
     TAILQ_ENTRY(MACMsg) tail;     // entry into mac_msg_list
 };
@@ -105,6 +105,9 @@
 #define TLV_T_MLACP_WARMBOOT_FLAG       0x1039
 #define TLV_T_MLACP_NDISC_INFO          0x103A
 #define TLV_T_MLACP_IF_UP_ACK           0x103B
+#define TLV_T_MLACP_CAPABILITY          0x103C
+#define TLV_T_MLACP_MAC_BULK_INFO       0x103D
+#define TLV_T_MLACP_ARP_BULK_INFO       0x103E
 #define TLV_T_MLACP_LIST_END            0x104a //list end
 
 /* Debug */
@@ -187,6 +190,15 @@ static char* get_tlv_type_string(int type)
 
         case TLV_T_MLACP_IF_UP_ACK:
             return "TLV_T_MLACP_IF_UP_ACK";
+
+        case TLV_T_MLACP_CAPABILITY:
+            return "TLV_T_MLACP_CAPABILITY";
+
+        case TLV_T_MLACP_MAC_BULK_INFO:
+            return "TLV_T_MLACP_MAC_BULK_INFO";
+
+        case TLV_T_MLACP_ARP_BULK_INFO:
+            return "TLV_T_MLACP_ARP_BULK_INFO";
     }
 
     return "UNKNOWN";
@@ -440,7 +452,8 @@ typedef enum mclag_syncd_msg_type_e_
     MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_DOMAIN       = 2,
     MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_IFACE        = 3,
     MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES       = 4,
-    MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_UNIQUE_IP    = 5
+    MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_UNIQUE_IP    = 5,
+    MCLAG_SYNCD_MSG_TYPE_CAPABILITY             = 6
 }mclag_syncd_msg_type_e;
 
 typedef enum mclag_msg_type_e_
@@ -460,7 +473,8 @@ typedef enum mclag_msg_type_e_
     MCLAG_MSG_TYPE_SET_REMOTE_IF_STATE      = 12,
     MCLAG_MSG_TYPE_DEL_REMOTE_IF_INFO       = 13,
     MCLAG_MSG_TYPE_SET_PEER_LINK_ISOLATION  = 14,
-    MCLAG_MSG_TYPE_SET_ICCP_PEER_SYSTEM_ID  = 15
+    MCLAG_MSG_TYPE_SET_ICCP_PEER_SYSTEM_ID  = 15,
+    MCLAG_MSG_TYPE_SET_FDB_BULK             = 16
 }mclag_msg_type_e;
 
 
@@ -528,6 +542,20 @@ struct mclag_fdb_info
     short op_type; /*add or del*/
 };
 
+/*
+ * Capabilities of mclagsyncd, MCLAG_SYNCD_MSG_TYPE_CAPABILITY
+ *
+ * iccpd sends one MCLAG_MSG_TYPE_SET_FDB per entry until mclagsyncd
+ * sends this message after it connects. The mclagsyncd of sonic-swss
+ * has to send MCLAG_SYNCD_CAP_FDB_BULK for the bulk path to be used.
+ */
+#define MCLAG_SYNCD_CAP_FDB_BULK    0x1 /* takes MCLAG_MSG_TYPE_SET_FDB_BULK */
+
+struct mclag_syncd_capability_info
+{
+    uint32_t flags;
+};
+
 struct mclag_domain_cfg_info
 {
     int op_type;/*add/del domain; add/del mclag domain */
@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
 #include <sys/queue.h>
 
@@ -59,6 +60,11 @@
 #define IF_T_VXLAN          3
 #define IF_T_BRIDGE         4
 
+/* Buckets of the system local interface indexes, power of 2 */
+#define LIF_NAME_HASH_SIZE      4096
+#define LIF_IFINDEX_HASH_SIZE   4096
+#define LIF_PO_ID_HASH_SIZE     256
+
 typedef struct
 {
     char *ifname;
@@ -77,32 +83,121 @@ struct Unq_ip_If_info
     LIST_ENTRY(Unq_ip_If_info) if_next;
 };
 
-struct VLAN_ID
+/* VLAN membership of an interface, one bit per VLAN ID. The helpers work
+ * a 64 bit word at a time in plain loops the compiler can vectorize.
+ * IDs of VLAN_ID_MAX and above are never members; callers reject them.
+ */
+#define VLAN_ID_MAX             4096
+#define VLAN_BITMAP_WORDS       (VLAN_ID_MAX / 64)
+
+struct vlan_bitmap
 {
-    uint16_t vid;
-    uint16_t vlan_removed;
-    struct LocalInterface* vlan_itf; /* loacl vlan interface */
-    RB_ENTRY(VLAN_ID) vlan_entry;
+    uint64_t bits[VLAN_BITMAP_WORDS];
 };
 
-RB_HEAD(vlan_rb_tree, VLAN_ID);
-RB_PROTOTYPE(vlan_rb_tree, VLAN_ID, vlan_rb_tree, vlan_node_compare);
+static inline void vlan_bitmap_zero(struct vlan_bitmap* bm)
+{
+    memset(bm, 0, sizeof(struct vlan_bitmap));
+}
+
+static inline void vlan_bitmap_set(struct vlan_bitmap* bm, uint16_t vid)
+{
+    if (vid < VLAN_ID_MAX)
+        bm->bits[vid >> 6] |= 1ULL << (vid & 63);
+}
+
+static inline void vlan_bitmap_clear(struct vlan_bitmap* bm, uint16_t vid)
+{
+    if (vid < VLAN_ID_MAX)
+        bm->bits[vid >> 6] &= ~(1ULL << (vid & 63));
+}
+
+static inline int vlan_bitmap_test(const struct vlan_bitmap* bm, uint16_t vid)
+{
+    return vid < VLAN_ID_MAX && ((bm->bits[vid >> 6] >> (vid & 63)) & 1);
+}
+
+static inline int vlan_bitmap_empty(const struct vlan_bitmap* bm)
+{
+    uint64_t any = 0;
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+        any |= bm->bits[i];
+
+    return any == 0;
+}
+
+static inline int vlan_bitmap_equal(const struct vlan_bitmap* a, const struct vlan_bitmap* b)
+{
+    uint64_t diff = 0;
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+        diff |= a->bits[i] ^ b->bits[i];
+
+    return diff == 0;
+}
+
+static inline unsigned int vlan_bitmap_count(const struct vlan_bitmap* bm)
+{
+    unsigned int count = 0;
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+        count += __builtin_popcountll(bm->bits[i]);
+
+    return count;
+}
+
+/* dst = a & b */
+static inline void vlan_bitmap_and(struct vlan_bitmap* dst, const struct vlan_bitmap* a, const struct vlan_bitmap* b)
+{
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+        dst->bits[i] = a->bits[i] & b->bits[i];
+}
+
+/* dst = a & ~b, the VLANs of a missing from b */
+static inline void vlan_bitmap_andnot(struct vlan_bitmap* dst, const struct vlan_bitmap* a, const struct vlan_bitmap* b)
+{
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+        dst->bits[i] = a->bits[i] & ~b->bits[i];
+}
+
+/* First VLAN ID set at or above vid, VLAN_ID_MAX if there is none */
+static inline int vlan_bitmap_next(const struct vlan_bitmap* bm, int vid)
+{
+    int i = vid >> 6;
+    uint64_t word;
+
+    if (vid >= VLAN_ID_MAX)
+        return VLAN_ID_MAX;
+
+    word = bm->bits[i] & (~0ULL << (vid & 63));
+    while (!word)
+    {
+        if (++i >= VLAN_BITMAP_WORDS)
+            return VLAN_ID_MAX;
+        word = bm->bits[i];
+    }
+
+    return (i << 6) + __builtin_ctzll(word);
+}
+
+#define VLAN_BITMAP_FOREACH(vid, bm) \
+    for ((vid) = vlan_bitmap_next((bm), 0); (vid) < VLAN_ID_MAX; (vid) = vlan_bitmap_next((bm), (vid) + 1))
 
 struct PendingVlanMbrIf
 {
     char name[MAX_L_PORT_NAME];
-    struct vlan_rb_tree vlan_tree;
+    struct vlan_bitmap vlan_bitmap;
     LIST_ENTRY(PendingVlanMbrIf) if_next;
 };
 
-#define VLAN_RB_REMOVE(name, head, elm) do {  \
-    RB_REMOVE(name, head, elm);              \
-    (elm)->vlan_entry.rbt_parent = NULL;   \
-    (elm)->vlan_entry.rbt_left = NULL;     \
-    (elm)->vlan_entry.rbt_right = NULL;    \
-} while (0)
-
-
 struct PeerInterface
 {
     int ifindex;
@@ -117,11 +212,13 @@ struct PeerInterface
     uint8_t is_peer_link;
     int po_id;
     uint8_t po_active;
+    uint8_t restored;   /* from the warm restart state, not sent by peer yet */
 
     struct CSM* csm;
 
     LIST_ENTRY(PeerInterface) mlacp_next;
-    struct vlan_rb_tree vlan_tree;
+    struct vlan_bitmap vlan_bitmap;
+    struct vlan_bitmap vlan_removed;    /* not in the last VLAN list from the peer */
 };
 
 struct LocalInterface
@@ -161,18 +258,25 @@ struct LocalInterface
     uint32_t vlan_count;
     uint32_t master_ifindex;   /* VRF ifindex*/
 
-    struct vlan_rb_tree vlan_tree;
+    struct vlan_bitmap vlan_bitmap;
 
     LIST_ENTRY(LocalInterface) system_next;
+    LIST_ENTRY(LocalInterface) system_name_next;    /* sys->lif_name_hash */
+    LIST_ENTRY(LocalInterface) system_ifindex_next; /* sys->lif_ifindex_hash */
+    LIST_ENTRY(LocalInterface) system_po_id_next;   /* sys->lif_po_id_hash, port channel only */
     LIST_ENTRY(LocalInterface) system_purge_next;
     LIST_ENTRY(LocalInterface) mlacp_next;
     LIST_ENTRY(LocalInterface) mlacp_purge_next;
 };
 
+LIST_HEAD(lif_hash_head, LocalInterface);
+
 struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint8_t state);
 struct LocalInterface* local_if_find_by_name(const char* ifname);
 struct LocalInterface* local_if_find_by_ifindex(int ifindex);
 struct LocalInterface* local_if_find_by_po_id(int po_id);
+void local_if_set_ifindex(struct LocalInterface* local_if, int ifindex);
+void local_if_index_del(struct LocalInterface* local_if);
 
 void local_if_destroy(char *ifname);
 void local_if_change_flag_clear(void);
@@ -180,6 +284,7 @@ void local_if_purge_clear(void);
 int local_if_is_l3_mode(struct LocalInterface* local_if);
 
 void local_if_init(struct LocalInterface*);
+struct LocalInterface* local_if_vlan_itf(uint16_t vid);
 void local_if_finalize(struct LocalInterface*);
 
 struct PeerInterface* peer_if_create(struct CSM* csm, int peer_if_number, int type);
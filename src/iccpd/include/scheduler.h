@@ -26,6 +26,7 @@
 
 #include <errno.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/queue.h>
@@ -43,6 +44,21 @@ struct System;
 #define TRANSIT_INTERVAL_SEC        1
 #define EPOLL_TIMEOUT_MSEC          100
 
+/* Output queue of a non-blocking socket, drained on EPOLLOUT */
+#define SOCK_TX_QUEUE_MIN_SIZE      (64 * 1024)
+#define SOCK_TX_QUEUE_MAX_SIZE      (32 * 1024 * 1024)
+
+struct sock_tx_queue
+{
+    char* buf;
+    size_t size;        /* bytes allocated */
+    size_t head;        /* first byte not yet sent */
+    size_t tail;        /* end of the queued bytes */
+    int pollout;        /* EPOLLOUT is registered for the socket */
+    uint32_t* depth;    /* debug counters, shared by queues of one kind */
+    uint32_t* hwm;
+};
+
 int scheduler_prepare_session(struct CSM*);
 int scheduler_check_csm_config(struct CSM*);
 int scheduler_unregister_sock_read_event_callback(struct CSM*);
@@ -50,12 +66,23 @@ void scheduler_session_disconnect_handler(struct CSM*);
 void scheduler_init();
 void scheduler_finalize();
 void scheduler_loop();
+void scheduler_loop_once(int max_timeout);
 void scheduler_start();
 void scheduler_server_sock_init();
 int scheduler_csm_read_callback(struct CSM* csm);
+int scheduler_csm_sock_attach(struct CSM* csm, int fd);
 int iccp_get_server_sock_fd();
 int scheduler_server_accept();
 int iccp_receive_signal_handler(struct System* sys);
 void scheduler_csm_socket_cleanup(struct CSM* csm, int location);
+void scheduler_csm_timer_init(struct CSM* csm);
+void scheduler_csm_timer_stop(struct CSM* csm);
+void scheduler_csm_heartbeat_restart(struct CSM* csm);
+void scheduler_csm_set_pending_all(struct System* sys);
+int scheduler_csm_write_callback(struct CSM* csm);
+void scheduler_sock_tx_queue_init(struct sock_tx_queue* q, uint32_t* depth, uint32_t* hwm);
+void scheduler_sock_tx_queue_free(struct sock_tx_queue* q);
+ssize_t scheduler_sock_send(int fd, struct sock_tx_queue* q, const char* buf, size_t len);
+int scheduler_sock_flush(int fd, struct sock_tx_queue* q);
 
 #endif /* SCHEDULER_H_ */
@@ -37,6 +37,8 @@
 #include <linux/netlink.h>
 
 #include "../include/port.h"
+#include "../include/scheduler.h"
+#include "../include/iccp_pool.h"
 
 #define FRONT_PANEL_PORT_PREFIX "Ethernet"
 #define PORTCHANNEL_PREFIX      "PortChannel"
@@ -104,6 +106,7 @@ enum SYNCD_TX_DBG_CNTR_MSG_e
     SYNCD_TX_DBG_CNTR_MSG_DEL_REMOTE_IF_INFO         = 12,
     SYNCD_TX_DBG_CNTR_MSG_PEER_LINK_ISOLATION        = 13,
     SYNCD_TX_DBG_CNTR_MSG_SET_ICCP_PEER_SYSTEM_ID    = 14,
+    SYNCD_TX_DBG_CNTR_MSG_SET_FDB_BULK               = 15,
     SYNCD_TX_DBG_CNTR_MSG_MAX
 };
 
@@ -115,6 +118,7 @@ enum SYNCD_RX_DBG_CNTR_MSG_e
     SYNCD_RX_DBG_CNTR_MSG_CFG_MCLAG_IFACE  = 2,
     SYNCD_RX_DBG_CNTR_MSG_CFG_MCLAG_UNIQUE_IP = 3,
     SYNCD_RX_DBG_CNTR_MSG_VLAN_MBR_UPDATES = 4,
+    SYNCD_RX_DBG_CNTR_MSG_CAPABILITY = 5,
     SYNCD_RX_DBG_CNTR_MSG_MAX
 };
 
@@ -194,14 +198,6 @@ do{\
     if (sys)\
         ++sys->dbg_counters.rx_retry_fail_counter;
 
-#define SYSTEM_INCR_MAC_ENTRY_ALLOC_COUNTER(sys)\
-    if (sys)\
-        ++sys->dbg_counters.mac_entry_alloc_counter;
-
-#define SYSTEM_INCR_MAC_ENTRY_FREE_COUNTER(sys)\
-    if (sys)\
-        ++sys->dbg_counters.mac_entry_free_counter;
-
 #define SYSTEM_INCR_RX_READ_SOCK_ZERO_COUNTER(sys)\
     if (sys)\
         ++sys->dbg_counters.rx_read_sock_zero_len_counter;
@@ -225,6 +221,14 @@ do{\
             sys->dbg_counters.rx_retry_max_counter = num_retry;\
     }
 
+#define SYSTEM_INCR_TX_QUEUE_FULL_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.tx_queue_full_counter;
+
+#define SYSTEM_INCR_RX_PEER_PARTIAL_MSG_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.rx_peer_partial_msg_counter;
+
 #define SYSTEM_INCR_NETLINK_UNKNOWN_IF_NAME(ifname)\
 do {\
     struct System *sys;\
@@ -247,6 +251,15 @@ do {\
         ++sys->dbg_counters.rx_error_count;\
 }while(0)
 
+/* Batched receive of ARP/ND packets, one batch per recvmmsg call */
+struct iccp_pkt_rx_stats
+{
+    uint64_t pkt_counter;
+    uint32_t batch_counter;
+    uint32_t batch_full_counter;   //batches that filled the receive ring
+    uint32_t batch_max;
+};
+
 typedef struct system_dbg_counter_info
 {
     /* Netlink message counters */
@@ -266,6 +279,15 @@ typedef struct system_dbg_counter_info
     uint32_t newmac_count;
     uint32_t delmac_count;
 
+    /* Netlink ingestion thread to scheduler handoff */
+    uint32_t nl_event_coalesce_counter; //updates merged before handoff
+    uint32_t nl_event_overflow_counter; //events dropped on a full ring, resynced
+    uint32_t nl_event_ring_hwm;         //most events waiting in the ring
+
+    /* ARP reply and neighbor advertisement packets */
+    struct iccp_pkt_rx_stats arp_rx_stats;
+    struct iccp_pkt_rx_stats ndisc_rx_stats;
+
     uint32_t session_down_counter;    //not counting down due to warmboot
     uint32_t peer_link_down_counter;
     uint32_t warmboot_counter;
@@ -285,9 +307,29 @@ typedef struct system_dbg_counter_info
     uint32_t rx_read_stp_sock_zero_len_counter; //counts socket header read zero length from syncd
     uint32_t rx_read_stp_sock_err_counter; //counts socket header read zero length from syncd
 
-    uint32_t mac_entry_alloc_counter;
+    uint32_t mac_entry_alloc_counter;  //from the MACMsg pool, filled on dump
     uint32_t mac_entry_free_counter;
 
+    /* FDB entries sent to MclagSyncd in MCLAG_MSG_TYPE_SET_FDB_BULK */
+    uint64_t fdb_bulk_entry_counter;
+    uint32_t fdb_bulk_entry_max;       //most entries in one message
+
+    /* Bytes waiting in the output queues of the peer and MclagSyncd sockets */
+    uint32_t peer_tx_queue_depth;
+    uint32_t peer_tx_queue_hwm;        //highest depth seen
+    uint32_t syncd_tx_queue_depth;
+    uint32_t syncd_tx_queue_hwm;
+    uint32_t tx_queue_full_counter;    //messages dropped on a full output queue
+    uint32_t rx_peer_partial_msg_counter; //peer reads that ended inside a message
+
+    /* Syncs with the peer, from mLACP stage 1 until the exchange state */
+    uint32_t peer_sync_counter;
+    uint32_t peer_sync_last_msec;
+    uint32_t peer_sync_max_msec;
+
+    /* Message pools, filled on dump */
+    iccp_pool_stats_t pool_stats[ICCP_POOL_MAX];
+
     uint64_t syncd_tx_counters[SYNCD_TX_DBG_CNTR_MSG_MAX][SYNCD_DBG_CNTR_STS_MAX];
     uint64_t syncd_rx_counters[SYNCD_RX_DBG_CNTR_MSG_MAX][SYNCD_DBG_CNTR_STS_MAX];
 }system_dbg_counter_info_t;
@@ -296,6 +338,7 @@ struct System
 {
     int server_fd;/* Peer-Link Socket*/
     int sync_fd;
+    struct sock_tx_queue sync_tx_queue;
     int sync_ctrl_fd;
     int arp_receive_fd;
     int ndisc_receive_fd;
@@ -308,6 +351,7 @@ struct System
     int route_sock_seq;
     struct nl_sock * genric_event_sock;
     struct nl_sock * route_event_sock;
+    int nl_event_fd;    /* events waiting from the ingestion thread */
 
     int sig_pipe_r;
     int sig_pipe_w;
@@ -317,6 +361,11 @@ struct System
     /* Info List*/
     LIST_HEAD(csm_list, CSM) csm_list;
     LIST_HEAD(lif_all_list, LocalInterface) lif_list;
+    /* Indexes of lif_list */
+    struct lif_hash_head lif_name_hash[LIF_NAME_HASH_SIZE];
+    struct lif_hash_head lif_ifindex_hash[LIF_IFINDEX_HASH_SIZE];
+    struct lif_hash_head lif_po_id_hash[LIF_PO_ID_HASH_SIZE];
+    struct LocalInterface* vlan_itf[VLAN_ID_MAX];  /* VlanN interface by VLAN ID */
     LIST_HEAD(lif_purge_all_list, LocalInterface) lif_purge_list;
     LIST_HEAD(unq_ip_all_if_list, Unq_ip_If_info) unq_ip_if_list;
     LIST_HEAD(pending_vlan_mbr_if_list, PendingVlanMbrIf) pending_vlan_mbr_if_list;
@@ -326,6 +375,7 @@ struct System
     char* cmd_file_path;
     char* config_file_path;
     char* mclagdctl_file_path;
+    char* warm_state_file_path;
     int pid_file_fd;
     int telnet_port;
     fd_set readfd; /*record socket need to listen*/
@@ -333,6 +383,8 @@ struct System
     time_t csm_trans_time;
     int need_sync_team_again;
     int need_sync_netlink_again;
+    int need_sync_neigh_again;
+    uint32_t syncd_capability;  /* MCLAG_SYNCD_CAP_*, announced by mclagsyncd */
 
     /* ICCDd/MclagSyncd debug counters */
     system_dbg_counter_info_t dbg_counters;
@@ -133,6 +133,7 @@ void cmd_option_parser_init(struct CmdOptionParser* parser)
     cmd_option_register(parser, "-l <LOG_FILE_PATH>", "Set log file path.\n(Default: /var/log/iccpd.log)");
     cmd_option_register(parser, "-p <TCP_PORT>", "Set the port used for telnet listening port.\n(Default: 2015)");
     cmd_option_register(parser, "-c", "Dump log message to console. (Default: No)");
+    cmd_option_register(parser, "-t <TRACE_FILE_PATH>", "Write a binary trace of FDB events.\n(Default: No)");
     cmd_option_register(parser, "-h", "Show the usage.");
 }
 
@@ -254,6 +255,8 @@ int cmd_option_parser_parse(struct CmdOptionParser* parser, int argc, char* argv
             if (num > 0 && num < 65535)
                 parser->telnet_port = num;
         }
+        else if (strncmp(opt_name, "-t", 2) == 0)
+            parser->fdb_trace_file_path = val;
         else if (strncmp(opt_name, "-c", 2) == 0)
             parser->console_log = 1;
         else
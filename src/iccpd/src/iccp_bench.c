@@ -0,0 +1,1372 @@
+/*
+ * iccp_bench.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+/* Offline scale and convergence benchmark of iccpd.
+ *
+ * The iccpd code runs single threaded in this process. The ICCP peer and
+ * mclagsyncd are played by stand-ins on socketpairs, the kernel by netlink
+ * messages built here or replayed from a file (a pcap of an nlmon device
+ * or plain netlink messages). For every MAC scale a child process does:
+ *
+ *   1. replay the topology: peer-link, MLAG port-channels and VLANs
+ *   2. mclagsyncd configures the domain, MLAG interfaces and VLAN members
+ *   3. ICCP session up until mLACP reaches the exchange state
+ *   4. the peer sends N MACs until mclagsyncd got N FDB adds, in bulk
+ *      messages only if mclagsyncd sent its capability (-S), else in one
+ *      message per MAC
+ *   5. mclagsyncd learns N MACs until the peer got N MAC entries
+ *   6. the peer-link goes down and the session is lost, until mclagsyncd
+ *      is asked to isolate ports
+ *
+ * and prints one row with the phase times, CPU time of iccpd without the
+ * stand-ins and the memory used. The exit code is not zero if a phase
+ * did not converge in time.
+ *
+ * With -L the topology alone is replayed, by default with 4000 VLANs,
+ * and the local interface lookups by name, ifindex and port-channel id
+ * are timed instead: "unshare -n iccpd_bench -L 1000".
+ *
+ * iccpd runs shell commands on some events, run it in its own network
+ * namespace: "unshare -n iccpd_bench -n 10000,100000". The team module
+ * must be loaded, iccpd waits for its generic netlink family.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <byteswap.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+
+#include <linux/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/iccp_csm.h"
+#include "../include/iccp_netlink.h"
+#include "../include/iccp_nl_ingest.h"
+#include "../include/msg_format.h"
+#include "../include/mlacp_fsm.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/mlacp_sync_prepare.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/port.h"
+#include "../include/scheduler.h"
+
+#define BENCH_MAX_SCALES            16
+#define BENCH_MAX_PO                64
+#define BENCH_DOMAIN_ID             1
+#define BENCH_LOCAL_IP              "10.0.0.1"
+#define BENCH_PEER_IP               "10.0.0.2"
+#define BENCH_PEER_LINK             "PortChannel100"
+#define BENCH_PEER_LINK_IFINDEX     900
+#define BENCH_PO_IFINDEX_BASE       1000
+#define BENCH_VLAN_BASE             2
+#define BENCH_LOOKUP_VLANS          4000
+#define BENCH_VLAN_IFINDEX_BASE     5000
+#define BENCH_TX_LOW_WATER          (256 * 1024)    /* stand-ins generate MACs below */
+#define BENCH_MAC_ENTRY_NUM         30              /* MAC info TLV entries, as iccpd sends */
+#define BENCH_MAC_BULK_NUM          1024
+#define BENCH_HEARTBEAT_MSEC        1000
+
+#define BENCH_DIR_PEER              1
+#define BENCH_DIR_SYNCD             2
+
+#define BENCH_PCAP_MAGIC            0xa1b2c3d4
+#define BENCH_PCAP_MAGIC_NSEC       0xa1b23c4d
+#define BENCH_PCAP_HDR_LEN          24
+#define BENCH_PCAP_REC_LEN          16
+#define BENCH_LINKTYPE_NETLINK      253
+#define BENCH_NETLINK_COOKED_LEN    16
+
+struct bench_opts
+{
+    int scales[BENCH_MAX_SCALES];
+    int num_scales;
+    int num_po;
+    int num_vlan;
+    int peer_bulk;
+    int syncd_bulk;
+    int timeout;
+    int log_level;
+    int lookup_rounds;
+    char* replay_buf;
+    int replay_len;
+};
+
+/* One end of a socketpair with what is not sent or handled yet */
+struct bench_conn
+{
+    int fd;
+    char* tx;
+    size_t tx_head;
+    size_t tx_tail;
+    size_t tx_size;
+    char* rx;
+    size_t rx_len;
+    size_t rx_size;
+};
+
+struct bench
+{
+    struct bench_opts* opts;
+    int num_mac;
+    int mac_per_vlan;
+
+    struct bench_conn peer;
+    struct bench_conn syncd;
+
+    /* the ICCP peer */
+    struct CSM* csm;
+    struct CSM* peer_csm;
+    struct LocalInterface* peer_po;
+    int peer_closed;
+    int peer_sync_req_sent;
+    int peer_mac_next;
+    int peer_mac_end;
+    long peer_mac_rx;
+    long peer_heartbeat_ms;
+
+    /* mclagsyncd */
+    int syncd_mac_next;
+    int syncd_mac_end;
+    long syncd_fdb_add;
+    long syncd_fdb_msgs;
+    long syncd_fdb_bulk_msgs;
+    long syncd_fdb_entries;
+    long syncd_isolate;
+
+    struct timespec standin_cpu;
+    struct MACMsg mac_chunk[BENCH_MAC_BULK_NUM];
+    struct MACMsg* mac_ptr[BENCH_MAC_BULK_NUM];
+};
+
+struct bench_result
+{
+    long handshake_ms;
+    long remote_ms;
+    long local_ms;
+    long isolate_ms;
+    double fdb_per_msg;
+    double cpu_s;
+    long rss_kb;
+    long maxrss_kb;
+};
+
+static char g_bench_buf[CSM_BUFFER_SIZE];
+
+static long bench_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void bench_usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-n macs[,macs...]] [-p port-channels] [-v vlans] [-B] [-S]\n"
+            "          [-L rounds] [-r netlink-file] [-t timeout] [-l log-level]\n"
+            "  -n  MAC scales, one run each (default 10000,100000,500000)\n"
+            "  -p  MLAG port-channels (default 8, at most %d)\n"
+            "  -v  VLANs (default 64)\n"
+            "  -B  peer sends MAC bulk TLVs\n"
+            "  -S  mclagsyncd takes FDB bulk messages\n"
+            "  -L  time interface lookups instead, rounds over all interfaces\n"
+            "      (default %d VLANs then)\n"
+            "  -r  netlink messages replayed after the topology, pcap from an\n"
+            "      nlmon device or plain messages\n"
+            "  -t  seconds a phase may take (default 600)\n"
+            "  -l  iccpd log level, 0 critical .. 5 debug\n",
+            prog, BENCH_MAX_PO, BENCH_LOOKUP_VLANS);
+}
+
+/*****************************************
+* Socketpair ends
+*
+* ***************************************/
+static int bench_conn_init(struct bench_conn* conn, int fd)
+{
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = fd;
+
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static int bench_conn_grow(char** buf, size_t* size, size_t need)
+{
+    size_t new_size = *size ? *size : 65536;
+    char* new_buf;
+
+    while (new_size < need)
+        new_size *= 2;
+    if (new_size == *size)
+        return 0;
+
+    if ((new_buf = realloc(*buf, new_size)) == NULL)
+        return MCLAG_ERROR;
+    *buf = new_buf;
+    *size = new_size;
+
+    return 0;
+}
+
+static size_t bench_conn_pending(struct bench_conn* conn)
+{
+    return conn->tx_tail - conn->tx_head;
+}
+
+static void bench_conn_queue(struct bench_conn* conn, const char* buf, size_t len)
+{
+    if (conn->tx_head > 0 && conn->tx_tail + len > conn->tx_size)
+    {
+        memmove(conn->tx, conn->tx + conn->tx_head, conn->tx_tail - conn->tx_head);
+        conn->tx_tail -= conn->tx_head;
+        conn->tx_head = 0;
+    }
+
+    if (bench_conn_grow(&conn->tx, &conn->tx_size, conn->tx_tail + len) < 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(conn->tx + conn->tx_tail, buf, len);
+    conn->tx_tail += len;
+
+    return;
+}
+
+static void bench_conn_flush(struct bench_conn* conn)
+{
+    ssize_t rc;
+
+    while (conn->tx_head < conn->tx_tail)
+    {
+        rc = send(conn->fd, conn->tx + conn->tx_head, conn->tx_tail - conn->tx_head, MSG_NOSIGNAL);
+        if (rc <= 0)
+            break;
+        conn->tx_head += rc;
+    }
+
+    return;
+}
+
+/* Read what iccpd sent, -1 once it closed the socket */
+static int bench_conn_read(struct bench_conn* conn)
+{
+    ssize_t rc;
+
+    while (1)
+    {
+        if (bench_conn_grow(&conn->rx, &conn->rx_size, conn->rx_len + 65536) < 0)
+            return MCLAG_ERROR;
+
+        rc = recv(conn->fd, conn->rx + conn->rx_len, conn->rx_size - conn->rx_len, 0);
+        if (rc == 0)
+            return MCLAG_ERROR;
+        if (rc < 0)
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : MCLAG_ERROR;
+        conn->rx_len += rc;
+    }
+}
+
+static void bench_conn_consume(struct bench_conn* conn, size_t len)
+{
+    conn->rx_len -= len;
+    memmove(conn->rx, conn->rx + len, conn->rx_len);
+
+    return;
+}
+
+/* name holds MAX_L_PORT_NAME */
+static void bench_po_name(char* name, int po_id)
+{
+    snprintf(name, MAX_L_PORT_NAME, "%s%u", PORTCHANNEL_PREFIX, (uint8_t)po_id);
+
+    return;
+}
+
+/*****************************************
+* Generated MACs
+*
+* ***************************************/
+static void bench_mac_addr(int index, int dir, uint8_t* mac_addr)
+{
+    mac_addr[0] = 0x02;
+    mac_addr[1] = dir;
+    mac_addr[2] = (index >> 24) & 0xff;
+    mac_addr[3] = (index >> 16) & 0xff;
+    mac_addr[4] = (index >> 8) & 0xff;
+    mac_addr[5] = index & 0xff;
+
+    return;
+}
+
+/* MACs are ordered by VLAN and address, as bulk TLVs want them */
+static void bench_mac_fill(struct bench* b, struct MACMsg* mac_msg, int index, int dir)
+{
+    memset(mac_msg, 0, sizeof(*mac_msg));
+    mac_msg->op_type = MAC_SYNC_ADD;
+    mac_msg->fdb_type = MAC_TYPE_DYNAMIC;
+    mac_msg->vid = BENCH_VLAN_BASE + index / b->mac_per_vlan;
+    bench_mac_addr(index, dir, mac_msg->mac_addr);
+    bench_po_name(mac_msg->ifname, 1 + index % b->opts->num_po);
+    memcpy(mac_msg->origin_ifname, mac_msg->ifname, MAX_L_PORT_NAME);
+
+    return;
+}
+
+/*****************************************
+* Kernel stand-in
+*
+* ***************************************/
+static int bench_nl_attr(char* buf, int len, int type, const void* data, int data_len)
+{
+    struct rtattr* rta = (struct rtattr*)(buf + NLMSG_ALIGN(len));
+
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(data_len);
+    memcpy(RTA_DATA(rta), data, data_len);
+
+    return NLMSG_ALIGN(len) + RTA_ALIGN(rta->rta_len);
+}
+
+/* RTM_NEWLINK as the kernel sends it on a link change */
+static int bench_nl_link(char* buf, int ifindex, const char* name, int up)
+{
+    struct nlmsghdr* nlh = (struct nlmsghdr*)buf;
+    struct ifinfomsg* ifi = NLMSG_DATA(nlh);
+    uint8_t operstate = up ? IF_OPER_UP : IF_OPER_DOWN;
+    uint8_t mac_addr[ETHER_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, (ifindex >> 8) & 0xff, ifindex & 0xff };
+    int len;
+
+    memset(buf, 0, NLMSG_SPACE(sizeof(*ifi)));
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_index = ifindex;
+    ifi->ifi_flags = IFF_UP | (up ? (IFF_RUNNING | IFF_LOWER_UP) : 0);
+    ifi->ifi_change = 0xffffffff;
+
+    len = NLMSG_LENGTH(sizeof(*ifi));
+    len = bench_nl_attr(buf, len, IFLA_IFNAME, name, strlen(name) + 1);
+    len = bench_nl_attr(buf, len, IFLA_OPERSTATE, &operstate, sizeof(operstate));
+    len = bench_nl_attr(buf, len, IFLA_ADDRESS, mac_addr, ETHER_ADDR_LEN);
+
+    nlh->nlmsg_len = len;
+    nlh->nlmsg_type = RTM_NEWLINK;
+
+    return NLMSG_ALIGN(len);
+}
+
+static void bench_step(struct bench* b);
+
+/* Hand netlink messages to iccpd in batches its event ring takes */
+static void bench_nl_replay(struct bench* b, char* buf, int len)
+{
+    struct nlmsghdr* nlh;
+    int pos = 0, start, count;
+
+    while (pos < len)
+    {
+        start = pos;
+        for (count = 0; pos < len && count < ICCP_NL_BATCH_SIZE; count++)
+        {
+            nlh = (struct nlmsghdr*)&buf[pos];
+            if (len - pos < (int)sizeof(*nlh) || nlh->nlmsg_len < sizeof(*nlh)
+                || nlh->nlmsg_len > (uint32_t)(len - pos))
+            {
+                len = pos;
+                break;
+            }
+            pos += NLMSG_ALIGN(nlh->nlmsg_len);
+        }
+        if (pos > len)
+            pos = len;
+        if (pos == start)
+            break;
+
+        iccp_netlink_replay(&buf[start], pos - start);
+        bench_step(b);
+    }
+
+    return;
+}
+
+static void bench_nl_topology(struct bench* b)
+{
+    struct bench_opts* opts = b->opts;
+    char name[MAX_L_PORT_NAME];
+    char* buf;
+    int i, len = 0;
+
+    if ((buf = calloc(opts->num_po + opts->num_vlan + 1, NLMSG_SPACE(256))) == NULL)
+        return;
+
+    len += bench_nl_link(&buf[len], BENCH_PEER_LINK_IFINDEX, BENCH_PEER_LINK, 1);
+    for (i = 0; i < opts->num_po; i++)
+    {
+        bench_po_name(name, i + 1);
+        len += bench_nl_link(&buf[len], BENCH_PO_IFINDEX_BASE + i + 1, name, 1);
+    }
+    for (i = 0; i < opts->num_vlan; i++)
+    {
+        snprintf(name, sizeof(name), "%s%u", VLAN_PREFIX, (uint16_t)(BENCH_VLAN_BASE + i));
+        len += bench_nl_link(&buf[len], BENCH_VLAN_IFINDEX_BASE + BENCH_VLAN_BASE + i, name, 1);
+    }
+    bench_nl_replay(b, buf, len);
+    free(buf);
+
+    return;
+}
+
+static uint32_t bench_pcap_u32(const char* p, int swap)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return swap ? bswap_32(v) : v;
+}
+
+/* Route netlink messages of a pcap from an nlmon device, in place */
+static int bench_pcap_extract(char* data, int size)
+{
+    uint32_t magic = bench_pcap_u32(data, 0);
+    int swap = (magic != BENCH_PCAP_MAGIC && magic != BENCH_PCAP_MAGIC_NSEC);
+    uint16_t protocol;
+    uint32_t caplen;
+    int pos = BENCH_PCAP_HDR_LEN, len = 0;
+
+    if (bench_pcap_u32(&data[20], swap) != BENCH_LINKTYPE_NETLINK)
+    {
+        fprintf(stderr, "pcap link type is not netlink\n");
+        return MCLAG_ERROR;
+    }
+
+    while (pos + BENCH_PCAP_REC_LEN <= size)
+    {
+        caplen = bench_pcap_u32(&data[pos + 8], swap);
+        pos += BENCH_PCAP_REC_LEN;
+        if (caplen > (uint32_t)(size - pos))
+            break;
+
+        memcpy(&protocol, &data[pos + BENCH_NETLINK_COOKED_LEN - 2], sizeof(protocol));
+        if (caplen > BENCH_NETLINK_COOKED_LEN && ntohs(protocol) == NETLINK_ROUTE)
+        {
+            memmove(&data[len], &data[pos + BENCH_NETLINK_COOKED_LEN], caplen - BENCH_NETLINK_COOKED_LEN);
+            len = NLMSG_ALIGN(len + caplen - BENCH_NETLINK_COOKED_LEN);
+        }
+        pos += caplen;
+    }
+
+    return len;
+}
+
+static int bench_replay_load(struct bench_opts* opts, const char* path)
+{
+    FILE* fp;
+    long size;
+    uint32_t magic;
+    char* data;
+
+    if ((fp = fopen(path, "r")) == NULL)
+    {
+        fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+        return MCLAG_ERROR;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+
+    if (size <= 0 || (data = malloc(size)) == NULL || fread(data, 1, size, fp) != (size_t)size)
+    {
+        fprintf(stderr, "read %s failed\n", path);
+        fclose(fp);
+        return MCLAG_ERROR;
+    }
+    fclose(fp);
+
+    opts->replay_buf = data;
+    opts->replay_len = size;
+
+    magic = bench_pcap_u32(data, 0);
+    if (size >= BENCH_PCAP_HDR_LEN
+        && (magic == BENCH_PCAP_MAGIC || magic == BENCH_PCAP_MAGIC_NSEC
+            || magic == bswap_32(BENCH_PCAP_MAGIC) || magic == bswap_32(BENCH_PCAP_MAGIC_NSEC)))
+    {
+        if ((opts->replay_len = bench_pcap_extract(data, size)) < 0)
+            return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
+/*****************************************
+* mclagsyncd stand-in
+*
+* ***************************************/
+static void bench_syncd_queue(struct bench* b, uint8_t type, const void* data, int size, int count)
+{
+    char buf[MCLAG_MAX_MSG_LEN];
+    struct IccpSyncdHDr* msg_hdr = (struct IccpSyncdHDr*)buf;
+    int per_msg = (MCLAG_MAX_MSG_LEN - sizeof(struct IccpSyncdHDr)) / size;
+    int i, num;
+
+    for (i = 0; i < count; i += num)
+    {
+        num = (count - i < per_msg) ? count - i : per_msg;
+        msg_hdr->ver = 1;
+        msg_hdr->type = type;
+        msg_hdr->len = sizeof(struct IccpSyncdHDr) + num * size;
+        memcpy(&buf[sizeof(struct IccpSyncdHDr)], (const char*)data + i * size, num * size);
+        bench_conn_queue(&b->syncd, buf, msg_hdr->len);
+    }
+
+    return;
+}
+
+static void bench_syncd_config(struct bench* b)
+{
+    struct bench_opts* opts = b->opts;
+    struct mclag_domain_cfg_info domain;
+    struct mclag_iface_cfg_info iface[BENCH_MAX_PO];
+    struct mclag_vlan_mbr_info* vlan_mbr;
+    struct mclag_syncd_capability_info cap;
+    uint8_t system_mac[ETHER_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    int i, v, count = 0;
+
+    memset(&domain, 0, sizeof(domain));
+    domain.op_type = MCLAG_CFG_OPER_ADD;
+    domain.domain_id = BENCH_DOMAIN_ID;
+    domain.keepalive_time = -1;
+    domain.session_timeout = -1;
+    snprintf(domain.local_ip, sizeof(domain.local_ip), "%s", BENCH_LOCAL_IP);
+    snprintf(domain.peer_ip, sizeof(domain.peer_ip), "%s", BENCH_PEER_IP);
+    snprintf(domain.peer_ifname, sizeof(domain.peer_ifname), "%s", BENCH_PEER_LINK);
+    memcpy(domain.system_mac, system_mac, ETHER_ADDR_LEN);
+    domain.attr_bmap = MCLAG_CFG_ATTR_SRC_ADDR | MCLAG_CFG_ATTR_PEER_ADDR | MCLAG_CFG_ATTR_PEER_LINK
+                       | MCLAG_CFG_ATTR_KEEPALIVE_INTERVAL | MCLAG_CFG_ATTR_SESSION_TIMEOUT;
+    bench_syncd_queue(b, MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_DOMAIN, &domain, sizeof(domain), 1);
+
+    memset(iface, 0, sizeof(iface));
+    for (i = 0; i < opts->num_po; i++)
+    {
+        iface[i].op_type = MCLAG_CFG_OPER_ADD;
+        iface[i].domain_id = BENCH_DOMAIN_ID;
+        bench_po_name(iface[i].mclag_iface, i + 1);
+    }
+    bench_syncd_queue(b, MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_IFACE, iface, sizeof(iface[0]), opts->num_po);
+
+    /* every port-channel and the peer-link in every VLAN */
+    if ((vlan_mbr = calloc((opts->num_po + 1) * opts->num_vlan, sizeof(*vlan_mbr))) == NULL)
+        return;
+    for (v = 0; v < opts->num_vlan; v++)
+    {
+        for (i = 0; i <= opts->num_po; i++, count++)
+        {
+            vlan_mbr[count].op_type = MCLAG_CFG_OPER_ADD;
+            vlan_mbr[count].vid = BENCH_VLAN_BASE + v;
+            if (i == opts->num_po)
+                snprintf(vlan_mbr[count].mclag_iface, MAX_L_PORT_NAME, "%s", BENCH_PEER_LINK);
+            else
+                bench_po_name(vlan_mbr[count].mclag_iface, i + 1);
+        }
+    }
+    bench_syncd_queue(b, MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES, vlan_mbr, sizeof(*vlan_mbr), count);
+    free(vlan_mbr);
+
+    if (opts->syncd_bulk)
+    {
+        cap.flags = MCLAG_SYNCD_CAP_FDB_BULK;
+        bench_syncd_queue(b, MCLAG_SYNCD_MSG_TYPE_CAPABILITY, &cap, sizeof(cap), 1);
+    }
+
+    return;
+}
+
+static void bench_syncd_msg(struct bench* b, char* msg, int len)
+{
+    struct IccpSyncdHDr* msg_hdr = (struct IccpSyncdHDr*)msg;
+    struct mclag_fdb_info* mac_info;
+    int i, count;
+
+    switch (msg_hdr->type)
+    {
+        case MCLAG_MSG_TYPE_SET_FDB:
+        case MCLAG_MSG_TYPE_SET_FDB_BULK:
+            count = (len - sizeof(struct IccpSyncdHDr)) / sizeof(struct mclag_fdb_info);
+            b->syncd_fdb_msgs++;
+            if (msg_hdr->type == MCLAG_MSG_TYPE_SET_FDB_BULK)
+                b->syncd_fdb_bulk_msgs++;
+            b->syncd_fdb_entries += count;
+            for (i = 0; i < count; i++)
+            {
+                mac_info = (struct mclag_fdb_info*)&msg[sizeof(struct IccpSyncdHDr) + i * sizeof(struct mclag_fdb_info)];
+                if (mac_info->op_type == MAC_SYNC_ADD)
+                    b->syncd_fdb_add++;
+            }
+            break;
+
+        case MCLAG_MSG_TYPE_PORT_ISOLATE:
+            b->syncd_isolate++;
+            break;
+
+        default:
+            break;
+    }
+
+    return;
+}
+
+/* Local MACs as mclagsyncd reports them learned */
+static void bench_syncd_send_macs(struct bench* b)
+{
+    struct mclag_fdb_info fdb[(MCLAG_MAX_MSG_LEN - sizeof(struct IccpSyncdHDr)) / sizeof(struct mclag_fdb_info)];
+    struct MACMsg mac_msg;
+    int i, num;
+
+    while (b->syncd_mac_next < b->syncd_mac_end && bench_conn_pending(&b->syncd) < BENCH_TX_LOW_WATER)
+    {
+        num = b->syncd_mac_end - b->syncd_mac_next;
+        if (num > (int)(sizeof(fdb) / sizeof(fdb[0])))
+            num = sizeof(fdb) / sizeof(fdb[0]);
+
+        memset(fdb, 0, sizeof(fdb));
+        for (i = 0; i < num; i++)
+        {
+            bench_mac_fill(b, &mac_msg, b->syncd_mac_next + i, BENCH_DIR_SYNCD);
+            memcpy(fdb[i].mac, mac_msg.mac_addr, ETHER_ADDR_LEN);
+            fdb[i].vid = mac_msg.vid;
+            memcpy(fdb[i].port_name, mac_msg.ifname, MAX_L_PORT_NAME);
+            fdb[i].type = MAC_TYPE_DYNAMIC;
+            fdb[i].op_type = MAC_SYNC_ADD;
+        }
+        bench_syncd_queue(b, MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION, fdb, sizeof(fdb[0]), num);
+        b->syncd_mac_next += num;
+    }
+
+    return;
+}
+
+static void bench_syncd_poll(struct bench* b)
+{
+    struct bench_conn* conn = &b->syncd;
+    struct IccpSyncdHDr* msg_hdr;
+    size_t pos = 0;
+
+    if (bench_conn_read(conn) < 0)
+    {
+        fprintf(stderr, "iccpd closed the mclagsyncd session\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (conn->rx_len - pos >= sizeof(struct IccpSyncdHDr))
+    {
+        msg_hdr = (struct IccpSyncdHDr*)&conn->rx[pos];
+        if (msg_hdr->len < sizeof(struct IccpSyncdHDr) || pos + msg_hdr->len > conn->rx_len)
+            break;
+        bench_syncd_msg(b, &conn->rx[pos], msg_hdr->len);
+        pos += msg_hdr->len;
+    }
+    bench_conn_consume(conn, pos);
+
+    bench_syncd_send_macs(b);
+    bench_conn_flush(conn);
+
+    return;
+}
+
+/*****************************************
+* ICCP peer stand-in
+*
+* ***************************************/
+static void bench_peer_queue(struct bench* b, int len)
+{
+    if (len > 0)
+        bench_conn_queue(&b->peer, g_bench_buf, len);
+
+    return;
+}
+
+/* Fake CSM of the peer for the TLV builders */
+static int bench_peer_init(struct bench* b)
+{
+    struct CSM* csm = b->csm;
+    struct CSM* peer_csm;
+    int i;
+
+    if ((peer_csm = calloc(1, sizeof(struct CSM))) == NULL)
+        return MCLAG_ERROR;
+    if ((b->peer_po = calloc(b->opts->num_po, sizeof(struct LocalInterface))) == NULL)
+        return MCLAG_ERROR;
+
+    peer_csm->mlag_id = csm->mlag_id;
+    peer_csm->iccp_info.icc_rg_id = csm->iccp_info.icc_rg_id;
+    memcpy(MLACP(peer_csm).system_id, MLACP(csm).system_id, ETHER_ADDR_LEN);
+    MLACP(peer_csm).system_id[5] ^= 0x80;
+    MLACP(peer_csm).system_priority = MLACP(csm).system_priority;
+    MLACP(peer_csm).node_id = MLACP(csm).node_id + 1;
+
+    for (i = 0; i < b->opts->num_po; i++)
+    {
+        bench_po_name(b->peer_po[i].name, i + 1);
+        b->peer_po[i].po_id = i + 1;
+        b->peer_po[i].type = IF_T_PORT_CHANNEL;
+        b->peer_po[i].state = PORT_STATE_UP;
+        memcpy(b->peer_po[i].mac_addr, MLACP(peer_csm).system_id, ETHER_ADDR_LEN);
+    }
+    b->peer_csm = peer_csm;
+
+    return 0;
+}
+
+static void bench_peer_send_sync_data(struct bench* b)
+{
+    struct CSM* peer_csm = b->peer_csm;
+    int i;
+
+    bench_peer_queue(b, mlacp_prepare_for_sync_data_tlv(peer_csm, g_bench_buf, CSM_BUFFER_SIZE, 0));
+    bench_peer_queue(b, mlacp_prepare_for_sys_config(peer_csm, g_bench_buf, CSM_BUFFER_SIZE));
+    if (b->opts->peer_bulk)
+        bench_peer_queue(b, mlacp_prepare_for_capability(peer_csm, g_bench_buf, CSM_BUFFER_SIZE));
+    for (i = 0; i < b->opts->num_po; i++)
+        bench_peer_queue(b, mlacp_prepare_for_Aggport_config(peer_csm, g_bench_buf, CSM_BUFFER_SIZE, &b->peer_po[i], 0));
+    for (i = 0; i < b->opts->num_po; i++)
+        bench_peer_queue(b, mlacp_prepare_for_Aggport_state(peer_csm, g_bench_buf, CSM_BUFFER_SIZE, &b->peer_po[i]));
+    bench_peer_queue(b, mlacp_prepare_for_sync_data_tlv(peer_csm, g_bench_buf, CSM_BUFFER_SIZE, 1));
+
+    return;
+}
+
+/* Remote MACs, in MAC info or MAC bulk TLVs */
+static void bench_peer_send_macs(struct bench* b)
+{
+    struct MACMsg mac_msg;
+    int i, num, count, len = 0;
+
+    while (b->peer_mac_next < b->peer_mac_end && bench_conn_pending(&b->peer) < BENCH_TX_LOW_WATER)
+    {
+        num = b->peer_mac_end - b->peer_mac_next;
+        if (b->opts->peer_bulk)
+        {
+            if (num > BENCH_MAC_BULK_NUM)
+                num = BENCH_MAC_BULK_NUM;
+            for (i = 0; i < num; i++)
+            {
+                bench_mac_fill(b, &b->mac_chunk[i], b->peer_mac_next + i, BENCH_DIR_PEER);
+                b->mac_ptr[i] = &b->mac_chunk[i];
+            }
+            count = 0;
+            len = mlacp_prepare_for_mac_bulk_info(b->peer_csm, g_bench_buf, CSM_BUFFER_SIZE,
+                                                  b->mac_ptr, num, &count);
+            num = count;
+        }
+        else
+        {
+            if (num > BENCH_MAC_ENTRY_NUM)
+                num = BENCH_MAC_ENTRY_NUM;
+            memset(g_bench_buf, 0, sizeof(ICCHdr) + sizeof(struct mLACPMACInfoTLV));
+            for (i = 0; i < num; i++)
+            {
+                bench_mac_fill(b, &mac_msg, b->peer_mac_next + i, BENCH_DIR_PEER);
+                len = mlacp_prepare_for_mac_info_to_peer(b->peer_csm, g_bench_buf, CSM_BUFFER_SIZE, &mac_msg, i);
+            }
+        }
+
+        if (len <= 0 || num <= 0)
+        {
+            fprintf(stderr, "MAC TLV encoding failed\n");
+            exit(EXIT_FAILURE);
+        }
+        bench_peer_queue(b, len);
+        b->peer_mac_next += num;
+    }
+
+    return;
+}
+
+static void bench_peer_msg(struct bench* b, char* msg, int len)
+{
+    LDPHdr* ldp_hdr = (LDPHdr*)msg;
+    ICCParameter* param;
+
+    switch (ntohs(ldp_hdr->msg_type))
+    {
+        case MSG_T_CAPABILITY:
+        case MSG_T_RG_CONNECT:
+            /* the peer offers what iccpd offers */
+            bench_conn_queue(&b->peer, msg, len);
+            break;
+
+        case MSG_T_RG_APP_DATA:
+            if (len < (int)(sizeof(ICCHdr) + sizeof(ICCParameter)))
+                break;
+
+            if (!b->peer_sync_req_sent)
+            {
+                bench_peer_queue(b, mlacp_prepare_for_sync_request_tlv(b->peer_csm, g_bench_buf, CSM_BUFFER_SIZE));
+                b->peer_sync_req_sent = 1;
+            }
+
+            param = (ICCParameter*)&msg[sizeof(ICCHdr)];
+            switch (ntohs(param->type))
+            {
+                case TLV_T_MLACP_SYNC_REQUEST:
+                    bench_peer_send_sync_data(b);
+                    break;
+
+                case TLV_T_MLACP_MAC_INFO:
+                    b->peer_mac_rx += ntohs(((struct mLACPMACInfoTLV*)param)->num_of_entry);
+                    break;
+
+                case TLV_T_MLACP_MAC_BULK_INFO:
+                    b->peer_mac_rx += ntohs(((struct mLACPBulkInfoTLV*)param)->num_of_entry);
+                    break;
+
+                default:
+                    break;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return;
+}
+
+static void bench_peer_poll(struct bench* b)
+{
+    struct bench_conn* conn = &b->peer;
+    LDPHdr* ldp_hdr;
+    size_t pos = 0, msg_len;
+    long now;
+
+    if (b->peer_closed || b->peer_csm == NULL)
+        return;
+
+    if (bench_conn_read(conn) < 0)
+    {
+        b->peer_closed = 1;
+        return;
+    }
+
+    while (conn->rx_len - pos >= sizeof(LDPHdr))
+    {
+        ldp_hdr = (LDPHdr*)&conn->rx[pos];
+        msg_len = ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+        if (pos + msg_len > conn->rx_len)
+            break;
+        bench_peer_msg(b, &conn->rx[pos], msg_len);
+        pos += msg_len;
+    }
+    bench_conn_consume(conn, pos);
+
+    now = bench_now_ms();
+    if (b->peer_sync_req_sent && now - b->peer_heartbeat_ms >= BENCH_HEARTBEAT_MSEC)
+    {
+        bench_peer_queue(b, mlacp_prepare_for_heartbeat(b->peer_csm, g_bench_buf, CSM_BUFFER_SIZE));
+        b->peer_heartbeat_ms = now;
+    }
+
+    bench_peer_send_macs(b);
+    bench_conn_flush(conn);
+
+    return;
+}
+
+/*****************************************
+* Phases
+*
+* ***************************************/
+static void bench_timespec_add(struct timespec* sum, struct timespec* start, struct timespec* end)
+{
+    sum->tv_sec += end->tv_sec - start->tv_sec;
+    sum->tv_nsec += end->tv_nsec - start->tv_nsec;
+    while (sum->tv_nsec < 0)
+    {
+        sum->tv_nsec += 1000000000;
+        sum->tv_sec--;
+    }
+    while (sum->tv_nsec >= 1000000000)
+    {
+        sum->tv_nsec -= 1000000000;
+        sum->tv_sec++;
+    }
+
+    return;
+}
+
+/* Stand-ins first, then one iccpd scheduler pass */
+static void bench_step(struct bench* b)
+{
+    struct timespec start, end;
+    int busy;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    bench_syncd_poll(b);
+    bench_peer_poll(b);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    bench_timespec_add(&b->standin_cpu, &start, &end);
+
+    busy = bench_conn_pending(&b->syncd) || bench_conn_pending(&b->peer)
+           || b->syncd_mac_next < b->syncd_mac_end || b->peer_mac_next < b->peer_mac_end;
+    scheduler_loop_once(busy ? 0 : 1);
+
+    return;
+}
+
+/* msec until done() holds, -1 on timeout */
+static long bench_run_until(struct bench* b, int (*done)(struct bench*))
+{
+    long start = bench_now_ms();
+
+    while (!done(b))
+    {
+        if (bench_now_ms() - start > b->opts->timeout * 1000L)
+            return -1;
+        bench_step(b);
+    }
+
+    return bench_now_ms() - start;
+}
+
+static int bench_config_done(struct bench* b)
+{
+    return bench_conn_pending(&b->syncd) == 0
+           && (b->csm = system_get_csm_by_mlacp_id(BENCH_DOMAIN_ID)) != NULL
+           && b->csm->peer_link_if != NULL
+           && LIST_FIRST(&MLACP(b->csm).lif_list) != NULL;
+}
+
+static int bench_handshake_done(struct bench* b)
+{
+    return MLACP(b->csm).current_state == MLACP_STATE_EXCHANGE;
+}
+
+static int bench_remote_done(struct bench* b)
+{
+    return b->syncd_fdb_add >= b->num_mac;
+}
+
+static int bench_local_done(struct bench* b)
+{
+    return b->peer_mac_rx >= b->num_mac;
+}
+
+static int bench_isolate_done(struct bench* b)
+{
+    return b->syncd_isolate > 0;
+}
+
+static void bench_memory(struct bench_result* res)
+{
+    struct rusage usage;
+    FILE* fp;
+    long size, resident;
+
+    res->rss_kb = -1;
+    if ((fp = fopen("/proc/self/statm", "r")) != NULL)
+    {
+        if (fscanf(fp, "%ld %ld", &size, &resident) == 2)
+            res->rss_kb = resident * (sysconf(_SC_PAGESIZE) / 1024);
+        fclose(fp);
+    }
+
+    getrusage(RUSAGE_SELF, &usage);
+    res->maxrss_kb = usage.ru_maxrss;
+
+    return;
+}
+
+static void bench_print_ms(long ms)
+{
+    if (ms < 0)
+        printf(" %10s", "timeout");
+    else
+        printf(" %10ld", ms);
+
+    return;
+}
+
+static void bench_print_rate(long ms, int num)
+{
+    if (ms < 0)
+        printf(" %10s", "-");
+    else
+        printf(" %10.0f", ms ? num * 1000.0 / ms : (double)num);
+
+    return;
+}
+
+static void bench_print_result(int num_mac, struct bench_result* res)
+{
+    printf("%9d", num_mac);
+    bench_print_ms(res->handshake_ms);
+    bench_print_ms(res->remote_ms);
+    bench_print_rate(res->remote_ms, num_mac);
+    bench_print_ms(res->local_ms);
+    bench_print_rate(res->local_ms, num_mac);
+    bench_print_ms(res->isolate_ms);
+    printf(" %8.1f %8.2f %10ld %10ld\n", res->fdb_per_msg, res->cpu_s, res->rss_kb, res->maxrss_kb);
+    fflush(stdout);
+
+    return;
+}
+
+/* iccpd with mclagsyncd attached and the topology replayed */
+static int bench_setup(struct bench* b, struct bench_opts* opts, int num_mac, int peer_sv[2])
+{
+    struct CmdOptionParser parser = CMD_OPTION_PARSER_INIT_VALUE;
+    int syncd_sv[2];
+
+    memset(b, 0, sizeof(*b));
+    b->opts = opts;
+    b->num_mac = num_mac;
+    b->mac_per_vlan = (num_mac + opts->num_vlan - 1) / opts->num_vlan;
+    if (b->mac_per_vlan == 0)
+        b->mac_per_vlan = 1;
+
+    parser.init(&parser);
+    log_init(&parser);
+    parser.finalize(&parser);
+    if (opts->log_level >= 0)
+        logger_set_configuration(opts->log_level);
+
+    if (system_get_instance() == NULL)
+        return MCLAG_ERROR;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, syncd_sv) < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, peer_sv) < 0)
+        return MCLAG_ERROR;
+    if (bench_conn_init(&b->syncd, syncd_sv[0]) < 0 || bench_conn_init(&b->peer, peer_sv[0]) < 0)
+        return MCLAG_ERROR;
+    fcntl(syncd_sv[1], F_SETFL, fcntl(syncd_sv[1], F_GETFL) | O_NONBLOCK);
+    fcntl(peer_sv[1], F_SETFL, fcntl(peer_sv[1], F_GETFL) | O_NONBLOCK);
+    if (iccp_syncd_sock_attach(syncd_sv[1]) < 0)
+        return MCLAG_ERROR;
+
+    bench_nl_topology(b);
+    if (opts->replay_len > 0)
+        bench_nl_replay(b, opts->replay_buf, opts->replay_len);
+
+    return 0;
+}
+
+/* One scale, in a child process of its own */
+static int bench_scale(struct bench_opts* opts, int num_mac)
+{
+    struct bench bench;
+    struct bench* b = &bench;
+    struct bench_result res;
+    struct System* sys = NULL;
+    struct rusage usage;
+    char buf[NLMSG_SPACE(256)];
+    int peer_sv[2];
+    int len;
+
+    memset(&res, 0, sizeof(res));
+    res.handshake_ms = res.remote_ms = res.local_ms = res.isolate_ms = -1;
+    if (bench_setup(b, opts, num_mac, peer_sv) < 0 || (sys = system_get_instance()) == NULL)
+        return MCLAG_ERROR;
+
+    bench_syncd_config(b);
+    if (bench_run_until(b, bench_config_done) < 0)
+    {
+        fprintf(stderr, "mclagsyncd configuration not applied\n");
+        return MCLAG_ERROR;
+    }
+
+    /* session up */
+    if (bench_peer_init(b) < 0 || scheduler_csm_sock_attach(b->csm, peer_sv[1]) < 0)
+        return MCLAG_ERROR;
+    scheduler_csm_set_pending_all(sys);
+    res.handshake_ms = bench_run_until(b, bench_handshake_done);
+
+    if (res.handshake_ms >= 0)
+    {
+        b->peer_mac_end = num_mac;
+        res.remote_ms = bench_run_until(b, bench_remote_done);
+        if (b->syncd_fdb_msgs > 0)
+            res.fdb_per_msg = (double)b->syncd_fdb_entries / b->syncd_fdb_msgs;
+
+        b->syncd_mac_end = num_mac;
+        res.local_ms = bench_run_until(b, bench_local_done);
+
+        bench_memory(&res);
+
+        /* peer-link down and the session with it */
+        b->syncd_isolate = 0;
+        len = bench_nl_link(buf, BENCH_PEER_LINK_IFINDEX, BENCH_PEER_LINK, 0);
+        iccp_netlink_replay(buf, len);
+        shutdown(b->peer.fd, SHUT_RDWR);
+        b->peer_closed = 1;
+        res.isolate_ms = bench_run_until(b, bench_isolate_done);
+    }
+    else
+    {
+        bench_memory(&res);
+    }
+
+    getrusage(RUSAGE_SELF, &usage);
+    res.cpu_s = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+                + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6
+                - (b->standin_cpu.tv_sec + b->standin_cpu.tv_nsec / 1e9);
+    bench_print_result(num_mac, &res);
+
+    /* bulk messages as negotiated with mclagsyncd, and only then */
+    if (opts->syncd_bulk ? b->syncd_fdb_bulk_msgs != b->syncd_fdb_msgs : b->syncd_fdb_bulk_msgs != 0)
+    {
+        fprintf(stderr, "%ld of %ld FDB messages were bulk messages\n", b->syncd_fdb_bulk_msgs, b->syncd_fdb_msgs);
+        return 1;
+    }
+
+    return (res.handshake_ms < 0 || res.remote_ms < 0 || res.local_ms < 0 || res.isolate_ms < 0) ? 1 : 0;
+}
+
+static void bench_print_lookup(const char* kind, int num, long lookups, struct timespec* start,
+                               struct timespec* end, long missed)
+{
+    double secs = (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+
+    printf("%-8s %10d %12ld %10.1f %12.0f %8ld\n", kind, num, lookups, secs * 1000,
+           secs > 0 ? lookups / secs : 0.0, missed);
+    fflush(stdout);
+
+    return;
+}
+
+/* Local interface lookups over the replayed topology, in a child process */
+static int bench_lookup(struct bench_opts* opts)
+{
+    struct bench bench;
+    struct bench* b = &bench;
+    struct LocalInterface* lif;
+    struct timespec start, end;
+    char (*names)[MAX_L_PORT_NAME];
+    int* ifindexes;
+    int num = opts->num_vlan + opts->num_po;
+    int peer_sv[2];
+    int r, i;
+    long missed, failed = 0;
+
+    if (bench_setup(b, opts, 0, peer_sv) < 0)
+        return MCLAG_ERROR;
+
+    /* VLANs, then port-channels */
+    names = calloc(num, sizeof(*names));
+    ifindexes = calloc(num, sizeof(*ifindexes));
+    if (names == NULL || ifindexes == NULL)
+        return MCLAG_ERROR;
+    for (i = 0; i < opts->num_vlan; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "%s%u", VLAN_PREFIX, (uint16_t)(BENCH_VLAN_BASE + i));
+        ifindexes[i] = BENCH_VLAN_IFINDEX_BASE + BENCH_VLAN_BASE + i;
+    }
+    for (i = 0; i < opts->num_po; i++)
+    {
+        bench_po_name(names[opts->num_vlan + i], i + 1);
+        ifindexes[opts->num_vlan + i] = BENCH_PO_IFINDEX_BASE + i + 1;
+    }
+
+    printf("%-8s %10s %12s %10s %12s %8s\n", "lookup", "interfaces", "lookups", "ms", "lookups/s", "missed");
+
+    missed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < opts->lookup_rounds; r++)
+        for (i = 0; i < num; i++)
+            if ((lif = local_if_find_by_name(names[i])) == NULL || lif->ifindex != ifindexes[i])
+                missed++;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    failed += missed;
+    bench_print_lookup("name", num, (long)opts->lookup_rounds * num, &start, &end, missed);
+
+    missed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < opts->lookup_rounds; r++)
+        for (i = 0; i < num; i++)
+            if ((lif = local_if_find_by_ifindex(ifindexes[i])) == NULL || lif->ifindex != ifindexes[i])
+                missed++;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    failed += missed;
+    bench_print_lookup("ifindex", num, (long)opts->lookup_rounds * num, &start, &end, missed);
+
+    missed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < opts->lookup_rounds; r++)
+        for (i = 0; i < opts->num_po; i++)
+            if ((lif = local_if_find_by_po_id(i + 1)) == NULL || lif->ifindex != ifindexes[opts->num_vlan + i])
+                missed++;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    failed += missed;
+    bench_print_lookup("po_id", opts->num_po, (long)opts->lookup_rounds * opts->num_po, &start, &end, missed);
+
+    free(names);
+    free(ifindexes);
+
+    return failed ? 1 : 0;
+}
+
+static int bench_parse_scales(struct bench_opts* opts, char* arg)
+{
+    char* tok;
+    char* save = NULL;
+
+    opts->num_scales = 0;
+    for (tok = strtok_r(arg, ",", &save); tok; tok = strtok_r(NULL, ",", &save))
+    {
+        if (opts->num_scales >= BENCH_MAX_SCALES || atoi(tok) <= 0)
+            return MCLAG_ERROR;
+        opts->scales[opts->num_scales++] = atoi(tok);
+    }
+
+    return opts->num_scales ? 0 : MCLAG_ERROR;
+}
+
+int main(int argc, char* argv[])
+{
+    struct bench_opts opts;
+    char default_scales[] = "10000,100000,500000";
+    int opt, i, status, failed = 0;
+    pid_t pid;
+
+    memset(&opts, 0, sizeof(opts));
+    opts.num_po = 8;
+    opts.num_vlan = 0;
+    opts.timeout = 600;
+    opts.log_level = -1;
+    bench_parse_scales(&opts, default_scales);
+
+    while ((opt = getopt(argc, argv, "n:p:v:BSL:r:t:l:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                if (bench_parse_scales(&opts, optarg) < 0)
+                {
+                    bench_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'p':
+                opts.num_po = atoi(optarg);
+                break;
+
+            case 'v':
+                opts.num_vlan = atoi(optarg);
+                if (opts.num_vlan <= 0)
+                {
+                    bench_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'B':
+                opts.peer_bulk = 1;
+                break;
+
+            case 'S':
+                opts.syncd_bulk = 1;
+                break;
+
+            case 'L':
+                opts.lookup_rounds = atoi(optarg);
+                if (opts.lookup_rounds <= 0)
+                {
+                    bench_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'r':
+                if (bench_replay_load(&opts, optarg) < 0)
+                    return EXIT_FAILURE;
+                break;
+
+            case 't':
+                opts.timeout = atoi(optarg);
+                break;
+
+            case 'l':
+                opts.log_level = atoi(optarg);
+                break;
+
+            default:
+                bench_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (opts.num_vlan == 0)
+        opts.num_vlan = opts.lookup_rounds ? BENCH_LOOKUP_VLANS : 64;
+    if (opts.num_po <= 0 || opts.num_po > BENCH_MAX_PO || opts.num_vlan <= 0
+        || opts.num_vlan > 4094 - BENCH_VLAN_BASE || opts.timeout <= 0)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.lookup_rounds)
+    {
+        printf("# %d port-channels, %d VLANs, %d lookup rounds\n", opts.num_po, opts.num_vlan, opts.lookup_rounds);
+        fflush(stdout);
+        if ((pid = fork()) < 0)
+            return EXIT_FAILURE;
+        if (pid == 0)
+            _exit(bench_lookup(&opts) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            fprintf(stderr, "interface lookups failed\n");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    printf("# %d port-channels, %d VLANs, peer %s, mclagsyncd %s\n", opts.num_po, opts.num_vlan,
+           opts.peer_bulk ? "bulk" : "per MAC", opts.syncd_bulk ? "bulk" : "per MAC");
+    printf("%9s %10s %10s %10s %10s %10s %10s %8s %8s %10s %10s\n", "macs", "session_ms", "remote_ms",
+           "remote/s", "local_ms", "local/s", "isolate_ms", "fdb/msg", "cpu_s", "rss_kb", "maxrss_kb");
+    fflush(stdout);
+
+    for (i = 0; i < opts.num_scales; i++)
+    {
+        if ((pid = fork()) < 0)
+            return EXIT_FAILURE;
+        if (pid == 0)
+            _exit(bench_scale(&opts, opts.scales[i]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            fprintf(stderr, "%d MACs did not converge\n", opts.scales[i]);
+            failed = 1;
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -32,6 +32,7 @@
 #include "../include/iccp_cmd_show.h"
 #include "../include/iccp_cli.h"
 #include "../include/logger.h"
+#include "../include/iccp_warm_state.h"
 
 int set_mc_lag_by_id(uint16_t mid)
 {
@@ -48,6 +49,7 @@ int set_mc_lag_by_id(uint16_t mid)
         }
 
         ret = set_mc_lag_id(csm, mid);
+        iccp_warm_state_restore_csm(csm);
 
         return ret;
     }
@@ -33,6 +33,7 @@
 #include "mclagdctl/mclagdctl.h"
 #include "../include/iccp_cmd_show.h"
 #include "../include/mlacp_link_handler.h"
+#include "../include/mlacp_sync_update.h"
 
 extern int local_if_l3_proto_enabled(const char* ifname);
 
@@ -216,6 +217,69 @@ int iccp_arp_dump(char * *buf, int *num, int mclag_id)
     return EXEC_TYPE_SUCCESS;
 }
 
+/* One page of the ARP list of a CSM, following the entry the cursor names.
+ * The list has no order of its own, the entry is found again through
+ * arp_hash; if it went away since the last page the dump cannot resume.
+ */
+int iccp_arp_dump_page(char * *buf, int *num, int mclag_id, struct mclagdctl_dump_cursor *cursor)
+{
+    struct System *sys = NULL;
+    struct CSM *csm = NULL;
+    struct Msg *msg = NULL;
+    struct ARPMsg *iccpd_arp = NULL;
+    struct mclagd_arp_msg *mclagd_arp = NULL;
+    int arp_num = 0;
+    char * arp_buf = NULL;
+
+    if (!(sys = system_get_instance()))
+        return EXEC_TYPE_NO_EXIST_SYS;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->mlag_id == mclag_id)
+            break;
+    }
+    if (!csm)
+        return EXEC_TYPE_NO_EXIST_MCLAGID;
+
+    if (cursor->resume)
+    {
+        if (!(msg = mlacp_find_arp(csm, cursor->ipv4_addr)))
+            return EXEC_TYPE_CURSOR_LOST;
+        msg = TAILQ_NEXT(msg, tail);
+    }
+    else
+    {
+        msg = TAILQ_FIRST(&MLACP(csm).arp_list);
+    }
+
+    arp_buf = (char*)calloc(1, MCLAGD_REPLY_PAGE_HDR + MCLAGDCTL_DUMP_PAGE_ENTRIES * sizeof(struct mclagd_arp_msg));
+    if (!arp_buf)
+        return EXEC_TYPE_FAILED;
+
+    for (; msg && arp_num < MCLAGDCTL_DUMP_PAGE_ENTRIES; msg = TAILQ_NEXT(msg, tail))
+    {
+        iccpd_arp = (struct ARPMsg*)msg->buf;
+        mclagd_arp = (struct mclagd_arp_msg*)(arp_buf + MCLAGD_REPLY_PAGE_HDR) + arp_num;
+
+        mclagd_arp->op_type = iccpd_arp->op_type;
+        mclagd_arp->learn_flag = iccpd_arp->learn_flag;
+        memcpy(mclagd_arp->ifname, iccpd_arp->ifname, strlen(iccpd_arp->ifname));
+        memcpy(mclagd_arp->ipv4_addr, show_ip_str(iccpd_arp->ipv4_addr), 16);
+        memcpy(mclagd_arp->mac_addr, iccpd_arp->mac_addr, 6);
+
+        cursor->ipv4_addr = iccpd_arp->ipv4_addr;
+        arp_num++;
+    }
+
+    cursor->resume = (msg != NULL);
+
+    *buf = arp_buf;
+    *num = arp_num;
+
+    return EXEC_TYPE_SUCCESS;
+}
+
 int iccp_ndisc_dump(char * *buf, int *num, int mclag_id)
 {
     struct System *sys = NULL;
@@ -348,6 +412,76 @@ int iccp_mac_dump(char * *buf, int *num, int mclag_id)
     return EXEC_TYPE_SUCCESS;
 }
 
+/* One page of the MAC table of a CSM, resuming after the (vid, mac) key
+ * the cursor names, so entries added or removed between pages do not
+ * shift the rest of the dump.
+ */
+int iccp_mac_dump_page(char * *buf, int *num, int mclag_id, struct mclagdctl_dump_cursor *cursor)
+{
+    struct System *sys = NULL;
+    struct CSM *csm = NULL;
+    struct MACMsg *iccpd_mac = NULL;
+    struct MACMsg mac_key;
+    struct mclagd_mac_msg *mclagd_mac = NULL;
+    int mac_num = 0;
+    char * mac_buf = NULL;
+
+    if (!(sys = system_get_instance()))
+        return EXEC_TYPE_NO_EXIST_SYS;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->mlag_id == mclag_id)
+            break;
+    }
+    if (!csm)
+        return EXEC_TYPE_NO_EXIST_MCLAGID;
+
+    if (cursor->resume)
+    {
+        memset(&mac_key, 0, sizeof(struct MACMsg));
+        mac_key.vid = cursor->vid;
+        memcpy(mac_key.mac_addr, cursor->mac_addr, ETHER_ADDR_LEN);
+
+        iccpd_mac = RB_NFIND(mac_rb_tree, &MLACP(csm).mac_rb, &mac_key);
+        if (iccpd_mac && iccpd_mac->vid == mac_key.vid
+            && memcmp(iccpd_mac->mac_addr, mac_key.mac_addr, ETHER_ADDR_LEN) == 0)
+            iccpd_mac = RB_NEXT(mac_rb_tree, iccpd_mac);
+    }
+    else
+    {
+        iccpd_mac = RB_MIN(mac_rb_tree, &MLACP(csm).mac_rb);
+    }
+
+    mac_buf = (char*)calloc(1, MCLAGD_REPLY_PAGE_HDR + MCLAGDCTL_DUMP_PAGE_ENTRIES * sizeof(struct mclagd_mac_msg));
+    if (!mac_buf)
+        return EXEC_TYPE_FAILED;
+
+    for (; iccpd_mac && mac_num < MCLAGDCTL_DUMP_PAGE_ENTRIES; iccpd_mac = RB_NEXT(mac_rb_tree, iccpd_mac))
+    {
+        mclagd_mac = (struct mclagd_mac_msg*)(mac_buf + MCLAGD_REPLY_PAGE_HDR) + mac_num;
+
+        mclagd_mac->op_type = iccpd_mac->op_type;
+        mclagd_mac->fdb_type = iccpd_mac->fdb_type;
+        memcpy(mclagd_mac->mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
+        mclagd_mac->vid = iccpd_mac->vid;
+        memcpy(mclagd_mac->ifname, iccpd_mac->ifname, strlen(iccpd_mac->ifname));
+        memcpy(mclagd_mac->origin_ifname, iccpd_mac->origin_ifname, strlen(iccpd_mac->origin_ifname));
+        mclagd_mac->age_flag = iccpd_mac->age_flag;
+
+        cursor->vid = iccpd_mac->vid;
+        memcpy(cursor->mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
+        mac_num++;
+    }
+
+    cursor->resume = (iccpd_mac != NULL);
+
+    *buf = mac_buf;
+    *num = mac_num;
+
+    return EXEC_TYPE_SUCCESS;
+}
+
 int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
 {
     struct System *sys = NULL;
@@ -355,7 +489,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
     struct LocalInterface *lif_po = NULL;
     struct LocalInterface *lif_peer = NULL;
     struct mclagd_local_if mclagd_lif;
-    struct VLAN_ID* vlan_id = NULL;
+    uint16_t vlan_id;
     char * str_buf = NULL;
     int str_size = MCLAGDCTL_PARA3_LEN - 1;
     int len = 0;
@@ -441,11 +575,11 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
             int range = 0;
             int to_be_printed = 0;
 
-            RB_FOREACH (vlan_id, vlan_rb_tree, &(lif_po->vlan_tree))
+            VLAN_BITMAP_FOREACH(vlan_id, &(lif_po->vlan_bitmap))
             {
                 if (str_size - len < 4)
                     break;
-                if (!prev_vlan_id || vlan_id->vid != prev_vlan_id + 1)
+                if (!prev_vlan_id || vlan_id != prev_vlan_id + 1)
                 {
                     if (range)
                     {
@@ -455,7 +589,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                         }
                         len += snprintf(str_buf + len, str_size - len, "- %d ", prev_vlan_id);
                     }
-                    len += snprintf(str_buf + len, str_size - len, "%d ", vlan_id->vid);
+                    len += snprintf(str_buf + len, str_size - len, "%d ", vlan_id);
                     range = 0;
                     to_be_printed = 0;
                 }
@@ -464,7 +598,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                     range = 1;
                     to_be_printed = 1;
                 }
-                prev_vlan_id = vlan_id->vid;
+                prev_vlan_id = vlan_id;
             }
 
             if (to_be_printed && (str_size - len > (4 + ((range)?8:0))))
@@ -550,11 +684,11 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
             int range = 0;
             int to_be_printed = 0;
 
-            RB_FOREACH (vlan_id, vlan_rb_tree, &(lif_peer->vlan_tree))
+            VLAN_BITMAP_FOREACH(vlan_id, &(lif_peer->vlan_bitmap))
             {
                 if (str_size - len < 4)
                     break;
-                if (!prev_vlan_id || vlan_id->vid != prev_vlan_id + 1)
+                if (!prev_vlan_id || vlan_id != prev_vlan_id + 1)
                 {
                     if (range)
                     {
@@ -564,7 +698,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                         }
                         len += snprintf(str_buf + len, str_size - len, "- %d ", prev_vlan_id);
                     }
-                    len += snprintf(str_buf + len, str_size - len, "%d ", vlan_id->vid);
+                    len += snprintf(str_buf + len, str_size - len, "%d ", vlan_id);
                     range = 0;
                     to_be_printed = 0;
                 }
@@ -573,7 +707,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                     range = 1;
                     to_be_printed = 1;
                 }
-                prev_vlan_id = vlan_id->vid;
+                prev_vlan_id = vlan_id;
             }
 
             if (to_be_printed && (str_size - len > (4 + ((range)?8:0))))
@@ -731,6 +865,11 @@ int iccp_cmd_dbg_counter_dump(char **buf, int *data_len, int mclag_id)
     memset(counter_buf, 0, buf_size);
     counter_ptr =
         (mclagd_dbg_counter_info_t *)(counter_buf + MCLAGD_REPLY_INFO_HDR);
+    iccp_pool_get_stats(sys->dbg_counters.pool_stats);
+    sys->dbg_counters.mac_entry_alloc_counter =
+        sys->dbg_counters.pool_stats[ICCP_POOL_MAC_MSG].alloc_counter;
+    sys->dbg_counters.mac_entry_free_counter =
+        sys->dbg_counters.pool_stats[ICCP_POOL_MAC_MSG].free_counter;
     memcpy(&counter_ptr->system_dbg, &sys->dbg_counters, sizeof(sys->dbg_counters));
     counter_ptr->num_iccp_counter_blocks = num_csm;
     temp_ptr = counter_ptr->iccp_dbg_counters;
@@ -96,8 +96,7 @@ static int iccp_check_interface_vlan(char* ifname)
 {
     struct CSM* csm = NULL;
     struct PeerInterface* peer_if = NULL;
-    struct VLAN_ID* local_vlan = NULL;
-    struct VLAN_ID* peer_vlan = NULL;
+    struct vlan_bitmap diff;
     struct LocalInterface* local_if = NULL;
 
     local_if = local_if_find_by_name(ifname);
@@ -112,27 +111,16 @@ static int iccp_check_interface_vlan(char* ifname)
     if (peer_if == NULL)
         return -4;
 
-    RB_FOREACH (local_vlan, vlan_rb_tree, &(local_if->vlan_tree))
-    {
-        peer_vlan = RB_FIND(vlan_rb_tree, &(peer_if->vlan_tree), local_vlan);
-
-        if (peer_vlan == NULL)
-        {
-            return -5;
-        }
-    }
-
-    RB_FOREACH (peer_vlan, vlan_rb_tree, &(peer_if->vlan_tree))
-    {
-        local_vlan = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), peer_vlan);
+    if (vlan_bitmap_equal(&local_if->vlan_bitmap, &peer_if->vlan_bitmap))
+        return 1;
 
-        if (local_vlan == NULL)
-        {
-            return -6;
-        }
-    }
+    /* Local VLAN missing on the peer */
+    vlan_bitmap_andnot(&diff, &local_if->vlan_bitmap, &peer_if->vlan_bitmap);
+    if (!vlan_bitmap_empty(&diff))
+        return -5;
 
-    return 1;
+    /* Peer VLAN missing locally */
+    return -6;
 }
 
 static const ConsistencyCheckFunc check_func[] = {
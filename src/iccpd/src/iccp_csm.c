@@ -31,6 +31,7 @@
 #include "../include/iccp_csm.h"
 #include "../include/iccp_cli.h"
 #include "../include/mlacp_link_handler.h"
+#include "../include/iccp_pool.h"
 /*****************************************
 * Define
 *
@@ -41,8 +42,7 @@
         while (!TAILQ_EMPTY(&(list))) { \
             msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), msg, tail); \
-            free(msg->buf); \
-            free(msg); \
+            iccp_csm_free_msg(msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
@@ -124,6 +124,7 @@ void iccp_csm_init(struct CSM* csm)
     csm->iccp_info.icc_rg_id = 0x0;
     csm->keepalive_time      = CONNECT_INTERVAL_SEC;
     csm->session_timeout     = HEARTBEAT_TIMEOUT_SEC;
+    scheduler_csm_timer_init(csm);
 }
 
 /* Connection State Machine instance status reset */
@@ -192,6 +193,7 @@ void iccp_csm_finalize(struct CSM* csm)
 
     /* Disconnect from peer */
     scheduler_session_disconnect_handler(csm);
+    scheduler_csm_timer_stop(csm);
 
     //Delete all MCLAG interfaces
     local_if = LIST_FIRST(&(MLACP(csm).lif_list));
@@ -237,7 +239,7 @@ void iccp_csm_msg_list_finalize(struct CSM* csm)
     {
         msg = TAILQ_FIRST(&(csm->msg_list));
         TAILQ_REMOVE(&(csm->msg_list), msg, tail);
-        free(msg);
+        iccp_csm_free_msg(msg);
     }
 }
 
@@ -266,7 +268,8 @@ int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
         csm->msg_log.end_index = 0;
 
     tlv_type = ntohs(param->type);
-    rc = write(csm->sock_fd, buf, msg_len);
+    /* Queued if the socket is full, sent on EPOLLOUT */
+    rc = scheduler_sock_send(csm->sock_fd, &csm->tx_queue, buf, msg_len);
     if ((rc <= 0) || (rc != msg_len))
     {
         MLACP_SET_ICCP_TX_DBG_COUNTER(
@@ -660,8 +663,7 @@ void iccp_csm_correspond_from_msg(struct CSM* csm, struct Msg* msg)
         ++csm->u_msg_in_count;
     }
 
-    free(msg->buf);
-    free(msg);
+    iccp_csm_free_msg(msg);
 }
 
 /* Receive capability message correspond function */
@@ -728,7 +730,7 @@ void iccp_csm_enqueue_msg(struct CSM* csm, struct Msg* msg)
     if (csm == NULL)
     {
         if (msg != NULL)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
 
@@ -793,31 +795,40 @@ int iccp_csm_init_msg(struct Msg** msg, char* data, int len)
     if (data == NULL || len <= 0)
         return MCLAG_ERROR;
 
-    iccp_msg = (struct Msg*)malloc(sizeof(struct Msg));
+    iccp_msg = (struct Msg*)iccp_pool_alloc(ICCP_POOL_MSG);
     if (iccp_msg == NULL)
         goto err_ret;
 
-    iccp_msg->buf = (char*)malloc(len);
+    iccp_msg->buf = (char*)iccp_pool_buf_alloc(len);
     if (iccp_msg->buf == NULL)
         goto err_ret;
 
     memcpy(iccp_msg->buf, data, len);
     iccp_msg->len = len;
+    iccp_msg->restored = 0;
     *msg = iccp_msg;
 
     return 0;
 
  err_ret:
     if (iccp_msg)
-    {
-        if (iccp_msg->buf)
-            free(iccp_msg->buf);
-        free(iccp_msg);
-    }
+        iccp_pool_free(iccp_msg);
 
     return MCLAG_ERROR;
 }
 
+/* Give back a message from iccp_csm_init_msg */
+void iccp_csm_free_msg(struct Msg* msg)
+{
+    if (msg == NULL)
+        return;
+
+    iccp_pool_free(msg->buf);
+    iccp_pool_free(msg);
+
+    return;
+}
+
 /* MAC Message initialization */
 int iccp_csm_init_mac_msg(struct MACMsg **mac_msg, char* data, int len)
 {
@@ -829,7 +840,7 @@ int iccp_csm_init_mac_msg(struct MACMsg **mac_msg, char* data, int len)
     if (data == NULL || len <= 0)
         return MCLAG_ERROR;
 
-    iccp_mac_msg = (struct MACMsg*)malloc(sizeof(struct MACMsg));
+    iccp_mac_msg = (struct MACMsg*)iccp_pool_alloc(ICCP_POOL_MAC_MSG);
     if (iccp_mac_msg == NULL)
        return -3;
 
@@ -841,6 +852,14 @@ int iccp_csm_init_mac_msg(struct MACMsg **mac_msg, char* data, int len)
     return 0;
 }
 
+/* Give back a MAC entry from iccp_csm_init_mac_msg */
+void iccp_csm_free_mac_msg(struct MACMsg* mac_msg)
+{
+    iccp_pool_free(mac_msg);
+
+    return;
+}
+
 
 void iccp_csm_stp_role_count(struct CSM *csm)
 {
@@ -37,6 +37,7 @@
 #include "../include/mlacp_link_handler.h"
 #include "../include/port.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_ifm.h"
 
 #define fwd_neigh_state_valid(state) (state & (NUD_REACHABLE | NUD_STALE | NUD_DELAY | NUD_PROBE | NUD_PERMANENT))
 
@@ -113,20 +114,19 @@ int iccp_sys_local_if_list_get_init()
     return ret;
 }
 
-static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int msgtype, int is_del)
+static void do_arp_learn_from_kernel(struct ndmsg *ndm, uint8_t *dst, uint8_t *lladdr, int msgtype, int is_del)
 {
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
     struct Msg *msg_send = NULL;
     uint16_t vid = 0;
     int entry_exists = 0;
     struct LocalInterface *peer_link_if = NULL;
     int ln = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     char buf[MAX_BUFSIZE] = { 0 };
     size_t msg_len = 0;
@@ -148,10 +148,10 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     arp_msg = (struct ARPMsg *)&buf;
     arp_msg->op_type = NEIGH_SYNC_LIF;
     sprintf(arp_msg->ifname, "%s", arp_lif->name);
-    if (tb[NDA_DST])
-        memcpy(&arp_msg->ipv4_addr, RTA_DATA(tb[NDA_DST]), RTA_PAYLOAD(tb[NDA_DST]));
-    if (!is_del && tb[NDA_LLADDR])
-        memcpy(arp_msg->mac_addr, RTA_DATA(tb[NDA_LLADDR]), RTA_PAYLOAD(tb[NDA_LLADDR]));
+    if (dst)
+        memcpy(&arp_msg->ipv4_addr, dst, sizeof(arp_msg->ipv4_addr));
+    if (!is_del && lladdr)
+        memcpy(arp_msg->mac_addr, lladdr, ETHER_ADDR_LEN);
 
     arp_msg->ipv4_addr = arp_msg->ipv4_addr;
 
@@ -180,11 +180,6 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
         sscanf (arp_msg->ifname, "Vlan%hu", &vlan_id);
     }
 
-    if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
-    }
-
     /* Find MLACP itf, member of port-channel*/
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
@@ -201,24 +196,19 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
             {
                 vid = 0;
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_itf = vlan_bitmap_test(&(lif_po->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-                if (!vlan_id_list) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (vlan_itf->ifindex != ndm->ndm_ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ndm->ndm_ifindex) {
-                    ln = __LINE__;
-                    continue;
-                }
-
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from mclag enabled member port of vlan %d", vid);
             }
             else
@@ -243,11 +233,11 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_itf = vlan_bitmap_test(&(peer_link_if->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ndm->ndm_ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_itf) {
+                   if (vlan_itf->ifindex == ndm->ndm_ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from peer link vlan %d", vid);
                        verify_arp = 1;
                        lif_po = peer_link_if;
@@ -268,8 +258,8 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     }
 
     if (vid != 0) {
-        if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-            if (arp_msg->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+        if (vid && vlan_itf) {
+            if (arp_msg->ipv4_addr == vlan_itf->ipv4_addr) {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignore My ip %s", show_ip_str(arp_msg->ipv4_addr));
                 return;
             }
@@ -277,19 +267,18 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     }
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    msg = mlacp_find_arp(csm, arp_msg->ipv4_addr);
+    if (msg)
     {
+        msg->restored = 0;
         arp_info = (struct ARPMsg *)msg->buf;
-        if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
-            continue;
 
         entry_exists = 1;
         if (msgtype == RTM_DELNEIGH)
         {
             /* delete ARP*/
-            TAILQ_REMOVE(&MLACP(csm).arp_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_dequeue_arp(csm, msg);
+            iccp_csm_free_msg(msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete ARP %s", show_ip_str(arp_msg->ipv4_addr));
         }
@@ -307,7 +296,6 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update ARP for %s", show_ip_str(arp_msg->ipv4_addr));
             }
         }
-        break;
     }
 
     if (msg && !arp_update)
@@ -372,20 +360,19 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     return;
 }
 
-static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int msgtype, int is_del)
+static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, uint8_t *dst, uint8_t *lladdr, int msgtype, int is_del)
 {
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
     struct Msg *msg_send = NULL;
     uint16_t vid = 0;
     int entry_exists = 0;
     int is_link_local = 0;
     int ln = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     char buf[MAX_BUFSIZE] = { 0 };
     size_t msg_len = 0;
@@ -409,10 +396,10 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     ndisc_msg = (struct NDISCMsg *)&buf;
     ndisc_msg->op_type = NEIGH_SYNC_LIF;
     sprintf(ndisc_msg->ifname, "%s", ndisc_lif->name);
-    if (tb[NDA_DST])
-        memcpy(&ndisc_msg->ipv6_addr, RTA_DATA(tb[NDA_DST]), RTA_PAYLOAD(tb[NDA_DST]));
-    if (!is_del && tb[NDA_LLADDR])
-        memcpy(ndisc_msg->mac_addr, RTA_DATA(tb[NDA_LLADDR]), RTA_PAYLOAD(tb[NDA_LLADDR]));
+    if (dst)
+        memcpy(&ndisc_msg->ipv6_addr, dst, sizeof(ndisc_msg->ipv6_addr));
+    if (!is_del && lladdr)
+        memcpy(ndisc_msg->mac_addr, lladdr, ETHER_ADDR_LEN);
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "ndisc type %s, state (%04X)(%d), ifindex [%d] (%s), ip %s, mac [%02X:%02X:%02X:%02X:%02X:%02X]",
                     msgtype == RTM_NEWNEIGH ? "New" : "Del", ndm->ndm_state, fwd_neigh_state_valid(ndm->ndm_state),
@@ -440,11 +427,6 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     if ((strncmp(ndisc_msg->ifname, VLAN_PREFIX, strlen(VLAN_PREFIX)) == 0)) {
         sscanf (ndisc_msg->ifname, "Vlan%hu", &vlan_id);
     }
-
-    if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
-    }
     /* Find MLACP itf, member of port-channel */
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
@@ -461,24 +443,19 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_itf = vlan_bitmap_test(&(lif_po->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-                if (!vlan_id_list) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (vlan_itf->ifindex != ndm->ndm_ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ndm->ndm_ifindex) {
-                    ln = __LINE__;
-                    continue;
-                }
-
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
                 ICCPD_LOG_DEBUG(__FUNCTION__, "neighor is from intf %s of vlan %d", lif_po->name, vid);
             }
             else
@@ -503,11 +480,11 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_itf = vlan_bitmap_test(&(peer_link_if->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ndm->ndm_ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_itf) {
+                   if (vlan_itf->ifindex == ndm->ndm_ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from peer link vlan %d", vid);
                        verify_neigh = 1;
                        lif_po = peer_link_if;
@@ -533,8 +510,8 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
         is_link_local = 1;
     }
 
-    if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+    if (vid && vlan_itf) {
+        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
         {
             ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             return;
@@ -542,7 +519,7 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
 
         if (is_link_local)
         {
-            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_ll_addr, 16) == 0)
+            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_ll_addr, 16) == 0)
             {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
                 return;
@@ -551,20 +528,18 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     }
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    msg = mlacp_find_ndisc(csm, ndisc_msg->ipv6_addr);
+    if (msg)
     {
+        msg->restored = 0;
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
-        if (memcmp(&ndisc_info->ipv6_addr, &ndisc_msg->ipv6_addr, 16) != 0)
-            continue;
-
         entry_exists = 1;
         if (msgtype == RTM_DELNEIGH)
         {
             /* delete ND */
-            TAILQ_REMOVE(&MLACP(csm).ndisc_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_dequeue_ndisc(csm, msg);
+            iccp_csm_free_msg(msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete neighbor %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
@@ -581,7 +556,6 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update neighbor for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             }
         }
-        break;
     }
 
     if (msg && !neigh_update)
@@ -672,14 +646,17 @@ void ifm_parse_rtattr(struct rtattr **tb, int max, struct rtattr *rta, int len)
     }
 }
 
-int do_one_neigh_request(struct nlmsghdr *n)
+/* Decode a neighbor message, returns 0 if it is of no interest to mclag.
+ * Touches no iccpd state, so it is safe on the netlink ingestion thread.
+ */
+int iccp_neigh_msg_decode(struct nlmsghdr *n, struct iccp_neigh_info *info)
 {
     struct ndmsg *ndm = NLMSG_DATA(n);
     int len = n->nlmsg_len;
     struct rtattr *tb[NDA_MAX + 1] = {{0}};
     int is_del = 0;
     int msgtype = n->nlmsg_type;
-    struct CSM* csm = NULL;
+    int alen;
 
     if (n->nlmsg_type == NLMSG_DONE)
     {
@@ -690,14 +667,9 @@ int do_one_neigh_request(struct nlmsghdr *n)
     if (n->nlmsg_type != RTM_NEWNEIGH && n->nlmsg_type  != RTM_DELNEIGH )
         return(0);
 
-    /*Check if mclag configured*/
-    csm = system_get_first_csm();
-    if (!csm)
-        return(0);
-
     len -= NLMSG_LENGTH(sizeof(*ndm));
     if (len < 0)
-        return MCLAG_ERROR;
+        return 0;
 
     ifm_parse_rtattr(tb, NDA_MAX, NDA_RTA(ndm), len);
 
@@ -724,16 +696,54 @@ int do_one_neigh_request(struct nlmsghdr *n)
         return(0);
     }
 
-    if (ndm->ndm_family == AF_INET)
+    if (ndm->ndm_family != AF_INET && ndm->ndm_family != AF_INET6)
+        return 0;
+
+    memset(info, 0, sizeof(*info));
+    memcpy(&info->ndm, ndm, sizeof(info->ndm));
+    info->msgtype = msgtype;
+    info->is_del = is_del;
+
+    alen = RTA_PAYLOAD(tb[NDA_DST]);
+    memcpy(info->dst, RTA_DATA(tb[NDA_DST]), alen < sizeof(info->dst) ? alen : sizeof(info->dst));
+    if (tb[NDA_LLADDR])
     {
-        do_arp_learn_from_kernel(ndm, tb, msgtype, is_del);
+        alen = RTA_PAYLOAD(tb[NDA_LLADDR]);
+        memcpy(info->lladdr, RTA_DATA(tb[NDA_LLADDR]), alen < ETHER_ADDR_LEN ? alen : ETHER_ADDR_LEN);
+        info->has_lladdr = 1;
     }
 
-    if (ndm->ndm_family == AF_INET6)
+    return 1;
+}
+
+void do_one_neigh_info(struct iccp_neigh_info *info)
+{
+    uint8_t *lladdr = info->has_lladdr ? info->lladdr : NULL;
+
+    /*Check if mclag configured*/
+    if (!system_get_first_csm())
+        return;
+
+    if (info->ndm.ndm_family == AF_INET)
     {
-        do_ndisc_learn_from_kernel(ndm, tb, msgtype, is_del);
+        do_arp_learn_from_kernel(&info->ndm, info->dst, lladdr, info->msgtype, info->is_del);
     }
 
+    if (info->ndm.ndm_family == AF_INET6)
+    {
+        do_ndisc_learn_from_kernel(&info->ndm, info->dst, lladdr, info->msgtype, info->is_del);
+    }
+
+    return;
+}
+
+int do_one_neigh_request(struct nlmsghdr *n)
+{
+    struct iccp_neigh_info info;
+
+    if (iccp_neigh_msg_decode(n, &info))
+        do_one_neigh_info(&info);
+
     return (0);
 }
 
@@ -805,13 +815,12 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
     struct Msg *msg_send = NULL;
     uint16_t vid = 0;
     struct LocalInterface *peer_link_if = NULL;
     int ln = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     char buf[MAX_BUFSIZE] = { 0 };
     size_t msg_len = 0;
@@ -856,11 +865,6 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     if ((strncmp(arp_lif->name, VLAN_PREFIX, strlen(VLAN_PREFIX)) == 0)) {
         sscanf (arp_lif->name, "Vlan%hu", &vlan_id);
     }
-
-    if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
-    }
     /* Find MLACP itf, member of port-channel*/
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
@@ -877,24 +881,19 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_itf = vlan_bitmap_test(&(lif_po->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-                if (!vlan_id_list) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (vlan_itf->ifindex != ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ifindex) {
-                    ln = __LINE__;
-                    continue;
-                }
-
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from mclag enabled port %s of vlan %d",
                                               lif_po->name, vid);
             }
@@ -919,11 +918,11 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_itf = vlan_bitmap_test(&(peer_link_if->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_itf) {
+                   if (vlan_itf->ifindex == ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from peer link vlan %d", vid);
                        verify_arp = 1;
                        lif_po = peer_link_if;
@@ -951,8 +950,8 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             return;
         }
     } else {
-        if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-            if (arp_msg->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+        if (vid && vlan_itf) {
+            if (arp_msg->ipv4_addr == vlan_itf->ipv4_addr) {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignore My ip %s", show_ip_str(arp_msg->ipv4_addr));
                 return;
             }
@@ -960,11 +959,11 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     }
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    msg = mlacp_find_arp(csm, arp_msg->ipv4_addr);
+    if (msg)
     {
+        msg->restored = 0;
         arp_info = (struct ARPMsg*)msg->buf;
-        if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
-            continue;
 
         /* update ARP*/
         if (arp_info->op_type != arp_msg->op_type
@@ -977,7 +976,6 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             ICCPD_LOG_DEBUG(__FUNCTION__, "Update ARP for %s",
                             show_ip_str(arp_msg->ipv4_addr));
         }
-        break;
     }
 
     /* enquene lif_msg (add)*/
@@ -1021,7 +1019,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
     struct Msg *msg_send = NULL;
     char mac_str[18] = "";
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
@@ -1034,7 +1032,6 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     size_t msg_len = 0;
     char addr_null[16] = { 0 };
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     struct LocalInterface *lif_po = NULL, *ndisc_lif = NULL;
 
@@ -1074,11 +1071,6 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     if ((strncmp(ndisc_lif->name, VLAN_PREFIX, strlen(VLAN_PREFIX)) == 0)) {
         sscanf (ndisc_lif->name, "Vlan%hu", &vlan_id);
     }
-
-    if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
-    }
     /* Find MLACP itf, member of port-channel */
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
@@ -1094,24 +1086,19 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_itf = vlan_bitmap_test(&(lif_po->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-                if (!vlan_id_list) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (vlan_itf->ifindex != ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ifindex) {
-                    ln = __LINE__;
-                    continue;
-                }
-
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
             }
             else
             {
@@ -1134,11 +1121,11 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_itf = vlan_bitmap_test(&(peer_link_if->vlan_bitmap), vlan_id) ? local_if_vlan_itf(vlan_id) : NULL;
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_itf) {
+                   if (vlan_itf->ifindex == ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from peer link vlan %d", vid);
                        verify_ndisc = 1;
                        lif_po = peer_link_if;
@@ -1164,8 +1151,8 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
         is_link_local = 1;
     }
 
-    if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+    if (vid && vlan_itf) {
+        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
         {
             ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             return;
@@ -1173,7 +1160,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
 
         if (is_link_local)
         {
-            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_ll_addr, 16) == 0)
+            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_ll_addr, 16) == 0)
             {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
                 return;
@@ -1182,13 +1169,12 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     }
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    msg = mlacp_find_ndisc(csm, ndisc_msg->ipv6_addr);
+    if (msg)
     {
+        msg->restored = 0;
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
-        if (memcmp((char *)ndisc_info->ipv6_addr, (char *)ndisc_msg->ipv6_addr, 16) != 0)
-            continue;
-
         /* If MAC addr is NULL, use the old one */
         if (memcmp(mac_addr, null_mac, ETHER_ADDR_LEN) == 0)
         {
@@ -1206,7 +1192,6 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
             memcpy(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
              ICCPD_LOG_DEBUG(__FUNCTION__, "Update ND for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
-        break;
     }
 
     /* enquene lif_msg (add) */
@@ -1327,34 +1312,15 @@ struct PendingVlanMbrIf* find_pending_vlan_mbr_if(struct System *sys, const char
 //add specific vlan id to pending vlan membership interface
 int add_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-    char vlan_name[16] = "";
-    if (!mbr_if)
+    if (!mbr_if || vid >= VLAN_ID_MAX)
     {
         return MCLAG_ERROR;
     }
 
-    sprintf(vlan_name, "Vlan%d", vid);
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
-    vlan = RB_FIND(vlan_rb_tree, &(mbr_if->vlan_tree), &vlan_key);
-
-    if (!vlan)
+    if (!vlan_bitmap_test(&mbr_if->vlan_bitmap, vid))
     {
-        vlan = (struct VLAN_ID*)malloc(sizeof(struct VLAN_ID));
-        if (!vlan)
-        {
-            ICCPD_LOG_WARN(__FUNCTION__, "Add Pending Vlan Member for If:%s Vlan:%d creation, malloc failed", mbr_if->name, vid);
-            return MCLAG_ERROR;
-        }
-
-        memset(vlan, 0, sizeof(struct VLAN_ID));
-        vlan->vid = vid;
-
         ICCPD_LOG_DEBUG(__FUNCTION__, "Add VLAN %d to pending vlan member if:%s ", vid, mbr_if->name);
-        RB_INSERT(vlan_rb_tree, &(mbr_if->vlan_tree), vlan);
+        vlan_bitmap_set(&mbr_if->vlan_bitmap, vid);
     }
     return 0;
 }
@@ -1362,21 +1328,14 @@ int add_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 //delete specific vlan id from pending vlan membership interface
 void del_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
     if (!mbr_if)
     {
         return;
     }
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
 
-    vlan = RB_FIND(vlan_rb_tree, &(mbr_if->vlan_tree), &vlan_key);
-
-    if (vlan != NULL)
+    if (vlan_bitmap_test(&mbr_if->vlan_bitmap, vid))
     {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(mbr_if->vlan_tree), vlan);
-        free(vlan);
+        vlan_bitmap_clear(&mbr_if->vlan_bitmap, vid);
         ICCPD_LOG_DEBUG(__FUNCTION__, "Remove VLAN %d from pending vlan mbr If:%s ",vid, mbr_if->name);
     }
     return;
@@ -1386,15 +1345,8 @@ void del_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 //delete all pending vlan members for a given vlan member interface
 void del_all_pending_vlan_mbrs(struct PendingVlanMbrIf* lif)
 {
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
-
     ICCPD_LOG_DEBUG(__FUNCTION__, "Remove all Pending VLANs from %s", lif->name);
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(lif->vlan_tree), vlan_temp)
-    {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(lif->vlan_tree), vlan);
-        free(vlan);
-    }
+    vlan_bitmap_zero(&lif->vlan_bitmap);
     return;
 }
 
@@ -1404,8 +1356,6 @@ void update_pending_vlan_mbr(char *mbr_if_name, unsigned int vlan_id,  int add_f
 {
     struct System *sys = NULL;
     struct PendingVlanMbrIf *mbr_if;
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
 
     if (!(sys = system_get_instance()))
     {
@@ -1429,7 +1379,7 @@ void update_pending_vlan_mbr(char *mbr_if_name, unsigned int vlan_id,  int add_f
             return;
         }
         snprintf(mbr_if->name, MAX_L_PORT_NAME, "%s", mbr_if_name);
-        RB_INIT(vlan_rb_tree, &mbr_if->vlan_tree);
+        vlan_bitmap_zero(&mbr_if->vlan_bitmap);
         LIST_INSERT_HEAD(&(sys->pending_vlan_mbr_if_list), mbr_if, if_next);
     }
     if (add_flag)
@@ -1449,8 +1399,7 @@ void update_pending_vlan_mbr(char *mbr_if_name, unsigned int vlan_id,  int add_f
 void move_pending_vlan_mbr_to_lif(struct System *sys, struct LocalInterface* lif)
 {
     struct PendingVlanMbrIf *mbr_if;
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
+    uint16_t vid;
     if (!sys || !lif)
     {
         return;
@@ -1463,14 +1412,12 @@ void move_pending_vlan_mbr_to_lif(struct System *sys, struct LocalInterface* lif
         return;
     }
 
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(mbr_if->vlan_tree), vlan_temp)
+    VLAN_BITMAP_FOREACH(vid, &mbr_if->vlan_bitmap)
     {
         //add vlan to system lif
-        local_if_add_vlan(lif, vlan->vid);
-
-        //delete from pending vlan member if
-        del_pending_vlan_mbr(mbr_if, vlan->vid);
+        local_if_add_vlan(lif, vid);
     }
+    vlan_bitmap_zero(&mbr_if->vlan_bitmap);
 
     ICCPD_LOG_DEBUG(__FUNCTION__, "Delete pending vlan member if %s \n", lif->name);
     LIST_REMOVE(mbr_if, if_next);
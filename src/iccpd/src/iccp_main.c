@@ -265,8 +265,8 @@ int main(int argc, char* argv[])
     scheduler_init();
     scheduler_start();
     system_finalize();
-    /*scheduler_finalize();
-       log_finalize();*/
+    /*scheduler_finalize();*/
+    log_finalize();
 
     return EXIT_SUCCESS;
 }
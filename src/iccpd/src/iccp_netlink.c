@@ -21,6 +21,7 @@
  *  Maintainer: jianjun, grace Li from nephos
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdbool.h>
 #include <unistd.h>
@@ -46,6 +47,7 @@
 #include <linux/types.h>
 #include <linux/socket.h>
 #include <linux/in6.h>
+#include <linux/filter.h>
 
 #include "../include/system.h"
 #include "../include/iccp_ifm.h"
@@ -58,6 +60,7 @@
 #include "../include/iccp_netlink.h"
 #include "../include/mlacp_sync_update.h"
 #include "../include/mlacp_tlv.h"
+#include "../include/iccp_nl_ingest.h"
 
 /**
  * SECTION: Netlink helpers
@@ -500,19 +503,7 @@ void iccp_set_interface_ipadd_mac(struct LocalInterface *lif, char * mac_addr )
     msg_hdr->len += sub_msg->op_len;
 
     /*send msg*/
-    if (sys->sync_fd)
-    {
-        if (write(sys->sync_fd,msg_buf, msg_hdr->len) == -1)
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
-        }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
-    }
+    iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
     return;
 }
 
@@ -626,7 +617,8 @@ void update_if_ipmac_on_standby(struct LocalInterface* lif_po, int dir)
 {
     struct CSM* csm;
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    uint16_t vid;
 
     csm = lif_po->csm;
     struct LocalInterface* lif_Bri;
@@ -689,44 +681,45 @@ void update_if_ipmac_on_standby(struct LocalInterface* lif_po, int dir)
     }
     else
     {
-        RB_FOREACH(vlan, vlan_rb_tree, &(lif_po->vlan_tree))
+        VLAN_BITMAP_FOREACH(vid, &lif_po->vlan_bitmap)
         {
-            if (!vlan->vlan_itf)
+            vlan_itf = local_if_vlan_itf(vid);
+            if (!vlan_itf)
                 continue;
 
             /*If the po is under a vlan, update vlan mac*/
-            if (local_if_is_l3_mode(vlan->vlan_itf))
+            if (local_if_is_l3_mode(vlan_itf))
             {
 
                 ICCPD_LOG_NOTICE(__FUNCTION__,
                         "%s Change the system-id of %s from [%02X:%02X:%02X:%02X:%02X:%02X] to [%02X:%02X:%02X:%02X:%02X:%02X], proto %d, dir %d",
                         (csm->role_type == STP_ROLE_STANDBY) ? "Standby" : "Active",
-                        vlan->vlan_itf->name, vlan->vlan_itf->l3_mac_addr[0], vlan->vlan_itf->l3_mac_addr[1],
-                        vlan->vlan_itf->l3_mac_addr[2], vlan->vlan_itf->l3_mac_addr[3],
-                        vlan->vlan_itf->l3_mac_addr[4], vlan->vlan_itf->l3_mac_addr[5],
+                        vlan_itf->name, vlan_itf->l3_mac_addr[0], vlan_itf->l3_mac_addr[1],
+                        vlan_itf->l3_mac_addr[2], vlan_itf->l3_mac_addr[3],
+                        vlan_itf->l3_mac_addr[4], vlan_itf->l3_mac_addr[5],
                         MLACP(csm).remote_system.system_id[0], MLACP(csm).remote_system.system_id[1],
                         MLACP(csm).remote_system.system_id[2], MLACP(csm).remote_system.system_id[3],
                         MLACP(csm).remote_system.system_id[4], MLACP(csm).remote_system.system_id[5],
-                        vlan->vlan_itf->is_l3_proto_enabled, dir);
+                        vlan_itf->is_l3_proto_enabled, dir);
 
-                if ((memcmp(vlan->vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN) != 0)
-                        && (vlan->vlan_itf->is_l3_proto_enabled == false))
+                if ((memcmp(vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN) != 0)
+                        && (vlan_itf->is_l3_proto_enabled == false))
                 {
-                    ret = iccp_netlink_if_hwaddr_set(vlan->vlan_itf->ifindex, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
+                    ret = iccp_netlink_if_hwaddr_set(vlan_itf->ifindex, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
                     if (ret != 0)
                     {
-                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d, dir %d", vlan->vlan_itf->name, ret, dir);
+                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d, dir %d", vlan_itf->name, ret, dir);
                     }
 
                     /* Refresh link local address according the new MAC */
-                    iccp_netlink_if_shutdown_set(vlan->vlan_itf->ifindex);
-                    iccp_netlink_if_startup_set(vlan->vlan_itf->ifindex);
+                    iccp_netlink_if_shutdown_set(vlan_itf->ifindex);
+                    iccp_netlink_if_startup_set(vlan_itf->ifindex);
 
-                    iccp_set_interface_ipadd_mac(vlan->vlan_itf, macaddr);
-                    memcpy(vlan->vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
+                    iccp_set_interface_ipadd_mac(vlan_itf, macaddr);
+                    memcpy(vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
                 }
             } else {
-                ICCPD_LOG_NOTICE(__FUNCTION__, "%s not L3 interface, dir %d", vlan->vlan_itf->name, dir);
+                ICCPD_LOG_NOTICE(__FUNCTION__, "%s not L3 interface, dir %d", vlan_itf->name, dir);
             }
         }
     }
@@ -738,7 +731,8 @@ void recover_if_ipmac_on_standby(struct LocalInterface *lif_po, int dir)
 {
     struct CSM *csm;
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    uint16_t vid;
 
     csm = lif_po->csm;
     char macaddr[64];
@@ -792,31 +786,32 @@ void recover_if_ipmac_on_standby(struct LocalInterface *lif_po, int dir)
     }
     else
     {
-        RB_FOREACH(vlan, vlan_rb_tree, &(lif_po->vlan_tree))
+        VLAN_BITMAP_FOREACH(vid, &lif_po->vlan_bitmap)
         {
-            if (!vlan->vlan_itf)
+            vlan_itf = local_if_vlan_itf(vid);
+            if (!vlan_itf)
                 continue;
 
             /*If the po is under a vlan, update vlan mac*/
-            if (local_if_is_l3_mode(vlan->vlan_itf) && (vlan->vlan_itf->is_l3_proto_enabled == false))
+            if (local_if_is_l3_mode(vlan_itf) && (vlan_itf->is_l3_proto_enabled == false))
             {
-                ret = iccp_netlink_if_hwaddr_set(vlan->vlan_itf->ifindex, MLACP(csm).system_id, ETHER_ADDR_LEN);
+                ret = iccp_netlink_if_hwaddr_set(vlan_itf->ifindex, MLACP(csm).system_id, ETHER_ADDR_LEN);
                 if (ret != 0)
                 {
                     if (ret != ICCP_NLE_SEQ_MISMATCH) {
-                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d", vlan->vlan_itf->name, ret);
+                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d", vlan_itf->name, ret);
                     }
                 }
 
                 /* Refresh link local address according the new MAC */
-                iccp_netlink_if_shutdown_set(vlan->vlan_itf->ifindex);
-                iccp_netlink_if_startup_set(vlan->vlan_itf->ifindex);
+                iccp_netlink_if_shutdown_set(vlan_itf->ifindex);
+                iccp_netlink_if_startup_set(vlan_itf->ifindex);
 
-                iccp_set_interface_ipadd_mac(vlan->vlan_itf, macaddr);
-                memcpy(vlan->vlan_itf->l3_mac_addr, MLACP(csm).system_id, ETHER_ADDR_LEN);
+                iccp_set_interface_ipadd_mac(vlan_itf, macaddr);
+                memcpy(vlan_itf->l3_mac_addr, MLACP(csm).system_id, ETHER_ADDR_LEN);
             } else {
                 ICCPD_LOG_NOTICE(__FUNCTION__, "%s not L3 interface, proto %d, dir %d",
-                        vlan->vlan_itf->name, vlan->vlan_itf->is_l3_proto_enabled, dir);
+                        vlan_itf->name, vlan_itf->is_l3_proto_enabled, dir);
             }
         }
     }
@@ -957,7 +952,7 @@ void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg)
 
     if (lif && (lif->ifindex == -1) && (lif->type == IF_T_VLAN))
     {
-        lif->ifindex = ifindex;
+        local_if_set_ifindex(lif, ifindex);
         lif->state = (op_state == IF_OPER_UP) ? PORT_STATE_UP : PORT_STATE_DOWN;
 
         if (addr_type == AF_LLC)
@@ -1226,8 +1221,8 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
-    struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
+    struct ARPMsg *arp_msg = NULL;
+    struct NDISCMsg *ndisc_msg = NULL;
     int err = 0;
 
     if (!(sys = system_get_instance()))
@@ -1239,20 +1234,12 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
         LIST_FOREACH(csm, &(sys->csm_list), next)
         {
-            TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
-            {
-                arp_info = (struct ARPMsg *)msg->buf;
-                if (arp_info->ipv4_addr == lif->ipv4_addr) {
-                    ICCPD_LOG_NOTICE(__FUNCTION__, " Delete ARP %s", show_ip_str(lif->ipv4_addr));
-                    break;
-                }
-            }
-
+            msg = mlacp_find_arp(csm, lif->ipv4_addr);
             if (msg)
             {
-                TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
-                free(msg->buf);
-                free(msg);
+                ICCPD_LOG_NOTICE(__FUNCTION__, " Delete ARP %s", show_ip_str(lif->ipv4_addr));
+                mlacp_dequeue_arp(csm, msg);
+                iccp_csm_free_msg(msg);
                 msg = NULL;
                 break;
             }
@@ -1261,21 +1248,12 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
         LIST_FOREACH(csm, &(sys->csm_list), next)
         {
-            TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
-            {
-                ndisc_info = (struct NDISCMsg *)msg->buf;
-
-                if (memcmp(&ndisc_info->ipv6_addr, &lif->ipv6_addr, 16) == 0) {
-                    ICCPD_LOG_DEBUG(__FUNCTION__, " Delete neighbor %s", show_ipv6_str((char *)lif->ipv6_addr));
-                    break;
-                }
-            }
-
+            msg = mlacp_find_ndisc(csm, lif->ipv6_addr);
             if (msg)
             {
-                TAILQ_REMOVE(&MLACP(csm).ndisc_list, msg, tail);
-                free(msg->buf);
-                free(msg);
+                ICCPD_LOG_DEBUG(__FUNCTION__, " Delete neighbor %s", show_ipv6_str((char *)lif->ipv6_addr));
+                mlacp_dequeue_ndisc(csm, msg);
+                iccp_csm_free_msg(msg);
                 msg = NULL;
                 break;
             }
@@ -1533,10 +1511,26 @@ int iccp_sys_local_if_list_get_addr()
     return ret;
 }
 
+/* libnl parsed a link or address message on the ingestion thread */
+static void iccp_event_obj_input(struct nl_object *obj, void *arg)
+{
+    struct iccp_nl_event event;
+
+    event.type = ICCP_NL_EVENT_OBJ;
+    event.msgtype = *(uint16_t *)arg;
+    nl_object_get(obj);
+    event.u.obj = obj;
+    iccp_nl_ingest_add(&event);
+
+    return;
+}
+
+/* Runs on the netlink ingestion thread, only decodes the message */
 static int iccp_route_event_handler(struct nl_msg *msg, void *arg)
 {
     struct nlmsghdr *nlh = nlmsg_hdr(msg);
-    unsigned int event = 1;
+    struct iccp_nl_event event;
+    uint16_t msgtype = nlh->nlmsg_type;
 
     /* Update netlink message counters */
     system_update_netlink_counters(nlh->nlmsg_type, nlh);
@@ -1544,36 +1538,80 @@ static int iccp_route_event_handler(struct nl_msg *msg, void *arg)
     switch (nlh->nlmsg_type)
     {
         case RTM_NEWLINK:
-            if (nl_msg_parse(msg, &iccp_event_handler_obj_input_newlink, &event) < 0)
-                ICCPD_LOG_DEBUG(__FUNCTION__, "Unknown message type(RTM_NEWLINK)");
             //vlan membership changes are handled through state db updates
             //iccp_parse_if_vlan_info_from_netlink(nlh);
-            break;
-
         case RTM_DELLINK:
-            if (nl_msg_parse(msg, &iccp_event_handler_obj_input_dellink, NULL) < 0)
-                ICCPD_LOG_DEBUG(__FUNCTION__, "Unknown message type(RTM_DELLINK)");
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            if (nl_msg_parse(msg, &iccp_event_obj_input, &msgtype) < 0)
+                ICCPD_LOG_DEBUG(__FUNCTION__, "Unknown message type(%d)", msgtype);
             break;
 
         case RTM_NEWNEIGH:
         case RTM_DELNEIGH:
-            do_one_neigh_request(nlh);
+            if (iccp_neigh_msg_decode(nlh, &event.u.neigh))
+            {
+                event.type = ICCP_NL_EVENT_NEIGH;
+                event.msgtype = msgtype;
+                iccp_nl_ingest_add(&event);
+            }
+            break;
+
+        default:
+            return NL_OK;
+    }
+
+    return NL_STOP;
+}
+
+/* Decode recorded route messages as if the kernel sent them, the
+ * ingestion thread must not be running. Returns the messages taken.
+ */
+int iccp_netlink_replay(char *buf, int len)
+{
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+    struct nl_msg *msg;
+    int count = 0;
+
+    for (; nlmsg_ok(nlh, len); nlh = nlmsg_next(nlh, &len))
+    {
+        if ((msg = nlmsg_convert(nlh)) == NULL)
+            break;
+        nlmsg_set_proto(msg, NETLINK_ROUTE);
+        iccp_route_event_handler(msg, NULL);
+        nlmsg_free(msg);
+        count++;
+    }
+    iccp_nl_ingest_flush();
+
+    return count;
+}
+
+/* Link and address events handed over by the ingestion thread */
+void iccp_netlink_obj_event_handler(int msgtype, struct nl_object *obj)
+{
+    unsigned int event = 1;
+
+    switch (msgtype)
+    {
+        case RTM_NEWLINK:
+            iccp_event_handler_obj_input_newlink(obj, &event);
+            break;
+
+        case RTM_DELLINK:
+            iccp_event_handler_obj_input_dellink(obj, NULL);
             break;
 
         case RTM_NEWADDR:
-            if (nl_msg_parse(msg, &iccp_event_handler_obj_input_newaddr, NULL) < 0)
-                ICCPD_LOG_DEBUG(__FUNCTION__, "Unknown message type.");
+            iccp_event_handler_obj_input_newaddr(obj, NULL);
             break;
+
         case RTM_DELADDR:
-            if (nl_msg_parse(msg, &iccp_event_handler_obj_input_deladdr, NULL) < 0)
-                ICCPD_LOG_DEBUG(__FUNCTION__, "Unknown message type.");
+            iccp_event_handler_obj_input_deladdr(obj, NULL);
             break;
-
-        default:
-            return NL_OK;
     }
 
-    return NL_STOP;
+    return;
 }
 
 /**
@@ -1639,6 +1677,39 @@ int iccp_make_nd_socket(void)
     return sock;
 }
 
+/* Only ARP replies for IPv4 over Ethernet reach the ARP socket.
+ * SOCK_DGRAM packet sockets hand over the packet from the ARP header on.
+ */
+static struct sock_filter iccp_arp_reply_filter[] =
+{
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),                  /* ar_op */
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ARPOP_REPLY, 0, 7),
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 2),                  /* ar_pro */
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 5),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 4),                  /* ar_hln */
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHER_ADDR_LEN, 0, 3),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 5),                  /* ar_pln */
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 4, 0, 1),
+    BPF_STMT(BPF_RET | BPF_K, 0xffff),
+    BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+static int iccp_attach_arp_filter(int sock)
+{
+    struct sock_fprog prog;
+
+    prog.len = sizeof(iccp_arp_reply_filter) / sizeof(iccp_arp_reply_filter[0]);
+    prog.filter = iccp_arp_reply_filter;
+
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to attach ARP filter, errno %d", errno);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
 /*init netlink socket*/
 int iccp_system_init_netlink_socket()
 {
@@ -1788,6 +1859,9 @@ int iccp_system_init_netlink_socket()
         }
     }
 
+    /* Not fatal, replies are checked again when received */
+    iccp_attach_arp_filter(sys->arp_receive_fd);
+
     /* receive ipv6 packet socket */
     //sys->ndisc_receive_fd = socket(PF_PACKET, SOCK_DGRAM, 0);
     sys->ndisc_receive_fd = iccp_make_nd_socket();
@@ -1870,40 +1944,34 @@ static int iccp_netlink_genic_sock_event_handler(struct System *sys)
     return ret;
 }
 
-static int iccp_get_netlink_route_sock_event_fd(struct System *sys)
-{
-    return nl_socket_get_fd(sys->route_event_sock);
-}
+/* Receive buffers of the ingestion thread, filled by recvmmsg */
+static unsigned char g_arp_rx_buf[ICCP_PKT_RX_BATCH][1024];
+static struct sockaddr_ll g_arp_rx_sll[ICCP_PKT_RX_BATCH];
+static struct mmsghdr g_arp_rx_msgs[ICCP_PKT_RX_BATCH];
+static struct iovec g_arp_rx_iov[ICCP_PKT_RX_BATCH];
 
-static int iccp_get_receive_arp_packet_sock_fd(struct System *sys)
-{
-    return sys->arp_receive_fd;
-}
+static uint8_t g_ndisc_rx_buf[ICCP_PKT_RX_BATCH][4096];
+static uint8_t g_ndisc_rx_adata[ICCP_PKT_RX_BATCH][1024];
+static struct sockaddr_in6 g_ndisc_rx_from[ICCP_PKT_RX_BATCH];
+static struct mmsghdr g_ndisc_rx_msgs[ICCP_PKT_RX_BATCH];
+static struct iovec g_ndisc_rx_iov[ICCP_PKT_RX_BATCH];
 
-static int iccp_get_receive_ndisc_packet_sock_fd(struct System *sys)
+static void iccp_pkt_rx_batch_stats(struct iccp_pkt_rx_stats *stats, int count)
 {
-    return sys->ndisc_receive_fd;
+    ++stats->batch_counter;
+    stats->pkt_counter += count;
+    if (count > stats->batch_max)
+        stats->batch_max = count;
+    if (count == ICCP_PKT_RX_BATCH)
+        ++stats->batch_full_counter;
+
+    return;
 }
 
-static int iccp_receive_arp_packet_handler(struct System *sys)
+static void iccp_arp_packet_input(unsigned char *buf, int n, struct sockaddr_ll *sll)
 {
-    unsigned char buf[1024];
-    struct sockaddr_ll sll;
-    socklen_t sll_len = sizeof(sll);
     struct arphdr *a = (struct arphdr*)buf;
-    int n;
-    unsigned int ifindex;
-    unsigned int addr;
-    uint8_t mac_addr[ETHER_ADDR_LEN];
-    struct CSM* csm = NULL;
-
-    n = recvfrom(sys->arp_receive_fd, buf, sizeof(buf), MSG_DONTWAIT,
-                 (struct sockaddr*)&sll, &sll_len);
-    if (n < 0)
-    {
-        ICCPD_LOG_WARN(__FUNCTION__, "ARP recvfrom error: %s", buf);
-        return MCLAG_ERROR;
-    }
+    struct iccp_nl_event event;
 
     /* Sanity checks */
     /*Only process ARPOP_REPLY*/
@@ -1911,32 +1979,70 @@ static int iccp_receive_arp_packet_handler(struct System *sys)
         a->ar_op != htons(ARPOP_REPLY) ||
         a->ar_pln != 4 ||
         a->ar_pro != htons(ETH_P_IP) ||
-        a->ar_hln != sll.sll_halen ||
+        a->ar_hln != sll->sll_halen ||
         sizeof(*a) + 2 * 4 + 2 * a->ar_hln > n)
-        return 0;
+        return;
 
-    /*Check if mclag configured*/
-    csm = system_get_first_csm();
-    if (!csm)
-        return 0;
+    memset(&event, 0, sizeof(event));
+    event.type = ICCP_NL_EVENT_ARP_REPLY;
+    event.u.reply.ifindex = sll->sll_ifindex;
+    memcpy(event.u.reply.mac, (char*)(a + 1), ETHER_ADDR_LEN);
+    memcpy(event.u.reply.addr, (char*)(a + 1) + a->ar_hln, 4);
+    iccp_nl_ingest_add(&event);
+
+    return;
+}
 
-    ifindex = sll.sll_ifindex;
-    memcpy(mac_addr,  (char*)(a + 1), ETHER_ADDR_LEN);
-    memcpy(&addr, (char*)(a + 1) + a->ar_hln, 4);
+/* Read up to ICCP_PKT_RX_BATCH packets with one system call */
+static int iccp_receive_arp_packet_batch(struct System *sys)
+{
+    int count;
+    int i;
 
-    do_arp_update_from_reply_packet(ifindex, addr, mac_addr);
+    for (i = 0; i < ICCP_PKT_RX_BATCH; i++)
+    {
+        g_arp_rx_iov[i].iov_base = g_arp_rx_buf[i];
+        g_arp_rx_iov[i].iov_len = sizeof(g_arp_rx_buf[i]);
+        memset(&g_arp_rx_msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+        g_arp_rx_msgs[i].msg_hdr.msg_name = &g_arp_rx_sll[i];
+        g_arp_rx_msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_ll);
+        g_arp_rx_msgs[i].msg_hdr.msg_iov = &g_arp_rx_iov[i];
+        g_arp_rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    count = recvmmsg(sys->arp_receive_fd, g_arp_rx_msgs, ICCP_PKT_RX_BATCH, MSG_DONTWAIT, NULL);
+    if (count < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            ICCPD_LOG_WARN(__FUNCTION__, "ARP recvmmsg error: %d", errno);
+        return MCLAG_ERROR;
+    }
+
+    iccp_pkt_rx_batch_stats(&sys->dbg_counters.arp_rx_stats, count);
+
+    for (i = 0; i < count; i++)
+        iccp_arp_packet_input(g_arp_rx_buf[i], g_arp_rx_msgs[i].msg_len, &g_arp_rx_sll[i]);
+
+    return count;
+}
+
+/* Runs on the netlink ingestion thread */
+int iccp_receive_arp_packet_handler(struct System *sys)
+{
+    int i;
+
+    for (i = 0; i < ICCP_NL_READ_BUDGET; i++)
+    {
+        if (iccp_receive_arp_packet_batch(sys) < ICCP_PKT_RX_BATCH)
+            break;
+    }
 
     return 0;
 }
 
-int iccp_receive_ndisc_packet_handler(struct System *sys)
+static void iccp_ndisc_packet_input(uint8_t *buf, int len, struct msghdr *msg)
 {
-    uint8_t buf[4096];
-    uint8_t adata[1024];
-    struct sockaddr_in6 from;
     unsigned int ifindex = 0;
-    struct msghdr msg;
-    struct iovec iov;
     struct cmsghdr *cmsgptr;
     struct nd_msg *ndmsg = NULL;
     struct nd_opt_hdr *nd_opt = NULL;
@@ -1944,29 +2050,13 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
     uint8_t mac_addr[ETHER_ADDR_LEN] = { 0 };
     int8_t *opt = NULL;
     int opt_len = 0, l = 0;
-    int len;
-    struct CSM* csm = NULL;
+    struct iccp_nl_event event;
 
-    /* Fill in message and iovec. */
-    msg.msg_name = (void *)(&from);
-    msg.msg_namelen = sizeof(struct sockaddr_in6);
-    msg.msg_iov = &iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = (void *)adata;
-    msg.msg_controllen = sizeof adata;
-    iov.iov_base = buf;
-    iov.iov_len = 4096;
-
-    len = recvmsg(sys->ndisc_receive_fd, &msg, 0);
-
-    if (len < 0)
-    {
-        ICCPD_LOG_DEBUG(__FUNCTION__, "ndisc recvmsg error!");
-        return MCLAG_ERROR;
-    }
+    if (len < sizeof(struct nd_msg))
+        return;
 
-    if (msg.msg_controllen >= sizeof(struct cmsghdr))
-        for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(&msg, cmsgptr))
+    if (msg->msg_controllen >= sizeof(struct cmsghdr))
+        for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
         {
             /* I want interface index which this packet comes from. */
             if (cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO)
@@ -1980,13 +2070,8 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
 
     ndmsg = (struct nd_msg *)buf;
 
-    /*Check if mclag configured*/
-    csm = system_get_first_csm();
-    if (!csm)
-        return 0;
-
     if (ndmsg->icmph.icmp6_type != NDISC_NEIGHBOUR_ADVERTISEMENT)
-        return 0;
+        return;
 
     memcpy((char *)(&target), (char *)(&ndmsg->target), sizeof(struct in6_addr));
 
@@ -1999,14 +2084,14 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
         while (opt_len)
         {
             if (opt_len < sizeof(struct nd_opt_hdr))
-                return 0;
+                return;
 
             nd_opt = (struct nd_opt_hdr *)opt;
 
             l = nd_opt->nd_opt_len << 3;
 
             if (l == 0)
-                return 0;
+                return;
 
             if (nd_opt->nd_opt_type == ND_OPT_TARGET_LL_ADDR)
             {
@@ -2019,7 +2104,65 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
         }
     }
 
-    do_ndisc_update_from_reply_packet(ifindex, (char *)&target, mac_addr);
+    memset(&event, 0, sizeof(event));
+    event.type = ICCP_NL_EVENT_ND_REPLY;
+    event.u.reply.ifindex = ifindex;
+    memcpy(event.u.reply.addr, &target, sizeof(target));
+    memcpy(event.u.reply.mac, mac_addr, ETHER_ADDR_LEN);
+    iccp_nl_ingest_add(&event);
+
+    return;
+}
+
+/* Read up to ICCP_PKT_RX_BATCH packets with one system call,
+ * the ICMPv6 filter of the socket only lets advertisements through.
+ */
+static int iccp_receive_ndisc_packet_batch(struct System *sys)
+{
+    struct msghdr *msg;
+    int count;
+    int i;
+
+    for (i = 0; i < ICCP_PKT_RX_BATCH; i++)
+    {
+        g_ndisc_rx_iov[i].iov_base = g_ndisc_rx_buf[i];
+        g_ndisc_rx_iov[i].iov_len = sizeof(g_ndisc_rx_buf[i]);
+        msg = &g_ndisc_rx_msgs[i].msg_hdr;
+        msg->msg_name = (void *)(&g_ndisc_rx_from[i]);
+        msg->msg_namelen = sizeof(struct sockaddr_in6);
+        msg->msg_iov = &g_ndisc_rx_iov[i];
+        msg->msg_iovlen = 1;
+        msg->msg_control = (void *)g_ndisc_rx_adata[i];
+        msg->msg_controllen = sizeof(g_ndisc_rx_adata[i]);
+        msg->msg_flags = 0;
+    }
+
+    count = recvmmsg(sys->ndisc_receive_fd, g_ndisc_rx_msgs, ICCP_PKT_RX_BATCH, MSG_DONTWAIT, NULL);
+    if (count < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            ICCPD_LOG_DEBUG(__FUNCTION__, "ndisc recvmmsg error!");
+        return MCLAG_ERROR;
+    }
+
+    iccp_pkt_rx_batch_stats(&sys->dbg_counters.ndisc_rx_stats, count);
+
+    for (i = 0; i < count; i++)
+        iccp_ndisc_packet_input(g_ndisc_rx_buf[i], g_ndisc_rx_msgs[i].msg_len, &g_ndisc_rx_msgs[i].msg_hdr);
+
+    return count;
+}
+
+/* Runs on the netlink ingestion thread */
+int iccp_receive_ndisc_packet_handler(struct System *sys)
+{
+    int i;
+
+    for (i = 0; i < ICCP_NL_READ_BUDGET; i++)
+    {
+        if (iccp_receive_ndisc_packet_batch(sys) < ICCP_PKT_RX_BATCH)
+            break;
+    }
 
     return 0;
 }
@@ -2040,6 +2183,14 @@ void iccp_netlink_sync_again()
         iccp_sys_local_if_list_get_init();
     }
 
+    if (sys->need_sync_neigh_again)
+    {
+        sys->need_sync_neigh_again = 0;
+
+        /*Get kernel ARP info */
+        iccp_neigh_get_init();
+    }
+
     if (sys->need_sync_team_again)
     {
         sys->need_sync_team_again = 0;
@@ -2056,22 +2207,28 @@ void iccp_netlink_sync_again()
     return;
 }
 
-static int iccp_netlink_route_sock_event_handler(struct System *sys)
+/* Runs on the netlink ingestion thread, the socket is non-blocking */
+int iccp_netlink_route_sock_event_handler(struct System *sys)
 {
+    struct nl_cb *cb;
     int ret = 0;
+    int i;
 
-    ret = nl_recvmsgs_default(sys->route_event_sock);
+    cb = nl_socket_get_cb(sys->route_event_sock);
+    for (i = 0; i < ICCP_NL_READ_BUDGET; i++)
+    {
+        ret = nl_recvmsgs_report(sys->route_event_sock, cb);
+        if (ret <= 0)
+            break;
+    }
+    nl_cb_put(cb);
 
-    if (ret)
+    if (ret < 0)
     {
-        sys->need_sync_netlink_again = 1;
         ICCPD_LOG_NOTICE(__FUNCTION__, "fd %d recvmsg error ret = %d  errno = %d ", nl_socket_get_fd(sys->route_event_sock), ret, errno);
         SYSTEM_INCR_NETLINK_RX_ERROR();
-    }
-    /*get netlink info again when error happens */
-    if (ret == 0 && sys->need_sync_netlink_again == 1)
-    {
-        iccp_netlink_sync_again();
+        /*get netlink info again when error happens */
+        iccp_nl_ingest_resync();
     }
 
     return ret;
@@ -2097,16 +2254,9 @@ static const struct iccp_eventfd iccp_eventfds[] = {
         .event_handler = iccp_netlink_genic_sock_event_handler,
     },
     {
-        .get_fd = iccp_get_netlink_route_sock_event_fd,
-        .event_handler = iccp_netlink_route_sock_event_handler,
-    },
-    {
-        .get_fd = iccp_get_receive_arp_packet_sock_fd,
-        .event_handler = iccp_receive_arp_packet_handler,
-     },
-    {
-     .get_fd = iccp_get_receive_ndisc_packet_sock_fd,
-     .event_handler = iccp_receive_ndisc_packet_handler,
+        /* route events and ARP/ND packets, via the ingestion thread */
+        .get_fd = iccp_nl_ingest_get_fd,
+        .event_handler = iccp_nl_ingest_event_handler,
     }
 };
 
@@ -2165,7 +2315,7 @@ close_efd:
  * @return Zero on success or negative number in case of an error.
  **/
 
-int iccp_handle_events(struct System * sys)
+int iccp_handle_events(struct System * sys, int timeout)
 {
     struct epoll_event events[ICCP_EVENT_FDS_COUNT + sys->readfd_count];
     struct CSM* csm = NULL;
@@ -2178,7 +2328,11 @@ int iccp_handle_events(struct System * sys)
 
     max_nfds = ICCP_EVENT_FDS_COUNT + sys->readfd_count;
 
-    nfds = epoll_wait(sys->epoll_fd, events, max_nfds, EPOLL_TIMEOUT_MSEC);
+    nfds = epoll_wait(sys->epoll_fd, events, max_nfds, timeout);
+
+    /* Any event may have queued work or changed config for the FSMs */
+    if (nfds > 0)
+        scheduler_csm_set_pending_all(sys);
 
     /* Go over list of event fds and handle them sequentially */
     for (i = 0; i < nfds; i++)
@@ -2211,7 +2365,10 @@ int iccp_handle_events(struct System * sys)
 
         if (events[i].data.fd == sys->sync_fd)
         {
-            iccp_mclagsyncd_msg_handler(sys);
+            if (events[i].events & EPOLLOUT)
+                iccp_mclagsyncd_write_handler(sys);
+            if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && sys->sync_fd > 0)
+                iccp_mclagsyncd_msg_handler(sys);
             continue;
         }
 
@@ -2228,6 +2385,11 @@ int iccp_handle_events(struct System * sys)
             {
                 if (csm->sock_fd == events[i].data.fd )
                 {
+                    if ((events[i].events & EPOLLOUT)
+                        && scheduler_csm_write_callback(csm) == MCLAG_ERROR)
+                        break;
+                    if (!(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+                        break;
                     if (scheduler_csm_read_callback(csm) != MCLAG_ERROR)
                     {
                         //consider any msg from peer as heartbeat update, this will be in scenarios of scaled msg sync b/w peers
@@ -2252,8 +2414,6 @@ void update_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir)
     char macaddr[64];
     uint8_t system_mac[ETHER_ADDR_LEN];
     int ret = 0;
-    struct VLAN_ID vlan_key = { 0 };
-    struct VLAN_ID *vlan = NULL;
     int vid = 0, vlan_member = 0;
 
     if (lif_vlan->type != IF_T_VLAN)
@@ -2264,17 +2424,13 @@ void update_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir)
 
     sscanf (lif_vlan->name, "Vlan%d", &vid);
 
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
     ICCPD_LOG_DEBUG(__FUNCTION__, " ifname %s vid %d, l3_proto %d, dir %d\n",
             lif_vlan->name, vid, lif_vlan->is_l3_proto_enabled, dir);
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
         if (csm->peer_link_if) {
             lif_peer = csm->peer_link_if;
-            vlan = RB_FIND(vlan_rb_tree, &(lif_peer->vlan_tree), &vlan_key);
-            if (vlan && vlan->vlan_itf)
+            if (vlan_bitmap_test(&lif_peer->vlan_bitmap, vid) && local_if_vlan_itf(vid))
             {
                 vlan_member = 1;
                 break;
@@ -2285,8 +2441,7 @@ void update_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir)
         {
             if (lif_po->type == IF_T_PORT_CHANNEL)
             {
-                vlan = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
-                if (vlan)
+                if (vlan_bitmap_test(&lif_po->vlan_bitmap, vid))
                 {
                     vlan_member = 1;
                     break;
@@ -2468,18 +2623,20 @@ void recover_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir, ui
 
 void update_vlan_if_mac_on_iccp_up(struct LocalInterface* lif_peer, int is_up, uint8_t *remote_system_mac)
 {
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    uint16_t vid;
 
     ICCPD_LOG_NOTICE(__FUNCTION__, " lif name %s, up %d", lif_peer->name, is_up);
-    RB_FOREACH(vlan_id_list, vlan_rb_tree, &(lif_peer->vlan_tree))
+    VLAN_BITMAP_FOREACH(vid, &lif_peer->vlan_bitmap)
     {
-        if (!vlan_id_list->vlan_itf)
+        vlan_itf = local_if_vlan_itf(vid);
+        if (!vlan_itf)
             continue;
 
         if (is_up) {
-            update_vlan_if_mac_on_standby(vlan_id_list->vlan_itf, 4);
+            update_vlan_if_mac_on_standby(vlan_itf, 4);
         } else {
-            recover_vlan_if_mac_on_standby(vlan_id_list->vlan_itf, 4, remote_system_mac);
+            recover_vlan_if_mac_on_standby(vlan_itf, 4, remote_system_mac);
         }
 
     }
@@ -0,0 +1,404 @@
+/*
+ * iccp_nl_ingest.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/iccp_netlink.h"
+#include "../include/iccp_nl_ingest.h"
+
+#define ICCP_NL_RING_MASK           (ICCP_NL_RING_SIZE - 1)
+#define ICCP_NL_BATCH_HASH_SIZE     (ICCP_NL_BATCH_SIZE * 2)
+
+/* Ring shared by the two threads, head and tail on their own cache lines */
+static struct iccp_nl_event g_nl_ring[ICCP_NL_RING_SIZE];
+static uint32_t g_nl_ring_head __attribute__((aligned(64)));    /* scheduler thread */
+static uint32_t g_nl_ring_tail __attribute__((aligned(64)));    /* ingestion thread */
+static int g_nl_resync __attribute__((aligned(64)));            /* events were lost */
+
+/* Ingestion thread only */
+static struct iccp_nl_event g_nl_batch[ICCP_NL_BATCH_SIZE];
+static int g_nl_batch_count = 0;
+static uint16_t g_nl_batch_hash[ICCP_NL_BATCH_HASH_SIZE];      /* batch index + 1 */
+
+/* Scheduler thread only */
+static int g_nl_resync_pending = 0;
+
+static pthread_t g_nl_thread;
+static int g_nl_thread_running = 0;
+static int g_nl_stop_fd = -1;
+
+static uint32_t iccp_nl_event_hash(struct iccp_nl_event* event)
+{
+    const uint8_t* addr;
+    uint32_t hash;
+    int i;
+
+    if (event->type == ICCP_NL_EVENT_NEIGH)
+    {
+        addr = event->u.neigh.dst;
+        hash = event->u.neigh.ndm.ndm_ifindex ^ (event->u.neigh.ndm.ndm_family << 24);
+    }
+    else
+    {
+        addr = event->u.reply.addr;
+        hash = event->u.reply.ifindex ^ (event->type << 24);
+    }
+
+    for (i = 0; i < 16; i++)
+        hash = hash * 31 + addr[i];
+
+    return hash;
+}
+
+static int iccp_nl_event_same_key(struct iccp_nl_event* a, struct iccp_nl_event* b)
+{
+    if (a->type != b->type)
+        return 0;
+
+    if (a->type == ICCP_NL_EVENT_NEIGH)
+        return a->u.neigh.ndm.ndm_family == b->u.neigh.ndm.ndm_family
+               && a->u.neigh.ndm.ndm_ifindex == b->u.neigh.ndm.ndm_ifindex
+               && memcmp(a->u.neigh.dst, b->u.neigh.dst, sizeof(a->u.neigh.dst)) == 0;
+
+    return a->u.reply.ifindex == b->u.reply.ifindex
+           && memcmp(a->u.reply.addr, b->u.reply.addr, sizeof(a->u.reply.addr)) == 0;
+}
+
+static void iccp_nl_event_free(struct iccp_nl_event* event)
+{
+    if (event->type == ICCP_NL_EVENT_OBJ && event->u.obj)
+        nl_object_put(event->u.obj);
+
+    return;
+}
+
+static void iccp_nl_ingest_signal(struct System* sys)
+{
+    eventfd_write(sys->nl_event_fd, 1);
+
+    return;
+}
+
+/* Move the batch into the ring, whatever does not fit is lost */
+void iccp_nl_ingest_flush(void)
+{
+    struct System* sys = system_get_instance();
+    uint32_t head;
+    uint32_t tail;
+    uint32_t space;
+    int count;
+    int i;
+
+    if (g_nl_batch_count == 0)
+        return;
+
+    head = __atomic_load_n(&g_nl_ring_head, __ATOMIC_ACQUIRE);
+    tail = g_nl_ring_tail;
+    space = ICCP_NL_RING_SIZE - (tail - head);
+    count = g_nl_batch_count < space ? g_nl_batch_count : space;
+
+    for (i = 0; i < count; i++)
+        g_nl_ring[(tail + i) & ICCP_NL_RING_MASK] = g_nl_batch[i];
+    __atomic_store_n(&g_nl_ring_tail, tail + count, __ATOMIC_RELEASE);
+
+    if (count < g_nl_batch_count)
+    {
+        for (i = count; i < g_nl_batch_count; i++)
+            iccp_nl_event_free(&g_nl_batch[i]);
+        sys->dbg_counters.nl_event_overflow_counter += g_nl_batch_count - count;
+        __atomic_store_n(&g_nl_resync, 1, __ATOMIC_RELEASE);
+    }
+
+    g_nl_batch_count = 0;
+    memset(g_nl_batch_hash, 0, sizeof(g_nl_batch_hash));
+    iccp_nl_ingest_signal(sys);
+
+    return;
+}
+
+/* Queue a decoded event, called on the ingestion thread */
+void iccp_nl_ingest_add(struct iccp_nl_event* event)
+{
+    struct System* sys = system_get_instance();
+    uint32_t bucket;
+    int index;
+
+    /* Link and address changes keep their order against everything else */
+    if (event->type == ICCP_NL_EVENT_OBJ)
+    {
+        if (g_nl_batch_count == ICCP_NL_BATCH_SIZE)
+            iccp_nl_ingest_flush();
+        memset(g_nl_batch_hash, 0, sizeof(g_nl_batch_hash));
+        g_nl_batch[g_nl_batch_count++] = *event;
+        return;
+    }
+
+    bucket = iccp_nl_event_hash(event) % ICCP_NL_BATCH_HASH_SIZE;
+    index = g_nl_batch_hash[bucket];
+    if (index && iccp_nl_event_same_key(&g_nl_batch[index - 1], event))
+    {
+        /* Only the latest state of a neighbor matters */
+        g_nl_batch[index - 1] = *event;
+        ++sys->dbg_counters.nl_event_coalesce_counter;
+        return;
+    }
+
+    if (g_nl_batch_count == ICCP_NL_BATCH_SIZE)
+        iccp_nl_ingest_flush();
+
+    g_nl_batch[g_nl_batch_count] = *event;
+    g_nl_batch_hash[bucket] = ++g_nl_batch_count;
+
+    return;
+}
+
+/* Kernel dropped events, ask the scheduler thread to read the state again */
+void iccp_nl_ingest_resync(void)
+{
+    __atomic_store_n(&g_nl_resync, 1, __ATOMIC_RELEASE);
+    iccp_nl_ingest_signal(system_get_instance());
+
+    return;
+}
+
+static void* iccp_nl_ingest_thread(void* arg)
+{
+    struct System* sys = (struct System*)arg;
+    struct epoll_event events[4];
+    struct epoll_event event;
+    sigset_t set;
+    int route_fd;
+    int efd;
+    int nfds;
+    int i;
+
+    /* Signals are for the scheduler thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    efd = epoll_create1(0);
+    if (efd < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Netlink ingestion epoll create error %d", errno);
+        return NULL;
+    }
+
+    route_fd = nl_socket_get_fd(sys->route_event_sock);
+    nl_socket_set_nonblocking(sys->route_event_sock);
+
+    event.events = EPOLLIN;
+    event.data.fd = route_fd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, route_fd, &event);
+    event.data.fd = sys->arp_receive_fd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, sys->arp_receive_fd, &event);
+    event.data.fd = sys->ndisc_receive_fd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, sys->ndisc_receive_fd, &event);
+    event.data.fd = g_nl_stop_fd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, g_nl_stop_fd, &event);
+
+    while (1)
+    {
+        nfds = epoll_wait(efd, events, 4, -1);
+        if (nfds < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ICCPD_LOG_ERR(__FUNCTION__, "Netlink ingestion epoll wait error %d", errno);
+            break;
+        }
+
+        for (i = 0; i < nfds; i++)
+        {
+            if (events[i].data.fd == g_nl_stop_fd)
+                goto done;
+            else if (events[i].data.fd == route_fd)
+                iccp_netlink_route_sock_event_handler(sys);
+            else if (events[i].data.fd == sys->arp_receive_fd)
+                iccp_receive_arp_packet_handler(sys);
+            else if (events[i].data.fd == sys->ndisc_receive_fd)
+                iccp_receive_ndisc_packet_handler(sys);
+        }
+
+        iccp_nl_ingest_flush();
+    }
+
+ done:
+    close(efd);
+
+    return NULL;
+}
+
+int iccp_nl_ingest_init(struct System* sys)
+{
+    sys->nl_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sys->nl_event_fd < 0)
+        return MCLAG_ERROR;
+
+    g_nl_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_nl_stop_fd < 0)
+        return MCLAG_ERROR;
+
+    return 0;
+}
+
+int iccp_nl_ingest_start(struct System* sys)
+{
+    int err;
+
+    if (g_nl_thread_running)
+        return 0;
+
+    err = pthread_create(&g_nl_thread, NULL, iccp_nl_ingest_thread, sys);
+    if (err)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Netlink ingestion thread create error %d", err);
+        return MCLAG_ERROR;
+    }
+    g_nl_thread_running = 1;
+
+    return 0;
+}
+
+void iccp_nl_ingest_stop(struct System* sys)
+{
+    uint32_t head;
+    uint32_t tail;
+
+    if (g_nl_thread_running)
+    {
+        eventfd_write(g_nl_stop_fd, 1);
+        pthread_join(g_nl_thread, NULL);
+        g_nl_thread_running = 0;
+    }
+
+    /* Drop what the scheduler did not get to */
+    head = g_nl_ring_head;
+    tail = g_nl_ring_tail;
+    while (head != tail)
+        iccp_nl_event_free(&g_nl_ring[head++ & ICCP_NL_RING_MASK]);
+    g_nl_ring_head = head;
+    while (g_nl_batch_count > 0)
+        iccp_nl_event_free(&g_nl_batch[--g_nl_batch_count]);
+
+    if (g_nl_stop_fd >= 0)
+        close(g_nl_stop_fd);
+    g_nl_stop_fd = -1;
+    if (sys->nl_event_fd >= 0)
+        close(sys->nl_event_fd);
+    sys->nl_event_fd = -1;
+
+    return;
+}
+
+int iccp_nl_ingest_get_fd(struct System* sys)
+{
+    return sys->nl_event_fd;
+}
+
+static void iccp_nl_event_dispatch(struct iccp_nl_event* event)
+{
+    uint32_t addr;
+
+    switch (event->type)
+    {
+        case ICCP_NL_EVENT_NEIGH:
+            do_one_neigh_info(&event->u.neigh);
+            break;
+
+        case ICCP_NL_EVENT_ARP_REPLY:
+            /*Check if mclag configured*/
+            if (!system_get_first_csm())
+                break;
+            memcpy(&addr, event->u.reply.addr, sizeof(addr));
+            do_arp_update_from_reply_packet(event->u.reply.ifindex, addr, event->u.reply.mac);
+            break;
+
+        case ICCP_NL_EVENT_ND_REPLY:
+            if (!system_get_first_csm())
+                break;
+            do_ndisc_update_from_reply_packet(event->u.reply.ifindex,
+                (char *)event->u.reply.addr, event->u.reply.mac);
+            break;
+
+        case ICCP_NL_EVENT_OBJ:
+            iccp_netlink_obj_event_handler(event->msgtype, event->u.obj);
+            break;
+    }
+
+    iccp_nl_event_free(event);
+
+    return;
+}
+
+/* Handle the events queued by the ingestion thread, on the scheduler thread */
+int iccp_nl_ingest_event_handler(struct System* sys)
+{
+    eventfd_t value;
+    uint32_t head;
+    uint32_t tail;
+    int count = 0;
+
+    eventfd_read(sys->nl_event_fd, &value);
+
+    if (__atomic_exchange_n(&g_nl_resync, 0, __ATOMIC_ACQ_REL))
+        g_nl_resync_pending = 1;
+
+    head = g_nl_ring_head;
+    tail = __atomic_load_n(&g_nl_ring_tail, __ATOMIC_ACQUIRE);
+    if (tail - head > sys->dbg_counters.nl_event_ring_hwm)
+        sys->dbg_counters.nl_event_ring_hwm = tail - head;
+
+    while (head != tail && count < ICCP_NL_DRAIN_BUDGET)
+    {
+        iccp_nl_event_dispatch(&g_nl_ring[head & ICCP_NL_RING_MASK]);
+        ++head;
+        ++count;
+    }
+    __atomic_store_n(&g_nl_ring_head, head, __ATOMIC_RELEASE);
+
+    /* Leave the rest for the next pass so peer sockets are served too */
+    if (head != tail)
+    {
+        iccp_nl_ingest_signal(sys);
+        return 0;
+    }
+
+    /* Events queued before the loss are applied first, then the state is read again */
+    if (g_nl_resync_pending)
+    {
+        g_nl_resync_pending = 0;
+        ICCPD_LOG_NOTICE(__FUNCTION__, "Netlink events lost, sync kernel state again");
+        sys->need_sync_netlink_again = 1;
+        sys->need_sync_neigh_again = 1;
+        iccp_netlink_sync_again();
+    }
+
+    return 0;
+}
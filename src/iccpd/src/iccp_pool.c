@@ -0,0 +1,231 @@
+/*
+ * iccp_pool.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/iccp_pool.h"
+#include "../include/logger.h"
+#include "../include/system.h"
+
+#define ICCP_POOL_ALIGN(x)  (((x) + 15) & ~((size_t)15))
+
+/* Header in front of every object, the owning pool is needed on free */
+struct iccp_pool_obj
+{
+    struct iccp_pool_obj* next;     /* free list, while cached */
+    uint32_t pool;
+    uint32_t in_use;
+};
+
+struct iccp_pool_chunk
+{
+    struct iccp_pool_chunk* next;
+    uint64_t pad;
+};
+
+struct iccp_pool
+{
+    size_t size;                    /* usable bytes of an object */
+    struct iccp_pool_obj* free_list;
+    struct iccp_pool_chunk* chunks;
+};
+
+/* Object pools get their size from iccp_pool_create */
+static struct iccp_pool g_iccp_pools[ICCP_POOL_MAX] =
+{
+    [ICCP_POOL_BUF_128]   = { 128 },
+    [ICCP_POOL_BUF_512]   = { 512 },
+    [ICCP_POOL_BUF_2K]    = { 2048 },
+    [ICCP_POOL_BUF_8K]    = { 8192 },
+    [ICCP_POOL_LARGE]     = { 0 },
+};
+
+static iccp_pool_stats_t g_iccp_pool_stats[ICCP_POOL_MAX];
+
+void iccp_pool_create(ICCP_POOL_ID_E id, size_t size)
+{
+    if (id < ICCP_POOL_BUF_128)
+        g_iccp_pools[id].size = size;
+
+    return;
+}
+
+/* Add one chunk worth of objects to the free list */
+static int iccp_pool_grow(ICCP_POOL_ID_E id)
+{
+    struct iccp_pool* pool = &g_iccp_pools[id];
+    struct iccp_pool_chunk* chunk;
+    struct iccp_pool_obj* obj;
+    size_t stride;
+    size_t count;
+    size_t i;
+
+    stride = sizeof(struct iccp_pool_obj) + ICCP_POOL_ALIGN(pool->size);
+    count = (ICCP_POOL_CHUNK_SIZE - sizeof(struct iccp_pool_chunk)) / stride;
+    if (count == 0)
+        count = 1;
+
+    chunk = (struct iccp_pool_chunk*)malloc(sizeof(struct iccp_pool_chunk) + count * stride);
+    if (chunk == NULL)
+        return MCLAG_ERROR;
+
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+
+    for (i = 0; i < count; i++)
+    {
+        obj = (struct iccp_pool_obj*)((char*)(chunk + 1) + i * stride);
+        obj->pool = id;
+        obj->in_use = 0;
+        obj->next = pool->free_list;
+        pool->free_list = obj;
+    }
+
+    g_iccp_pool_stats[id].chunks++;
+    g_iccp_pool_stats[id].cached += count;
+
+    return 0;
+}
+
+void* iccp_pool_alloc(ICCP_POOL_ID_E id)
+{
+    struct iccp_pool* pool;
+    iccp_pool_stats_t* stats;
+    struct iccp_pool_obj* obj;
+
+    if (id >= ICCP_POOL_LARGE || g_iccp_pools[id].size == 0)
+        return NULL;
+
+    pool = &g_iccp_pools[id];
+    stats = &g_iccp_pool_stats[id];
+
+    if (pool->free_list == NULL && iccp_pool_grow(id) != 0)
+    {
+        stats->alloc_fail_counter++;
+        return NULL;
+    }
+
+    obj = pool->free_list;
+    pool->free_list = obj->next;
+    obj->in_use = 1;
+
+    stats->alloc_counter++;
+    stats->cached--;
+    if (++stats->in_use > stats->in_use_max)
+        stats->in_use_max = stats->in_use;
+
+    return obj + 1;
+}
+
+/* Message buffer of len bytes from the smallest pool that fits */
+void* iccp_pool_buf_alloc(size_t len)
+{
+    iccp_pool_stats_t* stats = &g_iccp_pool_stats[ICCP_POOL_LARGE];
+    struct iccp_pool_obj* obj;
+    int id;
+
+    if (len == g_iccp_pools[ICCP_POOL_ARP_MSG].size)
+        return iccp_pool_alloc(ICCP_POOL_ARP_MSG);
+    if (len == g_iccp_pools[ICCP_POOL_NDISC_MSG].size)
+        return iccp_pool_alloc(ICCP_POOL_NDISC_MSG);
+
+    for (id = ICCP_POOL_BUF_128; id < ICCP_POOL_LARGE; id++)
+    {
+        if (len <= g_iccp_pools[id].size)
+            return iccp_pool_alloc(id);
+    }
+
+    obj = (struct iccp_pool_obj*)malloc(sizeof(struct iccp_pool_obj) + len);
+    if (obj == NULL)
+    {
+        stats->alloc_fail_counter++;
+        return NULL;
+    }
+
+    obj->pool = ICCP_POOL_LARGE;
+    obj->in_use = 1;
+    stats->alloc_counter++;
+    if (++stats->in_use > stats->in_use_max)
+        stats->in_use_max = stats->in_use;
+
+    return obj + 1;
+}
+
+void iccp_pool_free(void* ptr)
+{
+    struct iccp_pool_obj* obj;
+    struct iccp_pool* pool;
+    iccp_pool_stats_t* stats;
+
+    if (ptr == NULL)
+        return;
+
+    obj = (struct iccp_pool_obj*)ptr - 1;
+    if (obj->pool >= ICCP_POOL_MAX || !obj->in_use)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Free of %p that is not an allocated pool object", ptr);
+        return;
+    }
+
+    stats = &g_iccp_pool_stats[obj->pool];
+    stats->free_counter++;
+    stats->in_use--;
+    obj->in_use = 0;
+
+    if (obj->pool == ICCP_POOL_LARGE)
+    {
+        free(obj);
+        return;
+    }
+
+    pool = &g_iccp_pools[obj->pool];
+    obj->next = pool->free_list;
+    pool->free_list = obj;
+    stats->cached++;
+
+    return;
+}
+
+void iccp_pool_get_stats(iccp_pool_stats_t* stats)
+{
+    memcpy(stats, g_iccp_pool_stats, sizeof(g_iccp_pool_stats));
+
+    return;
+}
+
+/* Give all chunks back, objects still in use become invalid */
+void iccp_pool_finalize(void)
+{
+    struct iccp_pool_chunk* chunk;
+    int id;
+
+    for (id = 0; id < ICCP_POOL_LARGE; id++)
+    {
+        while ((chunk = g_iccp_pools[id].chunks) != NULL)
+        {
+            g_iccp_pools[id].chunks = chunk->next;
+            free(chunk);
+        }
+        g_iccp_pools[id].free_list = NULL;
+    }
+    memset(g_iccp_pool_stats, 0, sizeof(g_iccp_pool_stats));
+
+    return;
+}
@@ -0,0 +1,207 @@
+/*
+ * iccp_timer.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#include <time.h>
+
+#include "../include/iccp_timer.h"
+
+#define ICCP_TIMER_ROOT_MASK    (ICCP_TIMER_ROOT_SIZE - 1)
+#define ICCP_TIMER_LEVEL_MASK   (ICCP_TIMER_LEVEL_SIZE - 1)
+
+static struct iccp_timer_list g_timer_root[ICCP_TIMER_ROOT_SIZE];
+static struct iccp_timer_list g_timer_level[ICCP_TIMER_LEVELS - 1][ICCP_TIMER_LEVEL_SIZE];
+static uint64_t g_timer_tick = 0;   /* next tick to run */
+static uint32_t g_timer_count = 0;  /* armed timers */
+
+uint64_t iccp_timer_now_msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t iccp_timer_now_tick(void)
+{
+    return iccp_timer_now_msec() / ICCP_TIMER_TICK_MSEC;
+}
+
+static void iccp_timer_add(struct iccp_timer* timer)
+{
+    uint64_t expire = timer->expire;
+    uint64_t idx;
+    int level;
+    int shift;
+
+    if (expire < g_timer_tick)
+        expire = g_timer_tick;
+    idx = expire - g_timer_tick;
+
+    if (idx < ICCP_TIMER_ROOT_SIZE)
+    {
+        LIST_INSERT_HEAD(&g_timer_root[expire & ICCP_TIMER_ROOT_MASK], timer, next);
+        return;
+    }
+
+    for (level = 0; level < ICCP_TIMER_LEVELS - 1; level++)
+    {
+        shift = ICCP_TIMER_ROOT_BITS + (level + 1) * ICCP_TIMER_LEVEL_BITS;
+        if (idx >= (1ULL << shift))
+        {
+            if (level < ICCP_TIMER_LEVELS - 2)
+                continue;
+
+            /* Beyond the wheel, fire at its far end */
+            expire = g_timer_tick + (1ULL << shift) - 1;
+            timer->expire = expire;
+        }
+
+        shift -= ICCP_TIMER_LEVEL_BITS;
+        LIST_INSERT_HEAD(&g_timer_level[level][(expire >> shift) & ICCP_TIMER_LEVEL_MASK], timer, next);
+        return;
+    }
+}
+
+/* Move the timers of the current slot of an upper level one level down */
+static int iccp_timer_cascade(int level)
+{
+    struct iccp_timer_list* slot;
+    struct iccp_timer* timer;
+    int index;
+
+    index = (g_timer_tick >> (ICCP_TIMER_ROOT_BITS + level * ICCP_TIMER_LEVEL_BITS)) & ICCP_TIMER_LEVEL_MASK;
+    slot = &g_timer_level[level][index];
+
+    while ((timer = LIST_FIRST(slot)) != NULL)
+    {
+        LIST_REMOVE(timer, next);
+        iccp_timer_add(timer);
+    }
+
+    return index;
+}
+
+void iccp_timer_init(struct iccp_timer* timer, void (*handler)(void*), void* arg)
+{
+    timer->expire = 0;
+    timer->handler = handler;
+    timer->arg = arg;
+    timer->armed = 0;
+}
+
+/* (Re)arm the timer to fire msec from now, at least one tick away */
+void iccp_timer_start(struct iccp_timer* timer, uint32_t msec)
+{
+    uint64_t now_msec = iccp_timer_now_msec();
+    uint64_t now = now_msec / ICCP_TIMER_TICK_MSEC;
+    uint64_t expire;
+
+    iccp_timer_stop(timer);
+
+    if (g_timer_count == 0)
+        g_timer_tick = now;
+
+    /* Round up, a timer never fires early */
+    expire = (now_msec + msec + ICCP_TIMER_TICK_MSEC - 1) / ICCP_TIMER_TICK_MSEC;
+    if (expire <= now)
+        expire = now + 1;
+    timer->expire = expire;
+    iccp_timer_add(timer);
+    timer->armed = 1;
+    ++g_timer_count;
+
+    return;
+}
+
+void iccp_timer_stop(struct iccp_timer* timer)
+{
+    if (!timer->armed)
+        return;
+
+    LIST_REMOVE(timer, next);
+    timer->armed = 0;
+    --g_timer_count;
+
+    return;
+}
+
+/* Milliseconds until the wheel needs to run again, -1 if no timer is armed */
+int iccp_timer_next_msec(void)
+{
+    uint64_t now = iccp_timer_now_msec();
+    uint64_t tick;
+
+    if (g_timer_count == 0)
+        return -1;
+
+    /* Stop at the first busy slot or at the next cascade */
+    for (tick = g_timer_tick; tick < g_timer_tick + ICCP_TIMER_ROOT_SIZE; tick++)
+    {
+        if ((tick & ICCP_TIMER_ROOT_MASK) == 0)
+            break;
+        if (!LIST_EMPTY(&g_timer_root[tick & ICCP_TIMER_ROOT_MASK]))
+            break;
+    }
+
+    if (tick * ICCP_TIMER_TICK_MSEC <= now)
+        return 0;
+
+    return (int)(tick * ICCP_TIMER_TICK_MSEC - now);
+}
+
+/* Run the handlers of all timers that are due */
+void iccp_timer_expire(void)
+{
+    uint64_t now = iccp_timer_now_tick();
+    struct iccp_timer* timer;
+    int index;
+    int level;
+
+    while (g_timer_tick <= now)
+    {
+        if (g_timer_count == 0)
+        {
+            g_timer_tick = now + 1;
+            break;
+        }
+
+        index = g_timer_tick & ICCP_TIMER_ROOT_MASK;
+        if (index == 0)
+        {
+            for (level = 0; level < ICCP_TIMER_LEVELS - 1; level++)
+            {
+                if (iccp_timer_cascade(level) != 0)
+                    break;
+            }
+        }
+
+        /* A handler may start timers again, never into this slot */
+        while ((timer = LIST_FIRST(&g_timer_root[index])) != NULL)
+        {
+            LIST_REMOVE(timer, next);
+            timer->armed = 0;
+            --g_timer_count;
+            timer->handler(timer->arg);
+        }
+
+        ++g_timer_tick;
+    }
+
+    return;
+}
@@ -0,0 +1,753 @@
+/*
+ * iccp_warm_state.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/iccp_csm.h"
+#include "../include/iccp_ifm.h"
+#include "../include/iccp_netlink.h"
+#include "../include/iccp_timer.h"
+#include "../include/iccp_warm_state.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/mlacp_sync_update.h"
+#include "../include/port.h"
+
+#define ICCP_WARM_STATE_PAD(x)  (((x) + 3) & ~((size_t)3))
+
+/* Mapped state of the last warm restart, until it is reconciled */
+static char* g_warm_state_map = NULL;
+static size_t g_warm_state_len = 0;
+static uint8_t* g_warm_state_done = NULL;  /* per CSM section, restored */
+static struct iccp_timer g_warm_state_timer;
+
+static uint32_t g_warm_state_crc_table[256];
+
+struct iccp_warm_state_writer
+{
+    FILE* fp;
+    uint32_t crc;
+    uint32_t len;
+    int err;
+};
+
+static void iccp_warm_state_crc_init(void)
+{
+    uint32_t crc;
+    int i, j;
+
+    if (g_warm_state_crc_table[1] != 0)
+        return;
+
+    for (i = 0; i < 256; i++)
+    {
+        crc = i;
+        for (j = 0; j < 8; j++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+        g_warm_state_crc_table[i] = crc;
+    }
+
+    return;
+}
+
+/* CRC-32 (IEEE), continues from crc of the previous chunk, 0 to start */
+static uint32_t iccp_warm_state_crc(uint32_t crc, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+
+    crc = ~crc;
+    while (len--)
+        crc = g_warm_state_crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static void iccp_warm_state_write(struct iccp_warm_state_writer* w, const void* data, size_t len)
+{
+    if (w->err || len == 0)
+        return;
+
+    if (fwrite(data, 1, len, w->fp) != len)
+    {
+        w->err = errno;
+        return;
+    }
+
+    w->crc = iccp_warm_state_crc(w->crc, data, len);
+    w->len += len;
+
+    return;
+}
+
+static uint16_t iccp_warm_state_pif_vlan_count(struct PeerInterface* pif)
+{
+    struct vlan_bitmap live;
+
+    vlan_bitmap_andnot(&live, &pif->vlan_bitmap, &pif->vlan_removed);
+
+    return vlan_bitmap_count(&live);
+}
+
+static void iccp_warm_state_count(struct CSM* csm, struct iccp_warm_state_csm* sec)
+{
+    struct MACMsg* mac_msg = NULL;
+    struct Msg* msg = NULL;
+    struct PeerInterface* pif = NULL;
+
+    memset(sec, 0, sizeof(struct iccp_warm_state_csm));
+    sec->mlag_id = csm->mlag_id;
+    sec->len = sizeof(struct iccp_warm_state_csm);
+
+    RB_FOREACH(mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+        sec->num_mac++;
+    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+        sec->num_arp++;
+    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+        sec->num_ndisc++;
+
+    sec->len += sec->num_mac * sizeof(struct iccp_warm_state_mac);
+    sec->len += sec->num_arp * sizeof(struct ARPMsg);
+    sec->len += sec->num_ndisc * sizeof(struct NDISCMsg);
+
+    LIST_FOREACH(pif, &(MLACP(csm).pif_list), mlacp_next)
+    {
+        sec->num_pif++;
+        sec->len += sizeof(struct iccp_warm_state_pif)
+            + ICCP_WARM_STATE_PAD(iccp_warm_state_pif_vlan_count(pif) * sizeof(uint16_t));
+    }
+
+    return;
+}
+
+static void iccp_warm_state_write_csm(struct iccp_warm_state_writer* w, struct CSM* csm)
+{
+    struct iccp_warm_state_csm sec;
+    struct iccp_warm_state_mac mac_rec;
+    struct iccp_warm_state_pif pif_rec;
+    struct MACMsg* mac_msg = NULL;
+    struct Msg* msg = NULL;
+    struct PeerInterface* pif = NULL;
+    struct vlan_bitmap live;
+    uint16_t vid;
+    uint32_t pad = 0;
+
+    iccp_warm_state_count(csm, &sec);
+    iccp_warm_state_write(w, &sec, sizeof(sec));
+
+    RB_FOREACH(mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+    {
+        memset(&mac_rec, 0, sizeof(mac_rec));
+        mac_rec.vid = mac_msg->vid;
+        memcpy(mac_rec.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+        mac_rec.op_type = mac_msg->op_type;
+        mac_rec.fdb_type = mac_msg->fdb_type;
+        mac_rec.age_flag = mac_msg->age_flag;
+        mac_rec.pending_local_del = mac_msg->pending_local_del;
+        mac_rec.add_to_syncd = mac_msg->add_to_syncd;
+        memcpy(mac_rec.ifname, mac_msg->ifname, MAX_L_PORT_NAME);
+        memcpy(mac_rec.origin_ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+        iccp_warm_state_write(w, &mac_rec, sizeof(mac_rec));
+    }
+
+    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+        iccp_warm_state_write(w, msg->buf, sizeof(struct ARPMsg));
+    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+        iccp_warm_state_write(w, msg->buf, sizeof(struct NDISCMsg));
+
+    LIST_FOREACH(pif, &(MLACP(csm).pif_list), mlacp_next)
+    {
+        memset(&pif_rec, 0, sizeof(pif_rec));
+        pif_rec.ifindex = pif->ifindex;
+        pif_rec.type = pif->type;
+        pif_rec.po_id = pif->po_id;
+        pif_rec.ipv4_addr = pif->ipv4_addr;
+        memcpy(pif_rec.name, pif->name, MAX_L_PORT_NAME);
+        memcpy(pif_rec.mac_addr, pif->mac_addr, ETHER_ADDR_LEN);
+        pif_rec.state = pif->state;
+        pif_rec.l3_mode = pif->l3_mode;
+        pif_rec.is_peer_link = pif->is_peer_link;
+        pif_rec.po_active = pif->po_active;
+        pif_rec.num_vlan = iccp_warm_state_pif_vlan_count(pif);
+        iccp_warm_state_write(w, &pif_rec, sizeof(pif_rec));
+
+        vlan_bitmap_andnot(&live, &pif->vlan_bitmap, &pif->vlan_removed);
+        VLAN_BITMAP_FOREACH(vid, &live)
+            iccp_warm_state_write(w, &vid, sizeof(vid));
+        iccp_warm_state_write(w, &pad,
+            ICCP_WARM_STATE_PAD(pif_rec.num_vlan * sizeof(uint16_t)) - pif_rec.num_vlan * sizeof(uint16_t));
+    }
+
+    return;
+}
+
+/* Write the state of all CSMs, called on warm reboot exit */
+int iccp_warm_state_save(struct System* sys)
+{
+    struct iccp_warm_state_writer w;
+    struct iccp_warm_state_hdr hdr;
+    struct CSM* csm = NULL;
+    char tmp_path[PATH_MAX];
+    char dir[PATH_MAX];
+    char* slash;
+    uint64_t start = iccp_timer_now_msec();
+
+    if (sys->warm_state_file_path == NULL)
+        return MCLAG_ERROR;
+
+    snprintf(dir, sizeof(dir), "%s", sys->warm_state_file_path);
+    if ((slash = strrchr(dir, '/')) != NULL && slash != dir)
+    {
+        *slash = '\0';
+        if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+            ICCPD_LOG_WARN(__FUNCTION__, "Can't create %s: %s", dir, strerror(errno));
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", sys->warm_state_file_path);
+    memset(&w, 0, sizeof(w));
+    if ((w.fp = fopen(tmp_path, "w")) == NULL)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Can't open %s: %s", tmp_path, strerror(errno));
+        return MCLAG_ERROR;
+    }
+
+    iccp_warm_state_crc_init();
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ICCP_WARM_STATE_MAGIC;
+    hdr.version = ICCP_WARM_STATE_VERSION;
+    hdr.hdr_len = sizeof(hdr);
+    hdr.save_time = time(NULL);
+    hdr.mac_size = sizeof(struct iccp_warm_state_mac);
+    hdr.arp_size = sizeof(struct ARPMsg);
+    hdr.ndisc_size = sizeof(struct NDISCMsg);
+    hdr.pif_size = sizeof(struct iccp_warm_state_pif);
+
+    /* Header goes in last, once the length and CRC are known */
+    if (fwrite(&hdr, 1, sizeof(hdr), w.fp) != sizeof(hdr))
+        w.err = errno;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        iccp_warm_state_write_csm(&w, csm);
+        hdr.num_csm++;
+    }
+
+    hdr.total_len = sizeof(hdr) + w.len;
+    hdr.crc = w.crc;
+    if (!w.err && (fseek(w.fp, 0, SEEK_SET) != 0 || fwrite(&hdr, 1, sizeof(hdr), w.fp) != sizeof(hdr)))
+        w.err = errno;
+    if (!w.err && (fflush(w.fp) != 0 || fsync(fileno(w.fp)) != 0))
+        w.err = errno;
+    if (fclose(w.fp) != 0 && !w.err)
+        w.err = errno;
+
+    if (w.err || rename(tmp_path, sys->warm_state_file_path) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Write of %s failed: %s", sys->warm_state_file_path,
+            strerror(w.err ? w.err : errno));
+        unlink(tmp_path);
+        return MCLAG_ERROR;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm restart state saved: %u CSM, %u bytes in %u ms",
+        hdr.num_csm, hdr.total_len, (uint32_t)(iccp_timer_now_msec() - start));
+
+    return 0;
+}
+
+/* Bytes a CSM section needs, 0 if it does not fit in len */
+static uint32_t iccp_warm_state_check_csm(const char* buf, uint32_t len)
+{
+    const struct iccp_warm_state_csm* sec = (const struct iccp_warm_state_csm*)buf;
+    const struct iccp_warm_state_pif* pif_rec;
+    uint64_t need;
+    uint32_t i;
+
+    if (len < sizeof(struct iccp_warm_state_csm) || sec->len > len)
+        return 0;
+
+    need = sizeof(struct iccp_warm_state_csm)
+        + (uint64_t)sec->num_mac * sizeof(struct iccp_warm_state_mac)
+        + (uint64_t)sec->num_arp * sizeof(struct ARPMsg)
+        + (uint64_t)sec->num_ndisc * sizeof(struct NDISCMsg);
+
+    for (i = 0; i < sec->num_pif; i++)
+    {
+        if (need + sizeof(struct iccp_warm_state_pif) > sec->len)
+            return 0;
+        pif_rec = (const struct iccp_warm_state_pif*)(buf + need);
+        need += sizeof(struct iccp_warm_state_pif)
+            + ICCP_WARM_STATE_PAD(pif_rec->num_vlan * sizeof(uint16_t));
+    }
+
+    if (need != sec->len)
+        return 0;
+
+    return sec->len;
+}
+
+static int iccp_warm_state_check(const char* buf, size_t len)
+{
+    const struct iccp_warm_state_hdr* hdr = (const struct iccp_warm_state_hdr*)buf;
+    size_t off;
+    uint32_t sec_len;
+    uint32_t i;
+
+    if (len < sizeof(struct iccp_warm_state_hdr))
+        return MCLAG_ERROR;
+
+    if (hdr->magic != ICCP_WARM_STATE_MAGIC || hdr->version != ICCP_WARM_STATE_VERSION
+        || hdr->hdr_len != sizeof(struct iccp_warm_state_hdr) || hdr->total_len != len
+        || hdr->mac_size != sizeof(struct iccp_warm_state_mac)
+        || hdr->arp_size != sizeof(struct ARPMsg)
+        || hdr->ndisc_size != sizeof(struct NDISCMsg)
+        || hdr->pif_size != sizeof(struct iccp_warm_state_pif))
+        return MCLAG_ERROR;
+
+    iccp_warm_state_crc_init();
+    if (iccp_warm_state_crc(0, buf + hdr->hdr_len, len - hdr->hdr_len) != hdr->crc)
+        return MCLAG_ERROR;
+
+    off = hdr->hdr_len;
+    for (i = 0; i < hdr->num_csm; i++)
+    {
+        if ((sec_len = iccp_warm_state_check_csm(buf + off, len - off)) == 0)
+            return MCLAG_ERROR;
+        off += sec_len;
+    }
+
+    return (off == len) ? 0 : MCLAG_ERROR;
+}
+
+static void iccp_warm_state_timeout(void* arg);
+
+/* Map the state of the previous run on warm start, drop it otherwise */
+int iccp_warm_state_load(struct System* sys)
+{
+    const struct iccp_warm_state_hdr* hdr;
+    struct stat st;
+    char* buf;
+    int fd;
+
+    if (sys->warm_state_file_path == NULL)
+        return MCLAG_ERROR;
+
+    if (sys->warmboot_start != WARM_REBOOT)
+    {
+        unlink(sys->warm_state_file_path);
+        return 0;
+    }
+
+    if ((fd = open(sys->warm_state_file_path, O_RDONLY)) < 0)
+    {
+        ICCPD_LOG_NOTICE(__FUNCTION__, "No warm restart state in %s: %s",
+            sys->warm_state_file_path, strerror(errno));
+        return MCLAG_ERROR;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct iccp_warm_state_hdr))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm restart state %s is truncated", sys->warm_state_file_path);
+        close(fd);
+        unlink(sys->warm_state_file_path);
+        return MCLAG_ERROR;
+    }
+
+    buf = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    /* Used once, a later restart must not pick up this state again */
+    unlink(sys->warm_state_file_path);
+    if (buf == MAP_FAILED)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Can't map %s: %s", sys->warm_state_file_path, strerror(errno));
+        return MCLAG_ERROR;
+    }
+
+    if (iccp_warm_state_check(buf, st.st_size) < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm restart state %s is not valid, ignored", sys->warm_state_file_path);
+        munmap(buf, st.st_size);
+        return MCLAG_ERROR;
+    }
+
+    hdr = (const struct iccp_warm_state_hdr*)buf;
+    g_warm_state_done = (uint8_t*)calloc(hdr->num_csm + 1, sizeof(uint8_t));
+    if (g_warm_state_done == NULL)
+    {
+        munmap(buf, st.st_size);
+        return MCLAG_ERROR;
+    }
+
+    g_warm_state_map = buf;
+    g_warm_state_len = st.st_size;
+
+    iccp_timer_init(&g_warm_state_timer, iccp_warm_state_timeout, NULL);
+    iccp_timer_start(&g_warm_state_timer, ICCP_WARM_STATE_RECONCILE_SEC * 1000);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm restart state loaded: %u CSM, %zu bytes, saved %ld s ago",
+        hdr->num_csm, g_warm_state_len, (long)(time(NULL) - (time_t)hdr->save_time));
+
+    return 0;
+}
+
+static void iccp_warm_state_restore_mac(struct CSM* csm, const struct iccp_warm_state_mac* rec, uint32_t num)
+{
+    struct MACMsg mac_data;
+    struct MACMsg* mac_msg = NULL;
+    uint32_t i;
+
+    for (i = 0; i < num; i++, rec++)
+    {
+        memset(&mac_data, 0, sizeof(struct MACMsg));
+        mac_data.vid = rec->vid;
+        memcpy(mac_data.mac_addr, rec->mac_addr, ETHER_ADDR_LEN);
+        if (RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb, &mac_data))
+            continue;
+
+        mac_data.op_type = rec->op_type;
+        mac_data.fdb_type = rec->fdb_type;
+        mac_data.age_flag = rec->age_flag;
+        mac_data.pending_local_del = rec->pending_local_del;
+        mac_data.add_to_syncd = rec->add_to_syncd;
+        memcpy(mac_data.ifname, rec->ifname, MAX_L_PORT_NAME);
+        memcpy(mac_data.origin_ifname, rec->origin_ifname, MAX_L_PORT_NAME);
+        mac_data.ifname[MAX_L_PORT_NAME - 1] = '\0';
+        mac_data.origin_ifname[MAX_L_PORT_NAME - 1] = '\0';
+        /* The peer sends its own MACs again once it is connected */
+        mac_data.restored = !(rec->age_flag & MAC_AGE_PEER);
+
+        if (iccp_csm_init_mac_msg(&mac_msg, (char*)&mac_data, sizeof(struct MACMsg)) != 0)
+            break;
+        RB_INSERT(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+    }
+
+    return;
+}
+
+static void iccp_warm_state_restore_arp(struct CSM* csm, const struct ARPMsg* rec, uint32_t num)
+{
+    struct ARPMsg arp_data;
+    struct Msg* msg = NULL;
+    uint32_t i;
+
+    for (i = 0; i < num; i++, rec++)
+    {
+        if (rec->op_type == NEIGH_SYNC_DEL || mlacp_find_arp(csm, rec->ipv4_addr))
+            continue;
+
+        memcpy(&arp_data, rec, sizeof(struct ARPMsg));
+        arp_data.ifname[MAX_L_PORT_NAME - 1] = '\0';
+        if (iccp_csm_init_msg(&msg, (char*)&arp_data, sizeof(struct ARPMsg)) != 0)
+            break;
+        msg->restored = 1;
+        mlacp_enqueue_arp(csm, msg);
+    }
+
+    return;
+}
+
+static void iccp_warm_state_restore_ndisc(struct CSM* csm, const struct NDISCMsg* rec, uint32_t num)
+{
+    struct NDISCMsg ndisc_data;
+    struct Msg* msg = NULL;
+    uint32_t i;
+
+    for (i = 0; i < num; i++, rec++)
+    {
+        memcpy(&ndisc_data, rec, sizeof(struct NDISCMsg));
+        if (ndisc_data.op_type == NEIGH_SYNC_DEL || mlacp_find_ndisc(csm, ndisc_data.ipv6_addr))
+            continue;
+
+        ndisc_data.ifname[MAX_L_PORT_NAME - 1] = '\0';
+        if (iccp_csm_init_msg(&msg, (char*)&ndisc_data, sizeof(struct NDISCMsg)) != 0)
+            break;
+        msg->restored = 1;
+        mlacp_enqueue_ndisc(csm, msg);
+    }
+
+    return;
+}
+
+static void iccp_warm_state_restore_pif(struct CSM* csm, const char* buf, uint32_t num)
+{
+    const struct iccp_warm_state_pif* rec;
+    const uint16_t* vids;
+    struct PeerInterface* pif = NULL;
+    char name[MAX_L_PORT_NAME];
+    uint32_t i;
+    uint16_t j;
+
+    for (i = 0; i < num; i++)
+    {
+        rec = (const struct iccp_warm_state_pif*)buf;
+        vids = (const uint16_t*)(rec + 1);
+        buf += sizeof(struct iccp_warm_state_pif) + ICCP_WARM_STATE_PAD(rec->num_vlan * sizeof(uint16_t));
+
+        memcpy(name, rec->name, MAX_L_PORT_NAME);
+        name[MAX_L_PORT_NAME - 1] = '\0';
+        if (peer_if_find_by_name(csm, name))
+            continue;
+        if ((pif = peer_if_create(csm, rec->ifindex, rec->type)) == NULL)
+            continue;
+
+        memcpy(pif->name, name, MAX_L_PORT_NAME);
+        memcpy(pif->mac_addr, rec->mac_addr, ETHER_ADDR_LEN);
+        pif->po_id = rec->po_id;
+        pif->ipv4_addr = rec->ipv4_addr;
+        pif->state = rec->state;
+        pif->l3_mode = rec->l3_mode;
+        pif->is_peer_link = rec->is_peer_link;
+        pif->po_active = rec->po_active;
+        pif->restored = 1;
+
+        for (j = 0; j < rec->num_vlan; j++)
+            peer_if_add_vlan(pif, vids[j]);
+    }
+
+    return;
+}
+
+/* Fill a CSM that was just configured from the state of the previous run */
+void iccp_warm_state_restore_csm(struct CSM* csm)
+{
+    const struct iccp_warm_state_hdr* hdr;
+    const struct iccp_warm_state_csm* sec = NULL;
+    const char* rec;
+    uint64_t start = iccp_timer_now_msec();
+    size_t off;
+    uint32_t i;
+
+    if (g_warm_state_map == NULL || csm == NULL)
+        return;
+
+    hdr = (const struct iccp_warm_state_hdr*)g_warm_state_map;
+    off = hdr->hdr_len;
+    for (i = 0; i < hdr->num_csm; i++)
+    {
+        sec = (const struct iccp_warm_state_csm*)(g_warm_state_map + off);
+        if (sec->mlag_id == (uint32_t)csm->mlag_id && !g_warm_state_done[i])
+            break;
+        off += sec->len;
+    }
+
+    if (i == hdr->num_csm)
+        return;
+    g_warm_state_done[i] = 1;
+
+    rec = (const char*)(sec + 1);
+    iccp_warm_state_restore_mac(csm, (const struct iccp_warm_state_mac*)rec, sec->num_mac);
+    rec += sec->num_mac * sizeof(struct iccp_warm_state_mac);
+    iccp_warm_state_restore_arp(csm, (const struct ARPMsg*)rec, sec->num_arp);
+    rec += sec->num_arp * sizeof(struct ARPMsg);
+    iccp_warm_state_restore_ndisc(csm, (const struct NDISCMsg*)rec, sec->num_ndisc);
+    rec += sec->num_ndisc * sizeof(struct NDISCMsg);
+    iccp_warm_state_restore_pif(csm, rec, sec->num_pif);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm restart state of mlag %d restored: %u MAC, %u ARP, %u ND, "
+        "%u peer interfaces in %u ms", csm->mlag_id, sec->num_mac, sec->num_arp, sec->num_ndisc,
+        sec->num_pif, (uint32_t)(iccp_timer_now_msec() - start));
+
+    return;
+}
+
+/* Session is up and the peer has sent its sync data, its updates follow */
+void iccp_warm_state_peer_up(struct CSM* csm)
+{
+    if (g_warm_state_map == NULL)
+        return;
+
+    iccp_timer_start(&g_warm_state_timer, ICCP_WARM_STATE_SETTLE_SEC * 1000);
+
+    return;
+}
+
+/* Remove a neighbor its owner did not report again */
+static void iccp_warm_state_reconcile_neigh(struct CSM* csm, struct Msg* msg, int family)
+{
+    struct ARPMsg* arp_msg = (struct ARPMsg*)msg->buf;
+    struct NDISCMsg* ndisc_msg = (struct NDISCMsg*)msg->buf;
+    struct Msg* msg_send = NULL;
+    uint8_t learn_flag = (family == AF_INET) ? arp_msg->learn_flag : ndisc_msg->learn_flag;
+
+    if (learn_flag == NEIGH_REMOTE)
+    {
+        /* Installed for the peer, which does not have it any more */
+        if (family == AF_INET)
+            iccp_netlink_neighbor_request(AF_INET, (uint8_t*)&arp_msg->ipv4_addr, 0,
+                arp_msg->mac_addr, arp_msg->ifname, 0, 11);
+        else
+            iccp_netlink_neighbor_request(AF_INET6, (uint8_t*)ndisc_msg->ipv6_addr, 0,
+                ndisc_msg->mac_addr, ndisc_msg->ifname, 0, 12);
+    }
+    else if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
+    {
+        /* Gone from the kernel while down, the peer may still have it */
+        if (family == AF_INET)
+        {
+            arp_msg->op_type = NEIGH_SYNC_DEL;
+            arp_msg->flag = 0;
+            if (iccp_csm_init_msg(&msg_send, (char*)arp_msg, sizeof(struct ARPMsg)) == 0)
+                TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
+        }
+        else
+        {
+            ndisc_msg->op_type = NEIGH_SYNC_DEL;
+            ndisc_msg->flag = 0;
+            if (iccp_csm_init_msg(&msg_send, (char*)ndisc_msg, sizeof(struct NDISCMsg)) == 0)
+                TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
+        }
+    }
+
+    if (family == AF_INET)
+        mlacp_dequeue_arp(csm, msg);
+    else
+        mlacp_dequeue_ndisc(csm, msg);
+    iccp_csm_free_msg(msg);
+
+    return;
+}
+
+static void iccp_warm_state_reconcile(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL;
+    struct MACMsg* mac_temp = NULL;
+    struct Msg* msg = NULL;
+    struct Msg* msg_next = NULL;
+    struct PeerInterface* pif = NULL;
+    struct PeerInterface* pif_next = NULL;
+    uint32_t num_mac = 0, num_arp = 0, num_ndisc = 0, num_pif = 0;
+
+    /* As if the peer had sent a delete for each of them */
+    RB_FOREACH_SAFE(mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    {
+        if (!mac_msg->restored)
+            continue;
+
+        mac_msg->restored = 0;
+        mac_msg->age_flag |= MAC_AGE_PEER;
+        if (mac_msg->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER))
+            continue;
+
+        if (mac_msg->add_to_syncd)
+            del_mac_from_chip(mac_msg);
+        MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+        if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
+            iccp_csm_free_mac_msg(mac_msg);
+        num_mac++;
+    }
+
+    for (msg = TAILQ_FIRST(&MLACP(csm).arp_list); msg != NULL; msg = msg_next)
+    {
+        msg_next = TAILQ_NEXT(msg, tail);
+        if (msg->restored)
+        {
+            iccp_warm_state_reconcile_neigh(csm, msg, AF_INET);
+            num_arp++;
+        }
+    }
+
+    for (msg = TAILQ_FIRST(&MLACP(csm).ndisc_list); msg != NULL; msg = msg_next)
+    {
+        msg_next = TAILQ_NEXT(msg, tail);
+        if (msg->restored)
+        {
+            iccp_warm_state_reconcile_neigh(csm, msg, AF_INET6);
+            num_ndisc++;
+        }
+    }
+
+    for (pif = LIST_FIRST(&MLACP(csm).pif_list); pif != NULL; pif = pif_next)
+    {
+        pif_next = LIST_NEXT(pif, mlacp_next);
+        if (!pif->restored)
+            continue;
+
+        mlacp_peer_mlag_intf_delete_handler(csm, pif->name);
+        mlacp_link_del_remote_if_info(csm->mlag_id, pif->name);
+        peer_if_destroy(pif);
+        num_pif++;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm restart state of mlag %d reconciled, removed %u MAC, "
+        "%u ARP, %u ND, %u peer interfaces", csm->mlag_id, num_mac, num_arp, num_ndisc, num_pif);
+
+    return;
+}
+
+static int iccp_warm_state_has_local_neigh(struct CSM* csm)
+{
+    struct Msg* msg = NULL;
+
+    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    {
+        if (msg->restored && ((struct ARPMsg*)msg->buf)->learn_flag != NEIGH_REMOTE)
+            return 1;
+    }
+    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    {
+        if (msg->restored && ((struct NDISCMsg*)msg->buf)->learn_flag != NEIGH_REMOTE)
+            return 1;
+    }
+
+    return 0;
+}
+
+static void iccp_warm_state_timeout(void* arg)
+{
+    struct System* sys = NULL;
+    struct CSM* csm = NULL;
+    int dump_neigh = 0;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    /* Wait for a sync that is under way */
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->sock_fd > 0 && MLACP(csm).current_state != MLACP_STATE_EXCHANGE)
+        {
+            iccp_timer_start(&g_warm_state_timer, ICCP_WARM_STATE_SETTLE_SEC * 1000);
+            return;
+        }
+        dump_neigh |= iccp_warm_state_has_local_neigh(csm);
+    }
+
+    /* The kernel reports the neighbors it still has */
+    if (dump_neigh)
+        iccp_neigh_get_init();
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+        iccp_warm_state_reconcile(csm);
+
+    munmap(g_warm_state_map, g_warm_state_len);
+    g_warm_state_map = NULL;
+    g_warm_state_len = 0;
+    free(g_warm_state_done);
+    g_warm_state_done = NULL;
+
+    return;
+}
@@ -23,10 +23,57 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include "../include/cmd_option.h"
 #include "../include/logger.h"
+#include "../include/iccp_timer.h"
+
+#define LOG_RING_MASK           (LOG_RING_SIZE - 1)
+#define LOG_DRAIN_BUDGET        64      /* messages of one ring per pass */
+#define LOG_IDLE_TIMEOUT_MS     1000
+
+typedef enum _log_record_type_t
+{
+    LOG_RECORD_TEXT = 1,
+    LOG_RECORD_FDB  = 2,
+} _log_record_type_t;
+
+struct log_record
+{
+    uint8_t type;
+    uint8_t level;
+    union
+    {
+        char text[LOGBUF_SIZE];
+        struct iccp_fdb_trace fdb;
+    } u;
+};
+
+struct log_rate
+{
+    const char* tag;
+    time_t sec;
+    uint32_t count;
+    uint32_t suppressed;
+};
+
+/* One per logging thread, head and tail on their own cache lines */
+struct log_ring
+{
+    struct log_record rec[LOG_RING_SIZE];
+    uint32_t head __attribute__((aligned(64)));         /* logger thread */
+    uint32_t tail __attribute__((aligned(64)));         /* owning thread */
+    uint64_t dropped;                                   /* owning thread */
+    pthread_mutex_t rate_lock;                          /* rate, owning and logger thread */
+    struct log_rate rate[LOG_RATE_HASH_SIZE];
+    uint64_t reported __attribute__((aligned(64)));     /* logger thread */
+};
 
 static uint32_t _iccpd_log_level_map[] =
 {
@@ -38,6 +85,18 @@ static uint32_t _iccpd_log_level_map[] =
     LOG_DEBUG
 };
 
+static struct log_ring* g_log_rings[LOG_RING_MAX];
+static uint32_t g_log_ring_count = 0;
+static __thread struct log_ring* t_log_ring = NULL;
+static __thread int t_log_ring_failed = 0;
+
+static pthread_t g_log_thread;
+static int g_log_thread_running = 0;
+static int g_log_stop = 0;
+static int g_log_sleeping = 0;
+static int g_log_wake_fd = -1;
+static FILE* g_log_trace_file = NULL;
+
 char* log_level_to_string(int level)
 {
     switch (level)
@@ -88,26 +147,436 @@ void logger_set_configuration(int log_level)
     return;
 }
 
+static struct log_ring* log_get_ring(void)
+{
+    struct log_ring* ring = NULL;
+    uint32_t idx;
+
+    if (t_log_ring || t_log_ring_failed)
+        return t_log_ring;
+
+    idx = __atomic_fetch_add(&g_log_ring_count, 1, __ATOMIC_ACQ_REL);
+    if (idx < LOG_RING_MAX)
+        ring = (struct log_ring*)calloc(1, sizeof(struct log_ring));
+    if (!ring)
+    {
+        t_log_ring_failed = 1;
+        return NULL;
+    }
+
+    pthread_mutex_init(&ring->rate_lock, NULL);
+    __atomic_store_n(&g_log_rings[idx], ring, __ATOMIC_RELEASE);
+    t_log_ring = ring;
+
+    return ring;
+}
+
+static struct log_record* log_ring_reserve(struct log_ring* ring)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (ring->tail - head >= LOG_RING_SIZE)
+    {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    return &ring->rec[ring->tail & LOG_RING_MASK];
+}
+
+/* Publish the reserved record, wake the logger thread only if it sleeps */
+static void log_ring_commit(struct log_ring* ring)
+{
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&g_log_sleeping, __ATOMIC_SEQ_CST)
+        && __atomic_exchange_n(&g_log_sleeping, 0, __ATOMIC_SEQ_CST))
+        eventfd_write(g_log_wake_fd, 1);
+
+    return;
+}
+
+static unsigned int log_format(char* buf, int level, const char* tag, const char* format, va_list args)
+{
+    unsigned int   prefix_len;
+    unsigned int   avbl_buf_len;
+    unsigned int   print_len;
+
+    prefix_len = snprintf(buf, LOGBUF_SIZE, "[%s.%s] ", tag, log_level_to_string(level));
+    avbl_buf_len = LOGBUF_SIZE - prefix_len;
+
+    print_len = vsnprintf(buf + prefix_len, avbl_buf_len, format, args);
+
+    /* Since osal_vsnprintf doesn't always return the exact size written to the buffer,
+     * we must check if the user string length exceeds the remaing buffer size.
+     */
+    if (print_len > avbl_buf_len)
+    {
+        print_len = avbl_buf_len;
+    }
+
+    buf[prefix_len + print_len] = '\0';
+
+    return prefix_len + print_len;
+}
+
+static void log_ring_put(struct log_ring* ring, int level, const char* tag, const char* format, ...)
+{
+    struct log_record* rec;
+    va_list args;
+
+    if (!(rec = log_ring_reserve(ring)))
+        return;
+
+    rec->type = LOG_RECORD_TEXT;
+    rec->level = level;
+    va_start(args, format);
+    log_format(rec->u.text, level, tag, format, args);
+    va_end(args);
+    log_ring_commit(ring);
+
+    return;
+}
+
+static uint32_t log_rate_hash(const char* tag)
+{
+    uint64_t hash = (uintptr_t)tag * 0x9E3779B97F4A7C15ULL;
+
+    return (uint32_t)(hash >> 32) & (LOG_RATE_HASH_SIZE - 1);
+}
+
+/* Count the message against its tag, 0 if it is over the limit.
+ * The tag takes its own slot, else the first free or idle one of the
+ * LOG_RATE_PROBE slots from its hash. If all of them are busy this
+ * second with other tags, the message is not limited.
+ */
+static int log_rate_check(struct log_ring* ring, const char* tag)
+{
+    struct log_rate* rate = NULL;
+    struct log_rate* slot;
+    time_t now = time(NULL);
+    uint32_t idx = log_rate_hash(tag);
+    int ret = 1;
+    int i;
+
+    pthread_mutex_lock(&ring->rate_lock);
+
+    for (i = 0; i < LOG_RATE_PROBE; i++)
+    {
+        slot = &ring->rate[(idx + i) & (LOG_RATE_HASH_SIZE - 1)];
+        if (slot->tag == tag)
+        {
+            rate = slot;
+            break;
+        }
+
+        if (!rate && (!slot->tag || slot->sec != now))
+            rate = slot;
+    }
+
+    if (!rate)
+    {
+        pthread_mutex_unlock(&ring->rate_lock);
+        return 1;
+    }
+
+    if (rate->tag != tag || rate->sec != now)
+    {
+        if (rate->suppressed)
+            log_ring_put(ring, NOTICE_LOG_LEVEL, rate->tag, "%u messages suppressed", rate->suppressed);
+        rate->tag = tag;
+        rate->sec = now;
+        rate->count = 0;
+        rate->suppressed = 0;
+    }
+
+    if (++rate->count > LOG_RATE_LIMIT)
+    {
+        rate->suppressed++;
+        ret = 0;
+    }
+
+    pthread_mutex_unlock(&ring->rate_lock);
+
+    return ret;
+}
+
+static void log_write_record(struct log_record* rec)
+{
+    if (rec->type == LOG_RECORD_TEXT)
+        ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[rec->level], "%s", rec->u.text);
+    else if (g_log_trace_file)
+        fwrite(&rec->u.fdb, sizeof(struct iccp_fdb_trace), 1, g_log_trace_file);
+
+    return;
+}
+
+/* Drain every ring once, up to LOG_DRAIN_BUDGET records each */
+static int log_drain(void)
+{
+    struct log_ring* ring;
+    uint32_t count;
+    uint32_t head;
+    uint32_t tail;
+    int done = 0;
+    int i;
+
+    count = __atomic_load_n(&g_log_ring_count, __ATOMIC_ACQUIRE);
+    if (count > LOG_RING_MAX)
+        count = LOG_RING_MAX;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(ring = __atomic_load_n(&g_log_rings[i], __ATOMIC_ACQUIRE)))
+            continue;
+
+        head = ring->head;
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST);
+        if (tail - head > LOG_DRAIN_BUDGET)
+            tail = head + LOG_DRAIN_BUDGET;
+
+        for (; head != tail; head++, done++)
+            log_write_record(&ring->rec[head & LOG_RING_MASK]);
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+
+    return done;
+}
+
+static void log_report_dropped(void)
+{
+    struct log_ring* ring;
+    uint64_t dropped;
+    uint32_t count;
+    int i;
+
+    count = __atomic_load_n(&g_log_ring_count, __ATOMIC_ACQUIRE);
+    if (count > LOG_RING_MAX)
+        count = LOG_RING_MAX;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(ring = __atomic_load_n(&g_log_rings[i], __ATOMIC_ACQUIRE)))
+            continue;
+
+        dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped == ring->reported)
+            continue;
+
+        ICCPD_UTILS_SYSLOG(LOG_WARNING, "[%s.%s] %llu log messages dropped, %llu in total",
+                           __FUNCTION__, log_level_to_string(WARN_LOG_LEVEL),
+                           (unsigned long long)(dropped - ring->reported), (unsigned long long)dropped);
+        ring->reported = dropped;
+    }
+
+    return;
+}
+
+/* Report suppressed counts the tag's next message would have reported,
+ * once its second is over, or all of them if 'all' is set.
+ */
+static void log_rate_flush(int all)
+{
+    struct log_rate pending[LOG_RATE_HASH_SIZE];
+    struct log_rate* slot;
+    struct log_ring* ring;
+    time_t now = time(NULL);
+    uint32_t count;
+    int num;
+    int i;
+    int j;
+
+    count = __atomic_load_n(&g_log_ring_count, __ATOMIC_ACQUIRE);
+    if (count > LOG_RING_MAX)
+        count = LOG_RING_MAX;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(ring = __atomic_load_n(&g_log_rings[i], __ATOMIC_ACQUIRE)))
+            continue;
+
+        /* Copy out under the lock, syslog may block the owning thread */
+        num = 0;
+        pthread_mutex_lock(&ring->rate_lock);
+        for (j = 0; j < LOG_RATE_HASH_SIZE; j++)
+        {
+            slot = &ring->rate[j];
+            if (!slot->suppressed || (!all && slot->sec == now))
+                continue;
+
+            pending[num++] = *slot;
+            slot->suppressed = 0;
+        }
+        pthread_mutex_unlock(&ring->rate_lock);
+
+        for (j = 0; j < num; j++)
+            ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[NOTICE_LOG_LEVEL], "[%s.%s] %u messages suppressed",
+                               pending[j].tag, log_level_to_string(NOTICE_LOG_LEVEL), pending[j].suppressed);
+    }
+
+    return;
+}
+
+static void* log_thread(void* arg)
+{
+    struct pollfd pfd;
+    eventfd_t val;
+    uint64_t flush_msec = iccp_timer_now_msec();
+    uint64_t now_msec;
+
+    pfd.fd = g_log_wake_fd;
+    pfd.events = POLLIN;
+
+    while (1)
+    {
+        /* The idle poll timeout keeps this running when nothing is logged */
+        now_msec = iccp_timer_now_msec();
+        if (now_msec - flush_msec >= LOG_RATE_FLUSH_MSEC)
+        {
+            log_rate_flush(0);
+            flush_msec = now_msec;
+        }
+
+        if (log_drain() > 0)
+            continue;
+
+        log_report_dropped();
+        if (g_log_trace_file)
+            fflush(g_log_trace_file);
+
+        if (__atomic_load_n(&g_log_stop, __ATOMIC_ACQUIRE))
+            break;
+
+        /* Recheck after announcing the sleep, a producer may have missed it */
+        __atomic_store_n(&g_log_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (log_drain() > 0)
+        {
+            __atomic_store_n(&g_log_sleeping, 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        if (poll(&pfd, 1, LOG_IDLE_TIMEOUT_MS) > 0)
+            eventfd_read(g_log_wake_fd, &val);
+        __atomic_store_n(&g_log_sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+
+    return NULL;
+}
+
+static void log_trace_open(const char* path)
+{
+    struct LoggerConfig* config = logger_get_configuration();
+    struct iccp_fdb_trace_hdr hdr;
+
+    if (!(g_log_trace_file = fopen(path, "a")))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to open FDB trace file %s", path);
+        return;
+    }
+
+    /* A new file starts with the header, later runs append to it */
+    if (ftell(g_log_trace_file) == 0)
+    {
+        memset(&hdr, 0, sizeof(struct iccp_fdb_trace_hdr));
+        hdr.magic = ICCP_FDB_TRACE_MAGIC;
+        hdr.version = ICCP_FDB_TRACE_VERSION;
+        hdr.rec_size = sizeof(struct iccp_fdb_trace);
+        fwrite(&hdr, sizeof(struct iccp_fdb_trace_hdr), 1, g_log_trace_file);
+    }
+
+    config->fdb_trace_enabled = 1;
+
+    return;
+}
+
 void log_init(struct CmdOptionParser* parser)
 {
     struct LoggerConfig* config = logger_get_configuration();
+    int err;
 
     config->console_log_enabled = parser->console_log;
+
+    if (parser->fdb_trace_file_path)
+        log_trace_open(parser->fdb_trace_file_path);
+
+    if (g_log_thread_running)
+        return;
+
+    g_log_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_log_wake_fd < 0)
+        return;
+
+    g_log_stop = 0;
+    err = pthread_create(&g_log_thread, NULL, log_thread, NULL);
+    if (err)
+    {
+        close(g_log_wake_fd);
+        g_log_wake_fd = -1;
+        ICCPD_LOG_ERR(__FUNCTION__, "Logger thread create error %d, logging synchronously", err);
+        return;
+    }
+
+    __atomic_store_n(&g_log_thread_running, 1, __ATOMIC_RELEASE);
+
+    return;
 }
 
+/* Flush what is queued and go back to logging on the calling thread */
 void log_finalize()
 {
-    /*do nothing*/
+    struct LoggerConfig* config = logger_get_configuration();
+    uint64_t dropped;
+
+    if (__atomic_exchange_n(&g_log_thread_running, 0, __ATOMIC_ACQ_REL))
+    {
+        __atomic_store_n(&g_log_stop, 1, __ATOMIC_RELEASE);
+        eventfd_write(g_log_wake_fd, 1);
+        pthread_join(g_log_thread, NULL);
+        while (log_drain() > 0)
+            ;
+        log_rate_flush(1);
+        close(g_log_wake_fd);
+        g_log_wake_fd = -1;
+
+        if ((dropped = log_get_dropped()) > 0)
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Logger dropped %llu messages", (unsigned long long)dropped);
+    }
+
+    config->fdb_trace_enabled = 0;
+    if (g_log_trace_file)
+        fclose(g_log_trace_file);
+    g_log_trace_file = NULL;
+
+    return;
+}
+
+uint64_t log_get_dropped(void)
+{
+    struct log_ring* ring;
+    uint64_t dropped = 0;
+    uint32_t count;
+    int i;
+
+    count = __atomic_load_n(&g_log_ring_count, __ATOMIC_ACQUIRE);
+    if (count > LOG_RING_MAX)
+        count = LOG_RING_MAX;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((ring = __atomic_load_n(&g_log_rings[i], __ATOMIC_ACQUIRE)))
+            dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    }
+
+    return dropped;
 }
 
 void write_log(int level, const char* tag, const char* format, ...)
 {
     struct LoggerConfig* config = logger_get_configuration();
+    struct log_ring* ring = NULL;
+    struct log_record* rec = NULL;
     char buf[LOGBUF_SIZE];
     va_list args;
-    unsigned int   prefix_len;
-    unsigned int   avbl_buf_len;
-    unsigned int   print_len;
 
 #if 0
     if (!config->console_log_enabled)
@@ -117,24 +586,66 @@ void write_log(int level, const char* tag, const char* format, ...)
     if (level > config->log_level)
         return;
 
-    prefix_len = snprintf(buf, LOGBUF_SIZE, "[%s.%s] ", tag, log_level_to_string(level));
-    avbl_buf_len = LOGBUF_SIZE - prefix_len;
+    /* Before the logger thread runs, after it stopped, or out of rings */
+    if (!__atomic_load_n(&g_log_thread_running, __ATOMIC_ACQUIRE) || !(ring = log_get_ring()))
+    {
+        va_start(args, format);
+        log_format(buf, level, tag, format, args);
+        va_end(args);
+        ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[level], "%s", buf);
+        return;
+    }
+
+    if (level >= NOTICE_LOG_LEVEL && !log_rate_check(ring, tag))
+        return;
+
+    if (!(rec = log_ring_reserve(ring)))
+        return;
 
+    rec->type = LOG_RECORD_TEXT;
+    rec->level = level;
     va_start(args, format);
-    print_len = vsnprintf(buf + prefix_len, avbl_buf_len, format, args);
+    log_format(rec->u.text, level, tag, format, args);
     va_end(args);
+    log_ring_commit(ring);
 
-    /* Since osal_vsnprintf doesn't always return the exact size written to the buffer,
-     * we must check if the user string length exceeds the remaing buffer size.
-     */
-    if (print_len > avbl_buf_len)
+    return;
+}
+
+void write_fdb_trace(uint8_t event, uint8_t op_type, uint8_t fdb_type, uint16_t vid,
+                     const uint8_t* mac_addr, const char* ifname)
+{
+    struct log_ring* ring = NULL;
+    struct log_record* rec = NULL;
+    struct iccp_fdb_trace fdb;
+    struct timespec ts;
+
+    if (!g_log_trace_file)
+        return;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memset(&fdb, 0, sizeof(struct iccp_fdb_trace));
+    fdb.time_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    fdb.vid = vid;
+    memcpy(fdb.mac_addr, mac_addr, 6);
+    fdb.event = event;
+    fdb.op_type = op_type;
+    fdb.fdb_type = fdb_type;
+    if (ifname)
+        strncpy(fdb.ifname, ifname, ICCP_FDB_TRACE_IFNAME_LEN - 1);
+
+    if (!__atomic_load_n(&g_log_thread_running, __ATOMIC_ACQUIRE) || !(ring = log_get_ring()))
     {
-        print_len = avbl_buf_len;
+        fwrite(&fdb, sizeof(struct iccp_fdb_trace), 1, g_log_trace_file);
+        return;
     }
 
-    buf[prefix_len + print_len] = '\0';
-    ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[level], "%s", buf);
+    if (!(rec = log_ring_reserve(ring)))
+        return;
+
+    rec->type = LOG_RECORD_FDB;
+    rec->u.fdb = fdb;
+    log_ring_commit(ring);
 
     return;
 }
-
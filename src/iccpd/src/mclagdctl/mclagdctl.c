@@ -27,6 +27,7 @@
 #include <stdbool.h>
 #include <getopt.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <netinet/in.h>
@@ -34,8 +35,10 @@
 #include "mclagdctl.h"
 #include "../../include/mlacp_fsm.h"
 #include "../../include/system.h"
+#include "../../include/logger.h"
 
 static int mclagdctl_sock_fd = -1;
+static int mclagdctl_dump_count = 0;    /* entries printed by earlier pages */
 char *mclagdctl_sock_path = "/var/run/iccpd/mclagdctl.sock";
 
 /*
@@ -84,6 +87,7 @@ static struct command_type command_types[] =
         .name = "arp",
         .enca_msg = mclagdctl_enca_dump_arp,
         .parse_msg = mclagdctl_parse_dump_arp,
+        .next_msg = mclagdctl_next_dump_page,
     },
     {
          .id = ID_CMDTYPE_D_A,
@@ -100,6 +104,7 @@ static struct command_type command_types[] =
         .name = "mac",
         .enca_msg = mclagdctl_enca_dump_mac,
         .parse_msg = mclagdctl_parse_dump_mac,
+        .next_msg = mclagdctl_next_dump_page,
     },
     {
         .id = ID_CMDTYPE_D_A,
@@ -346,6 +351,7 @@ int mclagdctl_enca_dump_arp(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_ARP;
     req.mclag_id = mclag_id;
+    ((struct mclagdctl_dump_cursor *)req.para1)->paged = 1;
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
@@ -375,12 +381,19 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-20s", "IP");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "%s", "Flag");
-    fprintf(stdout, "\n");
+    /* paged reply, entries follow the cursor */
+    msg += sizeof(struct mclagdctl_dump_cursor);
+    data_len -= sizeof(struct mclagdctl_dump_cursor);
+
+    if (mclagdctl_dump_count == 0)
+    {
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-20s", "IP");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "%s", "Flag");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_arp_msg);
 
@@ -388,7 +401,7 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
     {
         arp_info = (struct mclagd_arp_msg*)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        fprintf(stdout, "%-6d", mclagdctl_dump_count + count + 1);
         fprintf(stdout, "%-20s", arp_info->ipv4_addr);
         fprintf(stdout, "%02x:%02x:%02x:%02x:%02x:%02x",
                 arp_info->mac_addr[0], arp_info->mac_addr[1],
@@ -406,6 +419,8 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
         fprintf(stdout, "\n");
     }
 
+    mclagdctl_dump_count += count;
+
     return 0;
 }
 
@@ -461,6 +476,7 @@ int mclagdctl_enca_dump_mac(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_MAC;
     req.mclag_id = mclag_id;
+    ((struct mclagdctl_dump_cursor *)req.para1)->paged = 1;
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
@@ -472,16 +488,23 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
+    /* paged reply, entries follow the cursor */
+    msg += sizeof(struct mclagdctl_dump_cursor);
+    data_len -= sizeof(struct mclagdctl_dump_cursor);
 
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-5s", "TYPE");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-5s", "VID");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "%-20s", "ORIGIN-DEV");
-    fprintf(stdout, "%-5s", "AGE");
-    fprintf(stdout, "\n");
+    if (mclagdctl_dump_count == 0)
+    {
+        fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
+
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-5s", "TYPE");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-5s", "VID");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "%-20s", "ORIGIN-DEV");
+        fprintf(stdout, "%-5s", "AGE");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_mac_msg);
 
@@ -489,7 +512,7 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
     {
         mac_info = (struct mclagd_mac_msg*)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        fprintf(stdout, "%-6d", mclagdctl_dump_count + count + 1);
 
         if (mac_info->fdb_type == MAC_TYPE_STATIC_CTL)
             fprintf(stdout, "%-5s", "S");
@@ -513,9 +536,29 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
         fprintf(stdout, "\n");
     }
 
+    mclagdctl_dump_count += count;
+
     return 0;
 }
 
+/* Turn the cursor of a paged reply into the request for the next page */
+int mclagdctl_next_dump_page(char *msg, char *data, int data_len)
+{
+    struct mclagdctl_req_hdr *req = (struct mclagdctl_req_hdr *)msg;
+    struct mclagdctl_dump_cursor cursor;
+
+    if (data_len < (int)sizeof(struct mclagdctl_dump_cursor))
+        return 0;
+
+    memcpy(&cursor, data, sizeof(struct mclagdctl_dump_cursor));
+    if (!cursor.resume)
+        return 0;
+
+    memcpy(req->para1, &cursor, sizeof(struct mclagdctl_dump_cursor));
+
+    return 1;
+}
+
 int mclagdctl_enca_dump_local_portlist(char *msg, int mclag_id, int argc, char **argv)
 {
     struct mclagdctl_req_hdr req;
@@ -756,6 +799,12 @@ static char *mclagdctl_dbg_counter_iccpid2str(ICCP_DBG_CNTR_MSG_e iccp_cntr_id)
             return "Warmboot";
         case ICCP_DBG_CNTR_MSG_IF_UP_ACK:
             return "IfUpAck";
+        case ICCP_DBG_CNTR_MSG_CAPABILITY:
+            return "Capability";
+        case ICCP_DBG_CNTR_MSG_MAC_BULK_INFO:
+            return "MacBulkInfo";
+        case ICCP_DBG_CNTR_MSG_ARP_BULK_INFO:
+            return "ArpBulkInfo";
         default:
             return "Unknown";
     }
@@ -798,6 +847,8 @@ static char *mclagdctl_dbg_counter_syncdtx2str(SYNCD_TX_DBG_CNTR_MSG_e syncdtx_i
             return "PeerLinkIsolation";
         case SYNCD_TX_DBG_CNTR_MSG_SET_ICCP_PEER_SYSTEM_ID:
             return "SetPeerSystemId";
+        case SYNCD_TX_DBG_CNTR_MSG_SET_FDB_BULK:
+            return "SetFdbBulk";
         default:
             return "Unknown";
     }
@@ -820,11 +871,50 @@ static char *mclagdctl_dbg_counter_syncdrx2str(SYNCD_RX_DBG_CNTR_MSG_e syncdrx_i
             return "CfgMclagUniqueIp";
         case SYNCD_RX_DBG_CNTR_MSG_VLAN_MBR_UPDATES:
             return "vlanMbrshipChange";
+        case SYNCD_RX_DBG_CNTR_MSG_CAPABILITY:
+            return "Capability";
         default:
             return "Unknown";
     }
 }
 
+static char *mclagdctl_dbg_counter_pool2str(ICCP_POOL_ID_E pool_id)
+{
+    /* Keep the string to 12 characters */
+    switch(pool_id)
+    {
+        case ICCP_POOL_MSG:
+            return "Msg";
+        case ICCP_POOL_MAC_MSG:
+            return "MACMsg";
+        case ICCP_POOL_ARP_MSG:
+            return "ARPMsg";
+        case ICCP_POOL_NDISC_MSG:
+            return "NDISCMsg";
+        case ICCP_POOL_BUF_128:
+            return "Buf128";
+        case ICCP_POOL_BUF_512:
+            return "Buf512";
+        case ICCP_POOL_BUF_2K:
+            return "Buf2K";
+        case ICCP_POOL_BUF_8K:
+            return "Buf8K";
+        case ICCP_POOL_LARGE:
+            return "BufLarge";
+        default:
+            return "Unknown";
+    }
+}
+
+static void mclagdctl_dbg_counter_pkt_rx_print(char *name, struct iccp_pkt_rx_stats *stats)
+{
+    fprintf(stdout, "%-12s%-16lu%-12u%-12u%-12u%-12lu\n",
+        name, stats->pkt_counter, stats->batch_counter, stats->batch_full_counter,
+        stats->batch_max, stats->batch_counter ? stats->pkt_counter / stats->batch_counter : 0);
+
+    return;
+}
+
 int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
 {
     mclagd_dbg_counter_info_t *dbg_counter_p;
@@ -860,9 +950,20 @@ int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
         sys_counter_p->socket_close_err_counter);
     fprintf(stdout, "%-20s%u\n", "Socket cleanup:",
         sys_counter_p->socket_cleanup_counter);
+    fprintf(stdout, "%-20s%u\n", "Rx partial msg:",
+        sys_counter_p->rx_peer_partial_msg_counter);
+    fprintf(stdout, "%-20s%u\n", "Tx queue depth:",
+        sys_counter_p->peer_tx_queue_depth);
+    fprintf(stdout, "%-20s%u\n", "Tx queue max:",
+        sys_counter_p->peer_tx_queue_hwm);
+    fprintf(stdout, "%-20s%u\n", "Tx queue full:",
+        sys_counter_p->tx_queue_full_counter);
 
     fprintf(stdout, "\n");
     fprintf(stdout, "%-20s%u\n\n", "Warmboot:", sys_counter_p->warmboot_counter);
+    fprintf(stdout, "%-20s%u\n", "Peer sync:", sys_counter_p->peer_sync_counter);
+    fprintf(stdout, "%-20s%u\n", "Peer sync last ms:", sys_counter_p->peer_sync_last_msec);
+    fprintf(stdout, "%-20s%u\n\n", "Peer sync max ms:", sys_counter_p->peer_sync_max_msec);
 
     /* ICCP daemon to Mclagsyncd messages */
     fprintf(stdout, "%-20s%-20s%-20s\n", "ICCP to MclagSyncd", "TX_OK", "TX_ERROR");
@@ -875,6 +976,15 @@ int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
             sys_counter_p->syncd_tx_counters[i][1]);
     }
 
+    fprintf(stdout, "%-20s%lu\n", "SetFdbBulk entries:",
+        sys_counter_p->fdb_bulk_entry_counter);
+    fprintf(stdout, "%-20s%u\n", "SetFdbBulk max:",
+        sys_counter_p->fdb_bulk_entry_max);
+    fprintf(stdout, "%-20s%u\n", "Tx queue depth:",
+        sys_counter_p->syncd_tx_queue_depth);
+    fprintf(stdout, "%-20s%u\n", "Tx queue max:",
+        sys_counter_p->syncd_tx_queue_hwm);
+
     fprintf(stdout, "\n%-20s%-20s%-20s\n", "MclagSyncd to ICCP", "RX_OK", "RX_ERROR");
     fprintf(stdout, "%-20s%-20s%-20s\n", "------------------", "-----", "--------");
     for (i = 0; i < SYNCD_RX_DBG_CNTR_MSG_MAX; ++i)
@@ -920,7 +1030,39 @@ int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
     fprintf(stdout, "Address add/del: %u/%u\n",
         sys_counter_p->newaddr_count, sys_counter_p->deladdr_count);
     fprintf(stdout, "Unexpected message type: %u\n", sys_counter_p->unknown_type_count);
-    fprintf(stdout, "Receive error: %u\n\n", sys_counter_p->rx_error_count);
+    fprintf(stdout, "Receive error: %u\n", sys_counter_p->rx_error_count);
+    fprintf(stdout, "Events coalesced: %u\n", sys_counter_p->nl_event_coalesce_counter);
+    fprintf(stdout, "Events overflowed: %u\n", sys_counter_p->nl_event_overflow_counter);
+    fprintf(stdout, "Event ring high watermark: %u\n\n", sys_counter_p->nl_event_ring_hwm);
+
+    /* ARP/ND packet receive batches */
+    fprintf(stdout, "%-12s%-16s%-12s%-12s%-12s%-12s\n",
+        "Packet", "PKTS", "BATCHES", "FULL", "MAX", "AVG");
+    fprintf(stdout, "%-12s%-16s%-12s%-12s%-12s%-12s\n",
+        "------", "----", "-------", "----", "---", "---");
+    mclagdctl_dbg_counter_pkt_rx_print("ARP", &sys_counter_p->arp_rx_stats);
+    mclagdctl_dbg_counter_pkt_rx_print("ND", &sys_counter_p->ndisc_rx_stats);
+    fprintf(stdout, "\n");
+
+    /* Message pools */
+    fprintf(stdout, "%-12s%-12s%-12s%-12s%-12s%-16s%-16s%-12s\n",
+        "Pool", "IN_USE", "IN_USE_MAX", "CACHED", "CHUNKS", "ALLOC", "FREE", "FAIL");
+    fprintf(stdout, "%-12s%-12s%-12s%-12s%-12s%-16s%-16s%-12s\n",
+        "----", "------", "----------", "------", "------", "-----", "----", "----");
+    for (i = 0; i < ICCP_POOL_MAX; ++i)
+    {
+        fprintf(stdout, "%-12s%-12u%-12u%-12u%-12u%-16lu%-16lu%-12u\n",
+            mclagdctl_dbg_counter_pool2str(i),
+            sys_counter_p->pool_stats[i].in_use,
+            sys_counter_p->pool_stats[i].in_use_max,
+            sys_counter_p->pool_stats[i].cached,
+            sys_counter_p->pool_stats[i].chunks,
+            sys_counter_p->pool_stats[i].alloc_counter,
+            sys_counter_p->pool_stats[i].free_counter,
+            sys_counter_p->pool_stats[i].alloc_fail_counter);
+    }
+    fprintf(stdout, "MAC entry alloc/free: %u/%u\n\n",
+        sys_counter_p->mac_entry_alloc_counter, sys_counter_p->mac_entry_free_counter);
     return 0;
 }
 
@@ -1066,7 +1208,8 @@ static void mclagdctl_print_help(const char *argv0)
     fprintf(stdout, "%s [options] command [command args]\n"
             "    -h --help                Show this help\n"
             "    -i --mclag-id            Specify one mclag id\n"
-            "    -l --level               Specify log level     critical,err,warn,notice,info,debug\n",
+            "    -l --level               Specify log level     critical,err,warn,notice,info,debug\n"
+            "    -t --trace               Decode an FDB trace file written by iccpd -t\n",
             argv0);
     fprintf(stdout, "Commands:\n");
 
@@ -1085,6 +1228,66 @@ static void mclagdctl_print_help(const char *argv0)
     }
 }
 
+/* Print the binary FDB trace iccpd writes with -t, no iccpd needed */
+static int mclagdctl_decode_fdb_trace(const char *path)
+{
+    static const char *event_str[] = { "-", "SYNCD", "PEER", "CHIP" };
+    struct iccp_fdb_trace_hdr hdr;
+    struct iccp_fdb_trace rec;
+    struct tm tm;
+    time_t sec;
+    char time_str[32];
+    FILE *fp;
+    int count = 0;
+
+    if (!(fp = fopen(path, "r")))
+    {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (fread(&hdr, sizeof(struct iccp_fdb_trace_hdr), 1, fp) != 1
+        || hdr.magic != ICCP_FDB_TRACE_MAGIC || hdr.version != ICCP_FDB_TRACE_VERSION
+        || hdr.rec_size != sizeof(struct iccp_fdb_trace))
+    {
+        fprintf(stderr, "%s is not an FDB trace of this version\n", path);
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "%-6s", "No.");
+    fprintf(stdout, "%-28s", "TIME");
+    fprintf(stdout, "%-7s", "EVENT");
+    fprintf(stdout, "%-5s", "OP");
+    fprintf(stdout, "%-5s", "TYPE");
+    fprintf(stdout, "%-20s", "MAC");
+    fprintf(stdout, "%-6s", "VID");
+    fprintf(stdout, "%s", "DEV");
+    fprintf(stdout, "\n");
+
+    while (fread(&rec, sizeof(struct iccp_fdb_trace), 1, fp) == 1)
+    {
+        sec = rec.time_ns / 1000000000ULL;
+        localtime_r(&sec, &tm);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm);
+        rec.ifname[ICCP_FDB_TRACE_IFNAME_LEN - 1] = '\0';
+
+        fprintf(stdout, "%-6d", ++count);
+        fprintf(stdout, "%s.%06llu   ", time_str, (unsigned long long)(rec.time_ns % 1000000000ULL) / 1000);
+        fprintf(stdout, "%-7s", rec.event <= ICCP_FDB_TRACE_CHIP ? event_str[rec.event] : "-");
+        fprintf(stdout, "%-5s", rec.op_type == MAC_SYNC_ADD ? "add" : "del");
+        fprintf(stdout, "%-5s", rec.fdb_type == MAC_TYPE_STATIC_CTL ? "S" : "D");
+        fprintf(stdout, "%-20s", mac_addr_to_str(rec.mac_addr));
+        fprintf(stdout, "%-6d", rec.vid);
+        fprintf(stdout, "%s", rec.ifname);
+        fprintf(stdout, "\n");
+    }
+
+    fclose(fp);
+
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char **argv)
 {
     char buf[MCLAGDCTL_CMD_SIZE] = { 0 };
@@ -1095,6 +1298,7 @@ int main(int argc, char **argv)
         { "help",      no_argument,             NULL,        'h' },
         { "mclag id",  required_argument,       NULL,        'i' },
         { "log level", required_argument,       NULL,        'l' },
+        { "trace",     required_argument,       NULL,        't' },
         { NULL,        0,                       NULL,        0   }
     };
     int opt;
@@ -1104,10 +1308,11 @@ int main(int argc, char **argv)
     unsigned para_int = 0;
 
     int len = 0;
+    int more = 0;
     char *data;
     struct mclagd_reply_hdr *reply;
 
-    while ((opt = getopt_long(argc, argv, "hi:l:", long_options, NULL)) >= 0)
+    while ((opt = getopt_long(argc, argv, "hi:l:t:", long_options, NULL)) >= 0)
     {
         switch (opt)
         {
@@ -1153,6 +1358,9 @@ int main(int argc, char **argv)
             }
             break;
 
+        case 't':
+            return mclagdctl_decode_fdb_trace(optarg);
+
             case '?':
                 fprintf(stderr, "unknown option.\n");
                 mclagdctl_print_help(argv0);
@@ -1182,93 +1390,107 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-    if (mclagdctl_sock_fd <= 0)
-    {
-        ret = mclagdctl_sock_connect();
-        if (ret < 0)
-            return EXIT_FAILURE;
-    }
-
     if (cmd_type->enca_msg(buf, para_int, argc, argv) < 0)
+        return EXIT_FAILURE;
+
+    /* one request per connection, paged dumps come back a page at a time */
+    do
     {
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (mclagdctl_sock_fd <= 0)
+        {
+            ret = mclagdctl_sock_connect();
+            if (ret < 0)
+                return EXIT_FAILURE;
+        }
 
-    ret = mclagdctl_sock_write(mclagdctl_sock_fd, buf, sizeof(struct mclagdctl_req_hdr));
+        ret = mclagdctl_sock_write(mclagdctl_sock_fd, buf, sizeof(struct mclagdctl_req_hdr));
 
-    if (ret <= 0)
-    {
-        fprintf(stderr, "Failed to send command to mclagd\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Failed to send command to mclagd\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    /*read data length*/
-    memset(buf, 0, MCLAGDCTL_CMD_SIZE);
-    ret = mclagdctl_sock_read(mclagdctl_sock_fd, buf, sizeof(int));
-    if (ret <= 0)
-    {
-        fprintf(stderr, "Failed to read data length from mclagd\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        /*read data length*/
+        len = 0;
+        ret = mclagdctl_sock_read(mclagdctl_sock_fd, (char *)&len, sizeof(int));
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Failed to read data length from mclagd\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    /*cont length*/
-    len = *((int*)buf);
-    if (len <= 0)
-    {
-        ret = EXIT_FAILURE;
-        fprintf(stderr, "pkt len = %d, error\n", len);
-        goto mclagdctl_disconnect;
-    }
+        /*cont length*/
+        if (len <= 0)
+        {
+            ret = EXIT_FAILURE;
+            fprintf(stderr, "pkt len = %d, error\n", len);
+            goto mclagdctl_disconnect;
+        }
 
-    rcv_buf = (char *)malloc(len);
-    if (!rcv_buf)
-    {
-        fprintf(stderr, "Failed to malloc rcv_buf for mclagdctl\n");
-        goto mclagdctl_disconnect;
-    }
+        rcv_buf = (char *)malloc(len);
+        if (!rcv_buf)
+        {
+            fprintf(stderr, "Failed to malloc rcv_buf for mclagdctl\n");
+            goto mclagdctl_disconnect;
+        }
 
-    /*read data*/
-    ret = mclagdctl_sock_read(mclagdctl_sock_fd, rcv_buf, len);
-    if (ret <= 0)
-    {
-        fprintf(stderr, "Failed to read data from mclagd\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        /*read data*/
+        ret = mclagdctl_sock_read(mclagdctl_sock_fd, rcv_buf, len);
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Failed to read data from mclagd\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    reply = (struct mclagd_reply_hdr *)rcv_buf;
-    if (reply->info_type != cmd_type->info_type)
-    {
-        fprintf(stderr, "Reply info type from mclagd error\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        reply = (struct mclagd_reply_hdr *)rcv_buf;
+        if (reply->info_type != cmd_type->info_type)
+        {
+            fprintf(stderr, "Reply info type from mclagd error\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_NO_EXIST_SYS)
-    {
-        fprintf(stderr, "No exist sys in iccpd!\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_NO_EXIST_SYS)
+        {
+            fprintf(stderr, "No exist sys in iccpd!\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_NO_EXIST_MCLAGID)
-    {
-        fprintf(stderr, "Mclag-id %d hasn't been configured in iccpd!\n", para_int);
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_NO_EXIST_MCLAGID)
+        {
+            fprintf(stderr, "Mclag-id %d hasn't been configured in iccpd!\n", para_int);
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_FAILED)
-    {
-        fprintf(stderr, "exec error in iccpd!\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_CURSOR_LOST)
+        {
+            fprintf(stderr, "Table changed during the dump, output is incomplete!\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
+
+        if (reply->exec_result == EXEC_TYPE_FAILED)
+        {
+            fprintf(stderr, "exec error in iccpd!\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    cmd_type->parse_msg((char *)(rcv_buf + sizeof(struct mclagd_reply_hdr)), len - sizeof(struct mclagd_reply_hdr));
+        data = rcv_buf + sizeof(struct mclagd_reply_hdr);
+        cmd_type->parse_msg(data, len - sizeof(struct mclagd_reply_hdr));
+
+        more = cmd_type->next_msg && cmd_type->next_msg(buf, data, len - sizeof(struct mclagd_reply_hdr)) > 0;
+
+        mclagdctl_sock_close();
+        free(rcv_buf);
+        rcv_buf = NULL;
+    } while (more);
 
     ret = EXIT_SUCCESS;
 
@@ -36,6 +36,7 @@
 
 typedef int (*call_enca_msg_fun)(char *msg, int mclag_id,  int argc, char **argv);
 typedef int (*call_parse_msg_fun)(char *msg, int data_len);
+typedef int (*call_next_msg_fun)(char *msg, char *data, int data_len);
 
 enum MAC_TYPE_CTL
 {
@@ -100,6 +101,24 @@ struct mclagdctl_req_hdr
     char para3[MCLAGDCTL_PARA2_LEN];
 };
 
+/* Carried in para1 of a MAC or ARP dump request. With paged set iccpd
+ * replies with at most MCLAGDCTL_DUMP_PAGE_ENTRIES entries following the
+ * entry the cursor names, and sends the cursor back ahead of the entries,
+ * resume set if more entries follow. A request without paged gets the
+ * whole table in one reply.
+ */
+#define MCLAGDCTL_DUMP_PAGE_ENTRIES 1024
+
+struct mclagdctl_dump_cursor
+{
+    uint8_t paged;
+    uint8_t resume;
+    uint16_t vid;                       /* MAC: last entry sent */
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint8_t reserved[2];
+    uint32_t ipv4_addr;                 /* ARP: last entry sent */
+};
+
 struct mclagd_reply_hdr
 {
     int info_type;
@@ -111,10 +130,12 @@ struct mclagd_reply_hdr
 #define EXEC_TYPE_NO_EXIST_SYS  -2
 #define EXEC_TYPE_NO_EXIST_MCLAGID  -3
 #define EXEC_TYPE_FAILED -4
+#define EXEC_TYPE_CURSOR_LOST -5
 
 #define MCLAG_ERROR -1
 
 #define MCLAGD_REPLY_INFO_HDR (sizeof(struct mclagd_reply_hdr) + sizeof(int))
+#define MCLAGD_REPLY_PAGE_HDR (MCLAGD_REPLY_INFO_HDR + sizeof(struct mclagdctl_dump_cursor))
 
 #define MCLAGDCTL_COMMAND_PARAM_MAX_CNT 8
 struct command_type
@@ -126,6 +147,7 @@ struct command_type
     char *params[MCLAGDCTL_COMMAND_PARAM_MAX_CNT];
     call_enca_msg_fun enca_msg;
     call_parse_msg_fun parse_msg;
+    call_next_msg_fun next_msg;
 };
 
 struct mclagd_state
@@ -234,6 +256,7 @@ extern int mclagdctl_parse_dump_arp(char *msg, int data_len);
 extern int mclagdctl_parse_dump_ndisc(char *msg, int data_len);
 extern int mclagdctl_enca_dump_mac(char *msg, int mclag_id, int argc, char **argv);
 extern int mclagdctl_parse_dump_mac(char *msg, int data_len);
+extern int mclagdctl_next_dump_page(char *msg, char *data, int data_len);
 extern int mclagdctl_enca_dump_local_portlist(char *msg, int mclag_id,  int argc, char **argv);
 extern int mclagdctl_parse_dump_local_portlist(char *msg, int data_len);
 extern int mclagdctl_enca_dump_peer_portlist(char *msg, int mclag_id,  int argc, char **argv);
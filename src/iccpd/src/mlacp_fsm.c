@@ -42,6 +42,8 @@
 #include "../include/mlacp_sync_update.h"
 #include "../include/system.h"
 #include "../include/scheduler.h"
+#include "../include/iccp_warm_state.h"
+#include "../include/iccp_timer.h"
 
 #include <signal.h>
 
@@ -55,12 +57,19 @@
         while (!TAILQ_EMPTY(&(list))) { \
             msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), msg, tail); \
-            free(msg->buf); \
-            free(msg); \
+            iccp_csm_free_msg(msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
 
+#define MLACP_NEIGH_QUEUE_REINIT(list, hash) \
+    { \
+        int i; \
+        MLACP_MSG_QUEUE_REINIT(list); \
+        for (i = 0; i < MLACP_NEIGH_HASH_SIZE; i++) \
+            LIST_INIT(&(hash)[i]); \
+    }
+
 #define MLACP_MAC_MSG_QUEUE_REINIT(list) \
     { \
         struct MACMsg* mac_msg = NULL; \
@@ -68,7 +77,7 @@
             mac_msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), mac_msg, tail); \
             if (mac_msg->op_type == MAC_SYNC_DEL) \
-                free(mac_msg); \
+                iccp_csm_free_mac_msg(mac_msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
@@ -203,6 +212,11 @@ static void mlacp_sync_send_sysConf(struct CSM* csm)
     else
         ICCPD_LOG_WARN(__FUNCTION__, "Invalid sysconf packet.");
 
+    /* Optional features; peers that do not know the TLV log it once as unsupported */
+    msg_len = mlacp_prepare_for_capability(csm, g_csm_buf, CSM_BUFFER_SIZE);
+    if (msg_len > 0)
+        iccp_csm_send(csm, g_csm_buf, msg_len);
+
     /*ICCPD_LOG_DEBUG("mlacp_fsm", "  [SYNC_Send] SysConf, len=[%d]", msg_len);*/
 
     return;
@@ -257,15 +271,142 @@ static void mlacp_sync_send_aggState(struct CSM* csm)
 }
 #define MAX_MAC_ENTRY_NUM 30
 #define MAX_NEIGH_ENTRY_NUM 40
+/* Entries sorted and sent in one round of bulk messages */
+#define MAX_BULK_ENTRY_NUM 65536
+
+/* Sort key of a queued entry, queue order is kept for equal keys */
+struct mlacp_bulk_sort_entry
+{
+    uint64_t key;
+    uint32_t seq;
+    void* data;
+};
+
+static struct mlacp_bulk_sort_entry* g_bulk_sort = NULL;
+static void** g_bulk_sorted = NULL;
+static struct ARPMsg** g_bulk_arp = NULL;
+
+static int mlacp_bulk_sort_cmp(const void* a, const void* b)
+{
+    const struct mlacp_bulk_sort_entry* ea = a;
+    const struct mlacp_bulk_sort_entry* eb = b;
+
+    if (ea->key != eb->key)
+        return ea->key < eb->key ? -1 : 1;
+
+    return ea->seq < eb->seq ? -1 : 1;
+}
+
+static int mlacp_bulk_sort_alloc(void)
+{
+    if (g_bulk_sort == NULL)
+        g_bulk_sort = (struct mlacp_bulk_sort_entry*)malloc(MAX_BULK_ENTRY_NUM * sizeof(struct mlacp_bulk_sort_entry));
+    if (g_bulk_sorted == NULL)
+        g_bulk_sorted = (void**)malloc(MAX_BULK_ENTRY_NUM * sizeof(void*));
+    if (g_bulk_arp == NULL)
+        g_bulk_arp = (struct ARPMsg**)malloc(MAX_BULK_ENTRY_NUM * sizeof(struct ARPMsg*));
+
+    return (g_bulk_sort && g_bulk_sorted && g_bulk_arp) ? 0 : MCLAG_ERROR;
+}
+
+static void mlacp_bulk_sort(int num)
+{
+    int i;
+
+    qsort(g_bulk_sort, num, sizeof(struct mlacp_bulk_sort_entry), mlacp_bulk_sort_cmp);
+    for (i = 0; i < num; i++)
+        g_bulk_sorted[i] = g_bulk_sort[i].data;
+
+    return;
+}
+
+/* The entry is no longer queued, free it if it was deleted */
+static void mlacp_sync_mac_msg_sent(struct CSM* csm, struct MACMsg* mac_msg)
+{
+    struct MACMsg mac_find;
+
+    //free mac_msg if marked for delete.
+    if (mac_msg->op_type == MAC_SYNC_DEL)
+    {
+        if (!(mac_msg->mac_entry_rb.rbt_parent))
+        {
+            //If the entry is parent then the parent pointer would be null
+            //search to confirm if the MAC is present in RB tree. if not then free.
+            memset(&mac_find, 0, sizeof(struct MACMsg));
+            mac_find.vid = mac_msg->vid ;
+            memcpy(mac_find.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+            if (!RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb ,&mac_find))
+                iccp_csm_free_mac_msg(mac_msg);
+        }
+    }
+
+    return;
+}
+
+/* Peer takes TLV_T_MLACP_MAC_BULK_INFO: sort by VLAN and MAC, fill whole messages */
+static void mlacp_sync_send_syncMacBulkInfo(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL;
+    struct MACMsg** mac_msgs;
+    int msg_len = 0;
+    int num;
+    int pos;
+    int count;
+    int i;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).mac_msg_list)))
+    {
+        num = 0;
+        while (num < MAX_BULK_ENTRY_NUM && !TAILQ_EMPTY(&(MLACP(csm).mac_msg_list)))
+        {
+            mac_msg = TAILQ_FIRST(&(MLACP(csm).mac_msg_list));
+            MAC_TAILQ_REMOVE(&(MLACP(csm).mac_msg_list), mac_msg, tail);
+            g_bulk_sort[num].key = ((uint64_t)mac_msg->vid << 48)
+                                   | ((uint64_t)mac_msg->mac_addr[0] << 40) | ((uint64_t)mac_msg->mac_addr[1] << 32)
+                                   | ((uint64_t)mac_msg->mac_addr[2] << 24) | ((uint64_t)mac_msg->mac_addr[3] << 16)
+                                   | ((uint64_t)mac_msg->mac_addr[4] << 8) | mac_msg->mac_addr[5];
+            g_bulk_sort[num].seq = num;
+            g_bulk_sort[num].data = mac_msg;
+            num++;
+        }
+        mlacp_bulk_sort(num);
+        mac_msgs = (struct MACMsg**)g_bulk_sorted;
+
+        for (pos = 0; pos < num; pos += count)
+        {
+            msg_len = mlacp_prepare_for_mac_bulk_info(csm, g_csm_buf, CSM_BUFFER_SIZE,
+                                                      &mac_msgs[pos], num - pos, &count);
+            if (msg_len <= 0)
+            {
+                ICCPD_LOG_ERR(__FUNCTION__, "Failed to prepare bulk MAC message, %d entries dropped", num - pos);
+                count = num - pos;
+            }
+            else
+            {
+                iccp_csm_send(csm, g_csm_buf, msg_len);
+            }
+
+            for (i = pos; i < pos + count; i++)
+                mlacp_sync_mac_msg_sent(csm, mac_msgs[i]);
+        }
+    }
+
+    return;
+}
+
 static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
 {
     int msg_len = 0;
     struct MACMsg* mac_msg = NULL;
-    struct MACMsg mac_find;
     int count = 0;
 
+    if ((MLACP(csm).peer_capability & MLACP_PEER_CAP_MAC_BULK) && mlacp_bulk_sort_alloc() == 0)
+    {
+        mlacp_sync_send_syncMacBulkInfo(csm);
+        return;
+    }
+
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
-    memset(&mac_find, 0, sizeof(struct MACMsg));
 
     while (!TAILQ_EMPTY(&(MLACP(csm).mac_msg_list)))
     {
@@ -275,19 +416,7 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
         msg_len = mlacp_prepare_for_mac_info_to_peer(csm, g_csm_buf, CSM_BUFFER_SIZE, mac_msg, count);
         count++;
 
-        //free mac_msg if marked for delete.
-        if (mac_msg->op_type == MAC_SYNC_DEL)
-        {
-            if (!(mac_msg->mac_entry_rb.rbt_parent))
-            {
-                //If the entry is parent then the parent pointer would be null
-                //search to confirm if the MAC is present in RB tree. if not then free.
-                mac_find.vid = mac_msg->vid ;
-                memcpy(mac_find.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
-                if (!RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb ,&mac_find))
-                    free(mac_msg);
-            }
-        }
+        mlacp_sync_mac_msg_sent(csm, mac_msg);
 
         if (count >= MAX_MAC_ENTRY_NUM)
         {
@@ -304,12 +433,67 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
     return;
 }
 
+/* Peer takes TLV_T_MLACP_ARP_BULK_INFO: sort by address, fill whole messages */
+static void mlacp_sync_send_syncArpBulkInfo(struct CSM* csm)
+{
+    struct Msg* msg = NULL;
+    struct ARPMsg** arp_msgs;
+    int msg_len = 0;
+    int num;
+    int pos;
+    int count;
+    int i;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).arp_msg_list)))
+    {
+        num = 0;
+        while (num < MAX_BULK_ENTRY_NUM && !TAILQ_EMPTY(&(MLACP(csm).arp_msg_list)))
+        {
+            msg = TAILQ_FIRST(&(MLACP(csm).arp_msg_list));
+            TAILQ_REMOVE(&(MLACP(csm).arp_msg_list), msg, tail);
+            g_bulk_sort[num].key = ntohl(((struct ARPMsg*)msg->buf)->ipv4_addr);
+            g_bulk_sort[num].seq = num;
+            g_bulk_sort[num].data = msg;
+            num++;
+        }
+        mlacp_bulk_sort(num);
+
+        /* The messages are freed once sent, keep them until then */
+        arp_msgs = g_bulk_arp;
+        for (i = 0; i < num; i++)
+            arp_msgs[i] = (struct ARPMsg*)((struct Msg*)g_bulk_sorted[i])->buf;
+
+        for (pos = 0; pos < num; pos += count)
+        {
+            msg_len = mlacp_prepare_for_arp_bulk_info(csm, g_csm_buf, CSM_BUFFER_SIZE,
+                                                      &arp_msgs[pos], num - pos, &count);
+            if (msg_len <= 0)
+            {
+                ICCPD_LOG_ERR(__FUNCTION__, "Failed to prepare bulk ARP message, %d entries dropped", num - pos);
+                break;
+            }
+            iccp_csm_send(csm, g_csm_buf, msg_len);
+        }
+
+        for (i = 0; i < num; i++)
+            iccp_csm_free_msg((struct Msg*)g_bulk_sorted[i]);
+    }
+
+    return;
+}
+
 static void mlacp_sync_send_syncArpInfo(struct CSM* csm)
 {
     int msg_len = 0;
     struct Msg* msg = NULL;
     int count = 0;
 
+    if ((MLACP(csm).peer_capability & MLACP_PEER_CAP_ARP_BULK) && mlacp_bulk_sort_alloc() == 0)
+    {
+        mlacp_sync_send_syncArpBulkInfo(csm);
+        return;
+    }
+
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
 
     while (!TAILQ_EMPTY(&(MLACP(csm).arp_msg_list)))
@@ -319,8 +503,7 @@ static void mlacp_sync_send_syncArpInfo(struct CSM* csm)
 
         msg_len = mlacp_prepare_for_arp_info(csm, g_csm_buf, CSM_BUFFER_SIZE, (struct ARPMsg*)msg->buf, count, NEIGH_SYNC_CLIENT_IP);
         count++;
-        free(msg->buf);
-        free(msg);
+        iccp_csm_free_msg(msg);
         if (count >= MAX_NEIGH_ENTRY_NUM)
         {
             iccp_csm_send(csm, g_csm_buf, msg_len);
@@ -351,8 +534,7 @@ static void mlacp_sync_send_syncNdiscInfo(struct CSM *csm)
 
         msg_len = mlacp_prepare_for_ndisc_info(csm, g_csm_buf, CSM_BUFFER_SIZE, (struct NDISCMsg *)msg->buf, count, NEIGH_SYNC_CLIENT_IP);
         count++;
-        free(msg->buf);
-        free(msg);
+        iccp_csm_free_msg(msg);
         if (count >= MAX_NEIGH_ENTRY_NUM)
         {
             iccp_csm_send(csm, g_csm_buf, msg_len);
@@ -616,6 +798,57 @@ static void mlacp_sync_recv_macInfo(struct CSM* csm, struct Msg* msg)
     return;
 }
 
+static void mlacp_sync_recv_capability(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPCapabilityTLV* tlv = NULL;
+
+    tlv = (struct mLACPCapabilityTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    MLACP(csm).peer_capability = ntohl(tlv->flags) & MLACP_PEER_CAP_ALL;
+    ICCPD_LOG_NOTICE("ICCP_FSM", "Peer capability 0x%x", MLACP(csm).peer_capability);
+    MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+        tlv->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
+
+    return;
+}
+
+static void mlacp_sync_recv_macBulkInfo(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPBulkInfoTLV* bulk_info = NULL;
+
+    bulk_info = (struct mLACPBulkInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    if (mlacp_fsm_update_mac_bulk_info_from_peer(csm, bulk_info) < 0)
+    {
+        MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+            bulk_info->icc_parameter.type, ICCP_DBG_CNTR_STS_ERR);
+    }
+    else
+    {
+        MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+            bulk_info->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
+    }
+
+    return;
+}
+
+static void mlacp_sync_recv_arpBulkInfo(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPBulkInfoTLV* bulk_info = NULL;
+
+    bulk_info = (struct mLACPBulkInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    if (mlacp_fsm_update_arp_bulk_info(csm, bulk_info) < 0)
+    {
+        MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+            bulk_info->icc_parameter.type, ICCP_DBG_CNTR_STS_ERR);
+    }
+    else
+    {
+        MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+            bulk_info->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
+    }
+
+    return;
+}
+
 static void mlacp_sync_recv_arpInfo(struct CSM* csm, struct Msg* msg)
 {
     struct mLACPARPInfoTLV* arp_info = NULL;
@@ -770,6 +1003,7 @@ void mlacp_init(struct CSM* csm, int all)
     MLACP(csm).sync_req_num = -1;
     MLACP(csm).need_to_sync = 0;
     MLACP(csm).error_msg = NULL;
+    MLACP(csm).peer_capability = 0;
 
     MLACP(csm).current_state = MLACP_STATE_INIT;
     memset(MLACP(csm).remote_system.system_id, 0, ETHER_ADDR_LEN);
@@ -785,8 +1019,8 @@ void mlacp_init(struct CSM* csm, int all)
     if (all != 0)
     {
         /* if no clean all, keep the arp info & local interface info for next connection*/
-        MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
-        MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
+        MLACP_NEIGH_QUEUE_REINIT(MLACP(csm).arp_list, MLACP(csm).arp_hash);
+        MLACP_NEIGH_QUEUE_REINIT(MLACP(csm).ndisc_list, MLACP(csm).ndisc_hash);
         RB_INIT(mac_rb_tree, &MLACP(csm).mac_rb );
         LIF_QUEUE_REINIT(MLACP(csm).lif_list);
 
@@ -812,8 +1046,8 @@ void mlacp_finalize(struct CSM* csm)
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_msg_list);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_msg_list);
     mlacp_mac_msg_queue_reinit(csm);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
+    MLACP_NEIGH_QUEUE_REINIT(MLACP(csm).arp_list, MLACP(csm).arp_hash);
+    MLACP_NEIGH_QUEUE_REINIT(MLACP(csm).ndisc_list, MLACP(csm).ndisc_hash);
 
     RB_INIT(mac_rb_tree, &MLACP(csm).mac_rb );
 
@@ -826,6 +1060,26 @@ void mlacp_finalize(struct CSM* csm)
     return;
 }
 
+/* Time from stage 1 until the exchange state, the initial sync with the peer */
+static void mlacp_sync_time_update(struct CSM* csm)
+{
+    struct System* sys = NULL;
+    uint32_t msec;
+
+    if ((sys = system_get_instance()) == NULL || MLACP(csm).sync_start_msec == 0)
+        return;
+
+    msec = (uint32_t)(iccp_timer_now_msec() - MLACP(csm).sync_start_msec);
+    MLACP(csm).sync_start_msec = 0;
+    sys->dbg_counters.peer_sync_counter++;
+    sys->dbg_counters.peer_sync_last_msec = msec;
+    if (msec > sys->dbg_counters.peer_sync_max_msec)
+        sys->dbg_counters.peer_sync_max_msec = msec;
+    ICCPD_LOG_NOTICE("ICCP_FSM", "Peer sync done in %u ms", msec);
+
+    return;
+}
+
 /*****************************************
 * MLACP FSM Transit
 *
@@ -899,8 +1153,7 @@ void mlacp_fsm_transit(struct CSM* csm)
                 if (icc_hdr->ldp_hdr.msg_type == MSG_T_NOTIFICATION && icc_param->type == TLV_T_NAK)
                 {
                     mlacp_sync_recv_nak_handler(csm, msg);
-                    free(msg->buf);
-                    free(msg);
+                    iccp_csm_free_msg(msg);
                     continue;
                 }
             }
@@ -913,7 +1166,11 @@ void mlacp_fsm_transit(struct CSM* csm)
         if (prev_state != MLACP(csm).current_state)
         {
             if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
+            {
+                mlacp_sync_time_update(csm);
                 mlacp_peer_conn_handler(csm);
+                iccp_warm_state_peer_up(csm);
+            }
             prev_state = MLACP(csm).current_state;
         }
 
@@ -922,6 +1179,7 @@ void mlacp_fsm_transit(struct CSM* csm)
         {
             MLACP(csm).wait_for_sync_data = 0;
             MLACP(csm).current_state = MLACP_STATE_STAGE1;
+            MLACP(csm).sync_start_msec = iccp_timer_now_msec();
             mlacp_resync_arp(csm);
             mlacp_resync_ndisc(csm);
         }
@@ -946,8 +1204,7 @@ void mlacp_fsm_transit(struct CSM* csm)
         /*ICCPD_LOG_DEBUG("mlacp_fsm", "  Next State = %s", mlacp_state(csm));*/
         if (msg)
         {
-            free(msg->buf);
-            free(msg);
+            iccp_csm_free_msg(msg);
         }
     }
 }
@@ -985,7 +1242,7 @@ void mlacp_enqueue_msg(struct CSM* csm, struct Msg* msg)
     if (csm == NULL )
     {
         if (msg != NULL )
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
 
@@ -1074,7 +1331,7 @@ void mlacp_local_lif_clear_pending_mac(struct CSM* csm, struct LocalInterface *l
                 mac_msg->op_type = MAC_SYNC_DEL;
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    iccp_csm_free_mac_msg(mac_msg);
                 }
             }
             else
@@ -1287,6 +1544,18 @@ static void mlacp_sync_receiver_handler(struct CSM* csm, struct Msg* msg)
             mlacp_fsm_recv_if_up_ack(csm, msg);
             break;
 
+        case TLV_T_MLACP_CAPABILITY:
+            mlacp_sync_recv_capability(csm, msg);
+            break;
+
+        case TLV_T_MLACP_MAC_BULK_INFO:
+            mlacp_sync_recv_macBulkInfo(csm, msg);
+            break;
+
+        case TLV_T_MLACP_ARP_BULK_INFO:
+            mlacp_sync_recv_arpBulkInfo(csm, msg);
+            break;
+
         default:
             ICCPD_LOG_ERR("ICCP_FSM", "Receive unsupported msg 0x%x from peer",
                 icc_param->type);
@@ -1661,6 +1930,15 @@ ICCP_DBG_CNTR_MSG_e mlacp_fsm_iccp_to_dbg_msg_type(uint32_t tlv_type)
         case TLV_T_MLACP_IF_UP_ACK:
             return ICCP_DBG_CNTR_MSG_IF_UP_ACK;
 
+        case TLV_T_MLACP_CAPABILITY:
+            return ICCP_DBG_CNTR_MSG_CAPABILITY;
+
+        case TLV_T_MLACP_MAC_BULK_INFO:
+            return ICCP_DBG_CNTR_MSG_MAC_BULK_INFO;
+
+        case TLV_T_MLACP_ARP_BULK_INFO:
+            return ICCP_DBG_CNTR_MSG_ARP_BULK_INFO;
+
         default:
             ICCPD_LOG_DEBUG(__FUNCTION__, "No debug counter for TLV type %u",
                 tlv_type);
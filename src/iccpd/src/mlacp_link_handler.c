@@ -68,14 +68,16 @@ char g_ipv6_str[INET6_ADDRSTRLEN];
 char g_iccp_mlagsyncd_recv_buf[ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE] = { 0 };
 char g_iccp_mlagsyncd_send_buf[ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE] = { 0 };
 
+/* FDB entries pending in one MCLAG_MSG_TYPE_SET_FDB_BULK message */
+static char g_iccp_mlagsyncd_fdb_bulk_buf[ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE] = { 0 };
+static uint32_t g_iccp_mlagsyncd_fdb_bulk_cnt = 0;
+/* bytes of an incomplete message at the start of g_iccp_mlagsyncd_recv_buf */
+static int g_iccp_mlagsyncd_recv_len = 0;
+
 
 extern void mlacp_sync_mac(struct CSM* csm);
 
-#define SYNCD_SEND_RETRY_INTERVAL_USEC    50000 //50 mseconds
-#define SYNCD_SEND_RETRY_MAX              5
 
-#define SYNCD_RECV_RETRY_INTERVAL_USEC    50000 //50 mseconds
-#define SYNCD_RECV_RETRY_MAX              5
 
 /*****************************************
 * Tool : show ip string
@@ -400,10 +402,7 @@ static int peer_po_is_alive(struct CSM *csm, int po_ifindex)
 ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t msg_len)
 {
     struct System *sys;
-    ssize_t write = 0;
-    int num_retry = 0;
-    size_t pos = 0;
-    int send_len = 0;
+    ssize_t rc = 0;
 
     sys = system_get_instance();
     if (sys == NULL)
@@ -412,55 +411,41 @@ ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t msg_
         return MCLAG_ERROR;
     }
 
-    if (sys->sync_fd)
+    /* keep the order of pending FDB entries and other messages */
+    if (msg_type != MCLAG_MSG_TYPE_SET_FDB_BULK)
+        iccp_flush_fdb_to_syncd();
+
+    if (sys->sync_fd > 0)
     {
-        while (msg_len > 0)
+        /* what mclagsyncd does not take now is sent on EPOLLOUT */
+        rc = scheduler_sock_send(sys->sync_fd, &sys->sync_tx_queue, send_buff, msg_len);
+        if (rc < 0)
         {
-            send_len = send(sys->sync_fd, &send_buff[pos], msg_len, MSG_DONTWAIT);
-
-            if (send_len == -1)
-            {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    ++num_retry;
-                    if (num_retry > SYNCD_SEND_RETRY_MAX)
-                    {
-                        ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() retry failed,msg_type: %d msg_len/send_len %d/%d",
-                                msg_type, msg_len, send_len);
-                        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                                            sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                        return MCLAG_ERROR;
-                    }
-                    else
-                    {
-                        usleep(SYNCD_SEND_RETRY_INTERVAL_USEC);
-                        send_len = 0;
-                    }
-                }
-                else
-                {
-                    ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed, msg_type: %d errno %d",
-                            msg_type, errno);
-                    SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                    return MCLAG_ERROR;
-                }
-            }
-            else if (send_len == 0)
-            {
-                ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed socket closed msg_type: %d errno %d",
-                        msg_type, errno);
-                SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                                    sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                return MCLAG_ERROR;
-            }
-            msg_len -= send_len;
-            pos += send_len;
+            ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd failed, msg_type: %d msg_len %d errno %d",
+                    msg_type, msg_len, errno);
+            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
+            return MCLAG_ERROR;
         }
         SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_OK);
     }
 
-    return pos;
+    return rc;
+}
+
+/* Send the messages queued for mclagsyncd when the socket can take them */
+int iccp_mclagsyncd_write_handler(struct System *sys)
+{
+    if (sys->sync_fd <= 0)
+        return MCLAG_ERROR;
+
+    if (scheduler_sock_flush(sys->sync_fd, &sys->sync_tx_queue) < 0)
+    {
+        ICCPD_LOG_WARN("ICCP_FSM", "Send to mclagsyncd failed, errno %d, reconnect", errno);
+        syncd_info_close();
+        return MCLAG_ERROR;
+    }
 
+    return 0;
 }
 
 #if 0
@@ -540,21 +525,11 @@ void set_peerlink_mlag_port_learn(struct LocalInterface *lif, int enable)
                     sub_msg->op_type == MCLAG_SUB_OPTION_TYPE_MAC_LEARN_DISABLE ? "DISABLE":"ENABLE", lif->name);
 
     /*send msg*/
-    if (sys->sync_fd)
+    rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
+    if ((rc <= 0) || (rc != msg_hdr->len))
     {
-        rc = write(sys->sync_fd,msg_buf, msg_hdr->len);
-        if ((rc <= 0) || (rc != msg_hdr->len))
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
-            ICCPD_LOG_ERR(__FUNCTION__, "Failed to write for %s, rc %d",
-                lif->name, rc);
-        }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to write for %s, rc %d",
+            lif->name, rc);
     }
     return;
 }
@@ -842,8 +817,7 @@ int mlacp_link_del_iccp_info(
     memcpy(sub_msg->data, &mlag_id, sub_msg->op_len);
     msg_hdr->len += (sizeof(mclag_sub_option_hdr_t) + sub_msg->op_len);
 
-    if (sys->sync_fd)
-        rc = send(sys->sync_fd,msg_buf, msg_hdr->len, MSG_DONTWAIT);
+    rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
 
     if ((rc <= 0) || (rc != msg_hdr->len))
     {
@@ -853,7 +827,6 @@ int mlacp_link_del_iccp_info(
     }
     else
     {
-        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
         ICCPD_LOG_DEBUG("ICCP_FSM", "Delete mlag %d", mlag_id);
         return 0;
     }
@@ -1189,20 +1162,10 @@ void update_peerlink_isolate_from_all_csm_lif(
     }
 
     /*send msg*/
-    if (sys->sync_fd)
+    rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
+    if ((rc <= 0) || (rc != msg_hdr->len))
     {
-        rc = write(sys->sync_fd,msg_buf, msg_hdr->len);
-        if ((rc <= 0) || (rc != msg_hdr->len))
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
-            ICCPD_LOG_ERR(__FUNCTION__, "Failed to write, rc %d", rc);
-        }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to write, rc %d", rc);
     }
 
     return;
@@ -1381,31 +1344,33 @@ static void update_l2_po_state(struct CSM *csm,
                                int po_state)
 {
     ROUTE_MANIPULATE_TYPE_E route_type = ROUTE_NONE;
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    uint16_t vid;
     struct LocalInterface *set_l3_vlan_if = NULL;
 
     if (!csm || !lif)
         return;
 
     /*Is there any L3 vlan over L2 po?*/
-    RB_FOREACH (vlan, vlan_rb_tree, &(lif->vlan_tree))
+    VLAN_BITMAP_FOREACH(vid, &lif->vlan_bitmap)
     {
         route_type = ROUTE_NONE;
 
-        if (!vlan->vlan_itf)
+        vlan_itf = local_if_vlan_itf(vid);
+        if (!vlan_itf)
             continue;
 
         /* If the po is under a vlan, update vlan state first*/
-        update_vlan_if_info(csm, lif, vlan->vlan_itf, po_state);
+        update_vlan_if_info(csm, lif, vlan_itf, po_state);
 
-        if (!local_if_is_l3_mode(vlan->vlan_itf))
+        if (!local_if_is_l3_mode(vlan_itf))
             continue;
 
         /*NOTE
          * assume only one mlag per vlan
          * need to add rules for per mlag per vlan later (arp list?)
          */
-        set_l3_vlan_if = vlan->vlan_itf;
+        set_l3_vlan_if = vlan_itf;
         if (po_state != lif->po_active
             || MLACP(csm).current_state != set_l3_vlan_if->mlacp_state)
         {
@@ -1472,9 +1437,9 @@ static void update_l3_po_state(struct CSM *csm,
     return;
 }
 
-int is_local_vlan_on(struct VLAN_ID* vlan_id_list)
+int is_local_vlan_on(uint16_t vid)
 {
-    if (!vlan_id_list->vlan_itf)
+    if (!local_if_vlan_itf(vid))
         return 0;
 
     return 1;
@@ -1557,7 +1522,8 @@ void update_stp_peer_link(struct CSM *csm,
                           int po_state, int new_create)
 {
     struct LocalInterface *lif = NULL;
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    uint16_t vid;
 
     if (!csm || !pif)
         return;
@@ -1592,11 +1558,12 @@ void update_stp_peer_link(struct CSM *csm,
         }
         else
         {
-            RB_FOREACH(vlan, vlan_rb_tree, &(lif->vlan_tree))
+            VLAN_BITMAP_FOREACH(vid, &lif->vlan_bitmap)
             {
-                if (!is_local_vlan_on(vlan))
+                if (!is_local_vlan_on(vid))
                     continue;
-                if (!local_if_is_l3_mode(vlan->vlan_itf))
+                vlan_itf = local_if_vlan_itf(vid);
+                if (!local_if_is_l3_mode(vlan_itf))
                     continue;
 
                 /*NOTE
@@ -1604,15 +1571,15 @@ void update_stp_peer_link(struct CSM *csm,
                  * need to add rules for per mlag per bridge later (arp list?)
                  */
                 if (po_state == 1 && lif->po_active == 0)
-                    set_l3_itf_state(csm, vlan->vlan_itf, ROUTE_ADD);
+                    set_l3_itf_state(csm, vlan_itf, ROUTE_ADD);
                 else if (po_state == 0 && lif->po_active == 0)
-                    set_l3_itf_state(csm, vlan->vlan_itf, ROUTE_DEL);
+                    set_l3_itf_state(csm, vlan_itf, ROUTE_DEL);
 
                 /*If pif change to active, and local is also active, syn arp to peer*/
                 if (po_state == 1 && lif->po_active == 1)
                 {
-                    syn_arp_info_to_peer(csm, vlan->vlan_itf);
-                    syn_ndisc_info_to_peer(csm, vlan->vlan_itf);
+                    syn_arp_info_to_peer(csm, vlan_itf);
+                    syn_ndisc_info_to_peer(csm, vlan_itf);
                 }
             }
         }
@@ -1622,6 +1589,51 @@ void update_stp_peer_link(struct CSM *csm,
     return;
 }
 
+/*
+ * Send the FDB entries pending in the bulk message to mclagsyncd.
+ * Called when the message is full, before any other message to
+ * mclagsyncd and at the end of each scheduler loop.
+ */
+void iccp_flush_fdb_to_syncd(void)
+{
+    struct IccpSyncdHDr * msg_hdr;
+    char *msg_buf = g_iccp_mlagsyncd_fdb_bulk_buf;
+    struct System *sys;
+    ssize_t rc;
+
+    if (g_iccp_mlagsyncd_fdb_bulk_cnt == 0)
+        return;
+
+    sys = system_get_instance();
+    if (sys == NULL)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Invalid system instance");
+        return;
+    }
+
+    msg_hdr = (struct IccpSyncdHDr *)msg_buf;
+    msg_hdr->ver = ICCPD_TO_MCLAGSYNCD_HDR_VERSION;
+    msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB_BULK;
+    msg_hdr->len = sizeof(struct IccpSyncdHDr) + g_iccp_mlagsyncd_fdb_bulk_cnt * sizeof(struct mclag_fdb_info);
+
+    ICCPD_LOG_DEBUG("ICCP_FDB", "Send fdb bulk to syncd: %u entries", g_iccp_mlagsyncd_fdb_bulk_cnt);
+
+    rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
+    if (rc <= 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Send to Mclagsyncd failed rc: %d",rc);
+    }
+    else
+    {
+        sys->dbg_counters.fdb_bulk_entry_counter += g_iccp_mlagsyncd_fdb_bulk_cnt;
+        if (g_iccp_mlagsyncd_fdb_bulk_cnt > sys->dbg_counters.fdb_bulk_entry_max)
+            sys->dbg_counters.fdb_bulk_entry_max = g_iccp_mlagsyncd_fdb_bulk_cnt;
+    }
+    g_iccp_mlagsyncd_fdb_bulk_cnt = 0;
+
+    return;
+}
+
 void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uint8_t oper)
 {
     struct IccpSyncdHDr * msg_hdr;
@@ -1644,6 +1656,37 @@ void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uin
         return;
     }
 
+    ICCPD_TRACE_FDB(ICCP_FDB_TRACE_CHIP, oper, mac_type, mac_msg->vid, mac_msg->mac_addr, mac_msg->ifname);
+
+    /* mclagsyncd takes many entries per message, add to the pending bulk message */
+    if ((sys->syncd_capability & MCLAG_SYNCD_CAP_FDB_BULK) && sys->sync_fd > 0)
+    {
+        if (sizeof(struct IccpSyncdHDr) + (g_iccp_mlagsyncd_fdb_bulk_cnt + 1) * sizeof(struct mclag_fdb_info)
+                > ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE)
+            iccp_flush_fdb_to_syncd();
+
+        mac_info = (struct mclag_fdb_info *)&g_iccp_mlagsyncd_fdb_bulk_buf[sizeof(struct IccpSyncdHDr)
+            + g_iccp_mlagsyncd_fdb_bulk_cnt * sizeof(struct mclag_fdb_info)];
+        memset(mac_info, 0, sizeof(struct mclag_fdb_info));
+        mac_info->vid = mac_msg->vid;
+        memcpy(mac_info->port_name, mac_msg->ifname, MAX_L_PORT_NAME);
+        memcpy(mac_info->mac, mac_msg->mac_addr, ETHER_ADDR_LEN);
+        mac_info->type = mac_type;
+        mac_info->op_type = oper;
+        g_iccp_mlagsyncd_fdb_bulk_cnt++;
+
+        ICCPD_LOG_DEBUG("ICCP_FDB", "Send fdb to syncd: add mac msg to bulk vid : %d ; ifname %s ; mac %s fdb type %d ; op type %s",
+            mac_info->vid, mac_info->port_name, mac_addr_to_str(mac_info->mac), mac_info->type,
+            oper == MAC_SYNC_ADD ? "add" : "del");
+
+        if (oper == MAC_SYNC_DEL)
+            mac_msg->add_to_syncd = 0;
+        else
+            mac_msg->add_to_syncd = 1;
+
+        return;
+    }
+
     memset(msg_buf, 0, ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE);
 
     msg_hdr = (struct IccpSyncdHDr *)msg_buf;
@@ -1842,7 +1885,7 @@ static void update_l2_mac_state(struct CSM *csm,
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    iccp_csm_free_mac_msg(mac_msg);
                 }
             }
             else
@@ -1931,7 +1974,7 @@ static void update_l2_mac_state(struct CSM *csm,
                         mac_msg->op_type = MAC_SYNC_DEL;
                         if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                         {
-                            free(mac_msg);
+                            iccp_csm_free_mac_msg(mac_msg);
                         }
                     }
                     else
@@ -2341,7 +2384,7 @@ void mlacp_peer_disconn_fdb_handler(struct CSM* csm)
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    iccp_csm_free_mac_msg(mac_msg);
                 }
             }
         }
@@ -2528,7 +2571,7 @@ void mlacp_peerlink_down_handler(struct CSM* csm)
             // else free is taken care after sending the update to peer
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
-                free(mac_msg);
+                iccp_csm_free_mac_msg(mac_msg);
             }
         }
     }
@@ -2582,6 +2625,25 @@ void mlacp_mlag_link_del_handler(struct CSM *csm, struct LocalInterface *lif)
     return;
 }
 
+/* Use a connected socket as the mclagsyncd session */
+int iccp_syncd_sock_attach(int fd)
+{
+    struct System* sys = NULL;
+    struct epoll_event event;
+
+    if ((sys = system_get_instance()) == NULL)
+        return MCLAG_ERROR;
+
+    sys->sync_fd = fd;
+    /* single FDB entry messages until mclagsyncd announces otherwise */
+    sys->syncd_capability = 0;
+
+    event.data.fd = fd;
+    event.events = EPOLLIN;
+
+    return epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
 int iccp_connect_syncd()
 {
     struct System* sys = NULL;
@@ -2589,7 +2651,6 @@ int iccp_connect_syncd()
     int fd = 0;
     struct sockaddr_in serv;
     static int count = 0;
-    struct epoll_event event;
 
     if ((sys = system_get_instance()) == NULL)
     {
@@ -2631,11 +2692,7 @@ int iccp_connect_syncd()
     }
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "Success to link syncd");
-    sys->sync_fd = fd;
-
-    event.data.fd = fd;
-    event.events = EPOLLIN;
-    ret = epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    iccp_syncd_sock_attach(fd);
 
     count = 0;
     return 0;
@@ -2664,6 +2721,11 @@ void syncd_info_close()
         close(sys->sync_fd);
         sys->sync_fd = -1;
     }
+    /* pending FDB entries and queued messages are lost with the connection */
+    g_iccp_mlagsyncd_fdb_bulk_cnt = 0;
+    g_iccp_mlagsyncd_recv_len = 0;
+    scheduler_sock_tx_queue_free(&sys->sync_tx_queue);
+    sys->syncd_capability = 0;
 
     return;
 }
@@ -2702,6 +2764,8 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
         return;
     }
 
+    ICCPD_TRACE_FDB(ICCP_FDB_TRACE_SYNCD, op_type, fdb_type, vid, mac_addr, ifname);
+
     /* create MAC msg*/
     memset(buf, 0, MAX_BUFSIZE);
     msg_len = sizeof(struct MACMsg);
@@ -2999,7 +3063,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                     // else free is taken care after sending the update to peer
                     if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_info, tail))
                     {
-                        free(mac_info);
+                        iccp_csm_free_mac_msg(mac_info);
                     }
                 }
                 else if (csm->peer_link_if && csm->peer_link_if->state != PORT_STATE_DOWN)
@@ -3036,7 +3100,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_info, tail))
                 {
-                    free(mac_info);
+                    iccp_csm_free_mac_msg(mac_info);
                 }
             }
             else
@@ -3349,6 +3413,28 @@ int iccp_mclagsyncd_vlan_mbr_update_handler(struct System *sys, char *msg_buf)
     return 0;
 }
 
+int iccp_mclagsyncd_capability_handler(struct System *sys, char *msg_buf)
+{
+    struct IccpSyncdHDr *msg_hdr;
+    struct mclag_syncd_capability_info *cap_info;
+
+    msg_hdr = (struct IccpSyncdHDr *)msg_buf;
+    if (msg_hdr->len < sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_syncd_capability_info))
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "recv capability msg, invalid length %d", msg_hdr->len);
+        return MCLAG_ERROR;
+    }
+
+    cap_info = (struct mclag_syncd_capability_info *)&msg_buf[sizeof(struct IccpSyncdHDr)];
+    ICCPD_LOG_NOTICE(__FUNCTION__, "recv mclagsyncd capability 0x%x", cap_info->flags);
+
+    if (!(cap_info->flags & MCLAG_SYNCD_CAP_FDB_BULK))
+        iccp_flush_fdb_to_syncd();
+    sys->syncd_capability = cap_info->flags;
+
+    return 0;
+}
+
 int iccp_receive_fdb_handler_from_syncd(struct System *sys, char *msg_buf)
 {
     int count = 0;
@@ -3376,18 +3462,15 @@ int iccp_mclagsyncd_msg_handler(struct System *sys)
     char *msg_buf = g_iccp_mlagsyncd_recv_buf;
     struct IccpSyncdHDr * msg_hdr;
     int pos = 0;
-    int recv_len = 0;
-    int num_retry = 0;
     errno = 0;
 
     if (sys == NULL)
         return MCLAG_ERROR;
-    memset(msg_buf, 0, ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE);
 
-    /* read (max_size - msg_size) so that we have space to
-       accomodate anything remaining in the last message */
-    num_bytes_rxed = recv(sys->sync_fd, msg_buf,
-            ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE - MCLAG_MAX_MSG_LEN, MSG_DONTWAIT );
+    /* a message cut at the end of the last read is kept at the start of the buffer */
+    memset(msg_buf + g_iccp_mlagsyncd_recv_len, 0, ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE - g_iccp_mlagsyncd_recv_len);
+    num_bytes_rxed = recv(sys->sync_fd, msg_buf + g_iccp_mlagsyncd_recv_len,
+            ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE - g_iccp_mlagsyncd_recv_len, MSG_DONTWAIT);
 
     if (num_bytes_rxed <= 0)
     {
@@ -3398,179 +3481,38 @@ int iccp_mclagsyncd_msg_handler(struct System *sys)
             SYSTEM_INCR_RX_READ_SOCK_ZERO_COUNTER(system_get_instance());
             return MCLAG_ERROR;
         }
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+            return 0;
 
-        while( num_bytes_rxed < 0 )
-        {
-            recv_len = recv(sys->sync_fd, msg_buf,
-                        ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE - MCLAG_MAX_MSG_LEN, MSG_DONTWAIT );
-
-            if (recv_len == -1)
-            {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    ICCPD_LOG_NOTICE(
-                        "ICCP_FSM", "Recv fom Mclagsyncd Non-blocking recv errno %d, num_retry %d",
-                        errno, num_retry);
-                    ++num_retry;
-                    if (num_retry > SYNCD_RECV_RETRY_MAX)
-                    {
-                        ICCPD_LOG_NOTICE(
-                            "ICCP_FSM", "Recv fom Mclagsyncd retry failed recv_len: %d", recv_len);
-                        SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                        return MCLAG_ERROR;
-                    }
-                    else
-                    {
-                        usleep(SYNCD_RECV_RETRY_INTERVAL_USEC);
-                        recv_len = 0;
-                    }
-                }
-                else
-                {
-                    ICCPD_LOG_NOTICE("ICCP_FSM", "Recv fom Mclagsyncd retry failed recv_len: %d", recv_len);
-                    SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
-                    return MCLAG_ERROR;
-                }
-            }
-            else if (recv_len == 0)
-            {
-                ICCPD_LOG_NOTICE("ICCP_FSM", "Recv fom Mclagsyncd error %d connection closed ", recv_len );
-                SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-                return MCLAG_ERROR;
-            }
-
-            num_bytes_rxed += recv_len;
-        }
+        ICCPD_LOG_NOTICE("ICCP_FSM", "Recv fom Mclagsyncd failed errno: %d", errno);
+        SYSTEM_INCR_RX_READ_SOCK_ERR_COUNTER(system_get_instance());
+        return MCLAG_ERROR;
     }
+    num_bytes_rxed += g_iccp_mlagsyncd_recv_len;
+    g_iccp_mlagsyncd_recv_len = 0;
 
-    num_retry = 0;
     while (pos < num_bytes_rxed) //iterate through all msgs
     {
         if ((num_bytes_rxed - pos) < sizeof(struct IccpSyncdHDr))
-        {
-            int recv_len = 0, len = 0;
-            int pending_len = sizeof(struct IccpSyncdHDr) - (num_bytes_rxed - pos);
-
-            ICCPD_LOG_NOTICE(__FUNCTION__, "Recv fom Mclagsync header less than expected, trying to retrieve %d bytes more ", pending_len);
-
-            while (recv_len < pending_len)
-            {
-                int remaining_len = pending_len-recv_len;
-                len = recv(sys->sync_fd, msg_buf+num_bytes_rxed+recv_len, remaining_len, MSG_DONTWAIT);
-                if (len <= 0)
-                {
-                    if (len == 0)
-                    {
-                        ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsync header less than expected data read error; recv_len:%d pending_len:%d ", recv_len, pending_len);
-                        SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-                        return MCLAG_ERROR;
-                    }
-
-                    if (len == -1)
-                    {
-                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        {
-                            ICCPD_LOG_NOTICE(
-                                "ICCP_FSM", "Recv fom Mclagsync header less than expected Non-blocking recv errno %d, num_retry %d",
-                                errno, num_retry);
-                            ++num_retry;
-                            if (num_retry > SYNCD_RECV_RETRY_MAX)
-                            {
-                                ICCPD_LOG_ERR(
-                                    "ICCP_FSM", "Recv fom Mclagsync header less than expected Non-blocking recv() retry failed, len: %d, errno: %d", len, errno);
-                                SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                                return MCLAG_ERROR;
-                            }
-                            else
-                            {
-                                usleep(SYNCD_RECV_RETRY_INTERVAL_USEC);
-                                len = 0;
-                            }
-                        }
-                        else
-                        {
-                            ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd header less than expected error; recv_len:%d errno %d",
-                                           recv_len, errno);
-                            SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
-                            return MCLAG_ERROR;
-                        }
-                    }
-                }
-                ICCPD_LOG_NOTICE("ICCP_FSM", "received %d pending bytes", len);
-                recv_len += len;
-            }
-        }
+            break;
 
         msg_hdr = (struct IccpSyncdHDr *)(&msg_buf[pos]);
         ICCPD_LOG_DEBUG(__FUNCTION__, "rcv msg version %d type %d len %d pos:%d num_bytes_rxed:%d ",
                 msg_hdr->ver , msg_hdr->type, msg_hdr->len, pos, num_bytes_rxed);
 
-        if (!msg_hdr->len)
+        if (msg_hdr->len < sizeof(struct IccpSyncdHDr))
         {
-            ICCPD_LOG_ERR(__FUNCTION__, "msg length zero!!!!! ");
+            ICCPD_LOG_ERR(__FUNCTION__, "msg length %d invalid!!!!! ", msg_hdr->len);
             return MCLAG_ERROR;
         }
+        if ((pos + msg_hdr->len) > num_bytes_rxed)
+            break;
         if (msg_hdr->ver != 1)
         {
             ICCPD_LOG_ERR(__FUNCTION__, "msg version %d wrong!!!!! ", msg_hdr->ver);
             pos += msg_hdr->len;
             continue;
         }
-        if ((pos + msg_hdr->len) > num_bytes_rxed)
-        {
-            int recv_len = 0, len = 0;
-            int pending_len = pos + msg_hdr->len - num_bytes_rxed;
-
-            ICCPD_LOG_NOTICE(__FUNCTION__, "Recv fom Mclagsyncd msg less than expected, trying to retrieve %d bytes more ",
-                pending_len);
-
-            while (recv_len < pending_len)
-            {
-                int remaining_len = pending_len-recv_len;
-                len = recv(sys->sync_fd, msg_buf+num_bytes_rxed+recv_len, remaining_len, MSG_DONTWAIT);
-                if (len <= 0)
-                {
-                    if (len == 0)
-                    {
-                        ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd msg less than expected read error; len:%d ",len);
-                        SYSTEM_INCR_TLV_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-                        return MCLAG_ERROR;
-                    }
-
-                    if (len == -1)
-                    {
-                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        {
-                            ICCPD_LOG_NOTICE(
-                                "ICCP_FSM", "Recv fom Mclagsyncd msg less than expected Non-blocking recv errno %d, num_retry %d",
-                                errno, num_retry);
-                            ++num_retry;
-                            if (num_retry > SYNCD_RECV_RETRY_MAX)
-                            {
-                                ICCPD_LOG_ERR("ICCP_FSM", "Recv fom Mclagsyncd msg less than expected Non-blocking recv() retry failed len %d",len);
-                                SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                                return MCLAG_ERROR;
-                            }
-                            else
-                            {
-                                usleep(SYNCD_RECV_RETRY_INTERVAL_USEC);
-                                len = 0;
-                            }
-                        }
-                        else
-                        {
-                            ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd msg less than expectedread retry error len:%d , errno %d",
-                                           len, errno);
-                            SYSTEM_INCR_TLV_READ_SOCK_ERR_COUNTER(system_get_instance());
-                            return MCLAG_ERROR;
-                        }
-                    }
-
-                }
-                ICCPD_LOG_NOTICE(__FUNCTION__, "received %d pending bytes", len);
-                recv_len += len;
-            }
-        }
 
         if (msg_hdr->type == MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION)
         {
@@ -3592,6 +3534,10 @@ int iccp_mclagsyncd_msg_handler(struct System *sys)
         {
             iccp_mclagsyncd_vlan_mbr_update_handler(sys, &msg_buf[pos]);
         }
+        else if (msg_hdr->type == MCLAG_SYNCD_MSG_TYPE_CAPABILITY)
+        {
+            iccp_mclagsyncd_capability_handler(sys, &msg_buf[pos]);
+        }
         else
         {
             ICCPD_LOG_ERR(__FUNCTION__, "recv unknown msg type %d ", msg_hdr->type);
@@ -3601,6 +3547,13 @@ int iccp_mclagsyncd_msg_handler(struct System *sys)
         pos += msg_hdr->len;
         SYSTEM_SET_SYNCD_RX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
     }
+
+    /* rest of the message comes with a later read */
+    if (pos < num_bytes_rxed)
+    {
+        g_iccp_mlagsyncd_recv_len = num_bytes_rxed - pos;
+        memmove(msg_buf, &msg_buf[pos], g_iccp_mlagsyncd_recv_len);
+    }
     return 0;
 }
 
@@ -3986,6 +3939,66 @@ void mclagd_ctl_handle_dump_mac(int client_fd, int mclag_id)
     return;
 }
 
+/* Reply with one page of a MAC or ARP dump; the scheduler gets back to
+ * its other fds between the pages of a large table.
+ */
+void mclagd_ctl_handle_dump_page(int client_fd, struct mclagdctl_req_hdr *req)
+{
+    char * Pbuf = NULL;
+    char buf[512] = { 0 };
+    struct mclagdctl_dump_cursor cursor;
+    int num = 0;
+    int entry_size = 0;
+    int ret = 0;
+    struct mclagd_reply_hdr *hd = NULL;
+    int len_tmp = 0;
+
+    memcpy(&cursor, req->para1, sizeof(struct mclagdctl_dump_cursor));
+
+    if (req->info_type == INFO_TYPE_DUMP_MAC)
+    {
+        ret = iccp_mac_dump_page(&Pbuf, &num, req->mclag_id, &cursor);
+        entry_size = sizeof(struct mclagd_mac_msg);
+    }
+    else
+    {
+        ret = iccp_arp_dump_page(&Pbuf, &num, req->mclag_id, &cursor);
+        entry_size = sizeof(struct mclagd_arp_msg);
+    }
+
+    if (ret != EXEC_TYPE_SUCCESS)
+    {
+        len_tmp = sizeof(struct mclagd_reply_hdr);
+        memcpy(buf, &len_tmp, sizeof(int));
+        hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+        hd->exec_result = ret;
+        hd->info_type = req->info_type;
+        hd->data_len = 0;
+        mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
+
+        if (Pbuf)
+            free(Pbuf);
+
+        return;
+    }
+
+    hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    hd->exec_result = EXEC_TYPE_SUCCESS;
+    hd->info_type = req->info_type;
+    hd->data_len = sizeof(struct mclagdctl_dump_cursor) + num * entry_size;
+    memcpy(Pbuf + MCLAGD_REPLY_INFO_HDR, &cursor, sizeof(struct mclagdctl_dump_cursor));
+
+    len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
+    memcpy(Pbuf, &len_tmp, sizeof(int));
+
+    mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
+
+    if (Pbuf)
+        free(Pbuf);
+
+    return;
+}
+
 void mclagd_ctl_handle_dump_local_portlist(int client_fd, int mclag_id)
 {
     char * Pbuf = NULL;
@@ -4188,7 +4201,10 @@ int mclagd_ctl_interactive_process(int client_fd)
             break;
 
         case INFO_TYPE_DUMP_ARP:
-            mclagd_ctl_handle_dump_arp(client_fd, req->mclag_id);
+            if (((struct mclagdctl_dump_cursor *)req->para1)->paged)
+                mclagd_ctl_handle_dump_page(client_fd, req);
+            else
+                mclagd_ctl_handle_dump_arp(client_fd, req->mclag_id);
             break;
 
         case INFO_TYPE_DUMP_NDISC:
@@ -4196,7 +4212,10 @@ int mclagd_ctl_interactive_process(int client_fd)
             break;
 
         case INFO_TYPE_DUMP_MAC:
-            mclagd_ctl_handle_dump_mac(client_fd, req->mclag_id);
+            if (((struct mclagdctl_dump_cursor *)req->para1)->paged)
+                mclagd_ctl_handle_dump_page(client_fd, req);
+            else
+                mclagd_ctl_handle_dump_mac(client_fd, req->mclag_id);
             break;
 
         case INFO_TYPE_DUMP_LOCAL_PORTLIST:
@@ -467,7 +467,7 @@ int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf,
     size_t msg_len;
     size_t tlv_len;
     size_t name_len = MAX_L_PORT_NAME;
-    struct VLAN_ID* vlan_id = NULL;
+    int vid = 0;
     int num_of_vlan_id = 0;
 
     if (csm == NULL )
@@ -482,9 +482,7 @@ int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf,
         return MCLAG_ERROR;
 
     /* Calculate VLAN ID Length */
-    RB_FOREACH(vlan_id, vlan_rb_tree, &(port_channel->vlan_tree))
-        if (vlan_id != NULL)
-            num_of_vlan_id++;
+    num_of_vlan_id = vlan_bitmap_count(&port_channel->vlan_bitmap);
 
     tlv_len = sizeof(struct mLACPPortChannelInfoTLV) + sizeof(struct mLACPVLANData) * num_of_vlan_id;
 
@@ -517,15 +515,12 @@ int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf,
     tlv->num_of_vlan_id = htons(num_of_vlan_id);
 
     num_of_vlan_id = 0;
-    RB_FOREACH(vlan_id, vlan_rb_tree, &(port_channel->vlan_tree))
+    VLAN_BITMAP_FOREACH(vid, &port_channel->vlan_bitmap)
     {
-        if (vlan_id != NULL )
-        {
-            tlv->vlanData[num_of_vlan_id].vlan_id = htons(vlan_id->vid);
+        tlv->vlanData[num_of_vlan_id].vlan_id = htons(vid);
 
-            num_of_vlan_id++;
-            ICCPD_LOG_DEBUG(__FUNCTION__, "PortChannel%d: ipv4 addr = %s vlan id %d num %d ", port_channel->po_id, show_ip_str( tlv->ipv4_addr), vlan_id->vid, num_of_vlan_id );
-        }
+        num_of_vlan_id++;
+        ICCPD_LOG_DEBUG(__FUNCTION__, "PortChannel%d: ipv4 addr = %s vlan id %d num %d ", port_channel->po_id, show_ip_str( tlv->ipv4_addr), vid, num_of_vlan_id );
     }
 
     ICCPD_LOG_DEBUG(__FUNCTION__, "PortChannel%d: ipv4 addr = %s  l3 mode %d", port_channel->po_id, show_ip_str( tlv->ipv4_addr),  tlv->l3_mode);
@@ -723,6 +718,336 @@ int mlacp_prepare_for_if_up_ack(
     return msg_len;
 }
 
+/*****************************************
+* Prepare capability TLV
+*
+* ***************************************/
+int mlacp_prepare_for_capability(struct CSM* csm, char* buf, size_t max_buf_size)
+{
+    ICCHdr* icc_hdr = (ICCHdr*)buf;
+    struct mLACPCapabilityTLV* tlv = (struct mLACPCapabilityTLV*)&buf[sizeof(ICCHdr)];
+    size_t msg_len = sizeof(ICCHdr) + sizeof(struct mLACPCapabilityTLV);
+
+    if (csm == NULL)
+        return MCLAG_ERROR;
+
+    if (buf == NULL)
+        return MCLAG_ERROR;
+
+    if (msg_len > max_buf_size)
+        return MCLAG_ERROR;
+
+    memset(buf, 0, msg_len);
+
+    /* ICC header */
+    mlacp_fill_icc_header(csm, icc_hdr, msg_len);
+
+    tlv->icc_parameter.u_bit = 0;
+    tlv->icc_parameter.f_bit = 0;
+    tlv->icc_parameter.type = htons(TLV_T_MLACP_CAPABILITY);
+    tlv->icc_parameter.len = htons(sizeof(struct mLACPCapabilityTLV) - sizeof(ICCParameter));
+    tlv->flags = htonl(MLACP_PEER_CAP_ALL);
+
+    return msg_len;
+}
+
+/*****************************************
+* Tool : Bulk TLV encoding
+*
+* ***************************************/
+#define MLACP_BULK_DICT_HASH_SIZE   512
+
+/* Interface names of one bulk message */
+struct mlacp_bulk_dict
+{
+    int num;
+    size_t len;                     /* encoded bytes */
+    const char* name[MLACP_BULK_MAX_IFNAME];
+    uint16_t hash[MLACP_BULK_DICT_HASH_SIZE];   /* index + 1 */
+};
+
+static unsigned int mlacp_bulk_dict_hash(const char* name)
+{
+    unsigned int hash = 2166136261u;
+
+    while (*name)
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+
+    return hash & (MLACP_BULK_DICT_HASH_SIZE - 1);
+}
+
+/* Index of the name, -1 if not known yet */
+static int mlacp_bulk_dict_find(struct mlacp_bulk_dict* dict, const char* name, unsigned int* slot)
+{
+    unsigned int bucket = mlacp_bulk_dict_hash(name);
+
+    while (dict->hash[bucket])
+    {
+        if (strcmp(dict->name[dict->hash[bucket] - 1], name) == 0)
+            return dict->hash[bucket] - 1;
+        bucket = (bucket + 1) & (MLACP_BULK_DICT_HASH_SIZE - 1);
+    }
+    *slot = bucket;
+
+    return -1;
+}
+
+static int mlacp_bulk_dict_add(struct mlacp_bulk_dict* dict, const char* name, unsigned int slot)
+{
+    dict->name[dict->num] = name;
+    dict->hash[slot] = ++dict->num;
+    dict->len += 1 + strnlen(name, MAX_L_PORT_NAME - 1);
+
+    return dict->num - 1;
+}
+
+static size_t mlacp_bulk_varint_len(uint64_t value)
+{
+    size_t len = 1;
+
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        len++;
+    }
+
+    return len;
+}
+
+static uint8_t* mlacp_bulk_varint_put(uint8_t* p, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+
+    return p;
+}
+
+static uint64_t mlacp_bulk_mac_value(uint8_t* mac_addr)
+{
+    uint64_t value = 0;
+    int i;
+
+    for (i = 0; i < ETHER_ADDR_LEN; i++)
+        value = (value << 8) | mac_addr[i];
+
+    return value;
+}
+
+/* Interface names go in front of the entries */
+static uint8_t* mlacp_bulk_dict_put(uint8_t* p, struct mlacp_bulk_dict* dict)
+{
+    size_t len;
+    int i;
+
+    for (i = 0; i < dict->num; i++)
+    {
+        len = strnlen(dict->name[i], MAX_L_PORT_NAME - 1);
+        *p++ = len;
+        memcpy(p, dict->name[i], len);
+        p += len;
+    }
+
+    return p;
+}
+
+static void mlacp_bulk_fill_header(struct CSM* csm, char* buf, size_t msg_len, uint16_t type,
+                                   int num_of_entry, struct mlacp_bulk_dict* dict)
+{
+    struct mLACPBulkInfoTLV* tlv = (struct mLACPBulkInfoTLV*)&buf[sizeof(ICCHdr)];
+
+    memset(buf, 0, sizeof(ICCHdr) + sizeof(struct mLACPBulkInfoTLV));
+    mlacp_fill_icc_header(csm, (ICCHdr*)buf, msg_len);
+    tlv->icc_parameter.u_bit = 0;
+    tlv->icc_parameter.f_bit = 0;
+    tlv->icc_parameter.type = htons(type);
+    tlv->icc_parameter.len = htons(msg_len - sizeof(ICCHdr) - sizeof(ICCParameter));
+    tlv->num_of_entry = htons(num_of_entry);
+    tlv->num_of_ifname = dict->num;
+
+    return;
+}
+
+/*****************************************
+* Prepare bulk MAC-Info TLV
+* mac_msgs must be sorted by VLAN and MAC, as many entries as fit
+* in max_buf_size are taken and their number returned in count.
+* ***************************************/
+int mlacp_prepare_for_mac_bulk_info(struct CSM* csm, char* buf, size_t max_buf_size,
+                                    struct MACMsg** mac_msgs, int num, int* count)
+{
+    static struct mlacp_bulk_dict dict;
+    struct MACMsg* mac_msg;
+    size_t msg_len = sizeof(ICCHdr) + sizeof(struct mLACPBulkInfoTLV);
+    size_t entry_len;
+    size_t name_len;
+    uint64_t mac_value;
+    uint64_t prev_mac = 0;
+    uint16_t prev_vid = 0;
+    unsigned int slot;
+    uint8_t* p;
+    int index;
+    int i;
+
+    if (!csm || !buf || !mac_msgs || !count)
+        return MCLAG_ERROR;
+
+    memset(&dict, 0, sizeof(dict));
+
+    /* Size the message and collect the interface names */
+    for (i = 0; i < num && i < UINT16_MAX; i++)
+    {
+        mac_msg = mac_msgs[i];
+        mac_value = mlacp_bulk_mac_value(mac_msg->mac_addr);
+
+        /* Deltas only go up, an out of order entry starts the next message */
+        if (mac_msg->vid < prev_vid || (mac_msg->vid == prev_vid && mac_value < prev_mac))
+            break;
+        if (mac_msg->vid != prev_vid)
+            prev_mac = 0;
+
+        entry_len = 3 + mlacp_bulk_varint_len(mac_msg->vid - prev_vid)
+                    + mlacp_bulk_varint_len(mac_value - prev_mac);
+
+        name_len = 0;
+        index = mlacp_bulk_dict_find(&dict, mac_msg->origin_ifname, &slot);
+        if (index < 0)
+        {
+            if (dict.num == MLACP_BULK_MAX_IFNAME)
+                break;
+            name_len = 1 + strnlen(mac_msg->origin_ifname, MAX_L_PORT_NAME - 1);
+        }
+
+        if (msg_len + dict.len + name_len + entry_len > max_buf_size)
+            break;
+        if (index < 0)
+            mlacp_bulk_dict_add(&dict, mac_msg->origin_ifname, slot);
+
+        msg_len += entry_len;
+        prev_vid = mac_msg->vid;
+        prev_mac = mac_value;
+    }
+
+    *count = i;
+    if (i == 0)
+        return MCLAG_ERROR;
+
+    msg_len += dict.len;
+    mlacp_bulk_fill_header(csm, buf, msg_len, TLV_T_MLACP_MAC_BULK_INFO, *count, &dict);
+
+    p = mlacp_bulk_dict_put((uint8_t*)&buf[sizeof(ICCHdr) + sizeof(struct mLACPBulkInfoTLV)], &dict);
+
+    prev_vid = 0;
+    prev_mac = 0;
+    for (i = 0; i < *count; i++)
+    {
+        mac_msg = mac_msgs[i];
+        mac_value = mlacp_bulk_mac_value(mac_msg->mac_addr);
+        if (mac_msg->vid != prev_vid)
+            prev_mac = 0;
+
+        *p++ = mac_msg->op_type;
+        *p++ = mac_msg->fdb_type;
+        *p++ = mlacp_bulk_dict_find(&dict, mac_msg->origin_ifname, &slot);
+        p = mlacp_bulk_varint_put(p, mac_msg->vid - prev_vid);
+        p = mlacp_bulk_varint_put(p, mac_value - prev_mac);
+
+        prev_vid = mac_msg->vid;
+        prev_mac = mac_value;
+    }
+
+    ICCPD_LOG_DEBUG("ICCP_FDB", "Send bulk MAC message to peer, %d entries, %d interfaces, len %zu",
+        *count, dict.num, msg_len);
+
+    return msg_len;
+}
+
+/*****************************************
+* Prepare bulk ARP-Info TLV
+* arp_msgs must be sorted by address, as many entries as fit in
+* max_buf_size are taken and their number returned in count.
+* ***************************************/
+int mlacp_prepare_for_arp_bulk_info(struct CSM* csm, char* buf, size_t max_buf_size,
+                                    struct ARPMsg** arp_msgs, int num, int* count)
+{
+    static struct mlacp_bulk_dict dict;
+    struct ARPMsg* arp_msg;
+    size_t msg_len = sizeof(ICCHdr) + sizeof(struct mLACPBulkInfoTLV);
+    size_t entry_len;
+    size_t name_len;
+    uint32_t addr;
+    uint32_t prev_addr = 0;
+    unsigned int slot;
+    uint8_t* p;
+    int index;
+    int i;
+
+    if (!csm || !buf || !arp_msgs || !count)
+        return MCLAG_ERROR;
+
+    memset(&dict, 0, sizeof(dict));
+
+    for (i = 0; i < num && i < UINT16_MAX; i++)
+    {
+        arp_msg = arp_msgs[i];
+        addr = ntohl(arp_msg->ipv4_addr);
+        if (addr < prev_addr)
+            break;
+
+        entry_len = 3 + mlacp_bulk_varint_len(addr - prev_addr) + ETHER_ADDR_LEN;
+
+        name_len = 0;
+        index = mlacp_bulk_dict_find(&dict, arp_msg->ifname, &slot);
+        if (index < 0)
+        {
+            if (dict.num == MLACP_BULK_MAX_IFNAME)
+                break;
+            name_len = 1 + strnlen(arp_msg->ifname, MAX_L_PORT_NAME - 1);
+        }
+
+        if (msg_len + dict.len + name_len + entry_len > max_buf_size)
+            break;
+        if (index < 0)
+            mlacp_bulk_dict_add(&dict, arp_msg->ifname, slot);
+
+        msg_len += entry_len;
+        prev_addr = addr;
+    }
+
+    *count = i;
+    if (i == 0)
+        return MCLAG_ERROR;
+
+    msg_len += dict.len;
+    mlacp_bulk_fill_header(csm, buf, msg_len, TLV_T_MLACP_ARP_BULK_INFO, *count, &dict);
+
+    p = mlacp_bulk_dict_put((uint8_t*)&buf[sizeof(ICCHdr) + sizeof(struct mLACPBulkInfoTLV)], &dict);
+
+    prev_addr = 0;
+    for (i = 0; i < *count; i++)
+    {
+        arp_msg = arp_msgs[i];
+        addr = ntohl(arp_msg->ipv4_addr);
+
+        *p++ = arp_msg->op_type;
+        *p++ = arp_msg->flag;
+        *p++ = mlacp_bulk_dict_find(&dict, arp_msg->ifname, &slot);
+        p = mlacp_bulk_varint_put(p, addr - prev_addr);
+        memcpy(p, arp_msg->mac_addr, ETHER_ADDR_LEN);
+        p += ETHER_ADDR_LEN;
+
+        prev_addr = addr;
+    }
+
+    ICCPD_LOG_DEBUG(__FUNCTION__, "Send bulk ARP message to peer, %d entries, %d interfaces, len %zu",
+        *count, dict.num, msg_len);
+
+    return msg_len;
+}
+
 /*****************************************
 * Tool : Prepare ICC Header
 *
@@ -98,6 +98,8 @@ int mlacp_fsm_update_Agg_conf(struct CSM* csm, mLACPAggConfigTLV* portconf)
 
     /* Looking for the peer port instance, is any peer if exist?*/
     pif = peer_if_find_by_name(csm, portconf->agg_name);
+    if (pif)
+        pif->restored = 0;
 
     /* Process purge*/
     if (portconf->flags & 0x02)
@@ -235,6 +237,9 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
         return 0;
     }
 
+    ICCPD_TRACE_FDB(ICCP_FDB_TRACE_PEER, MacData->type, MacData->mac_type, ntohs(MacData->vid),
+                    MacData->mac_addr, MacData->ifname);
+
 
     /*Find the interface in MCLAG interface list*/
     LIST_FOREACH(local_if, &(MLACP(csm).lif_list), mlacp_next)
@@ -254,6 +259,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
     //if (strcmp(mac_msg->mac_str, MacData->mac_str) == 0 && mac_msg->vid == ntohs(MacData->vid))
     if (mac_msg)
     {
+        mac_msg->restored = 0;
         ICCPD_LOG_DEBUG("ICCP_FDB", "Recv MAC update from peer RB_FIND success, existing MAC age flag:%d interface %s, "
             "MAC %s vlan-id %d, fdb_type: %d, op_type %s", mac_msg->age_flag, mac_msg->ifname,
             mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid, mac_msg->fdb_type,
@@ -361,7 +367,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                             // else free is taken care after sending the update to peer
                             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                             {
-                                free(mac_msg);
+                                iccp_csm_free_mac_msg(mac_msg);
                             }
 
                             ICCPD_LOG_ERR(__FUNCTION__, "Ignore Recv MAC ADD "
@@ -467,7 +473,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
             // else free is taken care after sending the update to peer
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
-                free(mac_msg);
+                iccp_csm_free_mac_msg(mac_msg);
             }
         }
         else
@@ -568,6 +574,140 @@ int mlacp_fsm_update_mac_info_from_peer(struct CSM* csm, struct mLACPMACInfoTLV*
     }
 }
 
+/*****************************************
+* Tool : Bulk TLV decoding
+*
+* ***************************************/
+struct mlacp_bulk_reader
+{
+    uint8_t* p;
+    uint8_t* end;
+    int num_of_ifname;
+    uint8_t* ifname[MLACP_BULK_MAX_IFNAME];     /* length byte, then the name */
+};
+
+/* Check the TLV length and read the interface names */
+static int mlacp_bulk_reader_init(struct mlacp_bulk_reader* reader, struct mLACPBulkInfoTLV* tlv)
+{
+    int i;
+
+    reader->p = tlv->data;
+    reader->end = (uint8_t*)tlv + sizeof(ICCParameter) + ntohs(tlv->icc_parameter.len);
+    reader->num_of_ifname = tlv->num_of_ifname;
+    if (reader->end < reader->p)
+        return MCLAG_ERROR;
+
+    for (i = 0; i < reader->num_of_ifname; i++)
+    {
+        if (reader->p >= reader->end || reader->p + 1 + *reader->p > reader->end
+            || *reader->p >= MAX_L_PORT_NAME)
+            return MCLAG_ERROR;
+        reader->ifname[i] = reader->p;
+        reader->p += 1 + *reader->p;
+    }
+
+    return 0;
+}
+
+static int mlacp_bulk_get_ifname(struct mlacp_bulk_reader* reader, char* ifname)
+{
+    uint8_t* name;
+
+    if (reader->p >= reader->end || *reader->p >= reader->num_of_ifname)
+        return MCLAG_ERROR;
+
+    name = reader->ifname[*reader->p++];
+    memset(ifname, 0, MAX_L_PORT_NAME);
+    memcpy(ifname, name + 1, *name);
+
+    return 0;
+}
+
+static int mlacp_bulk_get_varint(struct mlacp_bulk_reader* reader, uint64_t* value)
+{
+    int shift = 0;
+
+    *value = 0;
+    while (reader->p < reader->end && shift < 64)
+    {
+        *value |= (uint64_t)(*reader->p & 0x7f) << shift;
+        if ((*reader->p++ & 0x80) == 0)
+            return 0;
+        shift += 7;
+    }
+
+    return MCLAG_ERROR;
+}
+
+int mlacp_fsm_update_mac_bulk_info_from_peer(struct CSM* csm, struct mLACPBulkInfoTLV* tlv)
+{
+    struct mlacp_bulk_reader reader;
+    struct mLACPMACData mac_data;
+    uint64_t vid = 0;
+    uint64_t mac_value = 0;
+    uint64_t delta;
+    int count;
+    int i, j;
+
+    if (!csm || !tlv)
+        return MCLAG_ERROR;
+
+    if (mlacp_bulk_reader_init(&reader, tlv) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Invalid bulk MAC message, bad interface names");
+        return MCLAG_ERROR;
+    }
+
+    count = ntohs(tlv->num_of_entry);
+    ICCPD_LOG_INFO(__FUNCTION__, "Received bulk MAC Info count %d ", count);
+
+    for (i = 0; i < count; i++)
+    {
+        if (reader.end - reader.p < 2)
+            break;
+        mac_data.type = *reader.p++;
+        mac_data.mac_type = *reader.p++;
+        if (mlacp_bulk_get_ifname(&reader, mac_data.ifname) < 0)
+            break;
+
+        if (mlacp_bulk_get_varint(&reader, &delta) < 0)
+            break;
+        if (delta)
+            mac_value = 0;
+        vid += delta;
+        if (mlacp_bulk_get_varint(&reader, &delta) < 0)
+            break;
+        mac_value += delta;
+
+        for (j = 0; j < ETHER_ADDR_LEN; j++)
+            mac_data.mac_addr[j] = mac_value >> (8 * (ETHER_ADDR_LEN - 1 - j));
+        mac_data.vid = htons(vid);
+
+        mlacp_fsm_update_mac_entry_from_peer(csm, &mac_data);
+    }
+
+    if (i < count)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Invalid bulk MAC message, %d of %d entries decoded", i, count);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
+static inline unsigned int mlacp_arp_hash(uint32_t ipv4_addr)
+{
+    return (ipv4_addr * 2654435761u) >> 18 & (MLACP_NEIGH_HASH_SIZE - 1);
+}
+
+static inline unsigned int mlacp_ndisc_hash(uint32_t *ipv6_addr)
+{
+    uint32_t addr[4];
+
+    memcpy(addr, ipv6_addr, 16);
+    return mlacp_arp_hash(addr[0] ^ addr[1] ^ addr[2] ^ addr[3]);
+}
+
 /*****************************************
  * Tool : Add ARP Info into ARP list
  *
@@ -579,7 +719,7 @@ void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
     if (!csm)
     {
         if (msg)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
     if (!msg)
@@ -589,6 +729,7 @@ void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
     if (arp_msg->op_type != NEIGH_SYNC_DEL)
     {
         TAILQ_INSERT_TAIL(&(MLACP(csm).arp_list), msg, tail);
+        LIST_INSERT_HEAD(&(MLACP(csm).arp_hash[mlacp_arp_hash(arp_msg->ipv4_addr)]), msg, neigh_next);
     }
 
     return;
@@ -605,7 +746,7 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
     if (!csm)
     {
         if (msg)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
     if (!msg)
@@ -615,11 +756,84 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
     if (ndisc_msg->op_type != NEIGH_SYNC_DEL)
     {
         TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_list), msg, tail);
+        LIST_INSERT_HEAD(&(MLACP(csm).ndisc_hash[mlacp_ndisc_hash(ndisc_msg->ipv6_addr)]), msg, neigh_next);
     }
 
     return;
 }
 
+/*****************************************
+ * Tool : Remove ARP Info from ARP list,
+ *        the caller frees it
+ *
+ ****************************************/
+void mlacp_dequeue_arp(struct CSM* csm, struct Msg* msg)
+{
+    if (!csm || !msg)
+        return;
+
+    TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
+    LIST_REMOVE(msg, neigh_next);
+
+    return;
+}
+
+/*****************************************
+ * Tool : Remove Ndisc Info from ndisc list,
+ *        the caller frees it
+ *
+ ****************************************/
+void mlacp_dequeue_ndisc(struct CSM *csm, struct Msg *msg)
+{
+    if (!csm || !msg)
+        return;
+
+    TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
+    LIST_REMOVE(msg, neigh_next);
+
+    return;
+}
+
+/*****************************************
+ * Tool : Find ARP Info in ARP list by IP
+ *
+ ****************************************/
+struct Msg* mlacp_find_arp(struct CSM* csm, uint32_t ipv4_addr)
+{
+    struct Msg *msg = NULL;
+
+    if (!csm)
+        return NULL;
+
+    LIST_FOREACH(msg, &(MLACP(csm).arp_hash[mlacp_arp_hash(ipv4_addr)]), neigh_next)
+    {
+        if (((struct ARPMsg*)msg->buf)->ipv4_addr == ipv4_addr)
+            return msg;
+    }
+
+    return NULL;
+}
+
+/*****************************************
+ * Tool : Find Ndisc Info in ndisc list by IP
+ *
+ ****************************************/
+struct Msg* mlacp_find_ndisc(struct CSM *csm, uint32_t *ipv6_addr)
+{
+    struct Msg *msg = NULL;
+
+    if (!csm)
+        return NULL;
+
+    LIST_FOREACH(msg, &(MLACP(csm).ndisc_hash[mlacp_ndisc_hash(ipv6_addr)]), neigh_next)
+    {
+        if (memcmp(((struct NDISCMsg *)msg->buf)->ipv6_addr, ipv6_addr, 16) == 0)
+            return msg;
+    }
+
+    return NULL;
+}
+
 /*****************************************
 * ARP-Info Update
 * ***************************************/
@@ -631,7 +845,8 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     struct LocalInterface *vlan_if = NULL;
     struct LocalInterface *peer_link_if = NULL;
     struct LocalInterface *local_vlan_if = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     int set_arp_flag = 0;
     int my_ip_arp_flag = 0;
     int vlan_count = 0;
@@ -639,7 +854,6 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     int err = 0, ln = 0;
     int permanent_neigh = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
     int vid_intf_present = 0;
 
     if (!csm || !arp_entry)
@@ -665,35 +879,33 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
 
     if (vlan_id)
     {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
-
         peer_link_if = local_if_find_by_name(csm->peer_itf_name);
 
         if (peer_link_if && !local_if_is_l3_mode(peer_link_if))
         {
             ln = __LINE__;
             /* Is peer-linlk itf belong to a vlan the same as peer?*/
-            vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+            vlan_member = vlan_bitmap_test(&(peer_link_if->vlan_bitmap), vlan_id);
+            vlan_itf = vlan_member ? local_if_vlan_itf(vlan_id) : NULL;
 
-            if (vlan_id_list)
+            if (vlan_member)
             {
                 vlan_count++;
-                if (vlan_id_list->vlan_itf) {
-                    if (strcmp(vlan_id_list->vlan_itf->name, arp_entry->ifname) == 0) {
+                if (vlan_itf) {
+                    if (strcmp(vlan_itf->name, arp_entry->ifname) == 0) {
                         ln = __LINE__;
                         vid_intf_present = 1;
                     }
 
-                    if (vid_intf_present && local_if_is_l3_mode(vlan_id_list->vlan_itf)) {
-                        if (arp_entry->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+                    if (vid_intf_present && local_if_is_l3_mode(vlan_itf)) {
+                        if (arp_entry->ipv4_addr == vlan_itf->ipv4_addr) {
                             my_ip_arp_flag = 1;
                         }
                     }
 
                     ICCPD_LOG_DEBUG(__FUNCTION__,
                             "ARP is learnt from intf %s, peer-link %s is the member of this vlan",
-                            vlan_id_list->vlan_itf->name, peer_link_if->name);
+                            vlan_itf->name, peer_link_if->name);
 
                     /* Peer-link belong to L3 vlan is alive, set the ARP info*/
                     set_arp_flag = 1;
@@ -733,21 +945,22 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
                 {
                     /* Is the L2 MLAG itf belong to a vlan the same as peer?*/
                     if (vlan_id) {
-                        vlan_id_list = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
-                        if (vlan_id_list && vlan_id_list->vlan_itf) {
-                            if (arp_entry->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+                        vlan_member = vlan_bitmap_test(&(local_if->vlan_bitmap), vlan_id);
+                        vlan_itf = vlan_member ? local_if_vlan_itf(vlan_id) : NULL;
+                        if (vlan_itf) {
+                            if (arp_entry->ipv4_addr == vlan_itf->ipv4_addr) {
                                 my_ip_arp_flag = 1;
                             }
 
                             ICCPD_LOG_DEBUG(__FUNCTION__,
                                 "ARP is learnt from intf %s, mclag %s is the member of this vlan",
-                                vlan_id_list->vlan_itf->name, local_if->name);
+                                vlan_itf->name, local_if->name);
                         }
                     }
 
                     ICCPD_LOG_DEBUG(__FUNCTION__, "ARP received PO %s, active %d, my_ip %d, ln %d",
                             local_if->name, local_if->po_active, my_ip_arp_flag, ln);
-                    if (vlan_id_list && local_if->po_active == 1)
+                    if (vlan_member && local_if->po_active == 1)
                     {
                         /* Any po of L3 vlan is alive, set the ARP info*/
                         set_arp_flag = 1;
@@ -841,24 +1054,21 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     }
 
     /* update ARP list*/
-    TAILQ_FOREACH(msg, &(MLACP(csm).arp_list), tail)
+    msg = mlacp_find_arp(csm, arp_entry->ipv4_addr);
+    if (msg)
     {
+        msg->restored = 0;
         arp_msg = (struct ARPMsg*)msg->buf;
-        if (arp_msg->ipv4_addr == arp_entry->ipv4_addr)
-        {
-            /*arp_msg->op_type = tlv->type;*/
-            sprintf(arp_msg->ifname, "%s", arp_entry->ifname);
-            memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
-            break;
-        }
+        /*arp_msg->op_type = tlv->type;*/
+        sprintf(arp_msg->ifname, "%s", arp_entry->ifname);
+        memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
     }
 
     /* delete/add ARP list*/
     if (msg && arp_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_dequeue_arp(csm, msg);
+        iccp_csm_free_msg(msg);
         /*ICCPD_LOG_INFO(__FUNCTION__, "Del arp queue successfully");*/
     }
     else if (!msg && arp_entry->op_type == NEIGH_SYNC_ADD)
@@ -889,8 +1099,7 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     {
         arp_msg = (struct ARPMsg*)msg->buf;
         TAILQ_REMOVE(&(MLACP(csm).arp_msg_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        iccp_csm_free_msg(msg);
         TAILQ_FOREACH(msg, &(MLACP(csm).arp_msg_list), tail)
         {
             arp_msg = (struct ARPMsg*)msg->buf;
@@ -918,6 +1127,58 @@ int mlacp_fsm_update_arp_info(struct CSM* csm, struct mLACPARPInfoTLV* tlv)
     }
 }
 
+int mlacp_fsm_update_arp_bulk_info(struct CSM* csm, struct mLACPBulkInfoTLV* tlv)
+{
+    struct mlacp_bulk_reader reader;
+    struct ARPMsg arp_data;
+    uint64_t addr = 0;
+    uint64_t delta;
+    int count;
+    int i;
+
+    if (!csm || !tlv)
+        return MCLAG_ERROR;
+
+    if (mlacp_bulk_reader_init(&reader, tlv) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Invalid bulk ARP message, bad interface names");
+        return MCLAG_ERROR;
+    }
+
+    count = ntohs(tlv->num_of_entry);
+    ICCPD_LOG_DEBUG(__FUNCTION__, "Received bulk ARP Info count %d ", count);
+
+    memset(&arp_data, 0, sizeof(arp_data));
+    for (i = 0; i < count; i++)
+    {
+        if (reader.end - reader.p < 2)
+            break;
+        arp_data.op_type = *reader.p++;
+        arp_data.flag = *reader.p++;
+        if (mlacp_bulk_get_ifname(&reader, arp_data.ifname) < 0)
+            break;
+
+        if (mlacp_bulk_get_varint(&reader, &delta) < 0)
+            break;
+        addr += delta;
+        if (reader.end - reader.p < ETHER_ADDR_LEN)
+            break;
+        memcpy(arp_data.mac_addr, reader.p, ETHER_ADDR_LEN);
+        reader.p += ETHER_ADDR_LEN;
+        arp_data.ipv4_addr = htonl((uint32_t)addr);
+
+        mlacp_fsm_update_arp_entry(csm, &arp_data);
+    }
+
+    if (i < count)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Invalid bulk ARP message, %d of %d entries decoded", i, count);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
 /*****************************************
 * NDISC-Info Update
 * ***************************************/
@@ -929,7 +1190,8 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     struct LocalInterface *vlan_if = NULL;
     struct LocalInterface *peer_link_if = NULL;
     struct LocalInterface *local_vlan_if = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     int set_ndisc_flag = 0;
     char mac_str[18] = "";
     int my_ip_nd_flag = 0;
@@ -939,7 +1201,6 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     int is_ack_ll = 0;
     int is_link_local = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
     int vid_intf_present = 0;
 
     if (!csm || !ndisc_entry)
@@ -964,35 +1225,33 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
 
     if (vlan_id)
     {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
-
         peer_link_if = local_if_find_by_name(csm->peer_itf_name);
 
         if (peer_link_if && !local_if_is_l3_mode(peer_link_if))
         {
             ln = __LINE__;
             /* Is peer-linlk itf belong to a vlan the same as peer? */
-            vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+            vlan_member = vlan_bitmap_test(&(peer_link_if->vlan_bitmap), vlan_id);
+            vlan_itf = vlan_member ? local_if_vlan_itf(vlan_id) : NULL;
 
-            if (vlan_id_list)
+            if (vlan_member)
             {
                 vlan_count++;
-                if (vlan_id_list->vlan_itf) {
-                    if (strcmp(vlan_id_list->vlan_itf->name, ndisc_entry->ifname) == 0) {
+                if (vlan_itf) {
+                    if (strcmp(vlan_itf->name, ndisc_entry->ifname) == 0) {
                         ln = __LINE__;
                         vid_intf_present = 1;
                     }
 
-                    if (vid_intf_present && local_if_is_l3_mode(vlan_id_list->vlan_itf)) {
-                        if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+                    if (vid_intf_present && local_if_is_l3_mode(vlan_itf)) {
+                        if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
                         {
                             my_ip_nd_flag = 1;
                         }
 
                         if ((my_ip_nd_flag == 0) && is_link_local)
                         {
-                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_ll_addr, 16) == 0)
+                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_itf->ipv6_ll_addr, 16) == 0)
                             {
                                 my_ip_nd_flag = 1;
                             }
@@ -1001,7 +1260,7 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
 
                     ICCPD_LOG_DEBUG(__FUNCTION__,
                             "ND is learnt from intf %s, peer-link %s is the member of this vlan",
-                            vlan_id_list->vlan_itf->name, peer_link_if->name);
+                            vlan_itf->name, peer_link_if->name);
 
                     /* Peer-link belong to L3 vlan is alive, set the NDISC info */
                     set_ndisc_flag = 1;
@@ -1051,22 +1310,23 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
                     ln = __LINE__;
                     /* Is the L2 MLAG itf belong to a vlan the same as peer? */
                     if (vlan_id) {
-                        vlan_id_list = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
-                        if (vlan_id_list && vlan_id_list->vlan_itf) {
+                        vlan_member = vlan_bitmap_test(&(local_if->vlan_bitmap), vlan_id);
+                        vlan_itf = vlan_member ? local_if_vlan_itf(vlan_id) : NULL;
+                        if (vlan_itf) {
 
-                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
                             {
                                 my_ip_nd_flag = 1;
                             }
 
                             ICCPD_LOG_DEBUG(__FUNCTION__, "ND is learnt from intf %s, %s is the member of this vlan, my_ip %d",
-                                    vlan_id_list->vlan_itf->name, local_if->name, my_ip_nd_flag);
+                                    vlan_itf->name, local_if->name, my_ip_nd_flag);
                         }
                     }
 
                     ICCPD_LOG_DEBUG(__FUNCTION__, "ND received PO %s, active %d, ln %d",
                             local_if->name, local_if->po_active, ln);
-                    if (vlan_id_list && local_if->po_active == 1)
+                    if (vlan_member && local_if->po_active == 1)
                     {
                         /* Any po of L3 vlan is alive, set the NDISC info */
                         set_ndisc_flag = 1;
@@ -1163,24 +1423,21 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     }
 
     /* update NDISC list */
-    TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_list), tail)
+    msg = mlacp_find_ndisc(csm, ndisc_entry->ipv6_addr);
+    if (msg)
     {
+        msg->restored = 0;
         ndisc_msg = (struct NDISCMsg *)msg->buf;
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16) == 0)
-        {
-            /* ndisc_msg->op_type = tlv->type; */
-            sprintf(ndisc_msg->ifname, "%s", ndisc_entry->ifname);
-            memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
-            break;
-        }
+        /* ndisc_msg->op_type = tlv->type; */
+        sprintf(ndisc_msg->ifname, "%s", ndisc_entry->ifname);
+        memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
     }
 
     /* delete/add NDISC list */
     if (msg && ndisc_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_dequeue_ndisc(csm, msg);
+        iccp_csm_free_msg(msg);
         /* ICCPD_LOG_INFO(__FUNCTION__, "Del ndisc queue successfully"); */
     }
     else if (!msg && ndisc_entry->op_type == NEIGH_SYNC_ADD)
@@ -1211,8 +1468,7 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     {
         ndisc_msg = (struct NDISCMsg *)msg->buf;
         TAILQ_REMOVE(&(MLACP(csm).ndisc_msg_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        iccp_csm_free_msg(msg);
         TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_msg_list), tail)
         {
             ndisc_msg = (struct NDISCMsg *)msg->buf;
@@ -1247,7 +1503,6 @@ int mlacp_fsm_update_port_channel_info(struct CSM* csm,
                                        struct mLACPPortChannelInfoTLV* tlv)
 {
     struct PeerInterface* peer_if = NULL;
-    struct VLAN_ID* peer_vlan_id = NULL;
     int i = 0;
 
     if (csm == NULL || tlv == NULL )
@@ -1261,10 +1516,8 @@ int mlacp_fsm_update_port_channel_info(struct CSM* csm,
         if (peer_if->po_id != ntohs(tlv->agg_id))
             continue;
 
-        RB_FOREACH(peer_vlan_id, vlan_rb_tree, &(peer_if->vlan_tree))
-        {
-            peer_vlan_id->vlan_removed = 1;
-        }
+        /* Mark all VLANs removed, the TLV re-adds the ones still present*/
+        peer_if->vlan_removed = peer_if->vlan_bitmap;
 
         /* Record peer info*/
         peer_if->ipv4_addr = ntohl(tlv->ipv4_addr);
@@ -1320,6 +1573,7 @@ int mlacp_fsm_update_heartbeat(struct CSM* csm, struct mLACPHeartbeatTLV* tlv)
         return MCLAG_ERROR;
 
     time(&csm->heartbeat_update_time);
+    scheduler_csm_heartbeat_restart(csm);
 
     return 0;
 }
@@ -33,19 +33,6 @@
 #include "../include/iccp_netlink.h"
 #include "../include/iccp_ifm.h"
 
-
-static int vlan_node_compare(const struct VLAN_ID *p_vlan_node1, const struct VLAN_ID *p_vlan_node2)
-{
-    if (p_vlan_node1->vid < p_vlan_node2->vid)
-        return -1;
-
-    if (p_vlan_node1->vid > p_vlan_node2->vid)
-        return 1;
-
-    return 0;
-}
-RB_GENERATE(vlan_rb_tree, VLAN_ID, vlan_entry, vlan_node_compare);
-
 void local_if_init(struct LocalInterface* local_if)
 {
     if (local_if == NULL)
@@ -68,26 +55,93 @@ void local_if_init(struct LocalInterface* local_if)
     local_if->isolate_to_peer_link = 0;
     local_if->is_l3_proto_enabled = false;
     local_if->vlan_count = 0;
-    RB_INIT(vlan_rb_tree, &local_if->vlan_tree);
+    vlan_bitmap_zero(&local_if->vlan_bitmap);
+
+    return;
+}
+
+static unsigned int local_if_name_hash(const char* ifname)
+{
+    unsigned int hash = 2166136261u;
+
+    /* FNV-1a */
+    while (*ifname)
+    {
+        hash ^= (unsigned char)*ifname++;
+        hash *= 16777619u;
+    }
+
+    return hash & (LIF_NAME_HASH_SIZE - 1);
+}
+
+static inline unsigned int local_if_ifindex_hash(int ifindex)
+{
+    return (unsigned int)ifindex & (LIF_IFINDEX_HASH_SIZE - 1);
+}
+
+static inline unsigned int local_if_po_id_hash(int po_id)
+{
+    return (unsigned int)po_id & (LIF_PO_ID_HASH_SIZE - 1);
+}
+
+/* Add to the indexes of sys->lif_list, in front like the list */
+static void local_if_index_add(struct System* sys, struct LocalInterface* local_if)
+{
+    LIST_INSERT_HEAD(&(sys->lif_name_hash[local_if_name_hash(local_if->name)]), local_if, system_name_next);
+    LIST_INSERT_HEAD(&(sys->lif_ifindex_hash[local_if_ifindex_hash(local_if->ifindex)]), local_if, system_ifindex_next);
+    if (local_if->type == IF_T_PORT_CHANNEL)
+        LIST_INSERT_HEAD(&(sys->lif_po_id_hash[local_if_po_id_hash(local_if->po_id)]), local_if, system_po_id_next);
 
     return;
 }
 
-void vlan_info_init(struct VLAN_ID* vlan)
+/* Remove from the indexes, along with the removal from sys->lif_list */
+void local_if_index_del(struct LocalInterface* local_if)
 {
-    vlan->vid = -1;
-    vlan->vlan_removed = 0;
-    vlan->vlan_itf = NULL;
+    LIST_REMOVE(local_if, system_name_next);
+    LIST_REMOVE(local_if, system_ifindex_next);
+    if (local_if->type == IF_T_PORT_CHANNEL)
+        LIST_REMOVE(local_if, system_po_id_next);
 
     return;
 }
 
+/* Change the ifindex of a local interface in sys->lif_list */
+void local_if_set_ifindex(struct LocalInterface* local_if, int ifindex)
+{
+    struct System* sys = NULL;
+
+    if (local_if == NULL || local_if->ifindex == ifindex)
+        return;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    LIST_REMOVE(local_if, system_ifindex_next);
+    local_if->ifindex = ifindex;
+    LIST_INSERT_HEAD(&(sys->lif_ifindex_hash[local_if_ifindex_hash(ifindex)]), local_if, system_ifindex_next);
+
+    return;
+}
+
+/* The VlanN interface of a VLAN, NULL if the kernel has none */
+struct LocalInterface* local_if_vlan_itf(uint16_t vid)
+{
+    struct System* sys = NULL;
+
+    if (!(sys = system_get_instance()) || vid >= VLAN_ID_MAX)
+        return NULL;
+
+    return sys->vlan_itf[vid];
+}
+
 struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint8_t state)
 {
     struct System* sys = NULL;
     struct LocalInterface* local_if = NULL;
     struct CSM* csm;
     struct If_info * cif = NULL;
+    int vid = 0;
 
     if (!ifname)
         return NULL;
@@ -146,6 +200,8 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint
             {
                 local_if->is_l3_proto_enabled = true;
             }
+            if (sscanf(local_if->name, "Vlan%d", &vid) == 1 && vid > 0 && vid < VLAN_ID_MAX)
+                sys->vlan_itf[vid] = local_if;
             break;
 
         case IF_T_VXLAN:
@@ -165,6 +221,7 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint
                    local_if->mac_addr[3], local_if->mac_addr[4], local_if->mac_addr[5], local_if->state ? "down" : "up");
 
     LIST_INSERT_HEAD(&(sys->lif_list), local_if, system_next);
+    local_if_index_add(sys, local_if);
 
     //if there is pending vlan membership for this interface move to system lif
     move_pending_vlan_mbr_to_lif(sys, local_if);
@@ -202,7 +259,7 @@ struct LocalInterface* local_if_find_by_name(const char* ifname)
     if (!(sys = system_get_instance()))
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_name_hash[local_if_name_hash(ifname)]), system_name_next)
     {
         if (strcmp(local_if->name, ifname) == 0)
             return local_if;
@@ -219,7 +276,7 @@ struct LocalInterface* local_if_find_by_ifindex(int ifindex)
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_ifindex_hash[local_if_ifindex_hash(ifindex)]), system_ifindex_next)
     {
         if (local_if->ifindex == ifindex)
             return local_if;
@@ -236,7 +293,7 @@ struct LocalInterface* local_if_find_by_po_id(int po_id)
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_po_id_hash[local_if_po_id_hash(po_id)]), system_po_id_next)
     {
         if (local_if->type == IF_T_PORT_CHANNEL && local_if->po_id == po_id)
             return local_if;
@@ -248,10 +305,7 @@ struct LocalInterface* local_if_find_by_po_id(int po_id)
  void local_if_vlan_remove(struct LocalInterface *lif_vlan)
 {
     struct System *sys = NULL;
-    struct LocalInterface *lif = NULL;
-    struct VLAN_ID *vlan = NULL;
     int vid = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     if (!lif_vlan || lif_vlan->type != IF_T_VLAN)
     {
@@ -259,26 +313,14 @@ struct LocalInterface* local_if_find_by_po_id(int po_id)
     }
 
     sscanf(lif_vlan->name, "Vlan%d", &vid);
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
 
-    if ((sys = system_get_instance()) != NULL)
+    //delink this vlan (lif_vlan) interface from all associated lifs
+    //in scenario where vlan membership delete comes later when compared
+    //to vlan interface delete from kernel
+    if ((sys = system_get_instance()) != NULL && vid > 0 && vid < VLAN_ID_MAX
+        && sys->vlan_itf[vid] == lif_vlan)
     {
-        LIST_FOREACH(lif, &(sys->lif_list), system_next)
-        {
-            if (lif->type == IF_T_VLAN)
-                continue;
-
-            //delink this vlan (lif_vlan) interface from all associated lifs
-            //in scenario where vlan membership delete comes later when compared
-            //to vlan interface delete from kernel
-            vlan = RB_FIND(vlan_rb_tree, &(lif->vlan_tree), &vlan_key);
-            if (vlan)
-            {
-                vlan->vlan_itf = NULL;
-            }
-       }
+        sys->vlan_itf[vid] = NULL;
     }
 
     return;
@@ -365,6 +407,7 @@ void local_if_destroy(char *ifname)
 to_sys_purge:
     /* sys purge */
     LIST_REMOVE(lif, system_next);
+    local_if_index_del(lif);
     if (lif->csm)
         LIST_REMOVE(lif, mlacp_next);
     LIST_INSERT_HEAD(&(sys->lif_purge_list), lif, system_purge_next);
@@ -373,6 +416,7 @@ to_sys_purge:
 to_mlacp_purge:
     /* sys & mlacp purge */
     LIST_REMOVE(lif, system_next);
+    local_if_index_del(lif);
     LIST_REMOVE(lif, mlacp_next);
     LIST_INSERT_HEAD(&(sys->lif_purge_list), lif, system_purge_next);
     LIST_INSERT_HEAD(&(MLACP(csm).lif_purge_list), lif, mlacp_purge_next);
@@ -542,15 +586,9 @@ struct PeerInterface* peer_if_find_by_name(struct CSM* csm, char* name)
 
 void peer_if_del_all_vlan(struct PeerInterface* pif)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
-
     ICCPD_LOG_NOTICE(__FUNCTION__, "Remove all VLANs from peer intf %s", pif->name);
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(pif->vlan_tree), vlan_temp)
-    {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(pif->vlan_tree), vlan);
-        free(vlan);
-    }
+    vlan_bitmap_zero(&pif->vlan_bitmap);
+    vlan_bitmap_zero(&pif->vlan_removed);
     return;
 }
 
@@ -569,44 +607,33 @@ void peer_if_destroy(struct PeerInterface* pif)
 
 int local_if_add_vlan(struct LocalInterface* local_if,  uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-    char vlan_name[16] = "";
-
-    sprintf(vlan_name, "Vlan%d", vid);
-
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
-    vlan = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
+    struct LocalInterface *vlan_itf = NULL;
 
-    if (!vlan)
+    if (vid >= VLAN_ID_MAX)
     {
-        vlan = (struct VLAN_ID*)malloc(sizeof(struct VLAN_ID));
-        if (!vlan)
-            return MCLAG_ERROR;
+        ICCPD_LOG_WARN(__FUNCTION__, "Invalid VLAN ID %d for %s", vid, local_if->name);
+        return MCLAG_ERROR;
+    }
 
-        vlan_info_init(vlan);
-        vlan->vid = vid;
-        vlan->vlan_itf = local_if_find_by_name(vlan_name);
+    vlan_itf = local_if_vlan_itf(vid);
 
-        if (vlan->vlan_itf == NULL) {
-            ICCPD_LOG_DEBUG(__FUNCTION__, "vlan_itf %s not present", vlan_name);
+    if (!vlan_bitmap_test(&local_if->vlan_bitmap, vid))
+    {
+        if (vlan_itf == NULL) {
+            ICCPD_LOG_DEBUG(__FUNCTION__, "vlan_itf Vlan%d not present", vid);
         }
+        vlan_bitmap_set(&local_if->vlan_bitmap, vid);
         local_if->vlan_count +=1;
         ICCPD_LOG_DEBUG(__FUNCTION__, "Add %s to VLAN %d vlan count %d", local_if->name, vid, local_if->vlan_count);
         local_if->port_config_sync = 1;
-        RB_INSERT(vlan_rb_tree, &(local_if->vlan_tree), vlan);
     }
 
-    vlan->vlan_removed = 0;
-
 //    update_if_ipmac_on_standby(local_if, 5);
-    if (vlan->vlan_itf)
+    if (vlan_itf)
     {
         if (local_if->is_peer_link)
         {
-            update_vlan_if_mac_on_standby(vlan->vlan_itf, 1);
+            update_vlan_if_mac_on_standby(vlan_itf, 1);
         }
     }
     else
@@ -618,18 +645,9 @@ int local_if_add_vlan(struct LocalInterface* local_if,  uint16_t vid)
 
 void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
-    vlan = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
-
-    if (vlan != NULL)
+    if (vlan_bitmap_test(&local_if->vlan_bitmap, vid))
     {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(local_if->vlan_tree), vlan);
-        free(vlan);
+        vlan_bitmap_clear(&local_if->vlan_bitmap, vid);
         local_if->port_config_sync = 1;
         local_if->vlan_count -=1;
         ICCPD_LOG_DEBUG(__FUNCTION__, "Remove %s from VLAN %d, count %d", local_if->name, vid, local_if->vlan_count);
@@ -639,16 +657,9 @@ void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid)
 
 void local_if_del_all_vlan(struct LocalInterface* lif)
 {
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
-
     ICCPD_LOG_NOTICE(__FUNCTION__, "Remove all VLANs from %s", lif->name);
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(lif->vlan_tree), vlan_temp)
-    {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(lif->vlan_tree), vlan);
-        lif->vlan_count -=1;
-        free(vlan);
-    }
+    vlan_bitmap_zero(&lif->vlan_bitmap);
+    lif->vlan_count = 0;
 
     return;
 }
@@ -656,62 +667,34 @@ void local_if_del_all_vlan(struct LocalInterface* lif)
 /* Add VLAN from peer-link*/
 int peer_if_add_vlan(struct PeerInterface* peer_if, uint16_t vlan_id)
 {
-    struct VLAN_ID *peer_vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-    char vlan_name[16] = "";
-
-    sprintf(vlan_name, "Vlan%d", vlan_id);
-
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vlan_id;
-
-    peer_vlan = RB_FIND(vlan_rb_tree, &(peer_if->vlan_tree), &vlan_key);
-
-    if (!peer_vlan)
+    if (vlan_id >= VLAN_ID_MAX)
     {
-        peer_vlan = (struct VLAN_ID*)malloc(sizeof(struct VLAN_ID));
-        if (!peer_vlan)
-            return MCLAG_ERROR;
-
-        vlan_info_init(peer_vlan);
-        peer_vlan->vid = vlan_id;
+        ICCPD_LOG_WARN(__FUNCTION__, "Invalid VLAN ID %d from peer's %s", vlan_id, peer_if->name);
+        return MCLAG_ERROR;
+    }
 
+    if (!vlan_bitmap_test(&peer_if->vlan_bitmap, vlan_id))
+    {
         ICCPD_LOG_DEBUG(__FUNCTION__, "add VLAN ID = %d from peer's %s", vlan_id, peer_if->name);
-        RB_INSERT(vlan_rb_tree, &(peer_if->vlan_tree), peer_vlan);
+        vlan_bitmap_set(&peer_if->vlan_bitmap, vlan_id);
     }
 
-    peer_vlan->vlan_removed = 0;
+    vlan_bitmap_clear(&peer_if->vlan_removed, vlan_id);
     return 0;
 }
 
-/* Used by sync update*/
+/* Used by sync update, drop the VLANs the peer no longer listed */
 int peer_if_clean_unused_vlan(struct PeerInterface* peer_if)
 {
-    struct VLAN_ID *peer_vlan = NULL;
-    struct VLAN_ID *peer_vlan_next = NULL;
-    struct VLAN_ID *vlan_temp = NULL;
+    int vid;
 
-    /* traverse 1 time */
-    RB_FOREACH_SAFE(peer_vlan_next, vlan_rb_tree, &(peer_if->vlan_tree), vlan_temp)
+    VLAN_BITMAP_FOREACH(vid, &peer_if->vlan_removed)
     {
-        if (peer_vlan != NULL)
-        {
-            ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, peer_vlan->vid);
-            VLAN_RB_REMOVE(vlan_rb_tree, &(peer_if->vlan_tree), peer_vlan);
-            free(peer_vlan);
-            peer_vlan = NULL;
-
-        }
-        if (peer_vlan_next->vlan_removed == 1)
-            peer_vlan = peer_vlan_next;
+        ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, vid);
     }
 
-    if (peer_vlan != NULL)
-    {
-        ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, peer_vlan->vid);
-        VLAN_RB_REMOVE(vlan_rb_tree, &(peer_if->vlan_tree), peer_vlan);
-        free(peer_vlan);
-    }
+    vlan_bitmap_andnot(&peer_if->vlan_bitmap, &peer_if->vlan_bitmap, &peer_if->vlan_removed);
+    vlan_bitmap_zero(&peer_if->vlan_removed);
 
     return 0;
 }
@@ -41,6 +41,8 @@
 #include "../include/iccp_cmd.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_nl_ingest.h"
+#include "../include/iccp_warm_state.h"
 
 /******************************************************
 *
@@ -51,8 +53,7 @@
 //this needs to be fine tuned
 #define PEER_SOCK_SND_BUF_LEN  (6 * 1024 * 1024)
 #define PEER_SOCK_RCV_BUF_LEN  (6 * 1024 * 1024)
-#define RECV_RETRY_INTERVAL_USEC    100000
-#define RECV_RETRY_MAX              10
+#define PEER_RX_READ_MAX            16
 
 extern int mlacp_prepare_for_warm_reboot(struct CSM* csm, char* buf, size_t max_buf_size);
 
@@ -71,49 +72,103 @@ static int session_conn_thread_unlock(pthread_mutex_t *conn_mutex)
     return 1;/* pthread_mutex_unlock(conn_mutex);*/
 }
 
-static void heartbeat_check(struct CSM *csm)
+/* Nothing from the peer within session_timeout, not even a heartbeat */
+static void scheduler_csm_heartbeat_timeout(void* arg)
 {
-    if (csm->heartbeat_update_time == 0)
-    {
-        time(&csm->heartbeat_update_time);
+    struct CSM* csm = (struct CSM*)arg;
+
+    if (csm->sock_fd <= 0)
         return;
-    }
 
-    if ( (time(NULL) - csm->heartbeat_update_time) > csm->session_timeout)
-    {
-        /* hearbeat timeout*/
-        ICCPD_LOG_WARN("ICCP_FSM", "iccpd connection timeout (heartbeat)");
-        scheduler_session_disconnect_handler(csm);
-    }
+    ICCPD_LOG_WARN("ICCP_FSM", "iccpd connection timeout (heartbeat)");
+    scheduler_session_disconnect_handler(csm);
+
+    return;
+}
+
+/* Keepalives, connect retries and the second based sync timers of the
+ * FSMs are all checked by a transit, run it at least once per interval.
+ */
+static void scheduler_csm_transit_timeout(void* arg)
+{
+    struct CSM* csm = (struct CSM*)arg;
+
+    csm->transit_pending = 1;
+    iccp_timer_start(&csm->transit_timer, TRANSIT_INTERVAL_SEC * 1000);
+
+    return;
+}
+
+void scheduler_csm_timer_init(struct CSM* csm)
+{
+    iccp_timer_init(&csm->transit_timer, scheduler_csm_transit_timeout, csm);
+    iccp_timer_init(&csm->heartbeat_timer, scheduler_csm_heartbeat_timeout, csm);
+    iccp_timer_start(&csm->transit_timer, TRANSIT_INTERVAL_SEC * 1000);
+    csm->transit_pending = 1;
+
+    return;
+}
+
+void scheduler_csm_timer_stop(struct CSM* csm)
+{
+    iccp_timer_stop(&csm->transit_timer);
+    iccp_timer_stop(&csm->heartbeat_timer);
 
     return;
 }
 
-static void heartbeat_update(struct CSM *csm)
+void scheduler_csm_heartbeat_restart(struct CSM* csm)
 {
     if (csm->sock_fd > 0)
+        iccp_timer_start(&csm->heartbeat_timer, csm->session_timeout * 1000);
+
+    return;
+}
+
+void scheduler_csm_set_pending_all(struct System* sys)
+{
+    struct CSM* csm = NULL;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
     {
-        heartbeat_check(csm);
+        csm->transit_pending = 1;
     }
 
     return;
 }
 
-/* Transit FSM of all connections */
+/* Transit FSM of the connections that have something to do */
 static int scheduler_transit_fsm()
 {
     struct CSM* csm = NULL;
     struct System* sys = NULL;
+    ICCP_CONNECTION_STATE_E iccp_state;
+    APP_CONNECTION_STATE_E app_state;
+    MLACP_APP_STATE_E mlacp_state;
 
     if ((sys = system_get_instance()) == NULL)
         return MCLAG_ERROR;
 
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
-        heartbeat_update(csm);
+        if (!csm->transit_pending)
+            continue;
+
+        csm->transit_pending = 0;
+        iccp_state = csm->current_state;
+        app_state = csm->app_csm.current_state;
+        mlacp_state = MLACP(csm).current_state;
+
         iccp_csm_transit(csm);
         app_csm_transit(csm);
         mlacp_fsm_transit(csm);
+
+        /* One transit moves a state or takes one ICCP msg, go on until idle */
+        if (iccp_state != csm->current_state
+            || app_state != csm->app_csm.current_state
+            || mlacp_state != MLACP(csm).current_state
+            || !TAILQ_EMPTY(&(csm->msg_list)))
+            csm->transit_pending = 1;
     }
 
     //lif->changed flag is marked for state change for lif, for active node when
@@ -126,135 +181,320 @@ static int scheduler_transit_fsm()
     return 1;
 }
 
+/* epoll timeout until the next FSM transit or timer is due */
+static int scheduler_next_timeout(struct System* sys)
+{
+    struct CSM* csm = NULL;
+    int timeout;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->transit_pending)
+            return 0;
+    }
+
+    timeout = iccp_timer_next_msec();
+
+    /* mclagsyncd connect is retried by the loop itself */
+    if (sys->sync_fd <= 0 && (timeout < 0 || timeout > EPOLL_TIMEOUT_MSEC))
+        timeout = EPOLL_TIMEOUT_MSEC;
+
+    return timeout;
+}
+
 /* Receive packets call back function */
 int scheduler_csm_read_callback(struct CSM* csm)
 {
     struct Msg* msg = NULL;
-    /*peer message*/
-    char *peer_msg = g_csm_buf;
-    LDPHdr* ldp_hdr = (LDPHdr*)peer_msg;
-    char* data = &peer_msg[sizeof(LDPHdr)];
-    size_t data_len = 0;
+    LDPHdr* ldp_hdr = NULL;
+    size_t msg_len = 0;
     size_t pos = 0;
-    int recv_len = 0, len = 0, retval;
-    int num_retry = 0;
-    int total_retry_time = 0;
-    int total_data_len = 0;
+    size_t space = 0;
+    ssize_t len = 0;
+    int num_read = 0;
+    int num_msg = 0;
+    int retval;
 
     if (csm->sock_fd <= 0)
         return MCLAG_ERROR;
 
-    memset(peer_msg, 0, CSM_BUFFER_SIZE);
-
-    recv_len = 0;
-    errno = 0;
+    if (csm->rx_buf == NULL)
+    {
+        csm->rx_buf = (char*)malloc(CSM_RX_BUFFER_SIZE);
+        if (csm->rx_buf == NULL)
+        {
+            ICCPD_LOG_ERR("ICCP_FSM", "Peer receive buffer allocation failed");
+            goto recv_err;
+        }
+        csm->rx_len = 0;
+    }
 
-    while (recv_len != sizeof(LDPHdr))
+    /* Read what the socket has, a message may end in a later call.
+     * The number of reads is bounded so one busy peer cannot hold the
+     * scheduler; epoll reports the socket again if data is left.
+     */
+    while (num_read++ < PEER_RX_READ_MAX)
     {
-        len = recv(csm->sock_fd, peer_msg + recv_len, sizeof(LDPHdr) - recv_len, 0);
+        space = CSM_RX_BUFFER_SIZE - csm->rx_len;
+        len = recv(csm->sock_fd, csm->rx_buf + csm->rx_len, space, MSG_DONTWAIT);
         if (len == -1)
         {
-            perror("recv(). Error");
-            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for header read error[%s] len = -1 till now received len  = %d ", strerror(errno), recv_len);
-            SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+                break;
+
+            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for read error[%s], pending len = %zu",
+                           strerror(errno), csm->rx_len);
+            if (csm->rx_len < sizeof(LDPHdr))
+            {
+                SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
+            }
+            else
+            {
+                SYSTEM_INCR_TLV_READ_SOCK_ERR_COUNTER(system_get_instance());
+            }
             goto recv_err;
         }
         else if (len == 0)
         {
-            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for header read error[%s] len = 0, till now received len = %d ",strerror(errno), recv_len);
-            SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
+            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect, pending len = %zu", csm->rx_len);
+            if (csm->rx_len < sizeof(LDPHdr))
+            {
+                SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
+            }
+            else
+            {
+                SYSTEM_INCR_TLV_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
+            }
             goto recv_err;
         }
-        recv_len += len;
-        /*usleep(100);*/
+        csm->rx_len += len;
+
+        /* Queue every complete message */
+        pos = 0;
+        while (csm->rx_len - pos >= sizeof(LDPHdr))
+        {
+            ldp_hdr = (LDPHdr*)&csm->rx_buf[pos];
+            if (ntohs(ldp_hdr->msg_len) < MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS)
+            {
+                ICCPD_LOG_ERR("ICCP_FSM", "Peer disconnect for invalid data error; length[%d] msg_type[0x%x] ", ntohs(ldp_hdr->msg_len),  ntohs(ldp_hdr->msg_type));
+                SYSTEM_INCR_INVALID_PEER_MSG_COUNTER(system_get_instance());
+                goto recv_err;
+            }
+            msg_len = ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+            if (csm->rx_len - pos < msg_len)
+                break;
+
+            retval = iccp_csm_init_msg(&msg, &csm->rx_buf[pos], msg_len);
+            if (retval == 0)
+            {
+                iccp_csm_enqueue_msg(csm, msg);
+                ++csm->icc_msg_in_count;
+            }
+            else
+                ++csm->i_msg_in_count;
+            pos += msg_len;
+            ++num_msg;
+        }
+
+        if (pos > 0)
+        {
+            csm->rx_len -= pos;
+            memmove(csm->rx_buf, csm->rx_buf + pos, csm->rx_len);
+        }
+        if (csm->rx_len > 0)
+            SYSTEM_INCR_RX_PEER_PARTIAL_MSG_COUNTER(system_get_instance());
+
+        /* Short read, the socket is empty */
+        if ((size_t)len < space)
+            break;
     }
 
-    if (ntohs(ldp_hdr->msg_len) >= MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS)
+    /* Any message from the peer shows it is alive */
+    if (num_msg > 0)
+        scheduler_csm_heartbeat_restart(csm);
+
+    return 1;
+
+ recv_err:
+    scheduler_session_disconnect_handler(csm);
+    return MCLAG_ERROR;
+}
+
+/* Send queued messages when the peer socket can take them */
+int scheduler_csm_write_callback(struct CSM* csm)
+{
+    if (csm->sock_fd <= 0)
+        return MCLAG_ERROR;
+
+    if (scheduler_sock_flush(csm->sock_fd, &csm->tx_queue) < 0)
     {
-        data_len = ntohs(ldp_hdr->msg_len) - MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+        ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for write error[%s]", strerror(errno));
+        scheduler_session_disconnect_handler(csm);
+        return MCLAG_ERROR;
     }
-    else
+
+    return 0;
+}
+
+/*****************************************
+* Socket output queue
+*
+* Messages are sent at once when the socket
+* takes them; the rest is queued and sent on
+* EPOLLOUT, so the scheduler never waits on a
+* slow receiver.
+* ***************************************/
+void scheduler_sock_tx_queue_init(struct sock_tx_queue* q, uint32_t* depth, uint32_t* hwm)
+{
+    /* a queue set up again drops what it held, and takes it off the depth */
+    scheduler_sock_tx_queue_free(q);
+    memset(q, 0, sizeof(struct sock_tx_queue));
+    q->depth = depth;
+    q->hwm = hwm;
+}
+
+void scheduler_sock_tx_queue_free(struct sock_tx_queue* q)
+{
+    if (q->depth)
+        *q->depth -= (q->tail - q->head);
+    if (q->buf)
+        free(q->buf);
+    q->buf = NULL;
+    q->size = 0;
+    q->head = 0;
+    q->tail = 0;
+    q->pollout = 0;
+}
+
+static void scheduler_sock_set_pollout(int fd, struct sock_tx_queue* q, int pollout)
+{
+    struct System* sys = NULL;
+    struct epoll_event event;
+
+    if (q->pollout == pollout)
+        return;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    event.data.fd = fd;
+    event.events = pollout ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0)
     {
-        ICCPD_LOG_ERR("ICCP_FSM", "Peer disconnect for invalid data error; length[%d] msg_type[0x%x] ", ntohs(ldp_hdr->msg_len),  ntohs(ldp_hdr->msg_type));
-        SYSTEM_INCR_INVALID_PEER_MSG_COUNTER(system_get_instance());
-        goto recv_err;
+        ICCPD_LOG_ERR(__FUNCTION__, "Socket %d epoll mod error %d", fd, errno);
+        return;
     }
-    total_data_len = data_len;
-    pos = 0;
+    q->pollout = pollout;
+}
 
-    while (data_len > 0)
+static int scheduler_sock_tx_queue_add(struct sock_tx_queue* q, const char* buf, size_t len)
+{
+    size_t pending = q->tail - q->head;
+    size_t new_size;
+    char* new_buf;
+
+    if (q->tail + len > q->size)
     {
-        /* When consecutive CCP session flaps happen, recv() call got stuck.
-         * Change recv() to non-blocking with retry mechanism. If max
-         * retry reaches, attempt one more retry after waiting for one KA
-         * interval before bringing down the session.
-         */
-        recv_len = recv(csm->sock_fd, &data[pos], data_len, MSG_DONTWAIT);
-        if (recv_len == -1)
+        if (q->head > 0)
         {
-            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-            {
-                ICCPD_LOG_NOTICE(
-                    "ICCP_FSM", "Non-blocking recv total/pending len %d/%d, errno %d, num_retry %d",
-                    total_data_len, data_len, errno, num_retry);
-                ++num_retry;
-                if (num_retry > RECV_RETRY_MAX)
-                {
-                    ICCPD_LOG_ERR(
-                        "ICCP_FSM", "Non-blocking recv() retry failed, total/pending len %d/%d",
-                        total_data_len, data_len);
-                    SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                    goto recv_err;
-                }
-                else
-                {
-                    if (num_retry == RECV_RETRY_MAX)
-                        usleep((csm->session_timeout * 1000000) - total_retry_time);
-                    else
-                    {
-                        total_retry_time += (num_retry * RECV_RETRY_INTERVAL_USEC);
-                        usleep(num_retry * RECV_RETRY_INTERVAL_USEC);
-                    }
-                    recv_len = 0;
-                }
-            }
-            else
-            {
-                perror("continue recv() Error");
-                ICCPD_LOG_WARN("ICCP_FSM", "Peer data read error; recv_len:%d data_len:%d, errno %d",
-                               recv_len, data_len, errno);
-                SYSTEM_INCR_TLV_READ_SOCK_ERR_COUNTER(system_get_instance());
-                goto recv_err;
-            }
+            memmove(q->buf, q->buf + q->head, pending);
+            q->head = 0;
+            q->tail = pending;
         }
-        else if (recv_len == 0)
+        if (q->tail + len > q->size)
         {
-            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for data read error; recv_len:%d data_len:%d ", recv_len, data_len);
-            SYSTEM_INCR_TLV_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-            goto recv_err;
+            new_size = q->size ? q->size : SOCK_TX_QUEUE_MIN_SIZE;
+            while (new_size < q->tail + len)
+                new_size *= 2;
+            new_buf = (char*)realloc(q->buf, new_size);
+            if (new_buf == NULL)
+                return MCLAG_ERROR;
+            q->buf = new_buf;
+            q->size = new_size;
+        }
+    }
+
+    memcpy(q->buf + q->tail, buf, len);
+    q->tail += len;
+    if (q->depth)
+    {
+        *q->depth += len;
+        if (*q->depth > *q->hwm)
+            *q->hwm = *q->depth;
+    }
+    return 0;
+}
+
+/* Return len once the message is sent or queued, MCLAG_ERROR if dropped */
+ssize_t scheduler_sock_send(int fd, struct sock_tx_queue* q, const char* buf, size_t len)
+{
+    ssize_t rc = 0;
+
+    if (q->head == q->tail)
+    {
+        rc = send(fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (rc == -1)
+        {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+                return MCLAG_ERROR;
+            rc = 0;
         }
-        data_len -= recv_len;
-        pos += recv_len;
-        /*usleep(100);*/
+        if ((size_t)rc == len)
+            return len;
     }
-    if (num_retry > 0)
+
+    /* Drop whole messages only, a partly sent one must be completed */
+    if (rc == 0 && (q->tail - q->head) + len > SOCK_TX_QUEUE_MAX_SIZE)
     {
-        SYSTEM_SET_RETRY_COUNTER(system_get_instance(), num_retry);
+        SYSTEM_INCR_TX_QUEUE_FULL_COUNTER(system_get_instance());
+        errno = ENOBUFS;
+        return MCLAG_ERROR;
     }
-    retval = iccp_csm_init_msg(&msg, peer_msg, ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS);
-    if (retval == 0)
+
+    if (scheduler_sock_tx_queue_add(q, buf + rc, len - rc) < 0)
     {
-        iccp_csm_enqueue_msg(csm, msg);
-        ++csm->icc_msg_in_count;
+        ICCPD_LOG_ERR(__FUNCTION__, "Socket %d output queue allocation failed", fd);
+        SYSTEM_INCR_TX_QUEUE_FULL_COUNTER(system_get_instance());
+        errno = ENOMEM;
+        return MCLAG_ERROR;
     }
-    else
-        ++csm->i_msg_in_count;
 
-    return 1;
+    scheduler_sock_set_pollout(fd, q, 1);
+    return len;
+}
 
- recv_err:
-    scheduler_session_disconnect_handler(csm);
-    return MCLAG_ERROR;
+/* Send queued bytes until the socket is full, MCLAG_ERROR on socket error */
+int scheduler_sock_flush(int fd, struct sock_tx_queue* q)
+{
+    ssize_t rc;
+
+    while (q->head < q->tail)
+    {
+        rc = send(fd, q->buf + q->head, q->tail - q->head, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (rc == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return 0;
+            return MCLAG_ERROR;
+        }
+        q->head += rc;
+        if (q->depth)
+            *q->depth -= rc;
+    }
+
+    q->head = 0;
+    q->tail = 0;
+    /* Give back the memory of a large backlog */
+    if (q->size > SOCK_TX_QUEUE_MIN_SIZE)
+    {
+        free(q->buf);
+        q->buf = NULL;
+        q->size = 0;
+    }
+    scheduler_sock_set_pollout(fd, q, 0);
+    return 0;
 }
 
 /* Handle server accept client */
@@ -319,20 +559,35 @@ int scheduler_server_accept()
     session_conn_thread_lock(&csm->conn_mutex);
     ICCPD_LOG_INFO(__FUNCTION__, "Server Accept, SocketFD [%d], %p", new_fd, csm);
 
-    struct epoll_event event;
-    int err;
-    int send_buf_len = PEER_SOCK_SND_BUF_LEN;
-    int recv_buf_len = PEER_SOCK_RCV_BUF_LEN;
-    event.data.fd = new_fd;
-    event.events = EPOLLIN;
-    err = epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, new_fd, &event);
-    if (err)
+    if (scheduler_csm_sock_attach(csm, new_fd) < 0)
     {
         session_conn_thread_unlock(&csm->conn_mutex);
         goto reject_client;
     }
 
-    csm->sock_fd = new_fd;
+    csm->current_state = ICCP_NONEXISTENT;
+    csm->transit_pending = 1;
+    session_conn_thread_unlock(&csm->conn_mutex);
+    return 0;
+}
+
+/* Use a connected socket as the peer session of the CSM */
+int scheduler_csm_sock_attach(struct CSM* csm, int fd)
+{
+    struct System* sys = NULL;
+    struct epoll_event event;
+    int send_buf_len = PEER_SOCK_SND_BUF_LEN;
+    int recv_buf_len = PEER_SOCK_RCV_BUF_LEN;
+
+    if ((sys = system_get_instance()) == NULL)
+        return MCLAG_ERROR;
+
+    event.data.fd = fd;
+    event.events = EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, fd, &event))
+        return MCLAG_ERROR;
+
+    csm->sock_fd = fd;
     if (setsockopt(csm->sock_fd, SOL_SOCKET, SO_SNDBUF, &send_buf_len, sizeof(send_buf_len)) == -1)
     {
         ICCPD_LOG_ERR(__FUNCTION__, "Set socket send buf option failed. Error");
@@ -341,10 +596,14 @@ int scheduler_server_accept()
     {
         ICCPD_LOG_ERR(__FUNCTION__, "Set socket recv buf option failed. Error");
     }
-    csm->current_state = ICCP_NONEXISTENT;
-    FD_SET(new_fd, &(sys->readfd));
+    scheduler_sock_tx_queue_init(&csm->tx_queue,
+        &sys->dbg_counters.peer_tx_queue_depth, &sys->dbg_counters.peer_tx_queue_hwm);
+    csm->rx_len = 0;
+    time(&csm->heartbeat_update_time);
+    scheduler_csm_heartbeat_restart(csm);
+    FD_SET(fd, &(sys->readfd));
     sys->readfd_count++;
-    session_conn_thread_unlock(&csm->conn_mutex);
+
     return 0;
 }
 
@@ -381,6 +640,8 @@ void scheduler_init()
         return;
 
     iccp_get_start_type(sys);
+    /*Tables of the previous run, restored as the CSMs are configured*/
+    iccp_warm_state_load(sys);
     /*Get kernel interface and port */
     iccp_sys_local_if_list_get_init();
     iccp_sys_local_if_list_get_addr();
@@ -406,6 +667,12 @@ void scheduler_init()
         ICCPD_LOG_WARN(__FUNCTION__, "Mclagd ctl info socket connect fail");
     }
 
+    /* Kernel events are received on their own thread from now on */
+    if (iccp_nl_ingest_start(sys) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Netlink ingestion thread start fail");
+    }
+
     return;
 }
 
@@ -458,28 +725,56 @@ int iccp_receive_signal_handler(struct System* sys)
     return 0;
 }
 
+/* One pass of the scheduler loop, blocks at most max_timeout msec (-1: no limit) */
+void scheduler_loop_once(int max_timeout)
+{
+    struct System* sys = NULL;
+    int timeout;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    if (sys->sync_fd <= 0)
+    {
+        iccp_connect_syncd();
+    }
+
+    timeout = scheduler_next_timeout(sys);
+    if (max_timeout >= 0 && (timeout < 0 || timeout > max_timeout))
+        timeout = max_timeout;
+
+    /*handle socket event, block until the next transit or timer is due*/
+    iccp_handle_events(sys, timeout);
+    iccp_timer_expire();
+    /*csm, app state machine transit */
+    scheduler_transit_fsm();
+    /*FDB entries batched during this loop*/
+    iccp_flush_fdb_to_syncd();
+
+    return;
+}
+
 /* Thread fetch to call */
 void scheduler_loop()
 {
     struct System* sys = NULL;
+    struct CSM* csm = NULL;
 
     if ((sys = system_get_instance()) == NULL)
         return;
 
     while (1)
     {
-        if (sys->sync_fd <= 0)
-        {
-            iccp_connect_syncd();
-        }
-
-        /*handle socket slelect event ,If no message received, it will block 0.1s*/
-        iccp_handle_events(sys);
-        /*csm, app state machine transit */
-        scheduler_transit_fsm();
+        scheduler_loop_once(-1);
 
         if (sys->warmboot_exit == WARM_REBOOT)
         {
+            /* Last try for the warmboot flag if it was queued */
+            LIST_FOREACH(csm, &(sys->csm_list), next)
+            {
+                if (csm->sock_fd > 0)
+                    scheduler_sock_flush(csm->sock_fd, &csm->tx_queue);
+            }
             ICCPD_LOG_DEBUG(__FUNCTION__, "Warm reboot exit ......");
             return;
         }
@@ -617,27 +912,8 @@ void session_client_conn_handler(struct CSM *csm)
     else
     {
         /* Conn OK*/
-        struct epoll_event event;
-        int err;
-        int send_buf_len = PEER_SOCK_SND_BUF_LEN;
-        int recv_buf_len = PEER_SOCK_RCV_BUF_LEN;
-        event.data.fd = connFd;
-        event.events = EPOLLIN;
-        err = epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, connFd, &event);
-        if (err)
+        if (scheduler_csm_sock_attach(csm, connFd) < 0)
             goto conn_fail;
-        csm->sock_fd = connFd;
-        if (setsockopt(csm->sock_fd, SOL_SOCKET, SO_SNDBUF, &send_buf_len, sizeof(send_buf_len)) == -1)
-        {
-            ICCPD_LOG_ERR(__FUNCTION__, "Set socket send buf option failed. Error");
-        }
-        if (setsockopt(csm->sock_fd, SOL_SOCKET, SO_RCVBUF, &recv_buf_len, sizeof(recv_buf_len)) == -1)
-        {
-            ICCPD_LOG_ERR(__FUNCTION__, "Set socket recv buf option failed. Error");
-        }
-
-        FD_SET(connFd, &(sys->readfd));
-        sys->readfd_count++;
         ICCPD_LOG_INFO(__FUNCTION__, "Connect to server %s sucess .", csm->peer_ip);
         goto conn_ok;
     }
@@ -851,6 +1127,7 @@ void scheduler_session_disconnect_handler(struct CSM* csm)
     mlacp_peer_disconn_handler(csm);
     MLACP(csm).current_state = MLACP_STATE_INIT;
     iccp_csm_status_reset(csm, 0);
+    csm->transit_pending = 1;
 
     time(&csm->connTimePrev);
     session_conn_thread_unlock(&csm->conn_mutex);
@@ -892,5 +1169,16 @@ void scheduler_csm_socket_cleanup(struct CSM* csm, int location)
                          csm->sock_fd, location);
     }
     csm->sock_fd = -1;
+    iccp_timer_stop(&csm->heartbeat_timer);
+    csm->transit_pending = 1;
+
+    /* Unsent and partly received messages belong to the closed session */
+    scheduler_sock_tx_queue_free(&csm->tx_queue);
+    if (csm->rx_buf)
+    {
+        free(csm->rx_buf);
+        csm->rx_buf = NULL;
+    }
+    csm->rx_len = 0;
 }
 
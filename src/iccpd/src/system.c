@@ -30,6 +30,8 @@
 #include "../include/scheduler.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_ifm.h"
+#include "../include/iccp_nl_ingest.h"
+#include "../include/iccp_warm_state.h"
 
 #define ETHER_ADDR_LEN 6
 char mac_print_str[ETHER_ADDR_STR_LEN];
@@ -56,12 +58,16 @@ struct System* system_get_instance()
 /* System instance initialization */
 void system_init(struct System* sys)
 {
+    int i;
+
     if (sys == NULL )
         return;
 
     memset(sys, 0, sizeof(struct System));
     sys->server_fd = -1;
     sys->sync_fd = -1;
+    scheduler_sock_tx_queue_init(&sys->sync_tx_queue,
+        &sys->dbg_counters.syncd_tx_queue_depth, &sys->dbg_counters.syncd_tx_queue_hwm);
     sys->sync_ctrl_fd = -1;
     sys->arp_receive_fd = -1;
     sys->ndisc_receive_fd = -1;
@@ -71,14 +77,25 @@ void system_init(struct System* sys)
     sys->warmboot_exit = 0;
     LIST_INIT(&(sys->csm_list));
     LIST_INIT(&(sys->lif_list));
+    for (i = 0; i < LIF_NAME_HASH_SIZE; i++)
+        LIST_INIT(&(sys->lif_name_hash[i]));
+    for (i = 0; i < LIF_IFINDEX_HASH_SIZE; i++)
+        LIST_INIT(&(sys->lif_ifindex_hash[i]));
+    for (i = 0; i < LIF_PO_ID_HASH_SIZE; i++)
+        LIST_INIT(&(sys->lif_po_id_hash[i]));
     LIST_INIT(&(sys->lif_purge_list));
     LIST_INIT(&(sys->unq_ip_if_list));
     LIST_INIT(&(sys->pending_vlan_mbr_if_list));
+    iccp_pool_create(ICCP_POOL_MSG, sizeof(struct Msg));
+    iccp_pool_create(ICCP_POOL_MAC_MSG, sizeof(struct MACMsg));
+    iccp_pool_create(ICCP_POOL_ARP_MSG, sizeof(struct ARPMsg));
+    iccp_pool_create(ICCP_POOL_NDISC_MSG, sizeof(struct NDISCMsg));
 
     sys->log_file_path = strdup("/var/log/iccpd.log");
     sys->cmd_file_path = strdup("/var/run/iccpd/iccpd.vty");
     sys->config_file_path = strdup("/etc/iccpd/iccpd.conf");
     sys->mclagdctl_file_path = strdup("/var/run/iccpd/mclagdctl.sock");
+    sys->warm_state_file_path = strdup("/var/warmboot/iccpd/iccpd_state.bin");
     sys->pid_file_fd = 0;
     sys->telnet_port = 2015;
     FD_ZERO(&(sys->readfd));
@@ -86,8 +103,11 @@ void system_init(struct System* sys)
     sys->csm_trans_time = 0;
     sys->need_sync_team_again = 0;
     sys->need_sync_netlink_again = 0;
+    sys->need_sync_neigh_again = 0;
+    sys->nl_event_fd = -1;
     scheduler_server_sock_init();
     iccp_system_init_netlink_socket();
+    iccp_nl_ingest_init(sys);
     iccp_init_netlink_event_fd(sys);
 }
 
@@ -106,6 +126,13 @@ void system_finalize()
         "System resource pool is destructing. Warmboot exit (%d)",
         sys->warmboot_exit);
 
+    /* No more kernel events while the sockets go away */
+    iccp_nl_ingest_stop(sys);
+
+    /* Keep the tables for the next start */
+    if (sys->warmboot_exit == WARM_REBOOT)
+        iccp_warm_state_save(sys);
+
     while (!LIST_EMPTY(&(sys->csm_list)))
     {
         csm = LIST_FIRST(&(sys->csm_list));
@@ -120,6 +147,7 @@ void system_finalize()
     {
         local_if = LIST_FIRST(&(sys->lif_list));
         LIST_REMOVE(local_if, system_next);
+        local_if_index_del(local_if);
         local_if_finalize(local_if);
     }
 
@@ -140,6 +168,9 @@ void system_finalize()
         free(unq_ip_if);
     }
 
+    /* All messages are released with the CSMs above */
+    iccp_pool_finalize();
+
     iccp_system_dinit_netlink_socket();
 
     if (sys->log_file_path != NULL )
@@ -148,12 +179,15 @@ void system_finalize()
         free(sys->cmd_file_path);
     if (sys->config_file_path != NULL )
         free(sys->config_file_path);
+    if (sys->warm_state_file_path != NULL )
+        free(sys->warm_state_file_path);
     if (sys->pid_file_fd > 0)
         close(sys->pid_file_fd);
     if (sys->server_fd > 0)
         close(sys->server_fd);
     if (sys->sync_fd > 0)
         close(sys->sync_fd);
+    scheduler_sock_tx_queue_free(&sys->sync_tx_queue);
     if (sys->sync_ctrl_fd > 0)
         close(sys->sync_ctrl_fd);
     if (sys->arp_receive_fd > 0)
@@ -320,6 +354,9 @@ SYNCD_TX_DBG_CNTR_MSG_e system_syncdtx_to_dbg_msg_type(uint32_t msg_type)
         case MCLAG_MSG_TYPE_SET_ICCP_PEER_SYSTEM_ID:
             return SYNCD_TX_DBG_CNTR_MSG_SET_ICCP_PEER_SYSTEM_ID;
 
+        case MCLAG_MSG_TYPE_SET_FDB_BULK:
+            return SYNCD_TX_DBG_CNTR_MSG_SET_FDB_BULK;
+
         default:
             return SYNCD_TX_DBG_CNTR_MSG_MAX;
     }
@@ -339,6 +376,8 @@ SYNCD_RX_DBG_CNTR_MSG_e system_syncdrx_to_dbg_msg_type(uint32_t msg_type)
             return SYNCD_RX_DBG_CNTR_MSG_CFG_MCLAG_UNIQUE_IP;
         case MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES:
             return SYNCD_RX_DBG_CNTR_MSG_VLAN_MBR_UPDATES;
+        case MCLAG_SYNCD_MSG_TYPE_CAPABILITY:
+            return SYNCD_RX_DBG_CNTR_MSG_CAPABILITY;
         default:
             return SYNCD_RX_DBG_CNTR_MSG_MAX;
     }
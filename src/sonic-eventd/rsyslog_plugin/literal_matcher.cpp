@@ -0,0 +1,126 @@
+#include <cstring>
+#include <queue>
+#include "literal_matcher.h"
+
+using namespace std;
+
+LiteralMatcher::LiteralMatcher() {
+    clear();
+}
+
+void LiteralMatcher::clear() {
+    memset(m_byteClass, 0, sizeof(m_byteClass));
+    m_classCnt = 1; // class 0 is for bytes in no literal
+    m_literalCnt = 0;
+    m_literals.clear();
+    m_ids.clear();
+    m_delta.clear();
+    m_hasOutput.clear();
+    m_outputs.clear();
+}
+
+void LiteralMatcher::addLiteral(const string& literal, int id) {
+    if(literal.empty()) {
+        return;
+    }
+    m_literals.push_back(literal);
+    m_ids.push_back(id);
+    m_literalCnt++;
+}
+
+/**
+ * Builds the trie of literals, then fills in the failure transitions breadth first,
+ * so matching needs exactly one table lookup per byte of message
+ *
+ */
+
+void LiteralMatcher::compile() {
+    m_delta.clear();
+    m_hasOutput.clear();
+    m_outputs.clear();
+    memset(m_byteClass, 0, sizeof(m_byteClass));
+    m_classCnt = 1;
+
+    for(const auto& literal : m_literals) {
+        for(unsigned char c : literal) {
+            if(m_byteClass[c] == 0) {
+                m_byteClass[c] = (uint8_t)m_classCnt++;
+            }
+        }
+    }
+
+    // root state
+    m_delta.assign(m_classCnt, -1);
+    m_outputs.resize(1);
+
+    for(size_t i = 0; i < m_literals.size(); i++) {
+        int32_t state = 0;
+        for(unsigned char c : m_literals[i]) {
+            int32_t& next = m_delta[state * m_classCnt + m_byteClass[c]];
+            if(next == -1) {
+                next = (int32_t)m_outputs.size();
+                m_outputs.emplace_back();
+                m_delta.resize(m_delta.size() + m_classCnt, -1);
+            }
+            state = m_delta[state * m_classCnt + m_byteClass[c]];
+        }
+        m_outputs[state].push_back(m_ids[i]);
+    }
+
+    vector<int32_t> fail(m_outputs.size(), 0);
+    queue<int32_t> pending;
+
+    for(int c = 0; c < m_classCnt; c++) {
+        int32_t& next = m_delta[c];
+        if(next == -1) {
+            next = 0;
+        } else {
+            pending.push(next);
+        }
+    }
+
+    while(!pending.empty()) {
+        int32_t state = pending.front();
+        pending.pop();
+        for(int c = 0; c < m_classCnt; c++) {
+            int32_t next = m_delta[state * m_classCnt + c];
+            int32_t fallback = m_delta[fail[state] * m_classCnt + c];
+            if(next == -1) {
+                m_delta[state * m_classCnt + c] = fallback;
+                continue;
+            }
+            fail[next] = fallback;
+            const vector<int>& inherited = m_outputs[fallback];
+            m_outputs[next].insert(m_outputs[next].end(), inherited.begin(), inherited.end());
+            pending.push(next);
+        }
+    }
+
+    m_hasOutput.resize(m_outputs.size());
+    for(size_t i = 0; i < m_outputs.size(); i++) {
+        m_hasOutput[i] = !m_outputs[i].empty();
+    }
+}
+
+/**
+ * Marks found[id] for each literal that occurs in text
+ *
+ * @param found is indexed by id and must be sized by caller
+ *
+ */
+
+void LiteralMatcher::match(const char* text, size_t len, vector<char>& found) const {
+    if(m_delta.empty()) {
+        return;
+    }
+    const int32_t* delta = m_delta.data();
+    int32_t state = 0;
+    for(size_t i = 0; i < len; i++) {
+        state = delta[state * m_classCnt + m_byteClass[(unsigned char)text[i]]];
+        if(m_hasOutput[state]) {
+            for(int id : m_outputs[state]) {
+                found[id] = 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef LITERAL_MATCHER_H
+#define LITERAL_MATCHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/***
+ *
+ * LiteralMatcher finds which of a set of literal strings occur in a message, in a single pass
+ * It is an Aho-Corasick automaton, compiled into a dense transition table over byte classes
+ *
+ */
+
+class LiteralMatcher {
+public:
+    LiteralMatcher();
+    void addLiteral(const string& literal, int id);
+    void compile();
+    void match(const char* text, size_t len, vector<char>& found) const;
+    bool empty() const { return m_literalCnt == 0; }
+    void clear();
+private:
+    uint8_t m_byteClass[256];
+    int m_classCnt;
+    int m_literalCnt;
+    vector<string> m_literals;
+    vector<int> m_ids;
+    vector<int32_t> m_delta;
+    vector<char> m_hasOutput;
+    vector<vector<int>> m_outputs;
+};
+
+#endif
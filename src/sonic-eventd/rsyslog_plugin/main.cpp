@@ -12,6 +12,7 @@ void showUsage() {
     cout << "Usage for rsyslog_plugin: \n" << "options\n"
         << "\t-r,required,type=string\t\tPath to regex file\n"
         << "\t-m,required,type=string\t\tYANG module name of source generating syslog message\n"
+        << "\t-t,optional,type=string\t\tTimestamp format of syslog message: traditional (default) or rfc5424\n"
         << "\t-h                     \t\tHelp"
         << endl;
 }
@@ -19,9 +20,10 @@ void showUsage() {
 int main(int argc, char** argv) {
     string regexPath;
     string moduleName;
+    TimestampFormat timestampFormat = TIMESTAMP_FORMAT_TRADITIONAL;
     int optionVal;
 
-    while((optionVal = getopt(argc, argv, "r:m:h")) != -1) {
+    while((optionVal = getopt(argc, argv, "r:m:t:h")) != -1) {
         switch(optionVal) {
             case 'r':
                 regexPath = optarg;
@@ -29,6 +31,14 @@ int main(int argc, char** argv) {
             case 'm':
                 moduleName = optarg;
                 break;
+            case 't':
+                if(string(optarg) == "rfc5424") {
+                    timestampFormat = TIMESTAMP_FORMAT_RFC5424;
+                } else if(string(optarg) != "traditional") {
+                    showUsage();
+                    return 1;
+                }
+                break;
             case 'h':
             case '?':
             default:
@@ -42,7 +52,7 @@ int main(int argc, char** argv) {
         return MISSING_ARGS_ERROR_CODE;
     }
 
-    unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin(moduleName, regexPath));
+    unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin(moduleName, regexPath, timestampFormat));
     int returnCode = plugin->onInit();
     if(returnCode == INVALID_REGEX_ERROR_CODE) {
         SWSS_LOG_ERROR("Rsyslog plugin was not able to be initialized due to invalid regex file provided.\n");
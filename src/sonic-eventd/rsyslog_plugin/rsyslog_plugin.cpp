@@ -4,27 +4,54 @@
 #include <regex>
 #include <ctime>
 #include <unordered_map>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
 #include "rsyslog_plugin.h"
 #include "json.hpp"
 
 using json = nlohmann::json;
 
+static volatile sig_atomic_t s_dumpStats = 0;
+
+static volatile sig_atomic_t s_shutdown = 0;
+
+static void onDumpStatsSignal(int) {
+    s_dumpStats = 1;
+}
+
+static void onShutdownSignal(int) {
+    s_shutdown = 1;
+}
+
 bool RsyslogPlugin::onMessage(string msg, lua_State* luaState) {
     string tag;
     event_params_t paramDict;
+    m_stats.linesIn++;
     if(!m_parser->parseMessage(msg, tag, paramDict, luaState)) {
         SWSS_LOG_DEBUG("%s was not able to be parsed into a structured event\n", msg.c_str());
         return false;
     } else {
-        int returnCode = event_publish(m_eventHandle, tag, &paramDict);
-        if(returnCode != 0) {
-            SWSS_LOG_ERROR("rsyslog_plugin was not able to publish event for %s.\n", tag.c_str());
-            return false;
-        }
-        return true;
+        m_stats.matched++;
+        return publish(tag, paramDict);
     }
 }
 
+bool RsyslogPlugin::publish(const string& tag, const event_params_t& params) {
+    int returnCode = event_publish(m_eventHandle, tag, &params);
+    if(returnCode != 0) {
+        SWSS_LOG_ERROR("rsyslog_plugin was not able to publish event for %s.\n", tag.c_str());
+        m_stats.publishFailed++;
+        return false;
+    }
+    m_stats.published++;
+    return true;
+}
+
 void parseParams(vector<string> params, vector<EventParam>& eventParams) {
     for(long unsigned int i = 0; i < params.size(); i++) {
         if(params[i].empty()) {
@@ -61,28 +88,16 @@ bool RsyslogPlugin::createRegexList() {
         return false;
     }
 
-    string regexString;
-    string timestampRegex = "^([a-zA-Z]{3})?\\s*([0-9]{1,2})?\\s*([0-9]{2}:[0-9]{2}:[0-9]{2}.[0-9]{0,6})?\\s*";
-    regex expression;
-    vector<RegexStruct> regexList;
+    unique_ptr<SyslogParser> parser(new SyslogParser());
 
     for(long unsigned int i = 0; i < jsonList.size(); i++) {
-        RegexStruct rs = RegexStruct();
         vector<EventParam> eventParams;
         try {
             string eventRegex = jsonList[i]["regex"];
-	    regexString = timestampRegex + eventRegex;
             string tag = jsonList[i]["tag"];
             vector<string> params = jsonList[i]["params"];
-	    vector<string> timestampParams = { "month", "day", "time" };
-	    params.insert(params.begin(), timestampParams.begin(), timestampParams.end());
-            regex expr(regexString);
-            expression = expr;
             parseParams(params, eventParams);
-            rs.params = eventParams;
-            rs.tag = tag;
-            rs.regexExpression = expression;
-            regexList.push_back(rs);
+            parser->addRegex(tag, eventRegex, eventParams);
 	} catch (domain_error& deException) {
             SWSS_LOG_ERROR("Missing required key, throws exception: %s\n", deException.what());
             return false;
@@ -92,29 +107,277 @@ bool RsyslogPlugin::createRegexList() {
 	}
     }
 
-    if(regexList.empty()) {
+    if(parser->m_regexList.empty()) {
         SWSS_LOG_ERROR("Empty list of regex expressions.\n");
         return false;
     }
 
-    m_parser->m_regexList = regexList;
+    m_parser->m_regexList.swap(parser->m_regexList);
+    m_parser->compile();
+    m_parser->compileLua(m_luaState);
 
     regexFile.close();
     return true;
 }
 
-void RsyslogPlugin::run() {
-    lua_State* luaState = luaL_newstate();
-    luaL_openlibs(luaState);
-    while(true) {
-        string line;
-        getline(cin, line);
-        if(line.empty()) {
+/**
+ * Logs line counts, and calls, errors, missing results & execution time of the lua code of each rule
+ *
+*/
+
+void RsyslogPlugin::dumpStats() {
+    SWSS_LOG_NOTICE("%s: lines in=%lu matched=%lu published=%lu publish failed=%lu truncated=%lu\n", m_moduleName.c_str(),
+            (unsigned long)m_stats.linesIn, (unsigned long)m_stats.matched, (unsigned long)m_stats.published,
+            (unsigned long)m_stats.publishFailed, (unsigned long)m_stats.truncated);
+    for(const auto& rs : m_parser->m_regexList) {
+        uint64_t calls = 0, errors = 0, noResult = 0, nanos = 0;
+        for(const auto& ep : rs.params) {
+            calls += ep.luaCalls;
+            errors += ep.luaErrors;
+            noResult += ep.luaNoResult;
+            nanos += ep.luaNanos;
+        }
+        if(calls == 0) {
             continue;
         }
-        onMessage(line, luaState);
+        SWSS_LOG_NOTICE("%s rule %s: lua calls=%lu errors=%lu no_result=%lu total_us=%lu avg_ns=%lu\n", m_moduleName.c_str(),
+                rs.tag.c_str(), (unsigned long)calls, (unsigned long)errors, (unsigned long)noResult,
+                (unsigned long)(nanos / 1000), (unsigned long)(nanos / calls));
+    }
+}
+
+/**
+ * Hands a batch of lines to the parse/publish stage, and continues in a free batch
+ *
+ * @param batch is the batch read into; replaced by the free batch
+ * @param lineStart is the start of the partial last line, moved to the free batch
+ * @return false on shutdown while waiting for a free batch; batch is unchanged then
+ *
+*/
+
+bool RsyslogPlugin::passBatch(InputBatch*& batch, size_t& lineStart) {
+    InputBatch* next;
+    {
+        unique_lock<mutex> lock(m_batchMutex);
+        while(m_freeBatches.empty()) {
+            if(s_shutdown) {
+                return false;
+            }
+            m_batchCv.wait_for(lock, chrono::milliseconds(INPUT_POLL_TIMEOUT_MS));
+        }
+        next = m_freeBatches.front();
+        m_freeBatches.pop_front();
+    }
+    size_t tail = batch->used - lineStart;
+    if(next->buf.size() < tail + INPUT_READ_SIZE) {
+        next->buf.resize(tail + INPUT_READ_SIZE);
+    }
+    memcpy(next->buf.data(), batch->buf.data() + lineStart, tail);
+    next->used = tail;
+    next->lines.clear();
+    next->truncated = 0;
+    lineStart = 0;
+    {
+        lock_guard<mutex> lock(m_batchMutex);
+        m_readBatches.push_back(batch);
     }
-    lua_close(luaState);
+    m_batchCv.notify_all();
+    batch = next;
+    return true;
+}
+
+/**
+ * Reader thread: reads the input in large non blocking reads, and splits it into lines in place
+ *
+ * @param inputFd is the input, rsyslog writes the messages to
+ *
+*/
+
+void RsyslogPlugin::readInput(int inputFd) {
+    InputBatch* batch;
+    size_t lineStart = 0;
+    size_t scanned = 0;
+    bool skipLine = false; // dropping the rest of a truncated line
+    struct pollfd pfd = { inputFd, POLLIN, 0 };
+
+    {
+        lock_guard<mutex> lock(m_batchMutex);
+        batch = m_freeBatches.front();
+        m_freeBatches.pop_front();
+    }
+    batch->used = 0;
+    batch->lines.clear();
+    batch->truncated = 0;
+
+    int flags = fcntl(inputFd, F_GETFL);
+    if(flags != -1) {
+        fcntl(inputFd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    while(!s_shutdown) {
+        if(batch->buf.size() - batch->used < INPUT_READ_SIZE) {
+            if(batch->lines.empty() && batch->buf.size() < INPUT_LINE_MAX_SIZE) { // line longer than the buffer
+                batch->buf.resize(min(batch->buf.size() * 2, (size_t)INPUT_LINE_MAX_SIZE));
+                continue;
+            }
+            if(batch->lines.empty()) { // parse what fits, drop the rest up to the newline
+                SWSS_LOG_WARN("Line of %s longer than %d bytes is truncated\n", m_moduleName.c_str(), INPUT_LINE_MAX_SIZE);
+                batch->lines.emplace_back(lineStart, batch->used - lineStart);
+                batch->truncated++;
+                lineStart = scanned = batch->used;
+                skipLine = true;
+            }
+            if(passBatch(batch, lineStart)) {
+                scanned = batch->used;
+            } else {
+                break;
+            }
+            continue;
+        }
+        ssize_t readCnt = read(inputFd, batch->buf.data() + batch->used, batch->buf.size() - batch->used);
+        if(readCnt > 0) {
+            batch->used += readCnt;
+            const char* data = batch->buf.data();
+            const char* newline;
+            if(skipLine) {
+                newline = (const char*)memchr(data + scanned, '\n', batch->used - scanned);
+                if(newline == NULL) {
+                    batch->used = scanned;
+                    continue;
+                }
+                lineStart = scanned = newline - data + 1;
+                skipLine = false;
+            }
+            while((newline = (const char*)memchr(data + scanned, '\n', batch->used - scanned)) != NULL) {
+                size_t lineEnd = newline - data;
+                batch->lines.emplace_back(lineStart, lineEnd - lineStart);
+                lineStart = scanned = lineEnd + 1;
+            }
+            scanned = batch->used;
+            continue;
+        }
+        if(readCnt == 0) { // EOF; last line may be w/o newline
+            if(lineStart < batch->used) {
+                batch->lines.emplace_back(lineStart, batch->used - lineStart);
+            }
+            break;
+        }
+        if(errno == EINTR) {
+            continue;
+        }
+        if(errno != EAGAIN && errno != EWOULDBLOCK) {
+            SWSS_LOG_ERROR("Failed to read input of %s: %s\n", m_moduleName.c_str(), strerror(errno));
+            break;
+        }
+        // all available input is read
+        if(!batch->lines.empty()) {
+            if(passBatch(batch, lineStart)) {
+                scanned = batch->used;
+                continue;
+            }
+            break;
+        }
+        poll(&pfd, 1, INPUT_POLL_TIMEOUT_MS);
+    }
+
+    {
+        lock_guard<mutex> lock(m_batchMutex);
+        if(batch->lines.empty()) {
+            m_freeBatches.push_back(batch);
+        } else {
+            m_readBatches.push_back(batch);
+        }
+        m_inputDone = true;
+    }
+    m_batchCv.notify_all();
+}
+
+/**
+ * Parses all lines of a batch, then publishes the events found
+ *
+*/
+
+void RsyslogPlugin::processBatch(const InputBatch& batch) {
+    size_t eventCnt = 0;
+
+    for(const auto& line : batch.lines) {
+        if(line.second == 0) {
+            continue;
+        }
+        m_stats.linesIn++;
+        m_line.assign(batch.buf.data() + line.first, line.second);
+        if(eventCnt == m_pendingEvents.size()) {
+            m_pendingEvents.emplace_back();
+        }
+        PendingEvent& event = m_pendingEvents[eventCnt];
+        event.params.clear();
+        if(!m_parser->parseMessage(m_line, event.tag, event.params, m_luaState)) {
+            SWSS_LOG_DEBUG("%s was not able to be parsed into a structured event\n", m_line.c_str());
+            continue;
+        }
+        m_stats.matched++;
+        eventCnt++;
+    }
+    for(size_t i = 0; i < eventCnt; i++) {
+        publish(m_pendingEvents[i].tag, m_pendingEvents[i].params);
+    }
+    m_stats.truncated += batch.truncated;
+    if(m_line.capacity() > INPUT_READ_SIZE) { // after a long line
+        string().swap(m_line);
+    }
+}
+
+void RsyslogPlugin::run(int inputFd) {
+    signal(SIGUSR1, onDumpStatsSignal);
+    signal(SIGTERM, onShutdownSignal);
+    signal(SIGINT, onShutdownSignal);
+
+    m_batches.clear();
+    m_readBatches.clear();
+    m_freeBatches.clear();
+    for(int i = 0; i < INPUT_BATCH_CNT; i++) {
+        m_batches.emplace_back(new InputBatch());
+        m_batches.back()->buf.resize(INPUT_BUFFER_SIZE);
+        m_freeBatches.push_back(m_batches.back().get());
+    }
+    m_inputDone = false;
+    thread reader(&RsyslogPlugin::readInput, this, inputFd);
+
+    while(true) {
+        InputBatch* batch = NULL;
+        {
+            unique_lock<mutex> lock(m_batchMutex);
+            while(m_readBatches.empty() && !m_inputDone) {
+                if(s_dumpStats) {
+                    break;
+                }
+                m_batchCv.wait_for(lock, chrono::milliseconds(INPUT_POLL_TIMEOUT_MS));
+            }
+            if(!m_readBatches.empty()) {
+                batch = m_readBatches.front();
+                m_readBatches.pop_front();
+            } else if(m_inputDone) {
+                break;
+            }
+        }
+        if(batch != NULL) {
+            processBatch(*batch);
+            if(batch->buf.size() > INPUT_BUFFER_SIZE) { // grown for a long line
+                vector<char>(INPUT_BUFFER_SIZE).swap(batch->buf);
+            }
+            {
+                lock_guard<mutex> lock(m_batchMutex);
+                m_freeBatches.push_back(batch);
+            }
+            m_batchCv.notify_all();
+        }
+        if(s_dumpStats) {
+            s_dumpStats = 0;
+            dumpStats();
+        }
+    }
+    reader.join();
+    dumpStats();
 }
 
 int RsyslogPlugin::onInit() {
@@ -128,8 +391,21 @@ int RsyslogPlugin::onInit() {
     return 0;
 }
 
-RsyslogPlugin::RsyslogPlugin(string moduleName, string regexPath) {
+RsyslogPlugin::RsyslogPlugin(string moduleName, string regexPath, TimestampFormat timestampFormat) {
     m_parser = unique_ptr<SyslogParser>(new SyslogParser());
+    m_parser->m_timestampFormat = timestampFormat;
+    m_eventHandle = NULL;
+    m_stats = PluginStats();
+    m_inputDone = false;
+    m_luaState = luaL_newstate();
+    luaL_openlibs(m_luaState);
     m_moduleName = moduleName;
     m_regexPath = regexPath;
 }
+
+RsyslogPlugin::~RsyslogPlugin() {
+    if(m_eventHandle != NULL) {
+        events_deinit_publisher(m_eventHandle);
+    }
+    lua_close(m_luaState);
+}
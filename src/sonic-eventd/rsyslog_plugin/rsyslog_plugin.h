@@ -9,6 +9,11 @@ extern "C"
 }
 #include <string>
 #include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <unistd.h>
 #include "syslog_parser.h"
 #include "events.h"
 #include "logger.h"
@@ -16,24 +21,80 @@ extern "C"
 using namespace std;
 using namespace swss;
 
+/* Input is read in chunks of at least this size, into buffers of INPUT_BUFFER_SIZE */
+#define INPUT_READ_SIZE (64 * 1024)
+#define INPUT_BUFFER_SIZE (1024 * 1024)
+/* A buffer grows up to this size for a long line; the rest of a longer line is dropped */
+#define INPUT_LINE_MAX_SIZE (4 * INPUT_BUFFER_SIZE)
+/* Buffers in flight between the reader thread & the parse/publish stage */
+#define INPUT_BATCH_CNT 4
+/* Reader checks for shutdown at least this often, while input is idle */
+#define INPUT_POLL_TIMEOUT_MS 100
+
+/* Lines read into one buffer; a line is an offset & length into buf, w/o the newline */
+struct InputBatch {
+    vector<char> buf;
+    size_t used;
+    vector<pair<size_t, size_t>> lines;
+    uint64_t truncated; // lines cut at INPUT_LINE_MAX_SIZE
+};
+
+/* Parsed event waiting to be published */
+struct PendingEvent {
+    string tag;
+    event_params_t params;
+};
+
+struct PluginStats {
+    uint64_t linesIn;
+    uint64_t matched;
+    uint64_t published;
+    uint64_t publishFailed;
+    uint64_t truncated;
+};
+
 /**
  * Rsyslog Plugin will utilize an instance of a syslog parser to read syslog messages from rsyslog.d and will continuously read from stdin
  * A plugin instance is created for each container/host.
  *
+ * A reader thread reads the input in large chunks & splits it into lines in place. Each batch of lines
+ * is parsed, then its events are published together. run returns on EOF or SIGTERM/SIGINT.
+ * A buffer grown for a long line is shrunk back once the line is parsed.
+ * Line & per rule lua execution stats are logged on SIGUSR1 and on exit.
+ *
  */
 
 class RsyslogPlugin {
 public:
     int onInit();
     bool onMessage(string msg, lua_State* luaState);
-    void run();
-    RsyslogPlugin(string moduleName, string regexPath);
+    void run(int inputFd = STDIN_FILENO);
+    void dumpStats();
+    const PluginStats& getStats() const { return m_stats; }
+    RsyslogPlugin(string moduleName, string regexPath, TimestampFormat timestampFormat = TIMESTAMP_FORMAT_TRADITIONAL);
+    ~RsyslogPlugin();
 private:
+    lua_State* m_luaState;
     unique_ptr<SyslogParser> m_parser;
     event_handle_t m_eventHandle;
     string m_regexPath;
     string m_moduleName;
+    PluginStats m_stats;
     bool createRegexList();
+    bool publish(const string& tag, const event_params_t& params);
+
+    /* Reader thread to parse/publish stage */
+    vector<unique_ptr<InputBatch>> m_batches;
+    deque<InputBatch*> m_readBatches;
+    deque<InputBatch*> m_freeBatches;
+    mutex m_batchMutex;
+    condition_variable m_batchCv;
+    bool m_inputDone;
+    void readInput(int inputFd);
+    bool passBatch(InputBatch*& batch, size_t& lineStart);
+    void processBatch(const InputBatch& batch);
+    string m_line;
+    vector<PendingEvent> m_pendingEvents;
 };
 
 #endif
@@ -1,8 +1,379 @@
 #include <iostream>
 #include <ctime>
+#include <cctype>
+#include <chrono>
 #include "syslog_parser.h"
 #include "logger.h"
 
+/**
+ * Finds the literals that any match of the regex must contain
+ *
+ * Only the top level of the regex is considered; groups, classes and anything quantified
+ * end a literal. A top level alternation or a back reference makes the regex unsafe to
+ * split from the timestamp prefix.
+ *
+ * @param eventRegex is the rule w/o timestamp prefix
+ * @param literals is set to required literals, of at least LITERAL_MIN_LENGTH
+ * @return false if eventRegex can't be matched apart from the timestamp prefix
+ *
+*/
+
+static bool extractLiterals(const string& eventRegex, vector<string>& literals) {
+    string current;
+    bool lastLiteral = false;
+    int depth = 0;
+    size_t i = 0;
+
+    literals.clear();
+    auto endLiteral = [&]() {
+        if(current.size() >= LITERAL_MIN_LENGTH) {
+            literals.push_back(current);
+        }
+        current.clear();
+        lastLiteral = false;
+    };
+
+    while(i < eventRegex.size()) {
+        char c = eventRegex[i];
+
+        if(c == '\\' && i + 1 < eventRegex.size() && isdigit((unsigned char)eventRegex[i + 1]) && eventRegex[i + 1] != '0') {
+            return false; // back reference to group numbers shifted by the prefix
+        }
+        if(depth > 0) {
+            if(c == '\\') {
+                i++;
+            } else if(c == '(') {
+                depth++;
+            } else if(c == ')') {
+                depth--;
+            } else if(c == '[') {
+                for(i++; i < eventRegex.size() && eventRegex[i] != ']'; i++) {
+                    if(eventRegex[i] == '\\') {
+                        i++;
+                    }
+                }
+            }
+            i++;
+            continue;
+        }
+
+        switch(c) {
+            case '|':
+                literals.clear();
+                return false;
+            case '(':
+                endLiteral();
+                depth++;
+                i++;
+                break;
+            case '[':
+                endLiteral();
+                for(i++; i < eventRegex.size() && eventRegex[i] != ']'; i++) {
+                    if(eventRegex[i] == '\\') {
+                        i++;
+                    }
+                }
+                i++;
+                break;
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+                // quantified atom may be absent or repeated
+                if(lastLiteral && !current.empty()) {
+                    current.pop_back();
+                }
+                endLiteral();
+                if(c == '{') {
+                    while(i < eventRegex.size() && eventRegex[i] != '}') {
+                        i++;
+                    }
+                }
+                i++;
+                break;
+            case '.':
+            case '^':
+            case '$':
+            case ')':
+                endLiteral();
+                i++;
+                break;
+            case '\\':
+                if(i + 1 < eventRegex.size() && !isalnum((unsigned char)eventRegex[i + 1])) {
+                    current.push_back(eventRegex[i + 1]);
+                    lastLiteral = true;
+                } else {
+                    endLiteral(); // class, assertion or control escape
+                }
+                i += 2;
+                break;
+            default:
+                current.push_back(c);
+                lastLiteral = true;
+                i++;
+                break;
+        }
+    }
+    endLiteral();
+    return true;
+}
+
+static inline bool isRegexSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline string_view getSubMatch(const string& message, const ssub_match& subMatch) {
+    if(!subMatch.matched) {
+        return string_view();
+    }
+    return string_view(message.data() + (subMatch.first - message.cbegin()), subMatch.length());
+}
+
+/**
+ * Parses the timestamp prefix, same as TIMESTAMP_REGEX matching greedily
+ * In RFC 5424 format, a leading timestamp token is taken instead, if any
+ *
+ * @return offset in message past the prefix
+ *
+*/
+
+size_t SyslogParser::parseTimestamp(const string& message, SyslogTimestamp& timestamp) const {
+    const char* msg = message.c_str();
+    size_t len = message.size();
+    size_t pos = 0;
+
+    timestamp = SyslogTimestamp();
+
+    if(m_timestampFormat == TIMESTAMP_FORMAT_RFC5424 && len >= 20 && isDigit(msg[0]) && isDigit(msg[1]) &&
+            isDigit(msg[2]) && isDigit(msg[3]) && msg[4] == '-') {
+        while(pos < len && !isRegexSpace(msg[pos])) {
+            pos++;
+        }
+        timestamp.rfc5424 = string_view(msg, pos);
+        while(pos < len && isRegexSpace(msg[pos])) {
+            pos++;
+        }
+        return pos;
+    }
+    if(len >= 3 && isalpha((unsigned char)msg[0]) && isalpha((unsigned char)msg[1]) && isalpha((unsigned char)msg[2])) {
+        timestamp.month = string_view(msg, 3);
+        pos = 3;
+    }
+    while(pos < len && isRegexSpace(msg[pos])) {
+        pos++;
+    }
+    if(pos < len && isDigit(msg[pos])) {
+        size_t digits = (pos + 1 < len && isDigit(msg[pos + 1])) ? 2 : 1;
+        timestamp.day = string_view(msg + pos, digits);
+        pos += digits;
+    }
+    while(pos < len && isRegexSpace(msg[pos])) {
+        pos++;
+    }
+    // hh:mm:ss followed by any char & upto 6 digits
+    if(pos + 9 <= len && isDigit(msg[pos]) && isDigit(msg[pos + 1]) && msg[pos + 2] == ':' &&
+            isDigit(msg[pos + 3]) && isDigit(msg[pos + 4]) && msg[pos + 5] == ':' &&
+            isDigit(msg[pos + 6]) && isDigit(msg[pos + 7]) && msg[pos + 8] != '\n' && msg[pos + 8] != '\r') {
+        size_t end = pos + 9;
+        while(end < len && end < pos + 15 && isDigit(msg[end])) {
+            end++;
+        }
+        timestamp.time = string_view(msg + pos, end - pos);
+        pos = end;
+    }
+    while(pos < len && isRegexSpace(msg[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+/**
+ * Adds a rule, with the timestamp prefix prepended
+ *
+ * @param eventRegex is regex of the rule, as given in regex file
+ * @param params are for the groups of eventRegex, w/o timestamp params
+ * @throws regex_error on invalid regex
+ *
+*/
+
+void SyslogParser::addRegex(const string& tag, const string& eventRegex, const vector<EventParam>& params) {
+    RegexStruct rs = RegexStruct();
+    vector<string> timestampParams = { "month", "day", "time" };
+
+    for(const auto& paramName : timestampParams) {
+        EventParam ep = EventParam();
+        ep.paramName = paramName;
+        rs.params.push_back(ep);
+    }
+    rs.params.insert(rs.params.end(), params.begin(), params.end());
+    rs.regexExpression = regex(TIMESTAMP_REGEX + eventRegex);
+    rs.tag = tag;
+    rs.eventRegex = eventRegex;
+    m_regexList.push_back(rs);
+}
+
+/**
+ * Builds the literal prefilter & the per rule regex w/o timestamp prefix
+ *
+ * A rule is a candidate for a message only when all its required literals occur in it.
+ * A rule with no known eventRegex, or with no long enough literal, is always a candidate
+ *
+*/
+
+void SyslogParser::compile() {
+    m_literalMatcher.clear();
+    m_ruleLiterals.assign(m_regexList.size(), vector<int>());
+    m_candidates.assign(m_regexList.size(), 0);
+    int literalCnt = 0;
+
+    for(size_t i = 0; i < m_regexList.size(); i++) {
+        RegexStruct& rs = m_regexList[i];
+        vector<string> literals;
+
+        rs.hasEventExpression = false;
+        if(rs.eventRegex.empty() || !extractLiterals(rs.eventRegex, literals)) {
+            continue;
+        }
+        try {
+            rs.eventExpression = regex(rs.eventRegex, regex::ECMAScript | regex::optimize);
+            rs.hasEventExpression = true;
+        } catch (regex_error& reException) {
+            SWSS_LOG_INFO("Rule %s is matched with timestamp prefix: %s", rs.tag.c_str(), reException.what());
+            continue;
+        }
+        rs.leadingAnyChars = (rs.eventRegex.compare(0, 2, ".*") == 0) &&
+            (rs.eventRegex.size() == 2 || (rs.eventRegex[2] != '?' && rs.eventRegex[2] != '+'));
+        for(const auto& literal : literals) {
+            m_literalMatcher.addLiteral(literal, literalCnt);
+            m_ruleLiterals[i].push_back(literalCnt++);
+        }
+    }
+    m_literalMatcher.compile();
+    m_literalFound.assign(literalCnt, 0);
+    m_compiledCnt = m_regexList.size();
+    m_luaStale = true; // lua code of the rules is compiled again on use
+}
+
+void SyslogParser::setParams(RegexStruct& regexStruct, const SyslogTimestamp& timestamp, const vector<string>& values, event_params_t& paramMap, lua_State* luaState) {
+    char formattedTimestamp[TIMESTAMP_BUFFER_SIZE];
+    size_t formattedLen = 0;
+    if(!timestamp.rfc5424.empty()) {
+        formattedLen = m_timestampFormatter->formatRfc5424Timestamp(timestamp.rfc5424, formattedTimestamp, sizeof(formattedTimestamp));
+    } else if(!timestamp.month.empty() && !timestamp.day.empty() && !timestamp.time.empty()) { // found timestamp components
+        formattedLen = m_timestampFormatter->formatTimestamp(timestamp.month, timestamp.day, timestamp.time, formattedTimestamp, sizeof(formattedTimestamp));
+    }
+    if(formattedLen > 0) {
+        paramMap["timestamp"].assign(formattedTimestamp, formattedLen);
+    } else {
+        SWSS_LOG_INFO("Timestamp is invalid and is not able to be formatted");
+    }
+
+    // check params for lua code
+    for(long unsigned int j = TIMESTAMP_PARAMS_CNT; j < regexStruct.params.size(); j++) {
+        const string& resultValue = values[j - TIMESTAMP_PARAMS_CNT];
+        EventParam& ep = regexStruct.params[j];
+
+        if(ep.luaCode.empty()) {
+            SWSS_LOG_INFO("Invalid lua code, empty or missing");
+            paramMap[ep.paramName] = resultValue;
+            continue;
+        }
+        if(!isLuaCompiled(luaState)) {
+            compileLua(luaState);
+        }
+
+        // execute compiled lua code, which reads global arg & sets global ret
+        auto start = chrono::steady_clock::now();
+        bool executed = false;
+        if(ep.luaRef != LUA_REFNIL) {
+            lua_pushstring(luaState, resultValue.c_str());
+            lua_setglobal(luaState, "arg");
+            lua_pushnil(luaState); // ret of an earlier call must not be taken
+            lua_setglobal(luaState, "ret");
+            lua_rawgeti(luaState, LUA_REGISTRYINDEX, ep.luaRef);
+            if(lua_pcall(luaState, 0, 0, 0) == 0) {
+                lua_getglobal(luaState, "ret");
+                const char* ret = lua_tostring(luaState, -1);
+                if(ret != NULL) {
+                    paramMap[ep.paramName] = ret;
+                    executed = true;
+                } else {
+                    ep.luaNoResult++;
+                }
+                lua_pop(luaState, 1);
+            } else { // error in lua code
+                const char* err = lua_tostring(luaState, -1);
+                SWSS_LOG_ERROR("Invalid lua code, unable to do operation: %s\n", err != NULL ? err : "");
+                lua_pop(luaState, 1);
+                ep.luaErrors++;
+            }
+        } else {
+            ep.luaErrors++;
+        }
+        if(!executed) {
+            paramMap[ep.paramName] = resultValue;
+        }
+        ep.luaCalls++;
+        ep.luaNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    }
+}
+
+/**
+ * Compiles the lua code of all params into functions, referenced from the registry of luaState
+ *
+ * @param luaState is the state, lua code is executed in by parseMessage
+ *
+*/
+
+void SyslogParser::compileLua(lua_State* luaState) {
+    bool recompile = isLuaMarked(luaState);
+    for(auto& rs : m_regexList) {
+        for(auto& ep : rs.params) {
+            if(recompile && ep.luaRef != LUA_NOREF && ep.luaRef != LUA_REFNIL) {
+                luaL_unref(luaState, LUA_REGISTRYINDEX, ep.luaRef);
+            }
+            ep.luaRef = LUA_NOREF;
+            if(ep.luaCode.empty()) {
+                continue;
+            }
+            if(luaL_loadstring(luaState, ep.luaCode.c_str()) != 0) {
+                const char* err = lua_tostring(luaState, -1);
+                SWSS_LOG_ERROR("Invalid lua code for %s of %s: %s\n", ep.paramName.c_str(), rs.tag.c_str(), err != NULL ? err : "");
+                lua_pop(luaState, 1);
+                ep.luaRef = LUA_REFNIL;
+                continue;
+            }
+            ep.luaRef = luaL_ref(luaState, LUA_REGISTRYINDEX);
+        }
+    }
+    // mark the state, as a later state may be allocated at the same address
+    lua_pushlightuserdata(luaState, this);
+    lua_pushboolean(luaState, 1);
+    lua_rawset(luaState, LUA_REGISTRYINDEX);
+    m_luaState = luaState;
+    m_luaStale = false;
+}
+
+bool SyslogParser::isLuaCompiled(lua_State* luaState) {
+    return !m_luaStale && isLuaMarked(luaState);
+}
+
+/* True if the refs of the rules are in the registry of luaState */
+bool SyslogParser::isLuaMarked(lua_State* luaState) {
+    if(luaState != m_luaState) {
+        return false;
+    }
+    lua_pushlightuserdata(luaState, this);
+    lua_rawget(luaState, LUA_REGISTRYINDEX);
+    bool compiled = lua_toboolean(luaState, -1);
+    lua_pop(luaState, 1);
+    return compiled;
+}
+
 /**
  * Parses syslog message and returns structured event
  *
@@ -11,55 +382,91 @@
  *
 */
 
-bool SyslogParser::parseMessage(string message, string& eventTag, event_params_t& paramMap, lua_State* luaState) {
+bool SyslogParser::parseMessage(const string& message, string& eventTag, event_params_t& paramMap, lua_State* luaState) {
+    if(m_compiledCnt != m_regexList.size()) {
+        compile();
+    }
+
+    SyslogTimestamp timestamp;
+    size_t eventOffset = parseTimestamp(message, timestamp);
+    vector<string> values;
+
+    m_literalFound.assign(m_literalFound.size(), 0);
+    m_literalMatcher.match(message.data(), message.size(), m_literalFound);
     for(long unsigned int i = 0; i < m_regexList.size(); i++) {
-        smatch matchResults;
-        if(!regex_search(message, matchResults, m_regexList[i].regexExpression) || m_regexList[i].params.size() != matchResults.size() - 1 || matchResults.size() < 4) {
+        m_candidates[i] = 1;
+        for(int id : m_ruleLiterals[i]) {
+            if(!m_literalFound[id]) {
+                m_candidates[i] = 0;
+                break;
+            }
+        }
+    }
+
+    for(long unsigned int i = 0; i < m_regexList.size(); i++) {
+        if(!m_candidates[i]) {
             continue;
         }
-        string formattedTimestamp;
-        if(!matchResults[1].str().empty() && !matchResults[2].str().empty() && !matchResults[3].str().empty()) { // found timestamp components
-            formattedTimestamp = m_timestampFormatter->changeTimestampFormat({ matchResults[1].str(), matchResults[2].str(), matchResults[3].str() });
-	}
-        if(!formattedTimestamp.empty()) {
-            paramMap["timestamp"] = formattedTimestamp;
-	} else {
-            SWSS_LOG_INFO("Timestamp is invalid and is not able to be formatted");
-	}
+        RegexStruct& rs = m_regexList[i];
+        smatch matchResults;
 
-        // found matching regex
-        eventTag = m_regexList[i].tag;
-	// check params for lua code
-        for(long unsigned int j = 3; j < m_regexList[i].params.size(); j++) {
-	    string resultValue = matchResults[j + 1].str();
-	    string paramName = m_regexList[i].params[j].paramName;
-	    const char* luaCode = m_regexList[i].params[j].luaCode.c_str();
-
-            if(luaCode == NULL || *luaCode == 0) {
-                SWSS_LOG_INFO("Invalid lua code, empty or missing");
-                paramMap[paramName] = resultValue;
-		continue;
-	    }
-
-	    // execute lua code
-            lua_pushstring(luaState, resultValue.c_str());
-            lua_setglobal(luaState, "arg");
-            if(luaL_dostring(luaState, luaCode) == 0) {
-                lua_pop(luaState, lua_gettop(luaState));
-	    } else { // error in lua code
-		SWSS_LOG_ERROR("Invalid lua code, unable to do operation.\n");
-		paramMap[paramName] = resultValue;
-		continue;
+        if(rs.hasEventExpression) {
+            // rule w/o prefix, from the end of the parsed timestamp
+            auto flags = regex_constants::match_continuous;
+            if(eventOffset > 0) {
+                flags |= regex_constants::match_prev_avail;
+            }
+            if(regex_search(message.cbegin() + eventOffset, message.cend(), matchResults, rs.eventExpression, flags)) {
+                if(rs.params.size() == matchResults.size() - 1 + TIMESTAMP_PARAMS_CNT) {
+                    values.clear();
+                    for(long unsigned int j = 1; j < matchResults.size(); j++) {
+                        values.push_back(matchResults[j].str());
+                    }
+                    eventTag = rs.tag;
+                    setParams(rs, timestamp, values, paramMap, luaState);
+                    return true;
+                }
+                continue;
+            }
+            /*
+             * A shorter timestamp prefix may leave more for the rule. As the prefix can be
+             * empty, a rule led by .* can't match at all, if it does not from the start.
+             * A RFC 5424 timestamp is a single token, hence not shorter.
+             */
+            if(eventOffset == 0 || !timestamp.rfc5424.empty() || (rs.leadingAnyChars &&
+                        !regex_search(message.cbegin(), message.cend(), rs.eventExpression, regex_constants::match_continuous))) {
+                continue;
             }
-            lua_getglobal(luaState, "ret");
-            paramMap[paramName] = lua_tostring(luaState, -1);
-            lua_pop(luaState, 1);
-	}
+        }
+
+        // full rule, as the timestamp prefix may match differently
+        SyslogTimestamp ruleTimestamp = timestamp;
+        if(!timestamp.rfc5424.empty()) {
+            // prefix matches none of the RFC 5424 timestamp, only what follows it
+            if(!regex_search(message.cbegin() + eventOffset, message.cend(), matchResults, rs.regexExpression) ||
+                    rs.params.size() != matchResults.size() - 1 || matchResults.size() < 4) {
+                continue;
+            }
+        } else {
+            if(!regex_search(message, matchResults, rs.regexExpression) || rs.params.size() != matchResults.size() - 1 || matchResults.size() < 4) {
+                continue;
+            }
+            ruleTimestamp.month = getSubMatch(message, matchResults[1]);
+            ruleTimestamp.day = getSubMatch(message, matchResults[2]);
+            ruleTimestamp.time = getSubMatch(message, matchResults[3]);
+        }
+        values.clear();
+        for(long unsigned int j = 1 + TIMESTAMP_PARAMS_CNT; j < matchResults.size(); j++) {
+            values.push_back(matchResults[j].str());
+        }
+        // found matching regex
+        eventTag = rs.tag;
+        setParams(rs, ruleTimestamp, values, paramMap, luaState);
         return true;
     }
     return false;
 }
 
-SyslogParser::SyslogParser() {
+SyslogParser::SyslogParser() : m_timestampFormat(TIMESTAMP_FORMAT_TRADITIONAL), m_compiledCnt(0), m_luaState(NULL), m_luaStale(true) {
     m_timestampFormatter = unique_ptr<TimestampFormatter>(new TimestampFormatter());
 }
@@ -11,36 +11,84 @@ extern "C"
 #include <vector>
 #include <string>
 #include <regex>
+#include <string_view>
+#include <cstdint>
 #include "json.hpp"
 #include "events.h"
 #include "timestamp_formatter.h"
+#include "literal_matcher.h"
 
 using namespace std;
 using json = nlohmann::json;
 
+/* Shared prefix of all rules, capturing month, day & time */
+#define TIMESTAMP_REGEX "^([a-zA-Z]{3})?\\s*([0-9]{1,2})?\\s*([0-9]{2}:[0-9]{2}:[0-9]{2}.[0-9]{0,6})?\\s*"
+#define TIMESTAMP_PARAMS_CNT 3
+
+/* Literals shorter than this filter too little to be worth a candidate check */
+#define LITERAL_MIN_LENGTH 3
+
 struct EventParam {
     string paramName;
     string luaCode;
+    int luaRef = LUA_NOREF; // compiled luaCode in registry; LUA_REFNIL if it failed to compile
+    uint64_t luaCalls = 0;
+    uint64_t luaErrors = 0; // luaCode failed to compile or to run
+    uint64_t luaNoResult = 0; // luaCode ran w/o setting ret
+    uint64_t luaNanos = 0; // total execution time of luaCode
 };
 
 struct RegexStruct {
     regex regexExpression;
     vector<EventParam> params;
     string tag;
+    string eventRegex; // rule w/o timestamp prefix; empty if not known
+    regex eventExpression;
+    bool hasEventExpression;
+    bool leadingAnyChars; // eventRegex starts with greedy .*
+};
+
+/* Views into the message being parsed */
+struct SyslogTimestamp {
+    string_view month;
+    string_view day;
+    string_view time;
+    string_view rfc5424; // set instead of the others in TIMESTAMP_FORMAT_RFC5424
 };
 
 /**
  * Syslog Parser is responsible for parsing log messages fed by rsyslog.d and returns
  * matched result to rsyslog_plugin to use with events publish API
  *
+ * Rules are compiled on first use. The timestamp prefix is parsed once per message and
+ * only the rules whose required literals all occur in the message are tried, in rule order.
+ * The lua code of params is compiled once per lua state, into functions kept in its registry.
+ * Recompiling into the same state releases the functions compiled before.
+ *
  */
 
 class SyslogParser {
 public:
     unique_ptr<TimestampFormatter> m_timestampFormatter;
     vector<RegexStruct> m_regexList;
-    bool parseMessage(string message, string& tag, event_params_t& paramDict, lua_State* luaState);
+    TimestampFormat m_timestampFormat;
+    bool parseMessage(const string& message, string& tag, event_params_t& paramDict, lua_State* luaState);
+    void addRegex(const string& tag, const string& eventRegex, const vector<EventParam>& params);
+    void compile();
+    void compileLua(lua_State* luaState);
     SyslogParser();
+private:
+    LiteralMatcher m_literalMatcher;
+    vector<vector<int>> m_ruleLiterals;
+    vector<char> m_literalFound;
+    vector<char> m_candidates;
+    size_t m_compiledCnt;
+    lua_State* m_luaState; // state the lua code is compiled into
+    bool m_luaStale; // rules changed since the lua code was compiled
+    bool isLuaCompiled(lua_State* luaState);
+    bool isLuaMarked(lua_State* luaState);
+    size_t parseTimestamp(const string& message, SyslogTimestamp& timestamp) const;
+    void setParams(RegexStruct& regexStruct, const SyslogTimestamp& timestamp, const vector<string>& values, event_params_t& paramMap, lua_State* luaState);
 };
 
 #endif
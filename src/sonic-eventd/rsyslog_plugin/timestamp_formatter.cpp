@@ -1,51 +1,242 @@
 #include <iostream>
+#include <cstring>
 #include "timestamp_formatter.h"
 #include "logger.h"
 #include "events.h"
 
 using namespace std;
 
+static const char g_months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+static int getMonth(string_view month) {
+    if(month.size() != 3) {
+        return 0;
+    }
+    for(int i = 0; i < 12; i++) {
+        if(memcmp(g_months + i * 3, month.data(), 3) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool readNumber(string_view str, size_t pos, size_t digits, int& value) {
+    if(pos + digits > str.size()) {
+        return false;
+    }
+    value = 0;
+    for(size_t i = pos; i < pos + digits; i++) {
+        if(!isDigit(str[i])) {
+            return false;
+        }
+        value = value * 10 + (str[i] - '0');
+    }
+    return true;
+}
+
+static inline char* writeNumber(char* out, int value, int digits) {
+    for(int i = digits - 1; i >= 0; i--) {
+        out[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return out + digits;
+}
+
+static int getDaysInMonth(int year, int month) {
+    static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if(month == 2 && (year % 4 == 0) && (year % 100 != 0 || year % 400 == 0)) {
+        return 29;
+    }
+    return days[month - 1];
+}
+
+TimestampFormatter::TimestampFormatter() : m_yearCheckTime(-1), m_currentYear(0), m_invalidLogTime(0), m_invalidCnt(0) {
+}
+
+void TimestampFormatter::logInvalidRfc5424(string_view timestamp) const {
+    time_t now = time(NULL);
+    if(now - m_invalidLogTime < TIMESTAMP_INVALID_LOG_INTERVAL_SECS) {
+        m_invalidCnt++;
+        return;
+    }
+    SWSS_LOG_ERROR("Timestamp %.*s is not in RFC 5424 format; %lu more since last logged\n",
+            (int)min(timestamp.size(), (size_t)TIMESTAMP_BUFFER_SIZE), timestamp.data(), (unsigned long)m_invalidCnt);
+    m_invalidLogTime = now;
+    m_invalidCnt = 0;
+}
+
+string_view TimestampFormatter::getYear(string_view timestamp) {
+    if(!m_storedTimestamp.empty()) {
+        if(string_view(m_storedTimestamp).compare(timestamp) <= 0) {
+            m_storedTimestamp.assign(timestamp.data(), timestamp.size());
+            return m_storedYear;
+        }
+    }
+    // no last timestamp or year change
+    time_t currentTime = time(nullptr);
+    if(currentTime != m_yearCheckTime) {
+        tm localTime;
+        localtime_r(&currentTime, &localTime);
+        m_currentYear = 1900 + localTime.tm_year;
+        m_yearCheckTime = currentTime;
+    }
+    char year[16];
+    int yearLen = snprintf(year, sizeof(year), "%d", m_currentYear);
+    m_storedTimestamp.assign(timestamp.data(), timestamp.size());
+    m_storedYear.assign(year, yearLen);
+    return m_storedYear;
+}
+
 /***
  *
- * Formats given string into string needed by YANG model
+ * Formats a traditional timestamp into the one needed by YANG model
+ * Mmm dd hh:mm:ss.SSSSSS to YYYY-mm-ddThh:mm:ss.SSSSSSZ
  *
- * @param timestamp parsed from syslog message
- * @return formatted timestamp that conforms to YANG model
+ * @param month, day & time are the components parsed from syslog message
+ * @param buf receives the formatted timestamp, nul terminated
+ * @return length of formatted timestamp; 0 if invalid or buf is too small
  *
  */
 
-static const unordered_map<string, string> g_monthDict {
-    { "Jan", "01" },
-    { "Feb", "02" },
-    { "Mar", "03" },
-    { "Apr", "04" },
-    { "May", "05" },
-    { "Jun", "06" },
-    { "Jul", "07" },
-    { "Aug", "08" },
-    { "Sep", "09" },
-    { "Oct", "10" },
-    { "Nov", "11" },
-    { "Dec", "12" }
-};
-
-string TimestampFormatter::getYear(string timestamp) {
-    if(!m_storedTimestamp.empty()) {
-        if(m_storedTimestamp.compare(timestamp) <= 0) {
-            m_storedTimestamp = timestamp;
-            return m_storedYear;
+size_t TimestampFormatter::formatTimestamp(string_view month, string_view day, string_view time, char* buf, size_t bufSize) {
+    int monthNum = getMonth(month);
+    if(monthNum == 0) {
+        SWSS_LOG_ERROR("Timestamp month was given in wrong format.\n");
+        return 0;
+    }
+    int dayNum;
+    if(day.empty() || day.size() > 2 || !readNumber(day, 0, day.size(), dayNum)) {
+        SWSS_LOG_ERROR("Timestamp day was given in wrong format.\n");
+        return 0;
+    }
+    if(4 + time.size() > TIMESTAMP_BUFFER_SIZE) {
+        SWSS_LOG_ERROR("Timestamp time was given in wrong format.\n");
+        return 0;
+    }
+
+    char currentTimestamp[TIMESTAMP_BUFFER_SIZE];
+    writeNumber(writeNumber(currentTimestamp, monthNum, 2), dayNum, 2);
+    memcpy(currentTimestamp + 4, time.data(), time.size());
+    string_view year = getYear(string_view(currentTimestamp, 4 + time.size()));
+
+    size_t len = year.size() + 7 + time.size() + 1;
+    if(len >= bufSize) {
+        SWSS_LOG_ERROR("Timestamp formatter unable to format into %zu bytes\n", bufSize);
+        return 0;
+    }
+    char* out = buf;
+    memcpy(out, year.data(), year.size());
+    out += year.size();
+    *out++ = '-';
+    out = writeNumber(out, monthNum, 2);
+    *out++ = '-';
+    out = writeNumber(out, dayNum, 2);
+    *out++ = 'T';
+    memcpy(out, time.data(), time.size());
+    out += time.size();
+    *out++ = 'Z';
+    *out = 0;
+    return len;
+}
+
+/***
+ *
+ * Formats a RFC 5424 timestamp into the one needed by YANG model, in UTC
+ * YYYY-mm-ddThh:mm:ss.SSSSSS+hh:mm to YYYY-mm-ddThh:mm:ss.SSSSSSZ, keeping up to 9 fraction digits
+ *
+ * @param timestamp is the timestamp parsed from syslog message
+ * @param buf receives the formatted timestamp, nul terminated
+ * @return length of formatted timestamp; 0 if invalid or buf is too small
+ *
+ */
+
+size_t TimestampFormatter::formatRfc5424Timestamp(string_view timestamp, char* buf, size_t bufSize) const {
+    int year, month, day, hour, minute, second;
+    if(timestamp.size() < 20 || !readNumber(timestamp, 0, 4, year) || timestamp[4] != '-' || !readNumber(timestamp, 5, 2, month) ||
+            timestamp[7] != '-' || !readNumber(timestamp, 8, 2, day) || timestamp[10] != 'T' ||
+            !readNumber(timestamp, 11, 2, hour) || timestamp[13] != ':' || !readNumber(timestamp, 14, 2, minute) ||
+            timestamp[16] != ':' || !readNumber(timestamp, 17, 2, second)) {
+        logInvalidRfc5424(timestamp);
+        return 0;
+    }
+    size_t pos = 19;
+    size_t fractionPos = pos;
+    if(pos < timestamp.size() && timestamp[pos] == '.') {
+        pos++;
+        while(pos < timestamp.size() && isDigit(timestamp[pos])) {
+            pos++;
         }
     }
-    // no last timestamp or year change
-    time_t currentTime = time(nullptr);
-    tm* const localTime = localtime(&currentTime);
-    stringstream ss;
-    auto currentYear = 1900 + localTime->tm_year;
-    ss << currentYear; // get current year
-    string year = ss.str();
-    m_storedTimestamp = timestamp;
-    m_storedYear = year;
-    return year;
+    size_t fractionLen = pos - fractionPos;
+    int offset = 0;
+    int offsetHour, offsetMinute;
+    if(pos + 1 == timestamp.size() && timestamp[pos] == 'Z') {
+        offset = 0;
+    } else if(pos + 6 == timestamp.size() && (timestamp[pos] == '+' || timestamp[pos] == '-') &&
+            readNumber(timestamp, pos + 1, 2, offsetHour) && timestamp[pos + 3] == ':' &&
+            readNumber(timestamp, pos + 4, 2, offsetMinute) && offsetHour < 24 && offsetMinute < 60) {
+        offset = (timestamp[pos] == '+' ? 1 : -1) * (offsetHour * 60 + offsetMinute);
+    } else {
+        logInvalidRfc5424(timestamp);
+        return 0;
+    }
+    if(fractionLen == 1 || fractionLen > TIMESTAMP_FRACTION_DIGITS_MAX + 1 || month < 1 || month > 12 ||
+            day < 1 || day > getDaysInMonth(year, month) || hour > 23 || minute > 59 || second > 60) {
+        logInvalidRfc5424(timestamp);
+        return 0;
+    }
+
+    // to UTC; the offset moves the date by one day at most
+    int minutes = hour * 60 + minute - offset;
+    if(minutes < 0) {
+        minutes += 24 * 60;
+        if(--day == 0) {
+            if(--month == 0) {
+                month = 12;
+                year--;
+            }
+            day = getDaysInMonth(year, month);
+        }
+    } else if(minutes >= 24 * 60) {
+        minutes -= 24 * 60;
+        if(++day > getDaysInMonth(year, month)) {
+            day = 1;
+            if(++month == 13) {
+                month = 1;
+                year++;
+            }
+        }
+    }
+    if(year < 0 || year > 9999) {
+        logInvalidRfc5424(timestamp);
+        return 0;
+    }
+
+    size_t len = 19 + fractionLen + 1;
+    if(len >= bufSize) {
+        SWSS_LOG_ERROR("Timestamp formatter unable to format into %zu bytes\n", bufSize);
+        return 0;
+    }
+    char* out = writeNumber(buf, year, 4);
+    *out++ = '-';
+    out = writeNumber(out, month, 2);
+    *out++ = '-';
+    out = writeNumber(out, day, 2);
+    *out++ = 'T';
+    out = writeNumber(out, minutes / 60, 2);
+    *out++ = ':';
+    out = writeNumber(out, minutes % 60, 2);
+    *out++ = ':';
+    out = writeNumber(out, second, 2);
+    memcpy(out, timestamp.data() + fractionPos, fractionLen);
+    out += fractionLen;
+    *out++ = 'Z';
+    *out = 0;
+    return len;
 }
 
 string TimestampFormatter::changeTimestampFormat(vector<string> dateComponents) {
@@ -53,22 +244,7 @@ string TimestampFormatter::changeTimestampFormat(vector<string> dateComponents)
         SWSS_LOG_ERROR("Timestamp formatter unable to format due to invalid input");
         return "";
     }
-    string formattedTimestamp; // need to change format of Mmm dd hh:mm:ss.SSSSSS to YYYY-mm-ddThh:mm:ss.SSSSSSZ
-    string month;
-    auto it = g_monthDict.find(dateComponents[0]);
-    if(it != g_monthDict.end()) {
-        month = it->second;
-    } else {
-        SWSS_LOG_ERROR("Timestamp month was given in wrong format.\n");
-        return "";
-    }
-    string day = dateComponents[1];
-    if(day.size() == 1) { // convert 1 -> 01
-       day.insert(day.begin(), '0');
-    }
-    string time = dateComponents[2];
-    string currentTimestamp = month + day + time;
-    string year = getYear(currentTimestamp);
-    formattedTimestamp = year + "-" + month + "-" + day + "T" + time + "Z";
-    return formattedTimestamp;
+    char formattedTimestamp[TIMESTAMP_BUFFER_SIZE];
+    size_t len = formatTimestamp(dateComponents[0], dateComponents[1], dateComponents[2], formattedTimestamp, sizeof(formattedTimestamp));
+    return string(formattedTimestamp, len);
 }
@@ -3,25 +3,54 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <regex>
 #include <ctime>
 #include <vector>
 
 using namespace std;
 
+/* Fits YYYY-mm-ddThh:mm:ss with up to 9 fraction digits and Z, with room to spare */
+#define TIMESTAMP_BUFFER_SIZE 64
+
+/* Max digits of second fractions taken from the input */
+#define TIMESTAMP_FRACTION_DIGITS_MAX 9
+
+/* An invalid RFC 5424 timestamp is logged at most once in this period; the others are counted */
+#define TIMESTAMP_INVALID_LOG_INTERVAL_SECS 60
+
+/* Timestamp syslog messages are prefixed with */
+enum TimestampFormat {
+    TIMESTAMP_FORMAT_TRADITIONAL, // Mmm dd hh:mm:ss.SSSSSS, w/o year
+    TIMESTAMP_FORMAT_RFC5424      // YYYY-mm-ddThh:mm:ss.SSSSSS+hh:mm, up to 9 fraction digits
+};
+
 /***
  *
  * TimestampFormatter is responsible for formatting the timestamps received in syslog messages and to format them into the type needed by YANG model
  *
+ * formatTimestamp & formatRfc5424Timestamp write into a buffer of the caller and do not allocate.
+ * The year of traditional timestamps is the one last seen, unless the timestamp goes back,
+ * as at year rollover; the current year is then read at most once a second.
+ * Invalid RFC 5424 timestamps fall back to no timestamp, and are logged rate limited.
+ *
  */
 
 class TimestampFormatter {
 public:
     string changeTimestampFormat(vector<string> dateComponents);
+    size_t formatTimestamp(string_view month, string_view day, string_view time, char* buf, size_t bufSize);
+    size_t formatRfc5424Timestamp(string_view timestamp, char* buf, size_t bufSize) const;
     string m_storedTimestamp;
     string m_storedYear;
+    TimestampFormatter();
 private:
-    string getYear(string timestamp);
+    time_t m_yearCheckTime; // second the current year was last read
+    int m_currentYear;
+    string_view getYear(string_view timestamp);
+    mutable time_t m_invalidLogTime; // invalid RFC 5424 timestamp last logged
+    mutable uint64_t m_invalidCnt; // invalid RFC 5424 timestamps not logged since
+    void logInvalidRfc5424(string_view timestamp) const;
 };
 
 #endif
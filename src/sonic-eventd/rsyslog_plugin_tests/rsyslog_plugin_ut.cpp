@@ -8,12 +8,17 @@ extern "C"
 #include <fstream>
 #include <memory>
 #include <regex>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <cstring>
 #include "gtest/gtest.h"
 #include "json.hpp"
 #include "events.h"
 #include "../rsyslog_plugin/rsyslog_plugin.h"
 #include "../rsyslog_plugin/syslog_parser.h"
 #include "../rsyslog_plugin/timestamp_formatter.h"
+#include "../rsyslog_plugin/literal_matcher.h"
 
 using namespace std;
 using namespace swss;
@@ -208,6 +213,77 @@ TEST(syslog_parser, lua_code_valid_2) {
     lua_close(luaState);
 }
 
+TEST(syslog_parser, lua_code_compiled) {
+    vector<string> params = { "is-sent", "is-received" };
+    vector<string> luaCodes = { "ret=tostring(arg==\"sent\")", "ret=tostring(arg==\"received\"" };
+
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    parser->addRegex("test_tag", "NOTIFICATION: (sent|received) (sent|received) .*", createEventParams(params, luaCodes));
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+
+    for(int i = 0; i < 3; i++) {
+        string tag;
+        event_params_t paramDict;
+        bool success = parser->parseMessage("NOTIFICATION: sent received to neighbor", tag, paramDict, luaState);
+        EXPECT_EQ(true, success);
+        EXPECT_EQ("true", paramDict["is-sent"]);
+        EXPECT_EQ("received", paramDict["is-received"]); // invalid lua code leaves the value as is
+    }
+    const EventParam& valid = parser->m_regexList[0].params[TIMESTAMP_PARAMS_CNT];
+    const EventParam& invalid = parser->m_regexList[0].params[TIMESTAMP_PARAMS_CNT + 1];
+    EXPECT_NE(LUA_NOREF, valid.luaRef);
+    EXPECT_NE(LUA_REFNIL, valid.luaRef);
+    EXPECT_EQ(LUA_REFNIL, invalid.luaRef);
+    EXPECT_EQ(3, valid.luaCalls);
+    EXPECT_EQ(0, valid.luaErrors);
+    EXPECT_EQ(0, valid.luaNoResult);
+    EXPECT_EQ(3, invalid.luaCalls);
+    EXPECT_EQ(3, invalid.luaErrors);
+    lua_close(luaState);
+
+    // a new state gets the lua code compiled again
+    luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    string tag;
+    event_params_t paramDict;
+    EXPECT_EQ(true, parser->parseMessage("NOTIFICATION: received sent from neighbor", tag, paramDict, luaState));
+    EXPECT_EQ("false", paramDict["is-sent"]);
+    EXPECT_EQ(0, parser->m_regexList[0].params[TIMESTAMP_PARAMS_CNT].luaErrors);
+    lua_close(luaState);
+}
+
+TEST(syslog_parser, lua_code_no_result) {
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    parser->addRegex("test_tag", "NOTIFICATION: (sent|received) .*", createEventParams({ "is-sent" }, { "if arg == \"sent\" then ret = \"yes\" end" }));
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    string tag;
+    event_params_t paramDict;
+
+    EXPECT_EQ(true, parser->parseMessage("NOTIFICATION: sent to neighbor", tag, paramDict, luaState));
+    EXPECT_EQ("yes", paramDict["is-sent"]);
+
+    // ret of the previous call is not taken
+    paramDict.clear();
+    EXPECT_EQ(true, parser->parseMessage("NOTIFICATION: received from neighbor", tag, paramDict, luaState));
+    EXPECT_EQ("received", paramDict["is-sent"]);
+    const EventParam& ep = parser->m_regexList[0].params[TIMESTAMP_PARAMS_CNT];
+    EXPECT_EQ(2, ep.luaCalls);
+    EXPECT_EQ(0, ep.luaErrors);
+    EXPECT_EQ(1, ep.luaNoResult);
+
+    // adding a rule recompiles into the same state, releasing the earlier ref
+    int ref = ep.luaRef;
+    parser->addRegex("other_tag", "LINK: (\\S+) down", createEventParams({ "link" }, { "" }));
+    paramDict.clear();
+    EXPECT_EQ(true, parser->parseMessage("NOTIFICATION: sent to neighbor", tag, paramDict, luaState));
+    EXPECT_EQ("yes", paramDict["is-sent"]);
+    EXPECT_EQ(ref, parser->m_regexList[0].params[TIMESTAMP_PARAMS_CNT].luaRef);
+
+    lua_close(luaState);
+}
+
 TEST(rsyslog_plugin, onInit_emptyJSON) {
     unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin("test_mod_name", "./rsyslog_plugin_tests/test_regex_1.rc.json"));
     EXPECT_NE(0, plugin->onInit());
@@ -253,6 +329,328 @@ TEST(rsyslog_plugin, onMessage_noParams) {
     infile.close();
 }
 
+TEST(rsyslog_plugin, run) {
+    const int repeatCnt = 50000;
+    const vector<string> lines = {
+        "Aug 17 02:39:21.286611 SN6-0101-0114-02T0 INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 100.126.188.90 Down Neighbor deleted",
+        "Aug 17 02:46:42.615668 SN6-0101-0114-02T0 INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 100.126.188.90 Up ",
+        "",
+        "Aug 17 04:46:51.290979 SN6-0101-0114-02T0 INFO bgp#bgpd[62]: %NOEVENT: no event"
+    };
+    unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin("test_mod_name", "./rsyslog_plugin_tests/test_regex_2.rc.json"));
+    EXPECT_EQ(0, plugin->onInit());
+
+    string input;
+    for(const auto& line : lines) {
+        input += line + "\n";
+    }
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    // written in odd sized chunks to split lines across reads; last line w/o newline
+    thread writer([&]() {
+        string data;
+        for(int i = 0; i < repeatCnt; i++) {
+            data += input;
+        }
+        data += lines[0];
+        for(size_t pos = 0; pos < data.size(); pos += 4099) {
+            size_t len = min((size_t)4099, data.size() - pos);
+            EXPECT_EQ((ssize_t)len, write(fds[1], data.data() + pos, len));
+        }
+        close(fds[1]);
+    });
+
+    auto start = chrono::steady_clock::now();
+    plugin->run(fds[0]);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    writer.join();
+    close(fds[0]);
+
+    const PluginStats& stats = plugin->getStats();
+    EXPECT_EQ((uint64_t)repeatCnt * 3 + 1, stats.linesIn);
+    EXPECT_EQ((uint64_t)repeatCnt * 2 + 1, stats.matched);
+    EXPECT_EQ(stats.matched, stats.published);
+    EXPECT_EQ(0, stats.publishFailed);
+    cout << "run: " << stats.linesIn << " lines, " << (uint64_t)(stats.linesIn / secs) << " lines/sec" << endl;
+}
+
+TEST(rsyslog_plugin, run_longLines) {
+    const string line = "Aug 17 02:39:21.286611 SN6-0101-0114-02T0 INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 100.126.188.90 Down Neighbor deleted";
+    unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin("test_mod_name", "./rsyslog_plugin_tests/test_regex_2.rc.json"));
+    EXPECT_EQ(0, plugin->onInit());
+
+    // a line the buffer grows for, then one cut at INPUT_LINE_MAX_SIZE
+    string data = string(2 * INPUT_BUFFER_SIZE, 'x') + "\n" + line + "\n" +
+        string(INPUT_LINE_MAX_SIZE + INPUT_BUFFER_SIZE, 'y') + "\n" + line + "\n";
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    thread writer([&]() {
+        for(size_t pos = 0; pos < data.size(); pos += INPUT_READ_SIZE) {
+            size_t len = min((size_t)INPUT_READ_SIZE, data.size() - pos);
+            EXPECT_EQ((ssize_t)len, write(fds[1], data.data() + pos, len));
+        }
+        close(fds[1]);
+    });
+    plugin->run(fds[0]);
+    writer.join();
+    close(fds[0]);
+
+    const PluginStats& stats = plugin->getStats();
+    EXPECT_EQ(4, stats.linesIn);
+    EXPECT_EQ(2, stats.matched);
+    EXPECT_EQ(1, stats.truncated);
+}
+
+// Throughput against the 50k lines/sec target, with 40 rules; run with
+// --gtest_also_run_disabled_tests --gtest_filter=rsyslog_plugin.DISABLED_runBenchmark
+TEST(rsyslog_plugin, DISABLED_runBenchmark) {
+    const uint64_t targetRate = 50000;
+    const int repeatCnt = 200000;
+    const vector<string> lines = {
+        "Aug 17 02:39:21.286611 SN6-0101-0114-02T0 INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 100.126.188.90 Down Neighbor deleted",
+        "Aug 17 02:46:42.615668 SN6-0101-0114-02T0 INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 100.126.188.90 Up ",
+        "Aug 17 04:46:51.290979 SN6-0101-0114-02T0 INFO sshd[123]: auth fail: Bad password for user admin from 10.1.1.1 port 22",
+        "Aug 17 04:46:51.290979 SN6-0101-0114-02T0 INFO bgp#bgpd[62]: %NOEVENT: no event"
+    };
+    unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin("test_mod_name", "./rsyslog_plugin_tests/test_regex_6.rc.json"));
+    EXPECT_EQ(0, plugin->onInit());
+
+    string data;
+    for(int i = 0; i < repeatCnt; i++) {
+        for(const auto& line : lines) {
+            data += line + "\n";
+        }
+    }
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    thread writer([&]() {
+        for(size_t pos = 0; pos < data.size(); pos += INPUT_READ_SIZE) {
+            size_t len = min((size_t)INPUT_READ_SIZE, data.size() - pos);
+            EXPECT_EQ((ssize_t)len, write(fds[1], data.data() + pos, len));
+        }
+        close(fds[1]);
+    });
+
+    auto start = chrono::steady_clock::now();
+    plugin->run(fds[0]);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    writer.join();
+    close(fds[0]);
+
+    const PluginStats& stats = plugin->getStats();
+    uint64_t rate = (uint64_t)(stats.linesIn / secs);
+    EXPECT_EQ((uint64_t)repeatCnt * lines.size(), stats.linesIn);
+    EXPECT_GE(rate, targetRate);
+    cout << "runBenchmark: " << stats.linesIn << " lines, " << stats.matched << " matched, " << rate << " lines/sec" << endl;
+}
+
+TEST(syslog_parser, literal_prefilter) {
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    string tag;
+    event_params_t paramDict;
+
+    parser->addRegex("tag_adj", ".* %ADJCHANGE: neighbor (.*) (Up|Down) .*", createEventParams({ "ip", "state" }, { "", "" }));
+    parser->addRegex("tag_alt", "link (\\S+) flap|port (\\S+) flap", createEventParams({ "link", "port" }, { "", "" }));
+    parser->addRegex("tag_any", "(.*) is (\\d+)", createEventParams({ "name", "value" }, { "", "" }));
+    parser->addRegex("tag_late", ".* %ADJCHANGE: neighbor (.*) Up", createEventParams({ "ip" }, { "" }));
+
+    EXPECT_TRUE(parser->parseMessage("Aug 17 02:46:42.615668 host INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 10.0.0.1 Up now", tag, paramDict, luaState));
+    EXPECT_EQ("tag_adj", tag);
+    EXPECT_EQ("10.0.0.1", paramDict["ip"]);
+    EXPECT_EQ("Up", paramDict["state"]);
+    EXPECT_FALSE(paramDict["timestamp"].empty());
+
+    // top level alternation is always tried
+    paramDict.clear();
+    EXPECT_TRUE(parser->parseMessage("Aug 17 02:46:42.615668 port Ethernet0 flap", tag, paramDict, luaState));
+    EXPECT_EQ("tag_alt", tag);
+    EXPECT_EQ("Ethernet0", paramDict["port"]);
+
+    // no literal long enough, hence always tried
+    paramDict.clear();
+    EXPECT_TRUE(parser->parseMessage("temperature is 42", tag, paramDict, luaState));
+    EXPECT_EQ("tag_any", tag);
+    EXPECT_EQ("42", paramDict["value"]);
+    EXPECT_EQ(0, paramDict.count("timestamp"));
+
+    // both have the literal, but only later one matches
+    paramDict.clear();
+    EXPECT_TRUE(parser->parseMessage("host %ADJCHANGE: neighbor 10.0.0.2 Up", tag, paramDict, luaState));
+    EXPECT_EQ("tag_late", tag);
+    EXPECT_EQ("10.0.0.2", paramDict["ip"]);
+
+    paramDict.clear();
+    EXPECT_FALSE(parser->parseMessage("Aug 17 02:46:42.615668 host INFO bgp#bgpd[62]: %NOEVENT: no event", tag, paramDict, luaState));
+
+    lua_close(luaState);
+}
+
+TEST(literalMatcher, match) {
+    LiteralMatcher matcher;
+    vector<char> found(4, 0);
+
+    matcher.addLiteral("he", 0);
+    matcher.addLiteral("she", 1);
+    matcher.addLiteral("his", 2);
+    matcher.addLiteral("hers", 3);
+    matcher.compile();
+
+    matcher.match("ushers", 6, found);
+    EXPECT_EQ(vector<char>({ 1, 1, 0, 1 }), found);
+
+    found.assign(4, 0);
+    matcher.match("this", 4, found);
+    EXPECT_EQ(vector<char>({ 0, 0, 1, 0 }), found);
+
+    found.assign(4, 0);
+    matcher.match("no match", 8, found);
+    EXPECT_EQ(vector<char>({ 0, 0, 0, 0 }), found);
+}
+
+static double replaySyslogs(SyslogParser* parser, const vector<string>& lines, int lineCnt, int& matchCnt) {
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    auto start = chrono::steady_clock::now();
+
+    matchCnt = 0;
+    for(int i = 0; i < lineCnt; i++) {
+        string tag;
+        event_params_t paramDict;
+        if(parser->parseMessage(lines[i % lines.size()], tag, paramDict, luaState)) {
+            matchCnt++;
+        }
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    lua_close(luaState);
+    return lineCnt / secs;
+}
+
+TEST(syslog_parser, match_counts) {
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    parser->addRegex("tag_adj", ".* %ADJCHANGE: neighbor (.*) (Up|Down) .*", createEventParams({ "ip", "state" }, { "", "" }));
+    parser->addRegex("tag_sshd", ".*sshd\\[\\d+\\]: auth fail: Bad password for user (\\S+) from (\\S+) .*", createEventParams({ "username", "ip" }, { "", "" }));
+    parser->addRegex("tag_disk", ".*monit\\[\\d+\\]: 'root-overlay' space usage (\\d+)\\.\\d+% matches resource limit.*", createEventParams({ "usage" }, { "" }));
+    parser->addRegex("tag_link", "link (\\S+) (up|down)", createEventParams({ "link", "state" }, { "", "" }));
+
+    unique_ptr<SyslogParser> sequentialParser(new SyslogParser());
+    sequentialParser->m_regexList = parser->m_regexList;
+    for(auto& rs : sequentialParser->m_regexList) {
+        rs.eventRegex.clear();
+    }
+
+    // message and the tag it is expected to match, empty for no match
+    const vector<pair<string, string>> messages = {
+        { "Aug 17 02:39:21.286611 host INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 100.126.188.90 Down Neighbor deleted", "tag_adj" },
+        { "Aug 17 02:46:42.615668 host INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 100.126.188.90 Up", "" },
+        { "Aug 17 04:46:51.290979 host sshd[123]: auth fail: Bad password for user admin from 10.1.1.1 port 22", "tag_sshd" },
+        { "Aug 17 04:46:51.290979 host monit[77]: 'root-overlay' space usage 91.2% matches resource limit [space usage>90.0%]", "tag_disk" },
+        { "Aug 17 04:46:51.290979 host INFO bgp#bgpd[62]: %NOEVENT: no event", "" },
+        { "link Ethernet0 down", "tag_link" },
+        { "Aug 17 04:46:51.290979 link Ethernet4 up", "tag_link" }
+    };
+    const int passes = 50;
+    vector<string> lines;
+    int expectedCnt = 0;
+    for(const auto& message : messages) {
+        lines.push_back(message.first);
+        expectedCnt += message.second.empty() ? 0 : 1;
+    }
+    ASSERT_EQ(5, expectedCnt);
+
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    for(const auto& message : messages) {
+        string tag, sequentialTag;
+        event_params_t paramDict, sequentialParamDict;
+        EXPECT_EQ(!message.second.empty(), parser->parseMessage(message.first, tag, paramDict, luaState)) << message.first;
+        EXPECT_EQ(!message.second.empty(), sequentialParser->parseMessage(message.first, sequentialTag, sequentialParamDict, luaState)) << message.first;
+        if(!message.second.empty()) {
+            EXPECT_EQ(message.second, tag);
+            EXPECT_EQ(message.second, sequentialTag);
+            EXPECT_EQ(sequentialParamDict, paramDict);
+        }
+    }
+    lua_close(luaState);
+
+    int matchCnt;
+    int sequentialMatchCnt;
+    replaySyslogs(parser.get(), lines, passes * (int)lines.size(), matchCnt);
+    replaySyslogs(sequentialParser.get(), lines, passes * (int)lines.size(), sequentialMatchCnt);
+    EXPECT_EQ(passes * expectedCnt, matchCnt);
+    EXPECT_EQ(passes * expectedCnt, sequentialMatchCnt);
+}
+
+// Throughput of the compiled rules against the sequential walk; run with
+// --gtest_also_run_disabled_tests --gtest_filter=syslog_parser.DISABLED_benchmark
+TEST(syslog_parser, DISABLED_benchmark) {
+    const int passes = 250000;
+    const int sequentialPasses = 500;
+    ifstream regexFile("./rsyslog_plugin_tests/test_regex_6.rc.json");
+    ifstream infile("./rsyslog_plugin_tests/test_syslogs.txt");
+    json jsonList = json::array();
+    vector<string> lines;
+    string line;
+    int matchCnt;
+    int sequentialMatchCnt;
+
+    regexFile >> jsonList;
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    for(long unsigned int i = 0; i < jsonList.size(); i++) {
+        vector<EventParam> eventParams;
+        vector<string> params = jsonList[i]["params"];
+        for(const string& param : params) {
+            EventParam ep = EventParam();
+            ep.paramName = param.substr(0, param.find(':'));
+            eventParams.push_back(ep);
+        }
+        parser->addRegex(jsonList[i]["tag"], jsonList[i]["regex"], eventParams);
+    }
+
+    // each rule tried in turn with the timestamp prefix, as before
+    unique_ptr<SyslogParser> sequentialParser(new SyslogParser());
+    sequentialParser->m_regexList = parser->m_regexList;
+    for(auto& rs : sequentialParser->m_regexList) {
+        rs.eventRegex.clear();
+    }
+
+    // quoted message followed by expected parse result
+    while(getline(infile, line)) {
+        size_t end = line.rfind('"');
+        if(line.empty() || end == 0 || end == string::npos) {
+            continue;
+        }
+        lines.push_back(line.substr(1, end - 1));
+    }
+    ASSERT_FALSE(lines.empty());
+
+    int passMatchCnt = 0;
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    for(const auto& message : lines) {
+        string tag, sequentialTag;
+        event_params_t paramDict, sequentialParamDict;
+        bool matched = parser->parseMessage(message, tag, paramDict, luaState);
+        passMatchCnt += matched ? 1 : 0;
+        EXPECT_EQ(sequentialParser->parseMessage(message, sequentialTag, sequentialParamDict, luaState), matched);
+        EXPECT_EQ(sequentialTag, tag);
+        EXPECT_EQ(sequentialParamDict, paramDict);
+    }
+    lua_close(luaState);
+
+    const int lineCnt = passes * (int)lines.size();
+    const int sequentialLineCnt = sequentialPasses * (int)lines.size();
+    double rate = replaySyslogs(parser.get(), lines, lineCnt, matchCnt);
+    printf("Compiled rules: %d lines with %d rules at %.0f lines/sec\n", lineCnt, (int)jsonList.size(), rate);
+
+    double sequentialRate = replaySyslogs(sequentialParser.get(), lines, sequentialLineCnt, sequentialMatchCnt);
+    printf("Sequential rules: %d lines with %d rules at %.0f lines/sec\n", sequentialLineCnt, (int)jsonList.size(), sequentialRate);
+
+    EXPECT_EQ(passes * passMatchCnt, matchCnt);
+    EXPECT_EQ(sequentialPasses * passMatchCnt, sequentialMatchCnt);
+}
+
 TEST(timestampFormatter, changeTimestampFormat) {
     unique_ptr<TimestampFormatter> formatter(new TimestampFormatter());
 
@@ -284,6 +682,118 @@ TEST(timestampFormatter, changeTimestampFormat) {
     EXPECT_EQ("2025-12-31T23:59:59.000000Z", formattedTimestampThree);
 }
 
+TEST(timestampFormatter, formatTimestamp) {
+    unique_ptr<TimestampFormatter> formatter(new TimestampFormatter());
+    char buf[TIMESTAMP_BUFFER_SIZE];
+
+    formatter->m_storedTimestamp = "010100:00:00.000000";
+    formatter->m_storedYear = g_stored_year;
+    size_t len = formatter->formatTimestamp("Jul", "2", "10:09:40.230874", buf, sizeof(buf));
+    EXPECT_EQ(g_stored_year + "-07-02T10:09:40.230874Z", string(buf, len));
+    EXPECT_EQ(len, strlen(buf));
+    EXPECT_EQ("070210:09:40.230874", formatter->m_storedTimestamp);
+
+    // too small buffer, invalid month & day
+    EXPECT_EQ(0, formatter->formatTimestamp("Jul", "2", "10:09:40.230874", buf, 20));
+    EXPECT_EQ(0, formatter->formatTimestamp("Jux", "2", "10:09:40.230874", buf, sizeof(buf)));
+    EXPECT_EQ(0, formatter->formatTimestamp("Jul", "x2", "10:09:40.230874", buf, sizeof(buf)));
+
+    // year rollover takes the current year
+    time_t currentTime = time(nullptr);
+    tm localTime;
+    localtime_r(&currentTime, &localTime);
+    string currentYear = to_string(1900 + localTime.tm_year);
+    formatter->m_storedTimestamp = "123123:59:59.000000";
+    formatter->m_storedYear = "1999";
+    len = formatter->formatTimestamp("Jan", "1", "00:00:01.000000", buf, sizeof(buf));
+    EXPECT_EQ(currentYear + "-01-01T00:00:01.000000Z", string(buf, len));
+    EXPECT_EQ(currentYear, formatter->m_storedYear);
+}
+
+TEST(timestampFormatter, formatRfc5424Timestamp) {
+    unique_ptr<TimestampFormatter> formatter(new TimestampFormatter());
+    char buf[TIMESTAMP_BUFFER_SIZE];
+    vector<pair<string, string>> timestamps = {
+        { "2024-07-20T10:09:40.230874Z", "2024-07-20T10:09:40.230874Z" },
+        { "2024-07-20T10:09:40Z", "2024-07-20T10:09:40Z" },
+        { "2024-07-20T10:09:40.123456789+05:30", "2024-07-20T04:39:40.123456789Z" },
+        { "2024-03-01T01:00:00.5+02:00", "2024-02-29T23:00:00.5Z" },
+        { "2023-12-31T23:30:00-01:00", "2024-01-01T00:30:00Z" },
+        { "2024-07-20T10:09:40.1234567890Z", "" },
+        { "2024-02-30T10:09:40Z", "" },
+        { "2024-07-20 10:09:40Z", "" },
+        { "2024-07-20T10:09:40+0530", "" },
+        { "2024-07-20T10:09:40.Z", "" }
+    };
+    for(const auto& timestamp : timestamps) {
+        size_t len = formatter->formatRfc5424Timestamp(timestamp.first, buf, sizeof(buf));
+        EXPECT_EQ(timestamp.second, string(buf, len)) << timestamp.first;
+    }
+}
+
+TEST(syslog_parser, rfc5424_timestamp) {
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    parser->m_timestampFormat = TIMESTAMP_FORMAT_RFC5424;
+    parser->addRegex("tag_adj", ".* %ADJCHANGE: neighbor (.*) (Up|Down) .*", createEventParams({ "ip", "state" }, { "", "" }));
+    parser->addRegex("tag_link", "link (\\S+) (up|down)", createEventParams({ "link", "state" }, { "", "" }));
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    string tag;
+    event_params_t paramDict;
+
+    EXPECT_TRUE(parser->parseMessage("2024-08-17T02:46:42.615668123+00:00 host INFO bgp#bgpd[62]: %ADJCHANGE: neighbor 10.0.0.1 Up now", tag, paramDict, luaState));
+    EXPECT_EQ("tag_adj", tag);
+    EXPECT_EQ("10.0.0.1", paramDict["ip"]);
+    EXPECT_EQ("2024-08-17T02:46:42.615668123Z", paramDict["timestamp"]);
+
+    paramDict.clear();
+    EXPECT_TRUE(parser->parseMessage("2024-08-17T02:46:42Z link Ethernet0 down", tag, paramDict, luaState));
+    EXPECT_EQ("tag_link", tag);
+    EXPECT_EQ("Ethernet0", paramDict["link"]);
+    EXPECT_EQ("2024-08-17T02:46:42Z", paramDict["timestamp"]);
+
+    // traditional timestamps are still taken
+    parser->m_timestampFormatter->m_storedTimestamp = "010100:00:00.000000";
+    parser->m_timestampFormatter->m_storedYear = g_stored_year;
+    paramDict.clear();
+    EXPECT_TRUE(parser->parseMessage("Aug 17 02:46:42.615668 link Ethernet4 up", tag, paramDict, luaState));
+    EXPECT_EQ("Ethernet4", paramDict["link"]);
+    EXPECT_EQ(g_stored_year + "-08-17T02:46:42.615668Z", paramDict["timestamp"]);
+
+    lua_close(luaState);
+}
+
+// run with --gtest_also_run_disabled_tests --gtest_filter=timestampFormatter.DISABLED_benchmark
+TEST(timestampFormatter, DISABLED_benchmark) {
+    const int cnt = 1000000;
+    unique_ptr<TimestampFormatter> formatter(new TimestampFormatter());
+    char buf[TIMESTAMP_BUFFER_SIZE];
+    vector<string> dateComponents = { "Jul", "20", "10:09:40.230874" };
+    size_t total = 0;
+
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < cnt; i++) {
+        total += formatter->formatTimestamp("Jul", "20", "10:09:40.230874", buf, sizeof(buf));
+    }
+    double formatNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / cnt;
+
+    start = chrono::steady_clock::now();
+    for(int i = 0; i < cnt; i++) {
+        total += formatter->formatRfc5424Timestamp("2024-07-20T10:09:40.230874+02:00", buf, sizeof(buf));
+    }
+    double rfc5424Ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / cnt;
+
+    start = chrono::steady_clock::now();
+    for(int i = 0; i < cnt; i++) {
+        total += formatter->changeTimestampFormat(dateComponents).size();
+    }
+    double changeNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / cnt;
+
+    EXPECT_EQ((size_t)cnt * 27 * 3, total);
+    cout << "formatTimestamp: " << formatNs << " ns, formatRfc5424Timestamp: " << rfc5424Ns
+        << " ns, changeTimestampFormat: " << changeNs << " ns" << endl;
+}
+
 int main(int argc, char* argv[]) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
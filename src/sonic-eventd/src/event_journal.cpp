@@ -0,0 +1,449 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <algorithm>
+#include "eventd.h"
+
+/*
+ * On-disk journal of events for replay across restarts of eventd
+ * & its subscribers. See event_journal in eventd.h
+ */
+
+using namespace std;
+
+#define JOURNAL_SEG_MAGIC 0x31304c4e524a5645ULL    /* "EVJRNL01" */
+#define JOURNAL_SEG_PREFIX "journal_"
+#define JOURNAL_SEG_SUFFIX ".seg"
+
+/* Max count of runtime ids tracked for sequence gaps */
+#define JOURNAL_RIDS_MAX 1024
+
+/* Min size of a segment & min count of segments in budget */
+#define JOURNAL_SEGMENT_BYTES_MIN (64 * 1024)
+#define JOURNAL_SEGMENTS_MIN 2
+
+event_journal::event_journal(const string &dir, size_t max_bytes,
+        size_t segment_bytes) :
+    m_dir(dir), m_seg_bytes(segment_bytes), m_segs_max(0), m_dropped(0)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (m_seg_bytes < JOURNAL_SEGMENT_BYTES_MIN) {
+        m_seg_bytes = JOURNAL_SEGMENT_BYTES_MIN;
+    }
+    m_seg_bytes = (m_seg_bytes + page - 1) & ~(page - 1);
+
+    m_segs_max = max_bytes / m_seg_bytes;
+    if (m_segs_max < JOURNAL_SEGMENTS_MIN) {
+        m_segs_max = JOURNAL_SEGMENTS_MIN;
+    }
+}
+
+
+uint32_t
+event_journal::checksum(const char *data, size_t len)
+{
+    /* FNV-1a; Only to detect torn records */
+    uint32_t h = 2166136261U;
+
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ (uint8_t)data[i]) * 16777619U;
+    }
+    return h;
+}
+
+
+string
+event_journal::seg_path(uint64_t id) const
+{
+    char name[64];
+
+    snprintf(name, sizeof(name), JOURNAL_SEG_PREFIX "%016lx" JOURNAL_SEG_SUFFIX,
+            (unsigned long)id);
+    return m_dir + "/" + name;
+}
+
+
+char *
+event_journal::map_segment(uint64_t id, bool create, size_t &size)
+{
+    char *base = NULL;
+    string path(seg_path(id));
+    struct stat st;
+    int fd;
+
+    fd = ::open(path.c_str(), O_RDWR | (create ? (O_CREAT | O_TRUNC) : 0), 0644);
+    RET_ON_ERR(fd >= 0, "Failed to open journal segment %s", path.c_str());
+
+    if (create) {
+        /*
+         * Reserve the blocks upfront. A write to mapped page of a sparse
+         * file on a full disk, would fault.
+         */
+        RET_ON_ERR(posix_fallocate(fd, 0, (off_t)m_seg_bytes) == 0,
+                "Failed to allocate %lu bytes for %s", m_seg_bytes, path.c_str());
+    }
+    RET_ON_ERR(fstat(fd, &st) == 0, "Failed to stat %s", path.c_str());
+    RET_ON_ERR((size_t)st.st_size > sizeof(seg_hdr_t), "Invalid size %ld of %s",
+            (long)st.st_size, path.c_str());
+    size = (size_t)st.st_size;
+
+    base = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        base = NULL;
+    }
+    RET_ON_ERR(base != NULL, "Failed to map %s", path.c_str());
+out:
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if ((base == NULL) && create) {
+        unlink(path.c_str());
+    }
+    return base;
+}
+
+
+void
+event_journal::load_segment(segment_t &seg)
+{
+    size_t offset = sizeof(seg_hdr_t);
+
+    while ((offset + sizeof(rec_hdr_t)) <= seg.size) {
+        const rec_hdr_t *hdr = (const rec_hdr_t *)(seg.base + offset);
+        const char *data = seg.base + offset + sizeof(rec_hdr_t);
+        runtime_id_t rid;
+        sequence_t seq;
+
+        if ((hdr->len == 0) || ((offset + rec_size(hdr->len)) > seg.size) ||
+                (checksum(data, hdr->len) != hdr->csum)) {
+            /* End of records or torn one */
+            break;
+        }
+        if (peek_event_header(data, hdr->len, rid, seq)) {
+            seg.index[rid].push_back(make_pair(seq, (uint32_t)offset));
+        }
+        offset += rec_size(hdr->len);
+        seg.cnt++;
+    }
+    seg.used = seg.synced = offset;
+}
+
+
+int
+event_journal::open()
+{
+    int ret = -1;
+    DIR *dir = NULL;
+    struct dirent *ent;
+    vector<uint64_t> ids;
+    size_t cnt = 0;
+
+    close();
+
+    lock_guard<mutex> lock(m_mutex);
+
+    RET_ON_ERR((mkdir(m_dir.c_str(), 0755) == 0) || (errno == EEXIST),
+            "Failed to create journal dir %s", m_dir.c_str());
+
+    dir = opendir(m_dir.c_str());
+    RET_ON_ERR(dir != NULL, "Failed to open journal dir %s", m_dir.c_str());
+
+    while ((ent = readdir(dir)) != NULL) {
+        unsigned long id;
+        char sfx[8] = "";
+
+        if ((sscanf(ent->d_name, JOURNAL_SEG_PREFIX "%16lx%7s", &id, sfx) == 2) &&
+                (strcmp(sfx, JOURNAL_SEG_SUFFIX) == 0)) {
+            ids.push_back(id);
+        }
+    }
+    sort(ids.begin(), ids.end());
+
+    for (const auto id : ids) {
+        segment_t seg;
+
+        seg.id = id;
+        seg.cnt = 0;
+        seg.base = map_segment(id, false, seg.size);
+        if ((seg.base != NULL) &&
+                (((seg_hdr_t *)seg.base)->magic == JOURNAL_SEG_MAGIC)) {
+            load_segment(seg);
+        }
+        if (seg.cnt == 0) {
+            /* Nothing to replay */
+            if (seg.base != NULL) {
+                munmap(seg.base, seg.size);
+            }
+            unlink(seg_path(id).c_str());
+            continue;
+        }
+        cnt += seg.cnt;
+        m_segs.push_back(move(seg));
+    }
+
+    if (!m_segs.empty() && (m_segs.back().size == m_seg_bytes)) {
+        /*
+         * Continue in newest segment. Clear any torn record & beyond,
+         * so the zero length marks the end again.
+         */
+        segment_t &seg = m_segs.back();
+
+        memset(seg.base + seg.used, 0, seg.size - seg.used);
+        seg.synced = sizeof(seg_hdr_t);
+        while (m_segs.size() > m_segs_max) {
+            drop_oldest();
+        }
+    }
+    else {
+        /* Room for a new segment */
+        while (m_segs.size() >= m_segs_max) {
+            drop_oldest();
+        }
+        RET_ON_ERR(rotate() == 0, "Failed to create journal segment");
+    }
+
+    SWSS_LOG_NOTICE("Journal %s opened with %lu events in %lu segments",
+            m_dir.c_str(), cnt, m_segs.size());
+    ret = 0;
+out:
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    return ret;
+}
+
+
+void
+event_journal::close()
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    while (!m_segs.empty()) {
+        segment_t &seg = m_segs.front();
+
+        sync_segment(seg);
+        munmap(seg.base, seg.size);
+        m_segs.pop_front();
+    }
+}
+
+
+void
+event_journal::sync_segment(segment_t &seg)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = seg.synced & ~(page - 1);
+
+    if (seg.synced < seg.used) {
+        if (msync(seg.base + start, seg.used - start, MS_SYNC) != 0) {
+            SWSS_LOG_ERROR("Failed to sync journal segment %lu errno=%d",
+                    (unsigned long)seg.id, errno);
+        }
+        seg.synced = seg.used;
+    }
+}
+
+
+void
+event_journal::drop_oldest()
+{
+    segment_t &seg = m_segs.front();
+
+    munmap(seg.base, seg.size);
+    unlink(seg_path(seg.id).c_str());
+    m_segs.pop_front();
+}
+
+
+int
+event_journal::rotate()
+{
+    int ret = -1;
+    segment_t seg;
+    seg_hdr_t *hdr;
+
+    if (!m_segs.empty()) {
+        sync_segment(m_segs.back());
+    }
+
+    seg.id = m_segs.empty() ? 1 : m_segs.back().id + 1;
+    seg.base = map_segment(seg.id, true, seg.size);
+    RET_ON_ERR(seg.base != NULL, "Failed to create journal segment %lu",
+            (unsigned long)seg.id);
+
+    hdr = (seg_hdr_t *)seg.base;
+    hdr->magic = JOURNAL_SEG_MAGIC;
+    hdr->id = seg.id;
+    seg.used = sizeof(seg_hdr_t);
+    seg.synced = 0;
+    seg.cnt = 0;
+    m_segs.push_back(move(seg));
+
+    while (m_segs.size() > m_segs_max) {
+        drop_oldest();
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+
+int
+event_journal::append(const runtime_id_t &rid, sequence_t seq,
+        const char *data, size_t len)
+{
+    size_t rec_sz = rec_size(len);
+    rec_hdr_t *hdr;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    {
+        /* A gap in sequence implies events missed upstream */
+        unordered_map<runtime_id_t, sequence_t>::iterator it = m_last_seq.find(rid);
+
+        if (it == m_last_seq.end()) {
+            if (m_last_seq.size() >= JOURNAL_RIDS_MAX) {
+                /* Bound the memory; Gaps are counted from next event */
+                m_last_seq.clear();
+            }
+            m_last_seq[rid] = seq;
+        }
+        else if (seq > it->second) {
+            m_dropped += seq - it->second - 1;
+            it->second = seq;
+        }
+    }
+
+    if (m_segs.empty() || (len == 0) ||
+            (rec_sz > (m_seg_bytes - sizeof(seg_hdr_t)))) {
+        m_dropped++;
+        return -1;
+    }
+    if ((m_segs.back().used + rec_sz) > m_segs.back().size) {
+        if (rotate() != 0) {
+            m_dropped++;
+            return -1;
+        }
+    }
+
+    segment_t &seg = m_segs.back();
+
+    /* Length last; Zero length implies end of records */
+    hdr = (rec_hdr_t *)(seg.base + seg.used);
+    memcpy(seg.base + seg.used + sizeof(rec_hdr_t), data, len);
+    hdr->csum = checksum(data, len);
+    hdr->len = (uint32_t)len;
+
+    seg.index[rid].push_back(make_pair(seq, (uint32_t)seg.used));
+    seg.used += rec_sz;
+    seg.cnt++;
+    return 0;
+}
+
+
+int
+event_journal::sync()
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (!m_segs.empty()) {
+        sync_segment(m_segs.back());
+    }
+    return 0;
+}
+
+
+bool
+event_journal::find_after(const runtime_id_t &rid, sequence_t seq,
+        size_t &seg_idx, size_t &offset) const
+{
+    seg_idx = 0;
+    offset = sizeof(seg_hdr_t);
+
+    if (rid.empty()) {
+        return true;
+    }
+
+    /* Most likely in newest */
+    for (size_t i = m_segs.size(); i-- > 0;) {
+        const segment_t &seg = m_segs[i];
+        const auto itc = seg.index.find(rid);
+
+        if (itc == seg.index.end()) {
+            continue;
+        }
+        const seq_offsets_t &lst = itc->second;
+        seq_offsets_t::const_iterator it = upper_bound(lst.begin(), lst.end(),
+                make_pair(seq, UINT32_MAX));
+
+        if (it != lst.begin()) {
+            /* Last one at or before the given sequence */
+            --it;
+            seg_idx = i;
+            offset = it->second + rec_size(((rec_hdr_t *)(seg.base + it->second))->len);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+int
+event_journal::read_from(const runtime_id_t &rid, sequence_t seq, size_t max_bytes,
+        event_serialized_lst_t &lst) const
+{
+    size_t seg_idx, offset;
+    size_t bytes = 0;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    if (!find_after(rid, seq, seg_idx, offset)) {
+        SWSS_LOG_INFO("Journal has no event of %s seq=%u; Read from oldest",
+                rid.c_str(), seq);
+    }
+
+    for (; (seg_idx < m_segs.size()) && (bytes < max_bytes); ++seg_idx) {
+        const segment_t &seg = m_segs[seg_idx];
+
+        for (; (offset < seg.used) && (bytes < max_bytes);) {
+            const rec_hdr_t *hdr = (const rec_hdr_t *)(seg.base + offset);
+
+            lst.push_back(event_serialized_t(seg.base + offset + sizeof(rec_hdr_t),
+                        hdr->len));
+            bytes += hdr->len;
+            offset += rec_size(hdr->len);
+        }
+        offset = sizeof(seg_hdr_t);
+    }
+    return 0;
+}
+
+
+size_t
+event_journal::size() const
+{
+    size_t cnt = 0;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    for (const auto &seg : m_segs) {
+        cnt += seg.cnt;
+    }
+    return cnt;
+}
+
+
+size_t
+event_journal::bytes_used() const
+{
+    size_t bytes = 0;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    for (const auto &seg : m_segs) {
+        bytes += seg.size;
+    }
+    return bytes;
+}
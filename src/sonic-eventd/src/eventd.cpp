@@ -1,9 +1,11 @@
 #include <thread>
+#include <fstream>
+#include <sys/mman.h>
 #include "eventd.h"
 #include "dbconnector.h"
 
 /*
- * There are 5 threads, including the main
+ * There are 7 threads, including the main
  *
  * (0) main thread -- Runs eventd service that accepts commands event_req_type_t
  *  This can be used to control caching events and a no-op echo service.
@@ -20,38 +22,65 @@
  *
  * (4) Thread to update counters from memory to redis periodically.
  *
+ * (5) Optional journal service, that writes all events to disk, for
+ *     replay across restarts.
+ *
+ * (6) Storm publisher, that publishes summaries of events suppressed by
+ *     proxy rate limits.
+ *
  */
 
 using namespace std;
 using namespace swss;
 
-#define MB(N) ((N) * 1024 * 1024)
-#define EVT_SIZE_AVG 150
+/* Size of each per-publisher last event slot in cache arena, including header */
+#define LAST_EVENT_SLOT_SIZE 2048
 
-#define MAX_CACHE_SIZE (MB(100) / (EVT_SIZE_AVG))
+/* Max share of cache arena for last event slots, as a divisor. */
+#define LAST_EVENT_SLOTS_SHARE 4
 
-/* Count of elements returned in each read */
-#define READ_SET_SIZE 100
+/* Bytes of events returned in each read, unless negotiated by client */
+#define READ_FRAME_BYTES_DEFAULT (1024 * 1024)
 
-#define VEC_SIZE(p) ((int)p.size())
+/* Max bytes of events returned in each read, as allowed for client */
+#define READ_FRAME_BYTES_MAX (16 * 1024 * 1024)
 
 /* Sock read timeout in milliseconds, to enable look for control signals */
 #define CAPTURE_SOCK_TIMEOUT 800
 
 #define HEARTBEAT_INTERVAL_SECS 2  /* Default: 2 seconds */
 
+/* Count of counters per source; published, dropped & suppressed */
+#define SOURCE_COUNTERS_CNT 3
+
 /* Source & tag for heartbeat events */
 #define EVENTD_PUBLISHER_SOURCE "sonic-events-eventd"
 #define EVENTD_HEARTBEAT_TAG "heartbeat"
+#define EVENTD_STORM_TAG "event-storm-suppressed"
 
 
 const char *counter_keys[COUNTERS_EVENTS_TOTAL] = {
     COUNTERS_EVENTS_PUBLISHED,
-    COUNTERS_EVENTS_MISSED_CACHE
+    COUNTERS_EVENTS_MISSED_CACHE,
+    COUNTERS_PROXY_MSGS_IN,
+    COUNTERS_PROXY_BYTES_IN,
+    COUNTERS_PROXY_MSGS_OUT,
+    COUNTERS_PROXY_BYTES_OUT,
+    COUNTERS_PROXY_SUPPRESSED
 };
 
 static bool s_unit_testing = false;
 
+/* eventd keys in init config, with defaults as string. */
+static map<string, string> s_eventd_cfg = {
+    { CACHE_MAX_BYTES, to_string(MAX_CACHE_BYTES_DEFAULT) },
+    { STATS_WRITE_INTERVAL_MS, to_string(STATS_WRITE_INTERVAL_MS_DEFAULT) },
+    { JOURNAL_DIR, "" },
+    { JOURNAL_MAX_BYTES, to_string(JOURNAL_MAX_BYTES_DEFAULT) },
+    { JOURNAL_SEGMENT_BYTES, to_string(JOURNAL_SEGMENT_BYTES_DEFAULT) },
+    { JOURNAL_SYNC_INTERVAL_MS, to_string(JOURNAL_SYNC_INTERVAL_MS_DEFAULT) },
+};
+
 int
 eventd_proxy::init()
 {
@@ -77,18 +106,437 @@ eventd_proxy::init()
     RET_ON_ERR(rc == 0, "Failing to bind capture PUB to %s", get_config(string(CAPTURE_END_KEY)).c_str());
 
     m_thr = thread(&eventd_proxy::run, this);
+    m_storm_thr = thread(&eventd_proxy::run_storm, this);
     ret = 0;
 out:
     return ret;
 }
 
+void
+event_rate_limiter::set_config(const rate_limit_config_t &cfg)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    m_pending_config = cfg;
+    m_updated = true;
+}
+
+
+rate_limit_config_t
+event_rate_limiter::get_config() const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    return m_pending_config;
+}
+
+
+void
+event_rate_limiter::apply_config()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        m_config = m_pending_config;
+        m_updated = false;
+    }
+
+    m_enabled = (m_config.source.rate != 0) || (m_config.tag.rate != 0);
+    for (const auto &itc : m_config.overrides) {
+        m_enabled = m_enabled || (itc.second.rate != 0);
+    }
+
+    /* Restart all buckets with new limits */
+    init_table(m_source_buckets, m_config.source);
+    init_table(m_tag_buckets, m_config.tag);
+
+    SWSS_LOG_NOTICE("Rate limits applied: enabled=%d source=%u/%u tag=%u/%u overrides=%d",
+            m_enabled, m_config.source.rate, m_config.source.burst,
+            m_config.tag.rate, m_config.tag.burst, (int)m_config.overrides.size());
+}
+
+
+bool
+event_rate_limiter::enabled()
+{
+    if (m_updated) {
+        apply_config();
+    }
+    return m_enabled;
+}
+
+
+void
+event_rate_limiter::init_table(bucket_table_t &table, const rate_limit_t &def_limit)
+{
+    table.buckets.clear();
+    table.overflow.limit = def_limit;
+    table.overflow.tokens = def_limit.burst;
+    table.overflow.last_ms = 0;
+    table.sweep_ms = 0;
+}
+
+
+void
+event_rate_limiter::refill(bucket_t &bucket, uint64_t now_ms)
+{
+    if ((bucket.limit.rate != 0) && (now_ms > bucket.last_ms)) {
+        bucket.tokens = min((double)bucket.limit.burst, bucket.tokens +
+                (((double)(now_ms - bucket.last_ms) * bucket.limit.rate) / 1000));
+        bucket.last_ms = now_ms;
+    }
+}
+
+
+bool
+event_rate_limiter::evict_idle(bucket_table_t &table, uint64_t now_ms)
+{
+    size_t cnt = table.buckets.size();
+
+    if ((table.sweep_ms != 0) && (now_ms < table.sweep_ms + RATE_LIMIT_SWEEP_MS)) {
+        return false;
+    }
+    table.sweep_ms = now_ms;
+
+    for (auto it = table.buckets.begin(); it != table.buckets.end(); ) {
+        refill(it->second, now_ms);
+        if ((it->second.limit.rate == 0) ||
+                (it->second.tokens >= it->second.limit.burst)) {
+            /* A new bucket would start the same */
+            it = table.buckets.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    return table.buckets.size() < cnt;
+}
+
+
+event_rate_limiter::bucket_t &
+event_rate_limiter::get_bucket(bucket_table_t &table, const string &key,
+        const rate_limit_t &def_limit, uint64_t now_ms)
+{
+    unordered_map<string, bucket_t>::iterator it = table.buckets.find(key);
+
+    if (it == table.buckets.end()) {
+        bucket_t bucket;
+        map<string, rate_limit_t>::const_iterator itc = m_config.overrides.find(key);
+
+        if ((itc == m_config.overrides.end()) &&
+                (table.buckets.size() >= RATE_LIMIT_BUCKETS_MAX) &&
+                !evict_idle(table, now_ms)) {
+            /* Bound the memory; Active buckets are kept as is */
+            refill(table.overflow, now_ms);
+            return table.overflow;
+        }
+        bucket.limit = (itc != m_config.overrides.end()) ? itc->second : def_limit;
+        bucket.tokens = bucket.limit.burst;
+        bucket.last_ms = now_ms;
+        it = table.buckets.emplace(key, bucket).first;
+    }
+    else {
+        refill(it->second, now_ms);
+    }
+    return it->second;
+}
+
+
+bool
+event_rate_limiter::allow(const string &key, uint64_t now_ms)
+{
+    if (!enabled()) {
+        return true;
+    }
+
+    m_source_key.assign(key, 0, key.find(':'));
+
+    bucket_t &src = get_bucket(m_source_buckets, m_source_key,
+            m_config.source, now_ms);
+    bucket_t &tag = get_bucket(m_tag_buckets, key, m_config.tag, now_ms);
+
+    if (((src.limit.rate != 0) && (src.tokens < 1)) ||
+            ((tag.limit.rate != 0) && (tag.tokens < 1))) {
+        ++m_suppressed[key];
+        return false;
+    }
+    if (src.limit.rate != 0) {
+        src.tokens -= 1;
+    }
+    if (tag.limit.rate != 0) {
+        tag.tokens -= 1;
+    }
+    return true;
+}
+
+
+void
+event_rate_limiter::read_suppressed(map<string, counters_t> &lst)
+{
+    lst.clear();
+    lst.swap(m_suppressed);
+}
+
+
+int
+eventd_proxy::send_part(void *dst, zmq_msg_t *msg, bool more)
+{
+    zmq_msg_t cap_msg;
+    int rc;
+
+    /* Capture gets a copy of every part, as with zmq_proxy */
+    zmq_msg_init(&cap_msg);
+    if (zmq_msg_copy(&cap_msg, msg) == 0) {
+        zmq_msg_send(&cap_msg, m_capture, more ? ZMQ_SNDMORE : 0);
+    }
+    zmq_msg_close(&cap_msg);
+
+    /* zmq_msg_send returns bytes sent, as msg is emptied upon send */
+    rc = zmq_msg_send(msg, dst, more ? ZMQ_SNDMORE : 0);
+    return (rc < 0) ? -1 : rc;
+}
+
+
+int
+eventd_proxy::forward(void *src, void *dst, zmq_msg_t *msg, counters_t &bytes_in,
+        counters_t &bytes_out)
+{
+    int more = 0;
+    int sent;
+
+    do {
+        if (zmq_msg_recv(msg, src, 0) < 0) {
+            return -1;
+        }
+        more = zmq_msg_more(msg);
+        bytes_in += zmq_msg_size(msg);
+
+        if ((sent = send_part(dst, msg, more)) < 0) {
+            return -1;
+        }
+        bytes_out += sent;
+    } while (more);
+
+    return 0;
+}
+
+
+int
+eventd_proxy::forward_event(zmq_msg_t *msg_src, zmq_msg_t *msg_evt)
+{
+    counters_t bytes = 0, bytes_out = 0;
+    int sent;
+    bool more;
+
+    if (zmq_msg_recv(msg_src, m_frontend, 0) < 0) {
+        return -1;
+    }
+    bytes = zmq_msg_size(msg_src);
+
+    if (zmq_msg_more(msg_src)) {
+        /* Part 2: Serialized event */
+        if (zmq_msg_recv(msg_evt, m_frontend, 0) < 0) {
+            return -1;
+        }
+        bytes += zmq_msg_size(msg_evt);
+        more = zmq_msg_more(msg_evt);
+
+        if (m_stats_instance != NULL) {
+            m_stats_instance->increment(INDEX_COUNTERS_PROXY_MSGS_IN, 1);
+            m_stats_instance->increment(INDEX_COUNTERS_PROXY_BYTES_IN, bytes);
+        }
+
+        if (!more && m_limiter.enabled() &&
+                peek_event_key((const char *)zmq_msg_data(msg_evt),
+                    zmq_msg_size(msg_evt), m_event_key) &&
+                (m_event_key.compare(0, strlen(EVENTD_PUBLISHER_SOURCE ":"),
+                             EVENTD_PUBLISHER_SOURCE ":") != 0)) {
+            uint64_t now_ms = duration_cast<milliseconds>(
+                    steady_clock::now().time_since_epoch()).count();
+            bool allow = m_limiter.allow(m_event_key, now_ms);
+
+            summarize_storm(now_ms);
+            if (!allow) {
+                /* Dropped for all subscribers & capture */
+                if (m_stats_instance != NULL) {
+                    m_stats_instance->increment(INDEX_COUNTERS_PROXY_SUPPRESSED, 1);
+                }
+                return 0;
+            }
+        }
+
+        if ((sent = send_part(m_backend, msg_src, true)) < 0) {
+            return -1;
+        }
+        bytes_out += sent;
+        if ((sent = send_part(m_backend, msg_evt, more)) < 0) {
+            return -1;
+        }
+        bytes_out += sent;
+        if (more) {
+            /* Unexpected extra parts; Forwarded as is */
+            counters_t bytes_more = 0;
+            int rc = forward(m_frontend, m_backend, msg_evt, bytes_more, bytes_out);
+
+            if (m_stats_instance != NULL) {
+                m_stats_instance->increment(INDEX_COUNTERS_PROXY_BYTES_IN, bytes_more);
+            }
+            if (rc != 0) {
+                return -1;
+            }
+        }
+    }
+    else {
+        /* Not an event; Forward as is */
+        if (m_stats_instance != NULL) {
+            m_stats_instance->increment(INDEX_COUNTERS_PROXY_MSGS_IN, 1);
+            m_stats_instance->increment(INDEX_COUNTERS_PROXY_BYTES_IN, bytes);
+        }
+        if ((sent = send_part(m_backend, msg_src, false)) < 0) {
+            return -1;
+        }
+        bytes_out += sent;
+    }
+
+    /* Counted only when all parts are accepted by XPUB */
+    if (m_stats_instance != NULL) {
+        m_stats_instance->increment(INDEX_COUNTERS_PROXY_MSGS_OUT, 1);
+        m_stats_instance->increment(INDEX_COUNTERS_PROXY_BYTES_OUT, bytes_out);
+    }
+    return 0;
+}
+
+
+void
+eventd_proxy::summarize_storm(uint64_t now_ms)
+{
+    map<string, counters_t> lst;
+
+    if ((now_ms - m_storm_last_ms) < STORM_SUMMARY_INTERVAL_MS) {
+        return;
+    }
+    m_storm_last_ms = now_ms;
+
+    m_limiter.read_suppressed(lst);
+    if (lst.empty()) {
+        return;
+    }
+
+    for (const auto &itc : lst) {
+        SWSS_LOG_NOTICE("Event storm suppressed: %s count=%lu in last %d secs",
+                itc.first.c_str(), itc.second, STORM_SUMMARY_INTERVAL_MS / 1000);
+
+        if (m_stats_instance != NULL) {
+            m_stats_instance->increment_source_suppressed(
+                    itc.first.substr(0, itc.first.find(':')), itc.second);
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(m_storm_mutex);
+
+        /* Merge, in case storm thread is behind */
+        for (const auto &itc : lst) {
+            m_storm_pending[itc.first] += itc.second;
+        }
+    }
+    m_storm_cv.notify_one();
+}
+
+
+void
+eventd_proxy::run_storm()
+{
+    event_handle_t storm_pub = NULL;
+
+    while (true) {
+        map<string, counters_t> lst;
+
+        {
+            unique_lock<mutex> lock(m_storm_mutex);
+
+            m_storm_cv.wait(lock, [this] {
+                    return m_storm_stop || !m_storm_pending.empty(); });
+            if (m_storm_stop) {
+                break;
+            }
+            lst.swap(m_storm_pending);
+        }
+
+        if (storm_pub == NULL) {
+            storm_pub = events_init_publisher(EVENTD_PUBLISHER_SOURCE);
+            if (storm_pub == NULL) {
+                SWSS_LOG_ERROR("Failed to create publisher for storm events");
+                continue;
+            }
+        }
+
+        for (const auto &itc : lst) {
+            string source(itc.first.substr(0, itc.first.find(':')));
+            string tag(itc.first.substr(source.size() < itc.first.size() ?
+                        source.size() + 1 : source.size()));
+            event_params_t params = {
+                { "source", source },
+                { "tag", tag },
+                { "suppressed", to_string(itc.second) },
+                { "interval_secs", to_string(STORM_SUMMARY_INTERVAL_MS / 1000) }
+            };
+            int rc = event_publish(storm_pub, EVENTD_STORM_TAG, &params);
+
+            if (rc != 0) {
+                SWSS_LOG_ERROR("Failed to publish storm event rc=%d", rc);
+            }
+        }
+    }
+
+    if (storm_pub != NULL) {
+        events_deinit_publisher(storm_pub);
+    }
+}
+
+
 void
 eventd_proxy::run()
 {
+    zmq_msg_t msg, msg_evt;
+    zmq_pollitem_t items[] = {
+        { m_frontend, 0, ZMQ_POLLIN, 0 },
+        { m_backend, 0, ZMQ_POLLIN, 0 }
+    };
+    int rc;
+
     SWSS_LOG_INFO("Running xpub/xsub proxy");
 
-    /* runs forever until zmq context is terminated */
-    zmq_proxy(m_frontend, m_backend, m_capture);
+    zmq_msg_init(&msg);
+    zmq_msg_init(&msg_evt);
+
+    /*
+     * runs forever until zmq context is terminated
+     * While rate limiting, wake up periodically to summarize storms.
+     */
+    while ((rc = zmq_poll(items, (int)ARRAY_SIZE(items),
+                    m_limiter.enabled() ? STORM_SUMMARY_INTERVAL_MS : -1)) >= 0) {
+        if (rc == 0) {
+            summarize_storm(duration_cast<milliseconds>(
+                        steady_clock::now().time_since_epoch()).count());
+            continue;
+        }
+        /* Events from publishers */
+        if ((items[0].revents & ZMQ_POLLIN) &&
+                (forward_event(&msg, &msg_evt) != 0)) {
+            break;
+        }
+        /* Subscriptions from subscribers */
+        if (items[1].revents & ZMQ_POLLIN) {
+            counters_t bytes_in = 0, bytes_out = 0;
+
+            if (forward(m_backend, m_frontend, &msg, bytes_in, bytes_out) != 0) {
+                break;
+            }
+        }
+    }
+    zmq_msg_close(&msg);
+    zmq_msg_close(&msg_evt);
 
     SWSS_LOG_INFO("Stopped xpub/xsub proxy");
 }
@@ -96,13 +544,152 @@ eventd_proxy::run()
 
 stats_collector::stats_collector() :
     m_shutdown(false), m_pause_heartbeat(false), m_heartbeats_published(0),
-    m_heartbeats_interval_cnt(0)
+    m_heartbeats_interval_cnt(0), m_write_interval_ms(STATS_WRITE_INTERVAL_MS_DEFAULT)
 {
     set_heartbeat_interval(HEARTBEAT_INTERVAL_SECS);
-    for (int i=0; i < COUNTERS_EVENTS_TOTAL; ++i) {
-        m_lst_counters[i] = 0;
+    for (int i=0; i < STATS_SHARDS_CNT; ++i) {
+        for (int j=0; j < COUNTERS_EVENTS_TOTAL; ++j) {
+            m_shards[i].counters[j] = 0;
+        }
+    }
+    for (int i=0; i < STATS_SOURCES_MAX; ++i) {
+        m_sources[i].published = 0;
+        m_sources[i].dropped = 0;
+        m_sources[i].suppressed = 0;
+    }
+    m_sources_cnt = 0;
+}
+
+
+int
+stats_collector::get_shard()
+{
+    static atomic<int> s_shards_assigned(0);
+    static thread_local int t_shard = -1;
+
+    if (t_shard < 0) {
+        t_shard = s_shards_assigned.fetch_add(1) % STATS_SHARDS_CNT;
+    }
+    return t_shard;
+}
+
+
+counters_t
+stats_collector::read_counter(stats_counter_index_t index) const
+{
+    counters_t val = 0;
+
+    if (index < COUNTERS_EVENTS_TOTAL) {
+        for (int i=0; i < STATS_SHARDS_CNT; ++i) {
+            val += m_shards[i].counters[index].load(memory_order_relaxed);
+        }
+    }
+    return val;
+}
+
+
+int
+stats_collector::find_source(const string &source) const
+{
+    lock_guard<mutex> lock(m_sources_mutex);
+    unordered_map<string, int>::const_iterator itc = m_sources_index.find(source);
+
+    return (itc != m_sources_index.end()) ? itc->second : -1;
+}
+
+
+int
+stats_collector::add_source(const string &source)
+{
+    lock_guard<mutex> lock(m_sources_mutex);
+    unordered_map<string, int>::const_iterator itc = m_sources_index.find(source);
+    int index;
+
+    if (itc != m_sources_index.end()) {
+        return itc->second;
+    }
+    index = m_sources_cnt.load(memory_order_relaxed);
+    if (index >= STATS_SOURCES_MAX) {
+        return -1;
+    }
+    m_sources[index].source = source;
+    m_sources_index[source] = index;
+
+    /* Publish the slot, after its name is set */
+    m_sources_cnt.store(index + 1, memory_order_release);
+    return index;
+}
+
+
+bool
+stats_collector::read_source_counters(const string &source, counters_t &published,
+        counters_t &dropped) const
+{
+    int i = find_source(source);
+
+    if (i < 0) {
+        return false;
+    }
+    published = m_sources[i].published.load(memory_order_relaxed);
+    dropped = m_sources[i].dropped.load(memory_order_relaxed);
+    return true;
+}
+
+
+counters_t
+stats_collector::read_source_suppressed(const string &source) const
+{
+    int i = find_source(source);
+
+    return i < 0 ? 0 : m_sources[i].suppressed.load(memory_order_relaxed);
+}
+
+
+void
+stats_collector::increment_source_suppressed(const string &source, counters_t val)
+{
+    int i = add_source(source);
+
+    if (i >= 0) {
+        m_sources[i].suppressed.fetch_add(val, memory_order_relaxed);
     }
-    m_updated = false;
+}
+
+
+void
+stats_collector::update_source_stats(const string &key, counters_t published,
+        counters_t dropped)
+{
+    int index;
+
+    m_collector_source.assign(key, 0, key.find(':'));
+
+    unordered_map<string, int>::const_iterator itc =
+        m_collector_index.find(m_collector_source);
+    if (itc != m_collector_index.end()) {
+        index = itc->second;
+    }
+    else {
+        index = add_source(m_collector_source);
+        if (index < 0) {
+            /* Not tracked; Still accounted in totals */
+            return;
+        }
+        m_collector_index[m_collector_source] = index;
+    }
+    m_sources[index].published.fetch_add(published, memory_order_relaxed);
+    m_sources[index].dropped.fetch_add(dropped, memory_order_relaxed);
+}
+
+
+void
+stats_collector::set_write_interval(int val)
+{
+    if (val > 0) {
+        m_write_interval_ms = val;
+    }
+    SWSS_LOG_INFO("Set stats write interval: val=%d ms final=%d ms", val,
+            m_write_interval_ms);
 }
 
 
@@ -152,10 +739,18 @@ stats_collector::start()
         }
         RET_ON_ERR(m_counters_db != NULL, "Failed to get COUNTERS_DB");
 
+        /* Buffered tables share a pipeline, to flush all in one write */
+        m_counters_pipeline = make_shared<swss::RedisPipeline>(m_counters_db.get());
+        RET_ON_ERR(m_counters_pipeline != NULL, "Failed to get COUNTERS_DB pipeline");
+
         m_stats_table = make_shared<swss::Table>(
-                m_counters_db.get(), COUNTERS_EVENTS_TABLE);
+                m_counters_pipeline.get(), COUNTERS_EVENTS_TABLE, true);
         RET_ON_ERR(m_stats_table != NULL, "Failed to get events table");
 
+        m_sources_table = make_shared<swss::Table>(
+                m_counters_pipeline.get(), COUNTERS_EVENTS_SOURCES_TABLE, true);
+        RET_ON_ERR(m_sources_table != NULL, "Failed to get events sources table");
+
         m_thr_writer = thread(&stats_collector::run_writer, this);
     }
     m_thr_collector = thread(&stats_collector::run_collector, this);
@@ -165,32 +760,85 @@ out:
 }
 
 void
-stats_collector::run_writer()
+stats_collector::write_counters(counters_t *last_counters, counters_t *last_sources,
+        bool force)
 {
-    while (true) {
-        if (m_updated.exchange(false)) {
-            /* Update if there had been any update */
+    bool updated = force;
+    int cnt = m_sources_cnt.load(memory_order_acquire);
+    counters_t vals[COUNTERS_EVENTS_TOTAL];
 
-            for (int i = 0; i < COUNTERS_EVENTS_TOTAL; ++i) {
-                vector<FieldValueTuple> fv;
+    for (int i = 0; i < COUNTERS_EVENTS_TOTAL; ++i) {
+        vals[i] = read_counter((stats_counter_index_t)i);
+        updated = updated || (vals[i] != last_counters[i]);
+    }
 
-                fv.emplace_back(EVENTS_STATS_FIELD_NAME, to_string(m_lst_counters[i]));
+    if (updated) {
+        /* Every key is written, including the ones at zero */
+        for (int i = 0; i < COUNTERS_EVENTS_TOTAL; ++i) {
+            vector<FieldValueTuple> fv;
 
-                m_stats_table->set(counter_keys[i], fv);
-            }
+            fv.emplace_back(EVENTS_STATS_FIELD_NAME, to_string(vals[i]));
+            m_stats_table->set(counter_keys[i], fv);
+            last_counters[i] = vals[i];
         }
+    }
+
+    for (int i = 0; i < cnt; ++i) {
+        counters_t *last = &last_sources[SOURCE_COUNTERS_CNT * i];
+        counters_t published = m_sources[i].published.load(memory_order_relaxed);
+        counters_t dropped = m_sources[i].dropped.load(memory_order_relaxed);
+        counters_t suppressed = m_sources[i].suppressed.load(memory_order_relaxed);
+
+        if ((published != last[0]) || (dropped != last[1]) || (suppressed != last[2])) {
+            vector<FieldValueTuple> fv;
+
+            fv.emplace_back(EVENTS_STATS_SOURCE_PUBLISHED, to_string(published));
+            fv.emplace_back(EVENTS_STATS_SOURCE_DROPPED, to_string(dropped));
+            fv.emplace_back(EVENTS_STATS_SOURCE_SUPPRESSED, to_string(suppressed));
+            m_sources_table->set(m_sources[i].source, fv);
+            last[0] = published;
+            last[1] = dropped;
+            last[2] = suppressed;
+            updated = true;
+        }
+    }
+
+    if (updated) {
+        /* All in one pipelined write */
+        m_counters_pipeline->flush();
+    }
+}
+
+
+void
+stats_collector::run_writer()
+{
+    counters_t last_counters[COUNTERS_EVENTS_TOTAL] = { 0 };
+    counters_t last_sources[SOURCE_COUNTERS_CNT * STATS_SOURCES_MAX] = { 0 };
+    bool force = true;
+
+    while (true) {
+        /* Write any update; All upon start, so every key exists */
+        write_counters(last_counters, last_sources, force);
+        force = false;
+
         if (m_shutdown) {
             break;
         }
-        this_thread::sleep_for(chrono::milliseconds(10));
         /*
          * After sleep always do an update if needed before checking
          * shutdown flag, as any counters collected during sleep
          * needs to be updated.
+         * Sleep in small steps to notice shutdown soon.
          */
+        for (int i = 0; (i < m_write_interval_ms) && !m_shutdown; i += 10) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
     }
 
     m_stats_table.reset();
+    m_sources_table.reset();
+    m_counters_pipeline.reset();
     m_counters_db.reset();
 }
 
@@ -245,6 +893,7 @@ stats_collector::run_collector()
         if ((rc == 0) && (op.key != hb_key)) {
             /* TODO: Discount EVENT_STR_CTRL_DEINIT messages too */
             increment_published(1+op.missed_cnt);
+            update_source_stats(op.key, 1+op.missed_cnt, op.missed_cnt);
 
             /* reset counter on receive to restart. */
             hb_cntr = 0;
@@ -253,7 +902,7 @@ stats_collector::run_collector()
             if (rc < 0) {
                 SWSS_LOG_ERROR(
                         "event_receive failed with rc=%d; stats:published(%lu)", rc,
-                        m_lst_counters[INDEX_COUNTERS_EVENTS_PUBLISHED]);
+                        read_counter(INDEX_COUNTERS_EVENTS_PUBLISHED));
             }
             if (!m_pause_heartbeat && (m_heartbeats_interval_cnt > 0) &&
                     ++hb_cntr >= m_heartbeats_interval_cnt) {
@@ -266,56 +915,570 @@ stats_collector::run_collector()
             }
         }
     }
-
-out:
-    /*
-     * NOTE: A shutdown could lose messages in cache.
-     * But consider, that eventd shutdown is a critical shutdown as it would
-     * bring down all other features. Hence done only at system level shutdown,
-     * hence losing few messages in flight is acceptable. Any more complex code
-     * to handle is unwanted.
-     */
-
-    events_deinit_subscriber(subs_handle);
-    events_deinit_publisher(pub_handle);
-    m_shutdown = true;
+
+out:
+    /*
+     * NOTE: A shutdown could lose messages in cache.
+     * But consider, that eventd shutdown is a critical shutdown as it would
+     * bring down all other features. Hence done only at system level shutdown,
+     * hence losing few messages in flight is acceptable. Any more complex code
+     * to handle is unwanted.
+     */
+
+    events_deinit_subscriber(subs_handle);
+    events_deinit_publisher(pub_handle);
+    m_shutdown = true;
+}
+
+event_cache_ring::event_cache_ring(size_t bytes_max, int cnt_max) :
+    m_bytes_max(bytes_max), m_cnt_max(cnt_max), m_arena(NULL), m_arena_sz(0),
+    m_slots(NULL), m_slots_max(0), m_ring(NULL), m_ring_sz(0), m_head(0),
+    m_tail(0), m_end(0), m_wrapped(false), m_cnt(0), m_missed(0)
+{}
+
+
+int
+event_cache_ring::init()
+{
+    int ret = -1;
+    size_t slots_sz;
+
+    release();
+    m_missed = 0;
+
+    RET_ON_ERR(m_bytes_max > sizeof(rec_hdr_t), "Invalid cache bytes max=%lu",
+            m_bytes_max);
+
+    /*
+     * mmap'd anonymous pages are backed only when written. Hence RSS grows
+     * with cached data, up to the cap.
+     */
+    m_arena = (char *)mmap(NULL, m_bytes_max, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (m_arena == MAP_FAILED) {
+        m_arena = NULL;
+    }
+    RET_ON_ERR(m_arena != NULL, "Failed to map cache arena of %lu bytes",
+            m_bytes_max);
+    m_arena_sz = m_bytes_max;
+
+    m_slots_max = (uint32_t)(m_arena_sz / LAST_EVENT_SLOTS_SHARE / LAST_EVENT_SLOT_SIZE);
+    if (m_slots_max > MAX_PUBLISHERS_COUNT) {
+        m_slots_max = MAX_PUBLISHERS_COUNT;
+    }
+    slots_sz = (size_t)m_slots_max * LAST_EVENT_SLOT_SIZE;
+
+    m_slots = m_arena;
+    m_ring = m_arena + slots_sz;
+    m_ring_sz = m_arena_sz - slots_sz;
+    ret = 0;
+out:
+    return ret;
+}
+
+
+void
+event_cache_ring::release()
+{
+    if (m_arena != NULL) {
+        munmap(m_arena, m_arena_sz);
+    }
+    m_arena = m_slots = m_ring = NULL;
+    m_arena_sz = m_ring_sz = 0;
+    m_slots_max = 0;
+    vector<runtime_id_t>().swap(m_slot_rids);
+    unordered_map<runtime_id_t, uint32_t>().swap(m_slot_index);
+    m_head = m_tail = m_end = 0;
+    m_wrapped = false;
+    m_cnt = 0;
+}
+
+
+size_t
+event_cache_ring::bytes_used() const
+{
+    if (m_cnt == 0) {
+        return 0;
+    }
+    return m_wrapped ? (m_end - m_head + m_tail) : (m_tail - m_head);
+}
+
+
+uint32_t
+event_cache_ring::get_slot(const runtime_id_t &rid)
+{
+    unordered_map<runtime_id_t, uint32_t>::const_iterator itc = m_slot_index.find(rid);
+
+    if (itc != m_slot_index.end()) {
+        return itc->second;
+    }
+    if (m_slot_rids.size() >= m_slots_max) {
+        /* Out of slots; Use an invalid one */
+        return UINT32_MAX;
+    }
+    uint32_t slot = (uint32_t)m_slot_rids.size();
+    m_slot_rids.push_back(rid);
+    m_slot_index[rid] = slot;
+    /* Mark slot as empty */
+    ((rec_hdr_t *)(m_slots + ((size_t)slot * LAST_EVENT_SLOT_SIZE)))->len = 0;
+    return slot;
+}
+
+
+int
+event_cache_ring::save_last(uint32_t slot, const char *data, size_t len)
+{
+    rec_hdr_t *hdr;
+    int missed = 0;
+
+    if ((slot >= m_slots_max) ||
+            ((sizeof(rec_hdr_t) + len) > LAST_EVENT_SLOT_SIZE)) {
+        /* No slot to save */
+        missed = 1;
+    }
+    else {
+        hdr = (rec_hdr_t *)(m_slots + ((size_t)slot * LAST_EVENT_SLOT_SIZE));
+        if (hdr->len != 0) {
+            /* Earlier event in slot is lost */
+            missed = 1;
+        }
+        hdr->len = (uint32_t)len;
+        hdr->slot = slot;
+        memcpy(hdr + 1, data, len);
+    }
+    m_missed += missed;
+    return missed;
+}
+
+
+int
+event_cache_ring::evict()
+{
+    const rec_hdr_t *hdr = rec_at(m_head);
+
+    int missed = save_last(hdr->slot, (const char *)(hdr + 1), hdr->len);
+    pop_front();
+    return missed;
+}
+
+
+bool
+event_cache_ring::reserve(size_t rec_sz, size_t &offset)
+{
+    if (m_cnt == 0) {
+        m_head = m_tail = m_end = 0;
+        m_wrapped = false;
+    }
+
+    if (!m_wrapped) {
+        if ((m_ring_sz - m_tail) >= rec_sz) {
+            offset = m_tail;
+            return true;
+        }
+        if (m_head >= rec_sz) {
+            /* Wrap to start, leaving the unused tail end */
+            m_end = m_tail;
+            m_wrapped = true;
+            offset = 0;
+            return true;
+        }
+    }
+    else if ((m_head - m_tail) >= rec_sz) {
+        offset = m_tail;
+        return true;
+    }
+    return false;
+}
+
+
+int
+event_cache_ring::push(const runtime_id_t &rid, const char *data, size_t len)
+{
+    size_t rec_sz = rec_size(len);
+    size_t offset = 0;
+    uint32_t slot;
+    int missed = 0;
+    rec_hdr_t *hdr;
+
+    if (m_ring == NULL) {
+        SWSS_LOG_ERROR("Cache arena is not initialized");
+        m_missed++;
+        return 1;
+    }
+
+    slot = get_slot(rid);
+
+    if (rec_sz > m_ring_sz) {
+        /* Can never fit in ring */
+        return save_last(slot, data, len);
+    }
+
+    while (((m_cnt_max > 0) && (m_cnt >= m_cnt_max)) || !reserve(rec_sz, offset)) {
+        missed += evict();
+    }
+
+    hdr = rec_at(offset);
+    hdr->len = (uint32_t)len;
+    hdr->slot = slot;
+    memcpy(hdr + 1, data, len);
+
+    m_tail = offset + rec_sz;
+    m_cnt++;
+    return missed;
+}
+
+
+bool
+event_cache_ring::front(const char *&data, size_t &len) const
+{
+    if (m_cnt == 0) {
+        return false;
+    }
+    const rec_hdr_t *hdr = rec_at(m_head);
+    data = (const char *)(hdr + 1);
+    len = hdr->len;
+    return true;
+}
+
+
+void
+event_cache_ring::pop_front()
+{
+    if (m_cnt == 0) {
+        return;
+    }
+    m_head += rec_size(rec_at(m_head)->len);
+    if (--m_cnt == 0) {
+        m_head = m_tail = m_end = 0;
+        m_wrapped = false;
+    }
+    else if (m_wrapped && (m_head >= m_end)) {
+        m_head = 0;
+        m_wrapped = false;
+    }
+}
+
+
+void
+event_cache_ring::read_last(last_events_t &lst)
+{
+    for (uint32_t slot = 0; slot < (uint32_t)m_slot_rids.size(); ++slot) {
+        rec_hdr_t *hdr = (rec_hdr_t *)(m_slots + ((size_t)slot * LAST_EVENT_SLOT_SIZE));
+
+        if (hdr->len != 0) {
+            lst[m_slot_rids[slot]] = string((const char *)(hdr + 1), hdr->len);
+            hdr->len = 0;
+        }
+    }
+}
+
+
+void
+event_cache_ring::swap(event_cache_ring &other)
+{
+    std::swap(m_bytes_max, other.m_bytes_max);
+    std::swap(m_cnt_max, other.m_cnt_max);
+    std::swap(m_arena, other.m_arena);
+    std::swap(m_arena_sz, other.m_arena_sz);
+    std::swap(m_slots, other.m_slots);
+    std::swap(m_slots_max, other.m_slots_max);
+    m_slot_rids.swap(other.m_slot_rids);
+    m_slot_index.swap(other.m_slot_index);
+    std::swap(m_ring, other.m_ring);
+    std::swap(m_ring_sz, other.m_ring_sz);
+    std::swap(m_head, other.m_head);
+    std::swap(m_tail, other.m_tail);
+    std::swap(m_end, other.m_end);
+    std::swap(m_wrapped, other.m_wrapped);
+    std::swap(m_cnt, other.m_cnt);
+    std::swap(m_missed, other.m_missed);
+}
+
+
+capture_service::~capture_service()
+{
+    stop_capture();
+}
+
+void
+capture_service::stop_capture()
+{
+    m_ctrl = STOP_CAPTURE;
+
+    if (m_thr.joinable()) {
+        m_thr.join();
+    }
+}
+
+/* Event data is a JSON object, as {"<source>:<tag>": {...}} */
+static bool
+validate_event_data(const char *data, size_t len)
+{
+    while ((len > 0) && isspace((unsigned char)data[len - 1])) {
+        --len;
+    }
+    while ((len > 0) && isspace((unsigned char)*data)) {
+        ++data;
+        --len;
+    }
+    return (len >= 2) && (data[0] == '{') && (data[len - 1] == '}');
+}
+
+
+static bool
+validate_event(const internal_event_t &event, runtime_id_t &rid, sequence_t &seq)
+{
+    bool ret = false;
+
+    internal_event_t::const_iterator itc_r, itc_s, itc_e;
+    itc_r = event.find(EVENT_RUNTIME_ID);
+    itc_s = event.find(EVENT_SEQUENCE);
+    itc_e = event.find(EVENT_STR_DATA);
+
+    if ((itc_r != event.end()) && (itc_s != event.end()) && (itc_e != event.end()) &&
+            validate_event_data(itc_e->second.data(), itc_e->second.size())) {
+        ret = true;
+        rid = itc_r->second;
+        seq = str_to_seq(itc_s->second);
+    }
+    else {
+        SWSS_LOG_ERROR("Invalid evt: %s", map_to_str(event).c_str());
+    }
+
+    return ret;
+}
+
+
+/* Read unsigned decimal followed by a space. */
+static bool
+peek_uint(const char *&p, const char *end, size_t &val)
+{
+    const char *st = p;
+
+    val = 0;
+    while ((p < end) && isdigit((unsigned char)*p)) {
+        val = (val * 10) + (*p - '0');
+        ++p;
+    }
+    if ((p == st) || (p >= end) || (*p != ' ')) {
+        return false;
+    }
+    ++p;
+    return true;
+}
+
+
+/* Skip the separator after a string; Only space or end of data is valid */
+static bool
+peek_sep(const char *&p, const char *end)
+{
+    if (p >= end) {
+        return true;
+    }
+    if (*p != ' ') {
+        return false;
+    }
+    ++p;
+    return true;
+}
+
+
+/* Read length prefixed string; Returns pointer into given data */
+static bool
+peek_str(const char *&p, const char *end, const char *&str, size_t &len)
+{
+    if (!peek_uint(p, end, len) || (len > (size_t)(end - p))) {
+        return false;
+    }
+    str = p;
+    p += len;
+    return peek_sep(p, end);
+}
+
+
+/*
+ * Peek runtime id & sequence from a serialized event, without a full
+ * deserialization.
+ *
+ * The event is a boost text archive of internal_event_t, like
+ *  22 serialization::archive 18 0 0 4 0 0 0 1 d 26 {...} 1 r 6 guid-1 1 s 3 105 ...
+ *
+ * The archive header is followed by a numeric preamble of versions &
+ * count and then the entries as length prefixed key & value strings.
+ * Values are skipped by length, so event data is never scanned.
+ *
+ * The whole of data is validated; The count of entries must match the
+ * count in preamble and the last entry must end the data, so a
+ * truncated or padded event is never cached.
+ *
+ * Only the fields asked for, i.e. non NULL, are required & returned.
+ * The event data is returned as pointer into given data.
+ *
+ * Returns false, if not in expected form; The caller may fall back to
+ * full deserialization.
+ */
+static bool
+peek_event_fields(const char *data, size_t len, runtime_id_t *rid, sequence_t *seq,
+        const char **evt_data, size_t *evt_len)
+{
+    const char *p = data, *end = data + len;
+    const char *str, *key;
+    size_t str_len, key_len = 0;
+    size_t entry_cnt = 0, entries = 0;
+    int preamble_cnt = 0;
+    bool has_data = false, has_rid = false, has_seq = false;
+
+    /* Archive header */
+    if (!peek_str(p, end, str, str_len)) {
+        return false;
+    }
+
+    /*
+     * Numeric preamble, as <version> <class info> <count> <item version>
+     * <item class info> ... The last number before first key is key's length.
+     */
+    while (true) {
+        if (!peek_uint(p, end, key_len) || (p >= end)) {
+            return false;
+        }
+        if (++preamble_cnt == 4) {
+            entry_cnt = key_len;
+        }
+        if (!isdigit((unsigned char)*p)) {
+            break;
+        }
+    }
+    if ((preamble_cnt < 5) || (key_len > (size_t)(end - p))) {
+        return false;
+    }
+    key = p;
+    p += key_len;
+    if (!peek_sep(p, end)) {
+        return false;
+    }
+
+    while (true) {
+        if (!peek_str(p, end, str, str_len)) {
+            return false;
+        }
+        ++entries;
+        if (key_len == 1) {
+            switch (*key) {
+            case EVENT_STR_DATA[0]:
+                if (!validate_event_data(str, str_len)) {
+                    return false;
+                }
+                if (evt_data != NULL) {
+                    *evt_data = str;
+                    *evt_len = str_len;
+                }
+                has_data = true;
+                break;
+
+            case EVENT_RUNTIME_ID[0]:
+                if (rid != NULL) {
+                    rid->assign(str, str_len);
+                }
+                has_rid = true;
+                break;
+
+            case EVENT_SEQUENCE[0]:
+                if (seq == NULL) {
+                    break;
+                }
+                if (str_len == 0) {
+                    return false;
+                }
+                *seq = 0;
+                for (size_t i = 0; i < str_len; ++i) {
+                    if (!isdigit((unsigned char)str[i])) {
+                        return false;
+                    }
+                    *seq = (*seq * 10) + (str[i] - '0');
+                }
+                has_seq = true;
+                break;
+
+            default:
+                break;
+            }
+        }
+        if (p >= end) {
+            break;
+        }
+        if (!peek_str(p, end, key, key_len)) {
+            return false;
+        }
+    }
+    if (entries != entry_cnt) {
+        return false;
+    }
+    return has_data && (has_rid || (rid == NULL)) && (has_seq || (seq == NULL));
 }
 
-capture_service::~capture_service()
+
+bool
+peek_event_header(const char *data, size_t len, runtime_id_t &rid, sequence_t &seq)
 {
-    stop_capture();
+    return peek_event_fields(data, len, &rid, &seq, NULL, NULL);
 }
 
-void
-capture_service::stop_capture()
+
+bool
+peek_event_key(const char *data, size_t len, string &key)
 {
-    m_ctrl = STOP_CAPTURE;
+    const char *evt_data, *st, *en;
+    size_t evt_len;
 
-    if (m_thr.joinable()) {
-        m_thr.join();
+    if (!peek_event_fields(data, len, NULL, NULL, &evt_data, &evt_len)) {
+        return false;
     }
-}
 
-static bool
-validate_event(const internal_event_t &event, runtime_id_t &rid, sequence_t &seq)
-{
-    bool ret = false;
+    /* Event data is JSON object with a single key, as {"<source>:<tag>": {...}} */
+    en = evt_data + evt_len;
+    st = (const char *)memchr(evt_data, '"', evt_len);
+    if ((st == NULL) || (++st >= en)) {
+        return false;
+    }
+    en = (const char *)memchr(st, '"', en - st);
+    if (en == NULL) {
+        return false;
+    }
+    key.assign(st, en - st);
+    return true;
+}
 
-    internal_event_t::const_iterator itc_r, itc_s, itc_e;
-    itc_r = event.find(EVENT_RUNTIME_ID);
-    itc_s = event.find(EVENT_SEQUENCE);
-    itc_e = event.find(EVENT_STR_DATA);
 
-    if ((itc_r != event.end()) && (itc_s != event.end()) && (itc_e != event.end())) {
-        ret = true;
-        rid = itc_r->second;
-        seq = str_to_seq(itc_s->second);
+/*
+ * Read an event from capture socket into given message.
+ *
+ * An event is two parts, source & the serialized event. Only the second
+ * part is retained in msg, as received, with no copy.
+ *
+ * The capture socket gets subscribe requests too, which are single part.
+ * Any message that is not two parts is reported as invalid.
+ */
+static int
+capture_read(void *sock, zmq_msg_t *msg)
+{
+    /* Part 1: Source */
+    if (zmq_msg_recv(msg, sock, 0) < 0) {
+        return zmq_errno();
     }
-    else {
-        SWSS_LOG_ERROR("Invalid evt: %s", map_to_str(event).c_str());
+    if (!zmq_msg_more(msg)) {
+        return ERR_MESSAGE_INVALID;
     }
 
-    return ret;
+    /* Part 2: Serialized event */
+    if (zmq_msg_recv(msg, sock, 0) < 0) {
+        return zmq_errno();
+    }
+    if (zmq_msg_more(msg)) {
+        /* Drain unexpected parts */
+        while (zmq_msg_more(msg) && (zmq_msg_recv(msg, sock, 0) >= 0));
+        return ERR_MESSAGE_INVALID;
+    }
+    return 0;
 }
 
 
@@ -340,7 +1503,7 @@ capture_service::init_capture_cache(const event_serialized_lst_t &lst)
 
             if (validate_event(event, rid, seq)) {
                 m_pre_exist_id[rid] = seq;
-                m_events.push_back(*itc);
+                m_events.push(rid, itc->data(), itc->size());
             }
         }
     }
@@ -354,7 +1517,7 @@ capture_service::do_capture()
     int block_ms=CAPTURE_SOCK_TIMEOUT;
     int init_cnt;
     void *cap_sub_sock = NULL;
-    counters_t total_overflow = 0;
+    zmq_msg_t msg;
 
     typedef enum {
         /*
@@ -363,15 +1526,14 @@ capture_service::do_capture()
          */
         CAP_STATE_INIT = 0,
 
-        /* In this state, all events read are cached until max limit */
-        CAP_STATE_ACTIVE,
-
-        /* Cache has hit max. Hence only save last event for each runime ID */
-        CAP_STATE_LAST
+        /* In this state, all events read are cached; Oldest evicted on overflow */
+        CAP_STATE_ACTIVE
     } cap_state_t;
 
     cap_state_t cap_state = CAP_STATE_INIT;
 
+    zmq_msg_init(&msg);
+
     /*
      * Need subscription for publishers to publish.
      * The stats collector service already has active subscriber for all.
@@ -409,30 +1571,38 @@ capture_service::do_capture()
      * Hence until as many events as in initial stock or until the cached id map
      * is empty, do this check.
      */
-    init_cnt = (int)m_events.size();
+    init_cnt = m_events.size();
 
     /* Read until STOP_CAPTURE */
     while(m_ctrl == START_CAPTURE) {
         runtime_id_t rid;
         sequence_t seq;
-        internal_event_t event;
-        string source, evt_str;
+        const char *evt_data;
+        size_t evt_len;
 
-        if ((rc = zmq_message_read(cap_sub_sock, 0, source, event)) != 0) {
+        if ((rc = capture_read(cap_sub_sock, &msg)) != 0) {
             /*
              * The capture socket captures SUBSCRIBE requests too.
              * The messge could contain subscribe filter strings and binary code.
-             * Empty string with binary code will fail to deserialize.
-             * Else would fail event validation.
              */
             RET_ON_ERR((rc == EAGAIN) || (rc == ERR_MESSAGE_INVALID),
                 "0:Failed to read from capture socket");
             continue;
         }
-        if (!validate_event(event, rid, seq)) {
-            continue;
+
+        /* Cache the event as received; Only peek for runtime id & sequence */
+        evt_data = (const char *)zmq_msg_data(&msg);
+        evt_len = zmq_msg_size(&msg);
+
+        if (!peek_event_header(evt_data, evt_len, rid, seq)) {
+            internal_event_t event;
+
+            /* Fall back to full deserialization */
+            if ((deserialize(string(evt_data, evt_len), event) != 0) ||
+                    !validate_event(event, rid, seq)) {
+                continue;
+            }
         }
-        serialize(event, evt_str);
 
         switch(cap_state) {
         case CAP_STATE_INIT:
@@ -459,7 +1629,7 @@ capture_service::do_capture()
                     }
                 }
                 if (add) {
-                    m_events.push_back(evt_str);
+                    cache_event(rid, evt_data, evt_len);
                 }
             }
             if(m_pre_exist_id.empty() || (init_cnt <= 0)) {
@@ -470,35 +1640,7 @@ capture_service::do_capture()
             break;
 
         case CAP_STATE_ACTIVE:
-            /* Save until max allowed */
-            try
-            {
-                m_events.push_back(evt_str);
-                if (VEC_SIZE(m_events) >= m_cache_max) {
-                    cap_state = CAP_STATE_LAST;
-                    /* Clear the map, created to ensure memory space available */
-                    m_last_events.clear();
-                    m_last_events_init = true;
-                }
-                break;
-            }
-            catch (bad_alloc& e)
-            {
-                stringstream ss;
-                ss << e.what();
-                SWSS_LOG_ERROR("Cache save event failed with %s events:size=%d",
-                        ss.str().c_str(), VEC_SIZE(m_events));
-                cap_state = CAP_STATE_LAST;
-                // fall through to save this event in last set.
-            }
-
-        case CAP_STATE_LAST:
-            total_overflow++;
-            m_last_events[rid] = evt_str;
-            if (total_overflow > m_last_events.size()) {
-                m_total_missed_cache++;
-                m_stats_instance->increment_missed_cache(1);
-            }
+            cache_event(rid, evt_data, evt_len);
             break;
         }
     }
@@ -508,12 +1650,25 @@ out:
      * Capture stop will close the socket which fail the read
      * and hence bail out.
      */
+    zmq_msg_close(&msg);
     zmq_close(cap_sub_sock);
     m_cap_run = false;
     return;
 }
 
 
+void
+capture_service::cache_event(const runtime_id_t &rid, const char *data, size_t len)
+{
+    int missed = m_events.push(rid, data, len);
+
+    if (missed > 0) {
+        m_total_missed_cache += missed;
+        m_stats_instance->increment_missed_cache(missed);
+    }
+}
+
+
 int
 capture_service::set_control(capture_control_t ctrl, event_serialized_lst_t *lst)
 {
@@ -535,16 +1690,11 @@ capture_service::set_control(capture_control_t ctrl, event_serialized_lst_t *lst
             break;
 
         case START_CAPTURE:
-
             /*
-             * Reserve a MAX_PUBLISHERS_COUNT entries for last events, as we use it only
-             * upon m_events/vector overflow, which might block adding new entries in map
-             * if overall mem consumption is too high. Clearing the map just before use
-             * is likely to help.
+             * Map the whole arena upfront, so the capture never needs to
+             * allocate per event.
              */
-            for (int i=0; i<MAX_PUBLISHERS_COUNT; ++i) {
-                m_last_events[to_string(i)] = "";
-            }
+            RET_ON_ERR(m_events.init() == 0, "Failed to init capture cache");
 
             if ((lst != NULL) && (!lst->empty())) {
                 init_capture_cache(*lst);
@@ -574,41 +1724,342 @@ out:
 }
 
 int
-capture_service::read_cache(event_serialized_lst_t &lst_fifo,
+capture_service::read_cache(event_cache_ring &lst_fifo,
         last_events_t &lst_last, counters_t &overflow_cnt)
 {
+    lst_fifo.release();
+    last_events_t().swap(lst_last);
+
+    m_events.read_last(lst_last);
     lst_fifo.swap(m_events);
-    if (m_last_events_init) {
-        lst_last.swap(m_last_events);
-    } else {
-        last_events_t().swap(lst_last);
-    }
-    last_events_t().swap(m_last_events);
-    event_serialized_lst_t().swap(m_events);
+
     overflow_cnt = m_total_missed_cache;
     return 0;
 }
 
+
+int
+journal_service::start()
+{
+    int ret = -1;
+
+    RET_ON_ERR(m_journal != NULL, "No journal to write");
+    stop();
+
+    m_run = true;
+    m_thr = thread(&journal_service::run_journal, this);
+    ret = 0;
+out:
+    return ret;
+}
+
+
+void
+journal_service::stop()
+{
+    m_run = false;
+
+    if (m_thr.joinable()) {
+        m_thr.join();
+    }
+}
+
+
+void
+journal_service::run_journal()
+{
+    int rc;
+    int block_ms = m_sync_interval_ms;
+    void *sock = NULL;
+    zmq_msg_t msg;
+    uint64_t last_sync_ms = 0;
+    bool dirty = false;
+
+    zmq_msg_init(&msg);
+
+    sock = zmq_socket(m_ctx, ZMQ_SUB);
+    RET_ON_ERR(sock != NULL, "failing to get ZMQ_SUB socket");
+
+    rc = zmq_connect(sock, get_config(string(CAPTURE_END_KEY)).c_str());
+    RET_ON_ERR(rc == 0, "Failing to connect journal SUB to %s",
+            get_config(string(CAPTURE_END_KEY)).c_str());
+
+    rc = zmq_setsockopt(sock, ZMQ_SUBSCRIBE, "", 0);
+    RET_ON_ERR(rc == 0, "Failing to ZMQ_SUBSCRIBE");
+
+    rc = zmq_setsockopt(sock, ZMQ_RCVTIMEO, &block_ms, sizeof (block_ms));
+    RET_ON_ERR(rc == 0, "Failed to ZMQ_RCVTIMEO to %d", block_ms);
+
+    while (m_run) {
+        runtime_id_t rid;
+        sequence_t seq;
+        const char *evt_data;
+        size_t evt_len;
+        uint64_t now_ms;
+
+        rc = capture_read(sock, &msg);
+        if (rc == 0) {
+            evt_data = (const char *)zmq_msg_data(&msg);
+            evt_len = zmq_msg_size(&msg);
+
+            if (peek_event_header(evt_data, evt_len, rid, seq)) {
+                dirty = (m_journal->append(rid, seq, evt_data, evt_len) == 0) || dirty;
+            }
+        }
+        else {
+            /* Subscribe requests are captured too */
+            RET_ON_ERR((rc == EAGAIN) || (rc == ERR_MESSAGE_INVALID),
+                    "Failed to read from capture socket");
+        }
+
+        /* Batch the disk writes */
+        now_ms = duration_cast<milliseconds>(
+                steady_clock::now().time_since_epoch()).count();
+        if (dirty && ((now_ms - last_sync_ms) >= (uint64_t)m_sync_interval_ms)) {
+            m_journal->sync();
+            last_sync_ms = now_ms;
+            dirty = false;
+        }
+    }
+
+out:
+    zmq_msg_close(&msg);
+    if (sock != NULL) {
+        zmq_close(sock);
+    }
+    m_journal->sync();
+    m_run = false;
+}
+
+
+typedef struct {
+    size_t frame_bytes;
+    bool journal;
+    runtime_id_t journal_rid;
+    sequence_t journal_seq;
+} cache_read_opts_t;
+
+
+/*
+ * Parse options in EVENT_CACHE_READ request, if any.
+ * All given options must be valid.
+ */
+static int
+parse_read_options(const event_serialized_lst_t &req_data, cache_read_opts_t &opts)
+{
+    int ret = -1;
+
+    opts.frame_bytes = READ_FRAME_BYTES_DEFAULT;
+    opts.journal = false;
+    opts.journal_rid.clear();
+    opts.journal_seq = 0;
+
+    if (!req_data.empty()) {
+        RET_ON_ERR(req_data.size() == 1, "Expect only one options string %d",
+                (int)req_data.size());
+        const auto &data = nlohmann::json::parse(*(req_data.begin()), nullptr, false);
+        RET_ON_ERR(data.is_object() && !data.empty(), "Failed to parse read options %s",
+                req_data.begin()->c_str());
+
+        for (auto it = data.begin(); it != data.end(); ++it) {
+            if (it.key() == CACHE_READ_FRAME_BYTES) {
+                RET_ON_ERR(it->is_number_unsigned() && (it->get<size_t>() > 0),
+                        "Expect %s in read options %s", CACHE_READ_FRAME_BYTES,
+                        req_data.begin()->c_str());
+                opts.frame_bytes = min(it->get<size_t>(), (size_t)READ_FRAME_BYTES_MAX);
+            }
+            else if (it.key() == CACHE_READ_JOURNAL_FROM) {
+                const auto itr = it->find(JOURNAL_FROM_RUNTIME_ID);
+                const auto its = it->find(JOURNAL_FROM_SEQUENCE);
+
+                RET_ON_ERR(it->is_object() && (itr != it->end()) && itr->is_string(),
+                        "Expect %s in %s", JOURNAL_FROM_RUNTIME_ID,
+                        req_data.begin()->c_str());
+                RET_ON_ERR((its == it->end()) || its->is_number_unsigned(),
+                        "Expect unsigned %s in %s", JOURNAL_FROM_SEQUENCE,
+                        req_data.begin()->c_str());
+                opts.journal = true;
+                opts.journal_rid = itr->get<string>();
+                opts.journal_seq = (its != it->end()) ? its->get<sequence_t>() : 0;
+            }
+            else {
+                RET_ON_ERR(false, "Unexpected read option %s", it.key().c_str());
+            }
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+
+/*
+ * Fill a frame of cached events for EVENT_CACHE_READ.
+ *
+ * The frame size in bytes is negotiated by the client via options in
+ * request, else default. A frame has at least one event, if any left.
+ *
+ * The last events saved per publisher are older than the ones in the
+ * ring, as the ring evicts oldest. Hence these are returned first.
+ * Both are drained from front, so the full drain is O(n).
+ */
+static int
+read_cache_frame(size_t frame_bytes, last_events_t &lst_last,
+        event_cache_ring &lst_fifo, event_serialized_lst_t &resp_data)
+{
+    size_t bytes = 0;
+    const char *data;
+    size_t len;
+
+    while (!lst_last.empty() && (bytes < frame_bytes)) {
+        last_events_t::iterator it = lst_last.begin();
+
+        bytes += it->second.size();
+        resp_data.push_back(move(it->second));
+        lst_last.erase(it);
+    }
+
+    while ((bytes < frame_bytes) && lst_fifo.front(data, len)) {
+        bytes += len;
+        resp_data.push_back(string(data, len));
+        lst_fifo.pop_front();
+    }
+
+    if (lst_fifo.empty()) {
+        /* Fully drained; release the arena */
+        lst_fifo.release();
+    }
+    return 0;
+}
+
+static int
+parse_rate_limit(const nlohmann::json &data, rate_limit_t &limit)
+{
+    int ret = -1;
+    const auto itr = data.find(RATE_LIMIT_RATE);
+    const auto itb = data.find(RATE_LIMIT_BURST);
+
+    RET_ON_ERR(data.is_object(), "Expect rate limit object; got %s",
+            data.dump().c_str());
+    RET_ON_ERR((itr != data.end()) && itr->is_number_unsigned(),
+            "Expect unsigned rate; got %s", data.dump().c_str());
+    RET_ON_ERR((itb == data.end()) || itb->is_number_unsigned(),
+            "Expect unsigned burst; got %s", data.dump().c_str());
+
+    limit.rate = itr->get<uint32_t>();
+    limit.burst = (itb != data.end()) ? itb->get<uint32_t>() : limit.rate;
+    RET_ON_ERR((limit.rate == 0) || (limit.burst != 0), "Expect non zero burst");
+    ret = 0;
+out:
+    return ret;
+}
+
+
+static int
+parse_rate_limit_config(const nlohmann::json &data, rate_limit_config_t &cfg)
+{
+    int ret = -1;
+
+    RET_ON_ERR(data.is_object(), "Expect RATE_LIMIT object; got %s",
+            data.dump().c_str());
+
+    for (auto it = data.begin(); it != data.end(); ++it) {
+        if (it.key() == RATE_LIMIT_SOURCE) {
+            RET_ON_ERR(parse_rate_limit(it.value(), cfg.source) == 0,
+                    "Failed to parse source limit");
+        }
+        else if (it.key() == RATE_LIMIT_TAG) {
+            RET_ON_ERR(parse_rate_limit(it.value(), cfg.tag) == 0,
+                    "Failed to parse tag limit");
+        }
+        else if (it.key() == RATE_LIMIT_OVERRIDES) {
+            RET_ON_ERR(it.value().is_object(), "Expect overrides object");
+            for (auto itc = it.value().begin(); itc != it.value().end(); ++itc) {
+                RET_ON_ERR(parse_rate_limit(itc.value(), cfg.overrides[itc.key()]) == 0,
+                        "Failed to parse override for %s", itc.key().c_str());
+            }
+        }
+        else {
+            RET_ON_ERR(false, "Unexpected RATE_LIMIT key %s", it.key().c_str());
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+
+static nlohmann::json
+rate_limit_to_json(const rate_limit_t &limit)
+{
+    nlohmann::json data = nlohmann::json::object();
+
+    data[RATE_LIMIT_RATE] = limit.rate;
+    data[RATE_LIMIT_BURST] = limit.burst;
+    return data;
+}
+
+
 static int
-process_options(stats_collector *stats, const event_serialized_lst_t &req_data,
-        event_serialized_lst_t &resp_data)
+process_options(stats_collector *stats, eventd_proxy *proxy,
+        const event_serialized_lst_t &req_data, event_serialized_lst_t &resp_data)
 {
     int ret = -1;
     if (!req_data.empty()) {
+        int heartbeat = -1;
+        bool has_limits = false;
+        rate_limit_config_t limits;
+
         RET_ON_ERR(req_data.size() == 1, "Expect only one options string %d",
                 (int)req_data.size());
         const auto &data = nlohmann::json::parse(*(req_data.begin()));
-        RET_ON_ERR(data.size() == 1, "Only one supported option. Expect 1. size=%d",
-                (int)data.size());
-        const auto it = data.find(GLOBAL_OPTION_HEARTBEAT);
-        RET_ON_ERR(it != data.end(), "Expect HEARTBEAT_INTERVAL; got %s",
-                data.begin().key().c_str());
-        stats->set_heartbeat_interval(it.value());
+        RET_ON_ERR(!data.empty(), "Expect at least one option");
+
+        /* Validate all before applying any */
+        for (auto it = data.begin(); it != data.end(); ++it) {
+            if (it.key() == GLOBAL_OPTION_HEARTBEAT) {
+                heartbeat = it.value();
+            }
+            else if (it.key() == GLOBAL_OPTION_RATE_LIMIT) {
+                RET_ON_ERR(parse_rate_limit_config(it.value(), limits) == 0,
+                        "Failed to parse RATE_LIMIT");
+                has_limits = true;
+            }
+            else {
+                RET_ON_ERR(false, "Expect HEARTBEAT_INTERVAL or RATE_LIMIT; got %s",
+                        it.key().c_str());
+            }
+        }
+        if (heartbeat != -1) {
+            stats->set_heartbeat_interval(heartbeat);
+        }
+        if (has_limits) {
+            RET_ON_ERR(proxy != NULL, "No proxy to set RATE_LIMIT");
+            proxy->set_rate_limits(limits);
+        }
         ret = 0;
     }
     else {
         nlohmann::json msg = nlohmann::json::object();
         msg[GLOBAL_OPTION_HEARTBEAT] = stats->get_heartbeat_interval();
+
+        if (proxy != NULL) {
+            rate_limit_config_t limits = proxy->get_rate_limits();
+
+            if ((limits.source.rate != 0) || (limits.tag.rate != 0) ||
+                    !limits.overrides.empty()) {
+                nlohmann::json lim = nlohmann::json::object();
+                nlohmann::json overrides = nlohmann::json::object();
+
+                lim[RATE_LIMIT_SOURCE] = rate_limit_to_json(limits.source);
+                lim[RATE_LIMIT_TAG] = rate_limit_to_json(limits.tag);
+                for (const auto &itc : limits.overrides) {
+                    overrides[itc.first] = rate_limit_to_json(itc.second);
+                }
+                lim[RATE_LIMIT_OVERRIDES] = overrides;
+                msg[GLOBAL_OPTION_RATE_LIMIT] = lim;
+            }
+        }
         resp_data.push_back(msg.dump());
         ret = 0;
     }
@@ -622,12 +2073,17 @@ run_eventd_service()
 {
     int code = 0;
     int cache_max;
+    size_t cache_bytes_max;
     event_service service;
     stats_collector stats_instance;
     eventd_proxy *proxy = NULL;
     capture_service *capture = NULL;
+    event_journal *journal = NULL;
+    journal_service *journal_writer = NULL;
+    string journal_dir;
+    cache_read_opts_t read_opts;
 
-    event_serialized_lst_t capture_fifo_events;
+    event_cache_ring capture_fifo_events(0);
     last_events_t capture_last_events;
 
     SWSS_LOG_INFO("Eventd service starting\n");
@@ -635,14 +2091,39 @@ run_eventd_service()
     void *zctx = zmq_ctx_new();
     RET_ON_ERR(zctx != NULL, "Failed to get zmq ctx");
 
-    cache_max = get_config_data(string(CACHE_MAX_CNT), (int)MAX_CACHE_SIZE);
-    RET_ON_ERR(cache_max > 0, "Failed to get CACHE_MAX_CNT");
+    /* Cache is bounded by bytes; Count limit is optional */
+    cache_max = get_config_data(string(CACHE_MAX_CNT), 0);
+    RET_ON_ERR(cache_max >= 0, "Failed to get CACHE_MAX_CNT");
 
-    proxy = new eventd_proxy(zctx);
+    cache_bytes_max = get_eventd_config_data(string(CACHE_MAX_BYTES),
+            (size_t)MAX_CACHE_BYTES_DEFAULT);
+    RET_ON_ERR(cache_bytes_max > 0, "Failed to get CACHE_MAX_BYTES");
+
+    stats_instance.set_write_interval(get_eventd_config_data(string(STATS_WRITE_INTERVAL_MS),
+                (int)STATS_WRITE_INTERVAL_MS_DEFAULT));
+
+    proxy = new eventd_proxy(zctx, &stats_instance);
     RET_ON_ERR(proxy != NULL, "Failed to create proxy");
 
     RET_ON_ERR(proxy->init() == 0, "Failed to init proxy");
 
+    /* Optional journal, written from capture, off the proxy's path */
+    journal_dir = get_eventd_config(string(JOURNAL_DIR));
+    if (!journal_dir.empty()) {
+        journal = new event_journal(journal_dir,
+                get_eventd_config_data(string(JOURNAL_MAX_BYTES),
+                    (size_t)JOURNAL_MAX_BYTES_DEFAULT),
+                get_eventd_config_data(string(JOURNAL_SEGMENT_BYTES),
+                    (size_t)JOURNAL_SEGMENT_BYTES_DEFAULT));
+        RET_ON_ERR(journal->open() == 0, "Failed to open journal %s",
+                journal_dir.c_str());
+
+        journal_writer = new journal_service(zctx, journal,
+                get_eventd_config_data(string(JOURNAL_SYNC_INTERVAL_MS),
+                    (int)JOURNAL_SYNC_INTERVAL_MS_DEFAULT));
+        RET_ON_ERR(journal_writer->start() == 0, "Failed to start journal");
+    }
+
     RET_ON_ERR(service.init_server(zctx) == 0, "Failed to init service");
 
     RET_ON_ERR(stats_instance.start() == 0, "Failed to start stats collector");
@@ -655,7 +2136,7 @@ run_eventd_service()
      * events until telemetry starts.
      * Telemetry will send a stop & collect cache upon startup
      */
-    capture = new capture_service(zctx, cache_max, &stats_instance);
+    capture = new capture_service(zctx, cache_max, &stats_instance, cache_bytes_max);
     RET_ON_ERR(capture->set_control(INIT_CAPTURE) == 0, "Failed to init capture");
     RET_ON_ERR(capture->set_control(START_CAPTURE) == 0, "Failed to start capture");
 
@@ -675,10 +2156,11 @@ run_eventd_service()
                 if (capture != NULL) {
                     delete capture;
                 }
-                event_serialized_lst_t().swap(capture_fifo_events);
+                capture_fifo_events.release();
                 last_events_t().swap(capture_last_events);
 
-                capture = new capture_service(zctx, cache_max, &stats_instance);
+                capture = new capture_service(zctx, cache_max, &stats_instance,
+                        cache_bytes_max);
                 if (capture != NULL) {
                     resp = capture->set_control(INIT_CAPTURE);
                 }
@@ -719,37 +2201,28 @@ run_eventd_service()
 
 
             case EVENT_CACHE_READ:
-                if (capture != NULL) {
-                    SWSS_LOG_ERROR("Cache is not stopped yet.");
-                    resp = -1;
+                resp = parse_read_options(req_data, read_opts);
+                if (resp != 0) {
                     break;
                 }
-                resp = 0;
-
-                if (capture_fifo_events.empty()) {
-                    for (last_events_t::iterator it = capture_last_events.begin();
-                            it != capture_last_events.end(); ++it) {
-                        capture_fifo_events.push_back(it->second);
+                if (read_opts.journal) {
+                    /* Replay is independent of cache */
+                    if (journal == NULL) {
+                        SWSS_LOG_ERROR("Journal is not enabled");
+                        resp = -1;
+                        break;
                     }
-                    last_events_t().swap(capture_last_events);
+                    resp = journal->read_from(read_opts.journal_rid,
+                            read_opts.journal_seq, read_opts.frame_bytes, resp_data);
+                    break;
                 }
-
-                {
-                    int sz = VEC_SIZE(capture_fifo_events) < READ_SET_SIZE ?
-                        VEC_SIZE(capture_fifo_events) : READ_SET_SIZE;
-
-                    if (sz != 0) {
-                        auto it = std::next(capture_fifo_events.begin(), sz);
-                        move(capture_fifo_events.begin(), capture_fifo_events.end(),
-                                back_inserter(resp_data));
-
-                        if (sz == VEC_SIZE(capture_fifo_events)) {
-                            event_serialized_lst_t().swap(capture_fifo_events);
-                        } else {
-                            capture_fifo_events.erase(capture_fifo_events.begin(), it);
-                        }
-                    }
+                if (capture != NULL) {
+                    SWSS_LOG_ERROR("Cache is not stopped yet.");
+                    resp = -1;
+                    break;
                 }
+                resp = read_cache_frame(read_opts.frame_bytes, capture_last_events,
+                        capture_fifo_events, resp_data);
                 break;
 
 
@@ -759,7 +2232,7 @@ run_eventd_service()
                 break;
 
             case EVENT_OPTIONS:
-                resp = process_options(&stats_instance, req_data, resp_data);
+                resp = process_options(&stats_instance, proxy, req_data, resp_data);
                 break;
 
             case EVENT_EXIT:
@@ -778,6 +2251,12 @@ out:
     service.close_service();
     stats_instance.stop();
 
+    if (journal_writer != NULL) {
+        delete journal_writer;
+    }
+    if (journal != NULL) {
+        delete journal;
+    }
     if (proxy != NULL) {
         delete proxy;
     }
@@ -790,6 +2269,49 @@ out:
     SWSS_LOG_ERROR("Eventd service exiting\n");
 }
 
+void
+read_eventd_config(const char *fname)
+{
+    ifstream fs(fname);
+
+    if (!fs.is_open()) {
+        SWSS_LOG_INFO("No init config %s; eventd config set to defaults", fname);
+        return;
+    }
+
+    const auto &data = nlohmann::json::parse(fs, nullptr, false);
+    if (!data.is_object()) {
+        SWSS_LOG_ERROR("Failed to parse init config %s; eventd config set to defaults",
+                fname);
+        return;
+    }
+
+    const auto it = data.find(CFG_EVENTS_KEY);
+    if ((it == data.end()) || !it->is_object()) {
+        return;
+    }
+
+    for (auto itc = it->begin(); itc != it->end(); ++itc) {
+        map<string, string>::iterator itk = s_eventd_cfg.find(itc.key());
+
+        if (itk != s_eventd_cfg.end()) {
+            itk->second = itc->is_string() ? itc->get<string>() : itc->dump();
+            SWSS_LOG_INFO("eventd config %s=%s", itk->first.c_str(),
+                    itk->second.c_str());
+        }
+    }
+}
+
+
+string
+get_eventd_config(const string &key)
+{
+    map<string, string>::const_iterator itc = s_eventd_cfg.find(key);
+
+    return (itc != s_eventd_cfg.end()) ? itc->second : string();
+}
+
+
 void set_unit_testing(bool b)
 {
     s_unit_testing = b;
@@ -5,23 +5,196 @@
 #include "events_service.h"
 #include "events.h"
 #include "events_wrap.h"
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
 
 #define ARRAY_SIZE(l) (sizeof(l)/sizeof((l)[0]))
 
 typedef map<runtime_id_t, event_serialized_t> last_events_t;
 
+/* Default cap on memory used by capture cache */
+#define MAX_CACHE_BYTES_DEFAULT (100 * 1024 * 1024)
+
 /* stat counters */
 typedef uint64_t counters_t;
 
 typedef enum {
     INDEX_COUNTERS_EVENTS_PUBLISHED,
     INDEX_COUNTERS_EVENTS_MISSED_CACHE,
+    INDEX_COUNTERS_PROXY_MSGS_IN,
+    INDEX_COUNTERS_PROXY_BYTES_IN,
+    INDEX_COUNTERS_PROXY_MSGS_OUT,
+    INDEX_COUNTERS_PROXY_BYTES_OUT,
+    INDEX_COUNTERS_PROXY_SUPPRESSED,
     COUNTERS_EVENTS_TOTAL
 } stats_counter_index_t;
 
 #define EVENTS_STATS_FIELD_NAME "value"
 #define STATS_HEARTBEAT_MIN 300
 
+/* Keys of proxy counters in COUNTERS_EVENTS_TABLE */
+#define COUNTERS_PROXY_MSGS_IN "proxy_msgs_in"
+#define COUNTERS_PROXY_BYTES_IN "proxy_bytes_in"
+#define COUNTERS_PROXY_MSGS_OUT "proxy_msgs_out"
+#define COUNTERS_PROXY_BYTES_OUT "proxy_bytes_out"
+#define COUNTERS_PROXY_SUPPRESSED "proxy_suppressed"
+
+/*
+ * Per source counters are in this table, keyed by source
+ * with a field per counter.
+ */
+#define COUNTERS_EVENTS_SOURCES_TABLE "COUNTERS_EVENTS_SOURCES"
+#define EVENTS_STATS_SOURCE_PUBLISHED "published"
+#define EVENTS_STATS_SOURCE_DROPPED "dropped"
+#define EVENTS_STATS_SOURCE_SUPPRESSED "suppressed"
+
+/* Max count of sources tracked for per source counters */
+#define STATS_SOURCES_MAX 128
+
+/* Count of counter shards. Each thread bumps its own shard. */
+#define STATS_SHARDS_CNT 8
+
+#define CACHE_LINE_SIZE 64
+
+/* Config key & default for interval of counters write to redis */
+#define STATS_WRITE_INTERVAL_MS "stats_write_interval_ms"
+#define STATS_WRITE_INTERVAL_MS_DEFAULT 100
+
+/* Config key for cache memory cap in bytes */
+#define CACHE_MAX_BYTES "cache_max_bytes"
+
+/*
+ * Option in EVENT_CACHE_READ request, to negotiate the max bytes of
+ * events returned per response. e.g. {"read_frame_bytes": 4194304}
+ */
+#define CACHE_READ_FRAME_BYTES "read_frame_bytes"
+
+/*
+ * EVENT_OPTIONS key for rate limits of events through proxy, e.g.
+ *  {"RATE_LIMIT": {
+ *      "source": {"rate": 1000, "burst": 2000},
+ *      "tag": {"rate": 100, "burst": 200},
+ *      "overrides": {
+ *          "sonic-events-bgp": {"rate": 500},
+ *          "sonic-events-bgp:bgp-state": {"rate": 10, "burst": 50}
+ *      }
+ *  }}
+ *
+ * rate is in events/sec and 0 implies no limit. burst defaults to rate.
+ * An override is keyed by source or source:tag and replaces the
+ * corresponding default limit.
+ */
+#define GLOBAL_OPTION_RATE_LIMIT "RATE_LIMIT"
+#define RATE_LIMIT_SOURCE "source"
+#define RATE_LIMIT_TAG "tag"
+#define RATE_LIMIT_OVERRIDES "overrides"
+#define RATE_LIMIT_RATE "rate"
+#define RATE_LIMIT_BURST "burst"
+
+/* Interval to summarize suppressed events as an event & in counters */
+#define STORM_SUMMARY_INTERVAL_MS 10000
+
+/* Max count of buckets per source and per tag in rate limiter */
+#define RATE_LIMIT_BUCKETS_MAX 4096
+
+/* Min interval between sweeps for idle buckets of a full table */
+#define RATE_LIMIT_SWEEP_MS 1000
+
+typedef struct {
+    uint32_t rate;
+    uint32_t burst;
+} rate_limit_t;
+
+typedef struct {
+    rate_limit_t source;
+    rate_limit_t tag;
+    map<string, rate_limit_t> overrides;
+} rate_limit_config_t;
+
+/*
+ *  Token bucket rate limiter per source and per source:tag.
+ *
+ *  An event is allowed only if both its source & tag buckets have a
+ *  token. The tokens are taken from both only upon allow.
+ *
+ *  A table holds up to RATE_LIMIT_BUCKETS_MAX buckets. When full, idle
+ *  buckets, which would have refilled to burst, are evicted. If none is
+ *  idle, new keys share one overflow bucket until the next sweep, so the
+ *  buckets of active sources are never reset. Keys with an override
+ *  always get a bucket of their own.
+ *
+ *  Config is set by the service thread and applied by the proxy thread
+ *  upon next event. All else is called from proxy thread only.
+ */
+class event_rate_limiter
+{
+    public:
+        event_rate_limiter() : m_updated(false), m_enabled(false) {
+            m_pending_config.source = m_pending_config.tag = { 0, 0 };
+            m_config = m_pending_config;
+        }
+
+        void set_config(const rate_limit_config_t &cfg);
+
+        rate_limit_config_t get_config() const;
+
+        /* key is source:tag. now_ms is any monotonic time in ms */
+        bool allow(const string &key, uint64_t now_ms);
+
+        /* True, if any limit is set. */
+        bool enabled();
+
+        /* Counts suppressed per source:tag since last call */
+        void read_suppressed(map<string, counters_t> &lst);
+
+    private:
+        typedef struct {
+            rate_limit_t limit;
+            double tokens;
+            uint64_t last_ms;
+        } bucket_t;
+
+        typedef struct {
+            unordered_map<string, bucket_t> buckets;
+            bucket_t overflow;
+            uint64_t sweep_ms;
+        } bucket_table_t;
+
+        void apply_config();
+
+        static void init_table(bucket_table_t &table, const rate_limit_t &def_limit);
+
+        /* Adds tokens for the time elapsed since last refill */
+        static void refill(bucket_t &bucket, uint64_t now_ms);
+
+        /* Evicts idle buckets; At most once per RATE_LIMIT_SWEEP_MS */
+        static bool evict_idle(bucket_table_t &table, uint64_t now_ms);
+
+        bucket_t &get_bucket(bucket_table_t &table, const string &key,
+                const rate_limit_t &def_limit, uint64_t now_ms);
+
+        mutable mutex m_mutex;
+        rate_limit_config_t m_pending_config;
+        atomic<bool> m_updated;
+
+        /* Proxy thread's copy */
+        rate_limit_config_t m_config;
+        bool m_enabled;
+
+        bucket_table_t m_source_buckets;
+        bucket_table_t m_tag_buckets;
+        map<string, counters_t> m_suppressed;
+
+        /* Source of current key; Reused to avoid allocation per event */
+        string m_source_key;
+};
+
+
+class stats_collector;
+
 /*
  *  Started by eventd_service.
  *  Creates XPUB & XSUB end points.
@@ -29,14 +202,26 @@ typedef enum {
  *  Create a PUB socket end point for capture and bind.
  *  Call run_proxy method with sockets in a dedicated thread.
  *  Thread runs forever until the zmq context is terminated.
+ *
+ *  The proxy loop forwards messages between XSUB & XPUB, with a copy
+ *  to capture. Messages & bytes forwarded are counted in stats, if given.
  */
 class eventd_proxy
 {
     public:
-        eventd_proxy(void *ctx) : m_ctx(ctx), m_frontend(NULL), m_backend(NULL),
-            m_capture(NULL) {};
+        eventd_proxy(void *ctx, stats_collector *stats = NULL) : m_ctx(ctx),
+            m_stats_instance(stats), m_frontend(NULL), m_backend(NULL),
+            m_capture(NULL), m_storm_last_ms(0), m_storm_stop(false) {};
 
         ~eventd_proxy() {
+            {
+                lock_guard<mutex> lock(m_storm_mutex);
+                m_storm_stop = true;
+            }
+            m_storm_cv.notify_one();
+            if (m_storm_thr.joinable())
+                m_storm_thr.join();
+
             zmq_close(m_frontend);
             zmq_close(m_backend);
             zmq_close(m_capture);
@@ -47,17 +232,93 @@ class eventd_proxy
 
         int init();
 
+        /* Set from any thread; Takes effect from next event */
+        void set_rate_limits(const rate_limit_config_t &cfg) {
+            m_limiter.set_config(cfg);
+        }
+
+        rate_limit_config_t get_rate_limits() const {
+            return m_limiter.get_config();
+        }
+
     private:
         void run();
 
+        /* Send a part to dst and a copy to capture. Returns bytes sent or -1 */
+        int send_part(void *dst, zmq_msg_t *msg, bool more);
+
+        /*
+         * Forward rest of a multi-part message from src to dst & capture.
+         * Bytes received & bytes sent to dst are added to given counts.
+         */
+        int forward(void *src, void *dst, zmq_msg_t *msg, counters_t &bytes_in,
+                counters_t &bytes_out);
+
+        /* Forward an event from frontend, subject to rate limits */
+        int forward_event(zmq_msg_t *msg_src, zmq_msg_t *msg_evt);
+
+        /*
+         * Summarize suppressed events, if any, once per interval.
+         * The summary is handed to storm thread to publish.
+         */
+        void summarize_storm(uint64_t now_ms);
+
+        /*
+         * Publishes storm summaries. A publish may block, as on first
+         * publish, hence never done from proxy thread.
+         */
+        void run_storm();
+
         void *m_ctx;
+        stats_collector *m_stats_instance;
         void *m_frontend;
         void *m_backend;
         void *m_capture;
         thread m_thr;
+
+        event_rate_limiter m_limiter;
+        uint64_t m_storm_last_ms;
+
+        thread m_storm_thr;
+        mutex m_storm_mutex;
+        condition_variable m_storm_cv;
+        map<string, counters_t> m_storm_pending;
+        bool m_storm_stop;
+
+        /* Key of current event; Reused to avoid allocation per event */
+        string m_event_key;
 };
 
 
+/*
+ *  Stats counters.
+ *
+ *  Counters are sharded, with each shard in its own cache lines. A thread
+ *  is assigned a shard upon its first update and it bumps only its
+ *  shard via relaxed atomics. Hence any eventd thread can update w/o
+ *  contention. A read sums all shards.
+ *
+ *  Per source published & dropped counters are updated by collector
+ *  thread only & suppressed by proxy. A source is added by either under
+ *  lock, with its name set before count of sources is bumped. Hence
+ *  writer walks the sources with no lock. Lookup by name is via a hash
+ *  index; The collector caches the index of sources it has seen.
+ *
+ *  Writer thread writes all counters that changed in a single pipelined
+ *  write to COUNTERS_DB, at configured interval.
+ */
+typedef struct alignas(CACHE_LINE_SIZE) {
+    atomic<counters_t> counters[COUNTERS_EVENTS_TOTAL];
+} stats_shard_t;
+
+typedef struct alignas(CACHE_LINE_SIZE) {
+    string source;
+    atomic<counters_t> published;
+    atomic<counters_t> dropped;
+    atomic<counters_t> suppressed;
+} stats_source_t;
+
+
 class stats_collector
 {
     public:
@@ -81,22 +342,35 @@ class stats_collector
         }
 
         void increment_published(counters_t val) {
-            _update_stats(INDEX_COUNTERS_EVENTS_PUBLISHED, val);
+            increment(INDEX_COUNTERS_EVENTS_PUBLISHED, val);
         }
 
         void increment_missed_cache(counters_t val) {
-            _update_stats(INDEX_COUNTERS_EVENTS_MISSED_CACHE, val);
+            increment(INDEX_COUNTERS_EVENTS_MISSED_CACHE, val);
         }
 
-        counters_t read_counter(stats_counter_index_t index) {
-            if (index != COUNTERS_EVENTS_TOTAL) {
-                return m_lst_counters[index];
+        /* Lock free; Callable from any thread */
+        void increment(stats_counter_index_t index, counters_t val) {
+            if (index < COUNTERS_EVENTS_TOTAL) {
+                m_shards[get_shard()].counters[index].fetch_add(val,
+                        memory_order_relaxed);
             }
             else {
-                return 0;
+                SWSS_LOG_ERROR("Internal code error. Invalid index=%d", index);
             }
         }
 
+        counters_t read_counter(stats_counter_index_t index) const;
+
+        /* Per source counters. Returns false, if source is not tracked */
+        bool read_source_counters(const string &source, counters_t &published,
+                counters_t &dropped) const;
+
+        counters_t read_source_suppressed(const string &source) const;
+
+        /* Callable from any thread; Source is added, if not tracked yet */
+        void increment_source_suppressed(const string &source, counters_t val);
+
         /* Sets heartbeat interval in milliseconds */
         void set_heartbeat_interval(int val_in_ms);
 
@@ -117,29 +391,52 @@ class stats_collector
             return m_heartbeats_published;
         }
 
+        /* Interval to write counters to redis. */
+        void set_write_interval(int val_in_ms);
+
         bool is_running()
         {
             return !m_shutdown;
         }
 
     private:
-        void _update_stats(stats_counter_index_t index, counters_t val) {
-            if (index != COUNTERS_EVENTS_TOTAL) {
-                m_lst_counters[index] += val;
-                m_updated = true;
-            }
-            else {
-                SWSS_LOG_ERROR("Internal code error. Invalid index=%d", index);
-            }
-        }
+        static int get_shard();
+
+        /* Called from collector thread only */
+        void update_source_stats(const string &key, counters_t published,
+                counters_t dropped);
+
+        /* Index of source in m_sources or -1 */
+        int find_source(const string &source) const;
+
+        /* Index of source in m_sources, added if new. -1, if no room */
+        int add_source(const string &source);
 
         void run_collector();
 
         void run_writer();
 
-        atomic<bool> m_updated;
+        /*
+         * Writes all counters, if any changed since last write or if forced.
+         * Writes a source's counters, if changed.
+         */
+        void write_counters(counters_t *last_counters, counters_t *last_sources,
+                bool force);
+
+        stats_shard_t m_shards[STATS_SHARDS_CNT];
+
+        stats_source_t m_sources[STATS_SOURCES_MAX];
+        atomic<int> m_sources_cnt;
 
-        counters_t m_lst_counters[COUNTERS_EVENTS_TOTAL];
+        /* Index into m_sources; Guarded by m_sources_mutex */
+        unordered_map<string, int> m_sources_index;
+        mutable mutex m_sources_mutex;
+
+        /* Cache of m_sources_index; Used by collector thread only */
+        unordered_map<string, int> m_collector_index;
+
+        /* Source of current event; Reused by collector thread */
+        string m_collector_source;
 
         bool m_shutdown;
 
@@ -147,13 +444,289 @@ class stats_collector
         thread m_thr_writer;
 
         shared_ptr<swss::DBConnector> m_counters_db;
+        shared_ptr<swss::RedisPipeline> m_counters_pipeline;
         shared_ptr<swss::Table> m_stats_table;
+        shared_ptr<swss::Table> m_sources_table;
 
         bool m_pause_heartbeat;
 
         uint64_t m_heartbeats_published;
 
         int m_heartbeats_interval_cnt;
+
+        int m_write_interval_ms;
+};
+
+/*
+ *  Bounded byte-budget cache of serialized events.
+ *
+ *  All cached events live in a single arena, mapped once with a hard
+ *  byte cap. The pages are not touched until written, hence the resident
+ *  memory grows with the cache and never exceeds the cap.
+ *
+ *  The arena is split in two regions.
+ *      1) Fixed size per-publisher "last event" slots; one per runtime id.
+ *      2) Byte ring of events in the order received.
+ *
+ *  Each ring record is a small header followed by the serialized event,
+ *  padded for alignment. A record that does not fit at the end of the
+ *  ring wraps to the start.
+ *
+ *  Eviction is oldest first. When a new event does not fit in the ring,
+ *  or the optional count limit is hit, the oldest events are evicted.
+ *  An evicted event is saved in its publisher's slot, replacing any
+ *  earlier event in that slot. The replaced event, or an evicted event
+ *  that can't be saved in a slot, is accounted as missed.
+ */
+class event_cache_ring
+{
+    public:
+        /*
+         * bytes_max - Cap on total memory for arena.
+         * cnt_max - Max count of events in ring. 0 implies no limit.
+         */
+        event_cache_ring(size_t bytes_max, int cnt_max = 0);
+
+        ~event_cache_ring() { release(); }
+
+        /* Maps the arena. Returns 0 on success. */
+        int init();
+
+        /* Unmaps the arena and resets all state. */
+        void release();
+
+        /*
+         * Append an event, evicting oldest as needed.
+         * Returns count of events missed due to this push.
+         */
+        int push(const runtime_id_t &rid, const char *data, size_t len);
+
+        /* Oldest event in ring. Returns false on empty */
+        bool front(const char *&data, size_t &len) const;
+
+        void pop_front();
+
+        bool empty() const { return m_cnt == 0; }
+
+        int size() const { return m_cnt; }
+
+        /* Bytes consumed by ring records, including padding. */
+        size_t bytes_used() const;
+
+        size_t bytes_max() const { return m_bytes_max; }
+
+        /* Saved events of slots. Slots are cleared. */
+        void read_last(last_events_t &lst);
+
+        /* Exchange contents, including the arena, with other ring. */
+        void swap(event_cache_ring &other);
+
+        counters_t missed() const { return m_missed; }
+
+    private:
+        typedef struct {
+            uint32_t len;
+            uint32_t slot;
+        } rec_hdr_t;
+
+        static size_t rec_size(size_t len) {
+            return (sizeof(rec_hdr_t) + len + sizeof(rec_hdr_t) - 1) &
+                ~(sizeof(rec_hdr_t) - 1);
+        }
+
+        rec_hdr_t *rec_at(size_t offset) const {
+            return (rec_hdr_t *)(m_ring + offset);
+        }
+
+        uint32_t get_slot(const runtime_id_t &rid);
+
+        /* Reserve space for a record of rec_sz at tail. */
+        bool reserve(size_t rec_sz, size_t &offset);
+
+        /* Evict oldest into its slot. Returns count missed. */
+        int evict();
+
+        /* Save given event in slot. Returns count missed. */
+        int save_last(uint32_t slot, const char *data, size_t len);
+
+        size_t m_bytes_max;
+        int m_cnt_max;
+
+        char *m_arena;
+        size_t m_arena_sz;
+
+        /* Slot region */
+        char *m_slots;
+        uint32_t m_slots_max;
+        vector<runtime_id_t> m_slot_rids;
+        unordered_map<runtime_id_t, uint32_t> m_slot_index;
+
+        /* Ring region */
+        char *m_ring;
+        size_t m_ring_sz;
+        size_t m_head;
+        size_t m_tail;
+        size_t m_end;
+        bool m_wrapped;
+        int m_cnt;
+
+        counters_t m_missed;
+};
+
+/*
+ * Config keys for the optional on-disk journal of events.
+ * The journal is enabled only when a directory is configured, e.g. in
+ * init_cfg.json as {"events": {"journal_dir": "/var/lib/eventd/journal"}}
+ */
+#define JOURNAL_DIR "journal_dir"
+#define JOURNAL_MAX_BYTES "journal_max_bytes"
+#define JOURNAL_SEGMENT_BYTES "journal_segment_bytes"
+#define JOURNAL_SYNC_INTERVAL_MS "journal_sync_interval_ms"
+
+#define JOURNAL_MAX_BYTES_DEFAULT (64 * 1024 * 1024)
+#define JOURNAL_SEGMENT_BYTES_DEFAULT (4 * 1024 * 1024)
+#define JOURNAL_SYNC_INTERVAL_MS_DEFAULT 1000
+
+/*
+ * Option in EVENT_CACHE_READ request, to replay events from journal,
+ * that were received after the given event.
+ *  e.g. {"journal_from": {"runtime_id": "<rid>", "sequence": 10}}
+ *
+ * An empty runtime_id replays from the oldest in journal. So does an
+ * event that is no longer in journal. The client continues with the
+ * last event received, until an empty response.
+ */
+#define CACHE_READ_JOURNAL_FROM "journal_from"
+#define JOURNAL_FROM_RUNTIME_ID "runtime_id"
+#define JOURNAL_FROM_SEQUENCE "sequence"
+
+/*
+ *  Append-only journal of serialized events, on disk.
+ *
+ *  The journal is a set of fixed size segment files, each memory mapped.
+ *  Events are appended to the newest segment; When full, a new segment is
+ *  created and the oldest is deleted, if over the disk budget. Hence the
+ *  disk use is bounded by max_bytes, rounded up to a segment.
+ *
+ *  Each record is a small header with length & checksum, followed by the
+ *  serialized event, padded for alignment. Zero length marks the end of
+ *  written records in a segment.
+ *
+ *  Writes are only to the mapped pages. The dirty pages are flushed to
+ *  disk by sync, which the caller batches, say once a second.
+ *
+ *  An index per segment maps runtime id to the sequences in that segment
+ *  with their offsets, to locate an event for replay in O(log n).
+ *
+ *  On open, existing segments are scanned to rebuild the index, stopping
+ *  at the first torn record in a segment. New events are appended to the
+ *  newest segment, past its last intact record.
+ *
+ *  Appends & reads may be from different threads.
+ */
+class event_journal
+{
+    public:
+        event_journal(const string &dir, size_t max_bytes = JOURNAL_MAX_BYTES_DEFAULT,
+                size_t segment_bytes = JOURNAL_SEGMENT_BYTES_DEFAULT);
+
+        ~event_journal() { close(); }
+
+        /* Loads existing segments for append. Returns 0 on success. */
+        int open();
+
+        /* Syncs & unmaps all segments. Files are retained. */
+        void close();
+
+        /*
+         * Append an event. An event larger than a segment is dropped.
+         * Returns 0 on success.
+         */
+        int append(const runtime_id_t &rid, sequence_t seq,
+                const char *data, size_t len);
+
+        /* Flush written records to disk. */
+        int sync();
+
+        /*
+         * Read events received after the given one, upto max_bytes, but at
+         * least one, if any. Empty rid reads from the oldest.
+         */
+        int read_from(const runtime_id_t &rid, sequence_t seq, size_t max_bytes,
+                event_serialized_lst_t &lst) const;
+
+        /* Count of events in journal. */
+        size_t size() const;
+
+        /* Bytes of segment files on disk. */
+        size_t bytes_used() const;
+
+        /*
+         * Events not in journal; Failed appends and gaps in sequence of
+         * a runtime id, as missed before reaching journal.
+         */
+        counters_t dropped() const { return m_dropped; }
+
+    private:
+        typedef struct {
+            uint32_t len;
+            uint32_t csum;
+        } rec_hdr_t;
+
+        typedef struct {
+            uint64_t magic;
+            uint64_t id;
+        } seg_hdr_t;
+
+        typedef vector<pair<sequence_t, uint32_t> > seq_offsets_t;
+
+        typedef struct {
+            uint64_t id;
+            char *base;
+            size_t size;
+            size_t used;
+            size_t synced;
+            size_t cnt;
+            unordered_map<runtime_id_t, seq_offsets_t> index;
+        } segment_t;
+
+        static size_t rec_size(size_t len) {
+            return (sizeof(rec_hdr_t) + len + sizeof(rec_hdr_t) - 1) &
+                ~(sizeof(rec_hdr_t) - 1);
+        }
+
+        static uint32_t checksum(const char *data, size_t len);
+
+        string seg_path(uint64_t id) const;
+
+        /* Map segment file, creating when asked. */
+        char *map_segment(uint64_t id, bool create, size_t &size);
+
+        /* Scan records of an existing segment & build its index */
+        void load_segment(segment_t &seg);
+
+        /* Start a new segment & drop oldest over budget. */
+        int rotate();
+
+        void drop_oldest();
+
+        void sync_segment(segment_t &seg);
+
+        /* Locate the record after given event. */
+        bool find_after(const runtime_id_t &rid, sequence_t seq,
+                size_t &seg_idx, size_t &offset) const;
+
+        string m_dir;
+        size_t m_seg_bytes;
+        size_t m_segs_max;
+
+        mutable mutex m_mutex;
+        deque<segment_t> m_segs;
+
+        /* Last sequence appended per runtime id, to detect gaps */
+        unordered_map<runtime_id_t, sequence_t> m_last_seq;
+
+        counters_t m_dropped;
 };
 
 /*
@@ -181,17 +754,13 @@ class stats_collector
  *  via thread.join().
  *
  *  Each event is 2 parts. It drops the first part, which is
- *  more for filtering events. It creates string from second part
- *  and saves it.
+ *  more for filtering events. The second part, the serialized version
+ *  of internal_event_ref, is saved as received. Only runtime id &
+ *  sequence are peeked from it, without a full deserialization.
  *
- *  The string is the serialized version of internal_event_ref
- *
- *  It keeps two sets of data
- *      1) List of all events received in vector in same order as received
- *      2) Map of last event from each runtime id upon list overflow max size.
- *
- *  We add to the vector as much as allowed by vector and max limit,
- *  whichever comes first.
+ *  The events are saved in event_cache_ring, which is bounded by bytes
+ *  and optionally by count. Upon overflow, oldest events are evicted and
+ *  the last evicted event from each runtime id is retained.
  *
  *  The sequence number in internal event will help assess the missed count
  *  by the consumer of the cache data.
@@ -208,23 +777,31 @@ typedef enum {
 class capture_service
 {
     public:
-        capture_service(void *ctx, int cache_max, stats_collector *stats) :
+        capture_service(void *ctx, int cache_max, stats_collector *stats,
+                size_t cache_bytes_max = MAX_CACHE_BYTES_DEFAULT) :
             m_ctx(ctx), m_stats_instance(stats), m_cap_run(false),
-            m_ctrl(NEED_INIT), m_cache_max(cache_max),
-            m_last_events_init(false), m_total_missed_cache(0)
+            m_ctrl(NEED_INIT), m_events(cache_bytes_max, cache_max),
+            m_total_missed_cache(0)
         {}
 
         ~capture_service();
 
         int set_control(capture_control_t ctrl, event_serialized_lst_t *p=NULL);
 
-        int read_cache(event_serialized_lst_t &lst_fifo,
+        /*
+         * Hands over the cache as is, to be drained by caller.
+         * lst_fifo is released and takes over the arena of the cache.
+         */
+        int read_cache(event_cache_ring &lst_fifo,
                 last_events_t &lst_last, counters_t &overflow_cnt);
 
     private:
         void init_capture_cache(const event_serialized_lst_t &lst);
         void do_capture();
 
+        /* Save in cache; Accounts any missed due to overflow */
+        void cache_event(const runtime_id_t &rid, const char *data, size_t len);
+
         void stop_capture();
 
         void *m_ctx;
@@ -234,12 +811,7 @@ class capture_service
         capture_control_t m_ctrl;
         thread m_thr;
 
-        int m_cache_max;
-
-        event_serialized_lst_t m_events;
-
-        last_events_t m_last_events;
-        bool m_last_events_init;
+        event_cache_ring m_events;
 
         typedef map<runtime_id_t, sequence_t> pre_exist_id_t;
         pre_exist_id_t m_pre_exist_id;
@@ -249,6 +821,40 @@ class capture_service
 };
 
 
+/*
+ *  Writes all events from capture socket to journal.
+ *
+ *  Runs in its own thread, off the proxy's path. The capture socket is
+ *  PUB, hence a slow disk can only drop events for the journal, never
+ *  slow the proxy. The journal is synced to disk once every sync interval.
+ */
+class journal_service
+{
+    public:
+        journal_service(void *ctx, event_journal *journal,
+                int sync_interval_ms = JOURNAL_SYNC_INTERVAL_MS_DEFAULT) :
+            m_ctx(ctx), m_journal(journal), m_sync_interval_ms(sync_interval_ms),
+            m_run(false)
+        {}
+
+        ~journal_service() { stop(); }
+
+        int start();
+
+        void stop();
+
+    private:
+        void run_journal();
+
+        void *m_ctx;
+        event_journal *m_journal;
+        int m_sync_interval_ms;
+
+        atomic<bool> m_run;
+        thread m_thr;
+};
+
+
 /*
  * Main server, that starts the zproxy service and honor
  * eventd service requests event_req_type_t
@@ -259,10 +865,54 @@ class capture_service
  *  capture_events thread. Upon cache stop command, close the handle
  *  which will stop the caching thread with read failure.
  *
- *  for cache read, returns the collected events in chunks.
+ *  for cache read, returns the collected events in frames. Each frame
+ *  is bounded by bytes, as negotiated by client via CACHE_READ_FRAME_BYTES
+ *  in request. The events are drained from the cache ring, oldest first.
+ *  A cache read with CACHE_READ_JOURNAL_FROM replays from journal instead,
+ *  which is allowed anytime.
  *
  */
 void run_eventd_service();
 
+/*
+ * Peek runtime id & sequence from serialized event, w/o deserializing.
+ * Returns false, if not a valid event.
+ */
+bool peek_event_header(const char *data, size_t len, runtime_id_t &rid,
+        sequence_t &seq);
+
+/*
+ * Peek the key of event data, i.e. "<source>:<tag>", w/o deserializing.
+ * Returns false, if not a valid event.
+ */
+bool peek_event_key(const char *data, size_t len, string &key);
+
+/*
+ * eventd specific config, from CFG_EVENTS_KEY section of init config.
+ *
+ * The init config read by swss-common is confined to the keys known
+ * to it. Hence eventd keeps its own keys with defaults, which are
+ * overridden by the values in given file, if any. Unknown keys are
+ * ignored. To be called upon startup, before any thread starts.
+ */
+void read_eventd_config(const char *fname = INIT_CFG_PATH);
+
+/* Value of eventd config key; Empty string, if unknown or unset */
+string get_eventd_config(const string &key);
+
+template<typename T>
+T get_eventd_config_data(const string &key, T def)
+{
+    string s(get_eventd_config(key));
+
+    if (s.empty()) {
+        return def;
+    }
+    T v;
+    stringstream ss(s);
+    ss >> v;
+    return ss.fail() ? def : v;
+}
+
 /* To help skip redis access during unit testing */
 void set_unit_testing(bool b);
@@ -9,6 +9,9 @@ int main()
     SWSS_LOG_INFO("The eventd service started");
     SWSS_LOG_ERROR("ERR:The eventd service started");
 
+    read_init_config(INIT_CFG_PATH);
+    read_eventd_config(INIT_CFG_PATH);
+
     run_eventd_service();
 
     SWSS_LOG_INFO("The eventd service exited");
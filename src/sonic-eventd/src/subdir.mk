@@ -1,9 +1,9 @@
 CC := g++
 
-TEST_OBJS += ./src/eventd.o
-OBJS += ./src/eventd.o ./src/main.o
+TEST_OBJS += ./src/eventd.o ./src/event_journal.o
+OBJS += ./src/eventd.o ./src/event_journal.o ./src/main.o
 
-C_DEPS += ./src/eventd.d ./src/main.d
+C_DEPS += ./src/eventd.d ./src/event_journal.d ./src/main.d
 
 src/%.o: src/%.cpp
 	@echo 'Building file: $<'
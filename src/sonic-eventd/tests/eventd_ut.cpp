@@ -5,6 +5,9 @@
 #include <deque>
 #include <regex>
 #include <chrono>
+#include <fstream>
+#include <sys/resource.h>
+#include <dirent.h>
 #include "gtest/gtest.h"
 #include "events_common.h"
 #include "events.h"
@@ -200,6 +203,18 @@ void run_sub(void *zctx, bool &term, string &read_source, internal_events_lst_t
     zmq_close(mock_sub);
 }
 
+/* Drain the cache handed over by capture service, oldest first */
+void drain_cache(event_cache_ring &ring, event_serialized_lst_t &lst)
+{
+    const char *data;
+    size_t len;
+
+    while (ring.front(data, len)) {
+        lst.push_back(string(data, len));
+        ring.pop_front();
+    }
+}
+
 void *init_pub(void *zctx)
 {
     void *mock_pub = zmq_socket (zctx, ZMQ_PUB);
@@ -229,11 +244,12 @@ TEST(eventd, proxy)
     internal_events_lst_t rd_evts, wr_evts;
     int rd_evts_sz = 0, rd_cevts_sz = 0;
     int wr_sz;
+    stats_collector stats_instance;
 
     void *zctx = zmq_ctx_new();
     EXPECT_TRUE(NULL != zctx);
 
-    eventd_proxy *pxy = new eventd_proxy(zctx);
+    eventd_proxy *pxy = new eventd_proxy(zctx, &stats_instance);
     EXPECT_TRUE(NULL != pxy);
 
     /* Starting proxy */
@@ -278,6 +294,13 @@ TEST(eventd, proxy)
     EXPECT_EQ(rd_evts.size(), wr_evts.size());
     EXPECT_EQ(rd_cevts_sz,  wr_evts.size());
 
+    /* Proxy counts each event forwarded */
+    EXPECT_EQ(wr_evts.size(), stats_instance.read_counter(INDEX_COUNTERS_PROXY_MSGS_IN));
+    EXPECT_EQ(wr_evts.size(), stats_instance.read_counter(INDEX_COUNTERS_PROXY_MSGS_OUT));
+    EXPECT_LT(0, (int)stats_instance.read_counter(INDEX_COUNTERS_PROXY_BYTES_IN));
+    EXPECT_EQ(stats_instance.read_counter(INDEX_COUNTERS_PROXY_BYTES_IN),
+            stats_instance.read_counter(INDEX_COUNTERS_PROXY_BYTES_OUT));
+
     zmq_close(mock_pub);
     zmq_ctx_term(zctx);
 
@@ -308,6 +331,7 @@ TEST(eventd, capture)
 
     /* startup strings; expected list & read list from capture */
     event_serialized_lst_t evts_start, evts_expect, evts_read;
+    event_cache_ring evts_ring(0);
     last_events_t last_evts_exp, last_evts_read;
     counters_t overflow, overflow_exp = 0;
 
@@ -359,18 +383,22 @@ TEST(eventd, capture)
 
         wr_evts.push_back(ev);
 
-        if (i < cache_max) {
-            if (i >= init_cache) {
-                /* for i < init_cache, evts_expect is already populated */
-                evts_expect.push_back(evt_str);
-            }
-        } else {
-            /* collect last entries for overflow */
-            last_evts_exp[ldata[i].rid] = evt_str;
-            overflow_exp++;
+        if (i >= init_cache) {
+            /* for i < init_cache, evts_expect is already populated */
+            evts_expect.push_back(evt_str);
         }
     }
+
+    /*
+     * Cache evicts oldest upon overflow and retains the last evicted
+     * event per runtime id. Rest of the evicted are missed.
+     */
+    for(int i=0; i < ((int)evts_expect.size() - cache_max); ++i) {
+        last_evts_exp[ldata[i].rid] = evts_expect[i];
+        overflow_exp++;
+    }
     overflow_exp -= (int)last_evts_exp.size();
+    evts_expect.erase(evts_expect.begin(), evts_expect.end() - cache_max);
 
     EXPECT_EQ(0, pcap->set_control(START_CAPTURE, &evts_start));
 
@@ -390,7 +418,8 @@ TEST(eventd, capture)
     term_sub = true;
 
     /* Read the cache */
-    EXPECT_EQ(0, pcap->read_cache(evts_read, last_evts_read, overflow));
+    EXPECT_EQ(0, pcap->read_cache(evts_ring, last_evts_read, overflow));
+    drain_cache(evts_ring, evts_read);
 
 #ifdef DEBUG_TEST
     if ((evts_read.size() != evts_expect.size()) ||
@@ -452,6 +481,7 @@ TEST(eventd, captureCacheMax)
 
     /* startup strings; expected list & read list from capture */
     event_serialized_lst_t evts_start, evts_expect, evts_read;
+    event_cache_ring evts_ring(0);
     last_events_t last_evts_read;
     counters_t overflow;
 
@@ -522,7 +552,8 @@ TEST(eventd, captureCacheMax)
     term_sub = true;
 
     /* Read the cache */
-    EXPECT_EQ(0, pcap->read_cache(evts_read, last_evts_read, overflow));
+    EXPECT_EQ(0, pcap->read_cache(evts_ring, last_evts_read, overflow));
+    drain_cache(evts_ring, evts_read);
 
 #ifdef DEBUG_TEST
     if ((evts_read.size() != evts_expect.size()) ||
@@ -673,6 +704,47 @@ TEST(eventd, service)
         }
     }
 
+    {
+        /* Read cache in frames of negotiated size */
+        int init_cache = 4;
+        int frames = 0;
+        event_serialized_lst_t evts_start, evts_read, opts;
+
+        for(int i=0; i < init_cache; ++i) {
+            string evt_str;
+            serialize(create_ev(ldata[i]), evt_str);
+            evts_start.push_back(evt_str);
+        }
+
+        EXPECT_EQ(0, service.cache_init());
+        EXPECT_EQ(0, service.cache_start(evts_start));
+
+        this_thread::sleep_for(chrono::milliseconds(200));
+
+        EXPECT_EQ(0, service.cache_stop());
+
+        /* Invalid option fails the read, with cache intact */
+        opts.push_back("{\"read_frame_bytes\": -1}");
+        EXPECT_NE(0, service.send_recv(EVENT_CACHE_READ, &opts));
+
+        /* Frame of a byte carries exactly one event */
+        opts[0] = string("{\"") + CACHE_READ_FRAME_BYTES + "\": 1}";
+
+        while (frames <= init_cache) {
+            event_serialized_lst_t frame;
+
+            EXPECT_EQ(0, service.send_recv(EVENT_CACHE_READ, &opts, &frame));
+            if (frame.empty()) {
+                break;
+            }
+            EXPECT_EQ(1, (int)frame.size());
+            evts_read.insert(evts_read.end(), frame.begin(), frame.end());
+            ++frames;
+        }
+        EXPECT_EQ(init_cache, frames);
+        EXPECT_EQ(evts_start, evts_read);
+    }
+
     {
         string set_opt_bad("{\"HEARTBEAT_INTERVAL\": 2000, \"OFFLINE_CACHE_SIZE\": 500}");
         string set_opt_good("{\"HEARTBEAT_INTERVAL\":5}");
@@ -791,6 +863,7 @@ TEST(eventd, testDB)
     stats_collector stats_instance;
     event_handle_t pub_handle;
     event_serialized_lst_t evts_read;
+    event_cache_ring evts_ring(0);
     last_events_t last_evts_read;
     counters_t overflow;
     string tag;
@@ -814,7 +887,7 @@ TEST(eventd, testDB)
     EXPECT_TRUE(NULL != zctx);
 
     /* Run proxy to enable receive as capture test needs to receive */
-    eventd_proxy *pxy = new eventd_proxy(zctx);
+    eventd_proxy *pxy = new eventd_proxy(zctx, &stats_instance);
     EXPECT_TRUE(NULL != pxy);
 
     /* Starting proxy */
@@ -842,12 +915,13 @@ TEST(eventd, testDB)
     EXPECT_EQ(0, pcap->set_control(STOP_CAPTURE));
 
     /* Read the cache */
-    EXPECT_EQ(0, pcap->read_cache(evts_read, last_evts_read, overflow));
+    EXPECT_EQ(0, pcap->read_cache(evts_ring, last_evts_read, overflow));
+    drain_cache(evts_ring, evts_read);
 
     /*
      * Sent pub_count messages of different tags.
-     * Upon cache max, only event per sender/runtime-id is saved. Hence
-     * expected last_evts_read is one.
+     * Upon cache max, oldest are evicted and only the last evicted event
+     * per sender/runtime-id is saved. Hence expected last_evts_read is one.
      * expected overflow = pub_count - cache_max - 1
      */
 
@@ -860,8 +934,38 @@ TEST(eventd, testDB)
     EXPECT_EQ((pub_count - cache_max - 1), stats_instance.read_counter(
                 INDEX_COUNTERS_EVENTS_MISSED_CACHE));
 
+    {
+        counters_t published = 0, dropped = 0;
+
+        EXPECT_TRUE(stats_instance.read_source_counters("test_db", published, dropped));
+        EXPECT_EQ(pub_count, (int)published);
+        EXPECT_EQ(0, (int)dropped);
+    }
+
     events_deinit_publisher(pub_handle);
 
+    /* Allow a write interval to pass */
+    this_thread::sleep_for(chrono::milliseconds(2 * STATS_WRITE_INTERVAL_MS_DEFAULT));
+
+    {
+        string key = string(COUNTERS_EVENTS_SOURCES_TABLE) + ":test_db";
+        unordered_map<string, string> m;
+
+        EXPECT_TRUE(db.exists(key));
+        m = db.hgetall(key);
+        EXPECT_EQ(to_string(pub_count), m[EVENTS_STATS_SOURCE_PUBLISHED]);
+        EXPECT_EQ("0", m[EVENTS_STATS_SOURCE_DROPPED]);
+    }
+
+    /* All published events pass through proxy; None suppressed */
+    EXPECT_LE(pub_count, (int)stats_instance.read_counter(INDEX_COUNTERS_PROXY_MSGS_IN));
+    EXPECT_EQ(stats_instance.read_counter(INDEX_COUNTERS_PROXY_MSGS_IN),
+            stats_instance.read_counter(INDEX_COUNTERS_PROXY_MSGS_OUT));
+    EXPECT_LT(0, (int)stats_instance.read_counter(INDEX_COUNTERS_PROXY_BYTES_IN));
+    EXPECT_EQ(stats_instance.read_counter(INDEX_COUNTERS_PROXY_BYTES_IN),
+            stats_instance.read_counter(INDEX_COUNTERS_PROXY_BYTES_OUT));
+    EXPECT_EQ(0, (int)stats_instance.read_counter(INDEX_COUNTERS_PROXY_SUPPRESSED));
+
     for (int i=0; i < COUNTERS_EVENTS_TOTAL; ++i) {
         string key = string("COUNTERS_EVENTS:") + counter_keys[i];
         unordered_map<string, string> m;
@@ -873,9 +977,21 @@ TEST(eventd, testDB)
                 unordered_map<string, string>::const_iterator itc =
                     m.find(string(EVENTS_STATS_FIELD_NAME));
                 if (itc != m.end()) {
-                    int expect =  (counter_keys[i] == string(COUNTERS_EVENTS_PUBLISHED) ?
-                            pub_count : (pub_count - cache_max - 1));
-                    val_match = (expect == stoi(itc->second) ? true : false);
+                    counters_t expect;
+
+                    switch (i) {
+                    case INDEX_COUNTERS_EVENTS_PUBLISHED:
+                        expect = pub_count;
+                        break;
+                    case INDEX_COUNTERS_EVENTS_MISSED_CACHE:
+                        expect = pub_count - cache_max - 1;
+                        break;
+                    default:
+                        /* Proxy counters, as asserted above */
+                        expect = stats_instance.read_counter((stats_counter_index_t)i);
+                        break;
+                    }
+                    val_match = (expect == stoull(itc->second) ? true : false);
                     val_found = true;
                 }
             }
@@ -912,4 +1028,695 @@ TEST(eventd, testDB)
 }
 
 
-// TODO -- Add unit tests for stats
+TEST(eventd, cacheRing)
+{
+    printf("Cache ring TEST started\n");
+
+    const int cnt_max = 4;
+    const int rid_cnt = 3;
+    const int push_cnt = 10;
+    event_cache_ring ring(MAX_CACHE_BYTES_DEFAULT, cnt_max);
+    last_events_t last_evts, last_evts_exp;
+    event_serialized_lst_t evts_read, evts_exp;
+    const char *data;
+    size_t len;
+    int missed = 0;
+
+    /* Push before init is dropped */
+    EXPECT_EQ(1, ring.push("rid", "x", 1));
+    EXPECT_TRUE(ring.empty());
+
+    EXPECT_EQ(0, ring.init());
+    EXPECT_EQ(0, (int)ring.missed());
+
+    for (int i = 0; i < push_cnt; ++i) {
+        string rid = "rid-" + to_string(i % rid_cnt);
+        string evt = "event-" + to_string(i);
+
+        missed += ring.push(rid, evt.data(), evt.size());
+        if (i >= (push_cnt - cnt_max)) {
+            evts_exp.push_back(evt);
+        }
+        else {
+            last_evts_exp[rid] = evt;
+        }
+    }
+    EXPECT_EQ(cnt_max, ring.size());
+    EXPECT_EQ(push_cnt - cnt_max - rid_cnt, missed);
+    EXPECT_EQ(missed, (int)ring.missed());
+
+    while (ring.front(data, len)) {
+        evts_read.push_back(string(data, len));
+        ring.pop_front();
+    }
+    EXPECT_EQ(evts_exp, evts_read);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(0, (int)ring.bytes_used());
+
+    ring.read_last(last_evts);
+    EXPECT_EQ(last_evts_exp, last_evts);
+
+    /* Bounded by bytes, with records wrapping around */
+    {
+        const size_t bytes_max = 256 * 1024;
+        event_cache_ring ring_b(bytes_max);
+        int prev = -1, cnt = 0;
+
+        EXPECT_EQ(0, ring_b.init());
+        for (int i = 0; i < 100000; ++i) {
+            string evt = to_string(i) + ":" + string(i % 300, 'x');
+
+            ring_b.push("rid-" + to_string(i % rid_cnt), evt.data(), evt.size());
+            EXPECT_LE(ring_b.bytes_used(), bytes_max);
+        }
+        while (ring_b.front(data, len)) {
+            int val = stoi(string(data, len));
+
+            /* Oldest first with no gaps */
+            EXPECT_TRUE((prev == -1) || (val == (prev + 1)));
+            prev = val;
+            ++cnt;
+            ring_b.pop_front();
+        }
+        EXPECT_EQ(99999, prev);
+        EXPECT_EQ(100000, cnt + rid_cnt + (int)ring_b.missed());
+    }
+
+    printf("Cache ring TEST completed\n");
+}
+
+
+/*
+ * Disabled by default, as it maps a sizable arena.
+ * Run with --gtest_also_run_disabled_tests --gtest_filter=*cacheRingBenchmark
+ */
+TEST(eventd, DISABLED_cacheRingBenchmark)
+{
+    printf("Cache ring benchmark started\n");
+
+    const int evt_cnt = 1000000;
+    event_serialized_lst_t evts;
+    struct rusage ru;
+    long rss_start_kb, rss_peak_kb;
+    size_t bytes_max = 0;
+    const char *data;
+    size_t len;
+
+    /* Sample real events, of a handful publishers */
+    for (int i = 0; i < (int)ARRAY_SIZE(ldata); ++i) {
+        string evt_str;
+        serialize(create_ev(ldata[i]), evt_str);
+        bytes_max = max(bytes_max, evt_str.size());
+        evts.push_back(evt_str);
+    }
+    /* Enough to hold all events; Add 1/4 for slots */
+    bytes_max = (bytes_max + 16) * evt_cnt;
+    bytes_max += bytes_max / 4;
+
+    getrusage(RUSAGE_SELF, &ru);
+    rss_start_kb = ru.ru_maxrss;
+
+    event_cache_ring ring(bytes_max);
+    EXPECT_EQ(0, ring.init());
+
+    auto st = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    for (int i = 0; i < evt_cnt; ++i) {
+        const test_data_t &d = ldata[i % ARRAY_SIZE(ldata)];
+        const string &evt = evts[i % evts.size()];
+
+        ring.push(d.rid, evt.data(), evt.size());
+    }
+    auto en = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+
+    getrusage(RUSAGE_SELF, &ru);
+    rss_peak_kb = ru.ru_maxrss;
+
+    EXPECT_EQ(evt_cnt, ring.size());
+    EXPECT_EQ(0, (int)ring.missed());
+    EXPECT_LE(ring.bytes_used(), bytes_max);
+
+    printf("Cached %d events of %lu bytes in %ld us; %.0f events/sec\n",
+            evt_cnt, ring.bytes_used(), (long)(en - st),
+            (en > st) ? ((double)evt_cnt * 1000000 / (en - st)) : 0.0);
+    printf("Peak RSS: start=%ld KB end=%ld KB growth=%ld KB cap=%lu KB\n",
+            rss_start_kb, rss_peak_kb, rss_peak_kb - rss_start_kb, bytes_max / 1024);
+
+    st = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    while (ring.front(data, len)) {
+        ring.pop_front();
+    }
+    en = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    printf("Drained %d events in %ld us\n", evt_cnt, (long)(en - st));
+
+    printf("Cache ring benchmark completed\n");
+}
+
+
+TEST(eventd, capturePeek)
+{
+    printf("Capture peek TEST started\n");
+
+    for (int i = 0; i < (int)ARRAY_SIZE(ldata); ++i) {
+        string evt_str;
+        runtime_id_t rid;
+        sequence_t seq = 0;
+
+        serialize(create_ev(ldata[i]), evt_str);
+
+        EXPECT_TRUE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+        EXPECT_EQ(ldata[i].rid, rid);
+        EXPECT_EQ(str_to_seq(ldata[i].seq), seq);
+    }
+
+    {
+        /* Event data that looks like archive entries is skipped by length */
+        internal_event_t ev;
+        string evt_str;
+        runtime_id_t rid;
+        sequence_t seq = 0;
+
+        ev[EVENT_STR_DATA] = "{\"src:tag\": {\"x\": \"1 r 3 abc 1 s 2 99\"}}";
+        ev[EVENT_RUNTIME_ID] = "guid-x";
+        ev[EVENT_SEQUENCE] = "7";
+        ev[EVENT_EPOCH] = "1234567";
+        serialize(ev, evt_str);
+
+        EXPECT_TRUE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+        EXPECT_EQ("guid-x", rid);
+        EXPECT_EQ(7, (int)seq);
+    }
+
+    {
+        /* Invalid ones */
+        internal_event_t ev;
+        string evt_str;
+        runtime_id_t rid;
+        sequence_t seq;
+
+        ev[EVENT_STR_DATA] = "{}";
+        ev[EVENT_RUNTIME_ID] = "guid-x";
+        serialize(ev, evt_str);
+
+        /* Missing sequence */
+        EXPECT_FALSE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+
+        /* Truncated */
+        evt_str = "22 serialization::archive 18 0 0 3 0 0 0 1 d 40 {}";
+        EXPECT_FALSE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+
+        /* Count of entries short of preamble count */
+        evt_str = "22 serialization::archive 18 0 0 3 0 0 0 1 d 2 {} 1 r 1 x";
+        EXPECT_FALSE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+
+        /* Trailing bytes past the last entry */
+        evt_str = "22 serialization::archive 18 0 0 3 0 0 0 1 d 2 {} 1 r 1 x 1 s 1 5 3";
+        EXPECT_FALSE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+
+        /* Value not ending at its length */
+        evt_str = "22 serialization::archive 18 0 0 3 0 0 0 1 d 1 {} 1 r 1 x 1 s 1 5";
+        EXPECT_FALSE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+
+        /* Event data not an object */
+        evt_str = "22 serialization::archive 18 0 0 3 0 0 0 1 d 2 {x 1 r 1 x 1 s 1 5";
+        EXPECT_FALSE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+
+        /* Well formed */
+        evt_str = "22 serialization::archive 18 0 0 3 0 0 0 1 d 2 {} 1 r 1 x 1 s 1 5";
+        EXPECT_TRUE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+        EXPECT_EQ("x", rid);
+        EXPECT_EQ(5, (int)seq);
+
+        /* Subscribe request */
+        evt_str = string("\x01", 1);
+        EXPECT_FALSE(peek_event_header(evt_str.data(), evt_str.size(), rid, seq));
+        EXPECT_FALSE(peek_event_header("", 0, rid, seq));
+    }
+
+    printf("Capture peek TEST completed\n");
+}
+
+
+/*
+ * Disabled by default, as it maps sizable arenas.
+ * Run with --gtest_also_run_disabled_tests --gtest_filter=*capturePeekBenchmark
+ */
+TEST(eventd, DISABLED_capturePeekBenchmark)
+{
+    printf("Capture peek benchmark started\n");
+
+    const int evt_cnts[] = { 10000, 100000, 1000000 };
+    event_serialized_lst_t evts;
+
+    for (int i = 0; i < (int)ARRAY_SIZE(ldata); ++i) {
+        string evt_str;
+        serialize(create_ev(ldata[i]), evt_str);
+        evts.push_back(evt_str);
+    }
+
+    for (int i = 0; i < (int)ARRAY_SIZE(evt_cnts); ++i) {
+        const int cnt = evt_cnts[i];
+        long us_full, us_peek;
+
+        {
+            /* Per event cost of read as map, validate & serialize back */
+            event_cache_ring ring(MAX_CACHE_BYTES_DEFAULT);
+            EXPECT_EQ(0, ring.init());
+
+            auto st = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+            for (int j = 0; j < cnt; ++j) {
+                const string &evt = evts[j % evts.size()];
+                internal_event_t event;
+                string evt_str;
+
+                EXPECT_EQ(0, deserialize(evt, event));
+                serialize(event, evt_str);
+                ring.push(event[EVENT_RUNTIME_ID], evt_str.data(), evt_str.size());
+            }
+            us_full = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count() - st;
+        }
+
+        {
+            /* Per event cost of peek & cache as received */
+            event_cache_ring ring(MAX_CACHE_BYTES_DEFAULT);
+            EXPECT_EQ(0, ring.init());
+
+            auto st = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+            for (int j = 0; j < cnt; ++j) {
+                const string &evt = evts[j % evts.size()];
+                runtime_id_t rid;
+                sequence_t seq;
+
+                EXPECT_TRUE(peek_event_header(evt.data(), evt.size(), rid, seq));
+                ring.push(rid, evt.data(), evt.size());
+            }
+            us_peek = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count() - st;
+        }
+
+        printf("events=%d full: %ld us %.0f events/sec; peek: %ld us %.0f events/sec\n",
+                cnt, us_full, us_full ? ((double)cnt * 1000000 / us_full) : 0.0,
+                us_peek, us_peek ? ((double)cnt * 1000000 / us_peek) : 0.0);
+    }
+
+    printf("Capture peek benchmark completed\n");
+}
+
+
+TEST(eventd, statsCounters)
+{
+    printf("Stats counters TEST started\n");
+
+    const int thr_cnt = STATS_SHARDS_CNT + 2;
+    const int incr_cnt = 100000;
+    stats_collector stats_instance;
+    vector<thread> thrs;
+
+    /* Not started; Counters are in memory only */
+    for (int i = 0; i < thr_cnt; ++i) {
+        thrs.push_back(thread([&stats_instance, incr_cnt]() {
+            for (int j = 0; j < incr_cnt; ++j) {
+                stats_instance.increment_published(1);
+                stats_instance.increment(INDEX_COUNTERS_PROXY_BYTES_IN, 10);
+            }
+        }));
+    }
+    for (auto &thr : thrs) {
+        thr.join();
+    }
+
+    EXPECT_EQ((counters_t)thr_cnt * incr_cnt,
+            stats_instance.read_counter(INDEX_COUNTERS_EVENTS_PUBLISHED));
+    EXPECT_EQ((counters_t)thr_cnt * incr_cnt * 10,
+            stats_instance.read_counter(INDEX_COUNTERS_PROXY_BYTES_IN));
+    EXPECT_EQ(0, (int)stats_instance.read_counter(INDEX_COUNTERS_EVENTS_MISSED_CACHE));
+    EXPECT_EQ(0, (int)stats_instance.read_counter(COUNTERS_EVENTS_TOTAL));
+
+    {
+        /* Suppressed count of a source not seen yet adds the source */
+        counters_t published = 1, dropped = 1;
+
+        EXPECT_FALSE(stats_instance.read_source_counters("src_storm", published, dropped));
+        stats_instance.increment_source_suppressed("src_storm", 5);
+        stats_instance.increment_source_suppressed("src_storm", 2);
+        EXPECT_EQ(7, (int)stats_instance.read_source_suppressed("src_storm"));
+        EXPECT_TRUE(stats_instance.read_source_counters("src_storm", published, dropped));
+        EXPECT_EQ(0, (int)published);
+        EXPECT_EQ(0, (int)dropped);
+        EXPECT_EQ(0, (int)stats_instance.read_source_suppressed("src_none"));
+    }
+
+    printf("Stats counters TEST completed\n");
+}
+
+
+
+TEST(eventd, rateLimiter)
+{
+    printf("Rate limiter TEST started\n");
+
+    event_rate_limiter limiter;
+    rate_limit_config_t cfg;
+    map<string, counters_t> suppressed;
+    uint64_t now_ms = 1000;
+    int allowed = 0;
+
+    /* Not configured; All pass */
+    EXPECT_FALSE(limiter.enabled());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(limiter.allow("src0:tag0", now_ms));
+    }
+
+    cfg.source = { 100, 20 };
+    cfg.tag = { 10, 5 };
+    cfg.overrides["src1:tag1"] = { 0, 0 };
+    cfg.overrides["src2"] = { 1, 1 };
+    limiter.set_config(cfg);
+    EXPECT_TRUE(limiter.enabled());
+    EXPECT_EQ(10, (int)limiter.get_config().tag.rate);
+
+    /* Tag burst of 5 then suppressed */
+    for (int i = 0; i < 10; ++i) {
+        allowed += limiter.allow("src0:tag0", now_ms) ? 1 : 0;
+    }
+    EXPECT_EQ(5, allowed);
+
+    /* Refill at 10/sec */
+    now_ms += 300;
+    allowed = 0;
+    for (int i = 0; i < 10; ++i) {
+        allowed += limiter.allow("src0:tag0", now_ms) ? 1 : 0;
+    }
+    EXPECT_EQ(3, allowed);
+
+    /* Unlimited tag is still bound by its source burst of 20 */
+    allowed = 0;
+    for (int i = 0; i < 30; ++i) {
+        allowed += limiter.allow("src1:tag1", now_ms) ? 1 : 0;
+    }
+    EXPECT_EQ(20, allowed);
+
+    /* Source override */
+    EXPECT_TRUE(limiter.allow("src2:tagx", now_ms));
+    EXPECT_FALSE(limiter.allow("src2:tagy", now_ms));
+
+    limiter.read_suppressed(suppressed);
+    EXPECT_EQ(3, (int)suppressed.size());
+    EXPECT_EQ(12, (int)suppressed["src0:tag0"]);
+    EXPECT_EQ(10, (int)suppressed["src1:tag1"]);
+    EXPECT_EQ(1, (int)suppressed["src2:tagy"]);
+
+    limiter.read_suppressed(suppressed);
+    EXPECT_TRUE(suppressed.empty());
+
+    /* A flood of new keys does not reset the buckets of a storm source */
+    for (int i = 0; i < 2 * RATE_LIMIT_BUCKETS_MAX; ++i) {
+        limiter.allow("flood" + to_string(i) + ":tag", now_ms);
+    }
+    EXPECT_FALSE(limiter.allow("src0:tag0", now_ms));
+    EXPECT_TRUE(limiter.allow("src0:tag0", now_ms + 100));
+
+    /* Disable */
+    limiter.set_config(rate_limit_config_t());
+    EXPECT_FALSE(limiter.enabled());
+    EXPECT_TRUE(limiter.allow("src2:tagy", now_ms));
+
+    {
+        /* Key from event data */
+        string evt_str, key;
+
+        serialize(create_ev(ldata[0]), evt_str);
+        EXPECT_TRUE(peek_event_key(evt_str.data(), evt_str.size(), key));
+        EXPECT_EQ(ldata[0].source + ":" + ldata[0].tag, key);
+    }
+
+    printf("Rate limiter TEST completed\n");
+}
+
+
+TEST(eventd, journal)
+{
+    printf("Journal TEST started\n");
+
+    char dir_tmpl[] = "/tmp/eventd_journal_XXXXXX";
+    string dir(mkdtemp(dir_tmpl));
+    const size_t seg_bytes = 64 * 1024;
+    const int evt_cnt = 3000;
+    const size_t frame_all = SIZE_MAX;
+    vector<string> evts;
+    event_serialized_lst_t lst;
+
+    for (int i = 0; i < evt_cnt; ++i) {
+        internal_event_t ev;
+        string evt_str;
+
+        ev[EVENT_STR_DATA] = "{\"src:tag\": {\"i\": \"" + to_string(i) + "\"}}";
+        ev[EVENT_RUNTIME_ID] = (i % 2) ? "rid-odd" : "rid-even";
+        ev[EVENT_SEQUENCE] = seq_to_str(i / 2 + 1);
+        ev[EVENT_EPOCH] = "1234567";
+        serialize(ev, evt_str);
+        evts.push_back(evt_str);
+    }
+
+    {
+        /* Budget of 4 segments */
+        event_journal journal(dir, 4 * seg_bytes, seg_bytes);
+
+        EXPECT_EQ(0, journal.open());
+        EXPECT_EQ(0, (int)journal.size());
+
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(0, journal.append(i % 2 ? "rid-odd" : "rid-even", i / 2 + 1,
+                        evts[i].data(), evts[i].size()));
+        }
+        EXPECT_EQ(100, (int)journal.size());
+
+        /* From oldest */
+        EXPECT_EQ(0, journal.read_from("", 0, frame_all, lst));
+        EXPECT_EQ(100, (int)lst.size());
+        EXPECT_EQ(evts[0], lst[0]);
+        EXPECT_EQ(evts[99], lst[99]);
+
+        /* After 21st event, i.e. rid-even seq 11; Events of both rids follow */
+        lst.clear();
+        EXPECT_EQ(0, journal.read_from("rid-even", 11, frame_all, lst));
+        EXPECT_EQ(79, (int)lst.size());
+        EXPECT_EQ(evts[21], lst[0]);
+
+        /* Latest; None after */
+        lst.clear();
+        EXPECT_EQ(0, journal.read_from("rid-odd", 50, frame_all, lst));
+        EXPECT_TRUE(lst.empty());
+
+        /* Frame bounded by bytes; At least one */
+        lst.clear();
+        EXPECT_EQ(0, journal.read_from("", 0, 1, lst));
+        EXPECT_EQ(1, (int)lst.size());
+
+        /* Rotate & evict over budget */
+        for (int i = 100; i < evt_cnt; ++i) {
+            EXPECT_EQ(0, journal.append(i % 2 ? "rid-odd" : "rid-even", i / 2 + 1,
+                        evts[i].data(), evts[i].size()));
+        }
+        EXPECT_GE(4 * seg_bytes, journal.bytes_used());
+        EXPECT_GT(evt_cnt, (int)journal.size());
+
+        /* Evicted; Reads from oldest */
+        lst.clear();
+        EXPECT_EQ(0, journal.read_from("rid-even", 11, frame_all, lst));
+        EXPECT_EQ(journal.size(), lst.size());
+        EXPECT_EQ(evts[evt_cnt - 1], lst.back());
+
+        /* Too big */
+        string big(seg_bytes, 'x');
+        EXPECT_EQ(-1, journal.append("rid-big", 1, big.data(), big.size()));
+        EXPECT_EQ(1, (int)journal.dropped());
+        journal.close();
+    }
+
+    {
+        /* Replay across restart */
+        event_journal journal(dir, 4 * seg_bytes, seg_bytes);
+        event_serialized_lst_t lst_restart;
+
+        EXPECT_EQ(0, journal.open());
+        EXPECT_EQ(lst.size(), journal.size());
+
+        EXPECT_EQ(0, journal.read_from("", 0, frame_all, lst_restart));
+        EXPECT_EQ(lst, lst_restart);
+
+        lst_restart.clear();
+        EXPECT_EQ(0, journal.read_from("rid-even", (evt_cnt - 2) / 2, frame_all,
+                    lst_restart));
+        EXPECT_EQ(3, (int)lst_restart.size());
+        EXPECT_EQ(evts[evt_cnt - 3], lst_restart[0]);
+        journal.close();
+    }
+
+    {
+        /* A torn record ends the replay, w/o failure */
+        event_journal journal(dir, 4 * seg_bytes, seg_bytes);
+        size_t cnt;
+
+        EXPECT_EQ(0, journal.open());
+        cnt = journal.size();
+        EXPECT_EQ(0, journal.append("rid-odd", evt_cnt, evts[0].data(), evts[0].size()));
+        EXPECT_EQ(0, journal.append("rid-odd", evt_cnt + 1, evts[1].data(), evts[1].size()));
+        journal.close();
+
+        /* Corrupt the last record written, in newest segment */
+        string last_seg, seg_data;
+        DIR *d = opendir(dir.c_str());
+        struct dirent *ent;
+
+        while ((ent = readdir(d)) != NULL) {
+            if ((ent->d_name[0] != '.') && (string(ent->d_name) > last_seg)) {
+                last_seg = ent->d_name;
+            }
+        }
+        closedir(d);
+        {
+            fstream f(dir + "/" + last_seg, ios::in | ios::out | ios::binary);
+
+            seg_data.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+            f.seekp(seg_data.rfind(evts[1]) + evts[1].size() - 1);
+            f.put('#');
+        }
+
+        EXPECT_EQ(0, journal.open());
+        EXPECT_EQ(cnt + 1, journal.size());
+        journal.close();
+    }
+
+    {
+        /* Gaps in sequence of a runtime id are counted as dropped */
+        event_journal journal(dir + "/gap", 4 * seg_bytes, seg_bytes);
+
+        EXPECT_EQ(0, journal.open());
+        EXPECT_EQ(0, journal.append("rid-gap", 10, evts[0].data(), evts[0].size()));
+        EXPECT_EQ(0, journal.append("rid-gap", 11, evts[2].data(), evts[2].size()));
+        EXPECT_EQ(0, (int)journal.dropped());
+        EXPECT_EQ(0, journal.append("rid-gap", 15, evts[4].data(), evts[4].size()));
+        EXPECT_EQ(3, (int)journal.dropped());
+
+        /* Other runtime ids are tracked apart */
+        EXPECT_EQ(0, journal.append("rid-other", 100, evts[1].data(), evts[1].size()));
+        EXPECT_EQ(0, journal.append("rid-gap", 16, evts[6].data(), evts[6].size()));
+        EXPECT_EQ(3, (int)journal.dropped());
+        journal.close();
+    }
+
+    {
+        /* Appends across syncs & segments replay in order */
+        event_journal journal(dir + "/sync", 4 * seg_bytes, seg_bytes);
+        const int cnt = 500;
+
+        EXPECT_EQ(0, journal.open());
+        for (int i = 0; i < cnt; ++i) {
+            EXPECT_EQ(0, journal.append("rid", i + 1, evts[i].data(), evts[i].size()));
+            if ((i % 100) == 0) {
+                journal.sync();
+            }
+        }
+        journal.sync();
+        journal.close();
+
+        lst.clear();
+        EXPECT_EQ(0, journal.open());
+        EXPECT_EQ(cnt, (int)journal.size());
+        EXPECT_EQ(0, journal.read_from("", 0, frame_all, lst));
+        EXPECT_EQ(cnt, (int)lst.size());
+        EXPECT_EQ(evts[0], lst[0]);
+        EXPECT_EQ(evts[cnt - 1], lst.back());
+        journal.close();
+    }
+
+    string cmd("rm -rf " + dir);
+    EXPECT_EQ(0, system(cmd.c_str()));
+
+    printf("Journal TEST completed\n");
+}
+
+
+TEST(eventd, DISABLED_journalBenchmark)
+{
+    printf("Journal benchmark started\n");
+
+    char dir_tmpl[] = "/tmp/eventd_journal_XXXXXX";
+    string dir(mkdtemp(dir_tmpl));
+    const int evt_cnt = 3000;
+    const int cnt = 500000;
+    vector<string> evts;
+
+    for (int i = 0; i < evt_cnt; ++i) {
+        internal_event_t ev;
+        string evt_str;
+
+        ev[EVENT_STR_DATA] = "{\"src:tag\": {\"i\": \"" + to_string(i) + "\"}}";
+        ev[EVENT_RUNTIME_ID] = "rid";
+        ev[EVENT_SEQUENCE] = seq_to_str(i + 1);
+        ev[EVENT_EPOCH] = "1234567";
+        serialize(ev, evt_str);
+        evts.push_back(evt_str);
+    }
+
+    {
+        /* Append throughput */
+        event_journal journal(dir, 64 * 1024 * 1024, 4 * 1024 * 1024);
+
+        EXPECT_EQ(0, journal.open());
+        auto start = steady_clock::now();
+        for (int i = 0; i < cnt; ++i) {
+            const string &evt = evts[i % evt_cnt];
+            journal.append("rid", i, evt.data(), evt.size());
+            if ((i % 10000) == 0) {
+                journal.sync();
+            }
+        }
+        journal.sync();
+        double secs = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+        printf("Journal appended %d events in %.3f secs; %.0f events/sec\n",
+                cnt, secs, cnt / secs);
+        journal.close();
+    }
+
+    string cmd("rm -rf " + dir);
+    EXPECT_EQ(0, system(cmd.c_str()));
+
+    printf("Journal benchmark completed\n");
+}
+
+
+TEST(eventd, config)
+{
+    printf("Config TEST started\n");
+
+    const char *fname = "/tmp/eventd_ut_init_cfg.json";
+
+    EXPECT_EQ((size_t)MAX_CACHE_BYTES_DEFAULT,
+            get_eventd_config_data(string(CACHE_MAX_BYTES), (size_t)0));
+
+    {
+        ofstream fs(fname);
+        fs << "{\"events\": {\"" CACHE_MAX_BYTES "\": 1048576, \"no_such_key\": 5}}";
+    }
+    read_eventd_config(fname);
+    EXPECT_EQ((size_t)1048576,
+            get_eventd_config_data(string(CACHE_MAX_BYTES), (size_t)0));
+    EXPECT_TRUE(get_eventd_config("no_such_key").empty());
+
+    /* Missing file leaves config as is */
+    read_eventd_config("/tmp/eventd_ut_no_such_cfg.json");
+    EXPECT_EQ((size_t)1048576,
+            get_eventd_config_data(string(CACHE_MAX_BYTES), (size_t)0));
+
+    /* Restore default */
+    {
+        ofstream fs(fname);
+        fs << "{\"events\": {\"" CACHE_MAX_BYTES "\": " << MAX_CACHE_BYTES_DEFAULT << "}}";
+    }
+    read_eventd_config(fname);
+    EXPECT_EQ((size_t)MAX_CACHE_BYTES_DEFAULT,
+            get_eventd_config_data(string(CACHE_MAX_BYTES), (size_t)0));
+    remove(fname);
+
+    printf("Config TEST completed\n");
+}
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include "events.h"
 #include "events_common.h"
+#include "events_service.h"
+#include "../src/eventd.h"
 
 /*
  * Sample i/p file contents for send
@@ -50,6 +52,12 @@ Note:\n\
 \n\
 -p  - Count of milliseconds to pause between sends or receives. In send-recv mode, it only affects send.\n\
       Default: 0 implying no pause\n\
+\n\
+-t  - Target rate of events per second to send. Takes precedence over -p.\n\
+      Progress is printed once per second worth of events and the achieved\n\
+      rate is reported upon completion.\n\
+      e.g. -t 100000 to inject 100k events/sec into eventd.\n\
+      Default: 0 implying no rate control\n\
 \n\
       -i  - List of JSON messages to send in a file, with each event/message\n\
             declared in a single line. When n is more than size of list, the list\n\
@@ -62,6 +70,12 @@ Note:\n\
       Default: <some test message>\n\
 \n\
 -c  - Use offline cache in receive mode\n\
+      Reports the cache drain throughput, counting events received until\n\
+      the first receive timeout as the ones drained from cache.\n\
+-j  - Replay events from eventd journal, that were received after the given\n\
+      <runtime id>:<sequence>. An empty runtime id replays from the oldest.\n\
+      The journal is read in frames, until drained. Count & rate are reported.\n\
+      e.g. -j : to replay all; -j <rid>:10 to replay after seq 10 of <rid>\n\
 -o  - O/p file to write received events\n\
       Default: STDOUT\n";
 
@@ -90,6 +104,8 @@ void
 do_receive(const event_subscribe_sources_t filter, const string outfile, int cnt, int pause, bool use_cache)
 {
     int index=0, total_missed = 0;
+    int drain_cnt = 0;
+    bool draining = use_cache;
     ostream* fp = &cout;
     ofstream fout;
 
@@ -100,9 +116,13 @@ do_receive(const event_subscribe_sources_t filter, const string outfile, int cnt
             printf("outfile=%s set\n", outfile.c_str());
         }
     }
+    /* With cache, subscriber init reads the entire cache from eventd */
+    auto st = steady_clock::now();
     event_handle_t h = events_init_subscriber(use_cache, 2000, filter.empty() ? NULL : &filter);
-    printf("Subscribed with use_cache=%d timeout=2000 filter %s\n",
-            use_cache, filter.empty() ? "empty" : "non-empty");
+    auto drain_end = steady_clock::now();
+    auto init_us = duration_cast<microseconds>(drain_end - st).count();
+    printf("Subscribed with use_cache=%d timeout=2000 filter %s in %ld us\n",
+            use_cache, filter.empty() ? "empty" : "non-empty", (long)init_us);
     ASSERT(h != NULL, "Failed to get subscriber handle");
 
     while(!term_receive) {
@@ -113,8 +133,19 @@ do_receive(const event_subscribe_sources_t filter, const string outfile, int cnt
         if (rc != 0) {
             ASSERT(rc == EAGAIN, "Failed to receive rc=%d index=%d\n",
                     rc, index);
+            if (draining) {
+                /* Timeout implies cache is drained by last received */
+                auto us = duration_cast<microseconds>(drain_end - st).count();
+                printf("Cache drained %d events in %ld us; rate=%.0f events/sec\n",
+                        drain_cnt, (long)us, us > 0 ? ((double)drain_cnt * 1000000 / us) : 0.0);
+                draining = false;
+            }
             continue;
         }
+        if (draining) {
+            ++drain_cnt;
+            drain_end = steady_clock::now();
+        }
         ASSERT(!evt.key.empty(), "received EMPTY key");
         ASSERT(evt.missed_cnt >= 0, "Missed count uninitialized");
         ASSERT(evt.publish_epoch_ms > 0, "publish_epoch_ms uninitialized");
@@ -142,8 +173,71 @@ do_receive(const event_subscribe_sources_t filter, const string outfile, int cnt
 }
 
 
+void
+do_replay(const string &from, const string outfile)
+{
+    event_service service;
+    runtime_id_t rid(from.substr(0, from.find(':')));
+    sequence_t seq = 0;
+    int index = 0, frames = 0;
+    ostream* fp = &cout;
+    ofstream fout;
+
+    if (from.find(':') != string::npos) {
+        string str_seq(from.substr(from.find(':') + 1));
+        seq = str_seq.empty() ? 0 : stoull(str_seq);
+    }
+
+    if (!outfile.empty() && (outfile != "STDOUT")) {
+        fout.open(outfile);
+        if (!fout.fail()) {
+            fp = &fout;
+        }
+    }
+
+    void *zctx = zmq_ctx_new();
+    ASSERT(zctx != NULL, "Failed to get zmq ctx");
+    ASSERT(service.init_client(zctx, 2000) == 0, "Failed to init client");
+
+    auto st = steady_clock::now();
+    while (true) {
+        event_serialized_lst_t opts, frame;
+        nlohmann::json msg = nlohmann::json::object();
+
+        /* Continue from last event received */
+        msg[CACHE_READ_JOURNAL_FROM][JOURNAL_FROM_RUNTIME_ID] = rid;
+        msg[CACHE_READ_JOURNAL_FROM][JOURNAL_FROM_SEQUENCE] = seq;
+        opts.push_back(msg.dump());
+
+        int rc = service.send_recv(EVENT_CACHE_READ, &opts, &frame);
+        ASSERT(rc == 0, "Failed to read journal rc=%d; Is journal enabled?", rc);
+        if (frame.empty()) {
+            break;
+        }
+        ++frames;
+
+        for (const auto &evt_str : frame) {
+            internal_event_t evt;
+
+            ASSERT(deserialize(evt_str, evt) == 0, "Failed to deserialize event %d", index);
+            rid = evt[EVENT_RUNTIME_ID];
+            seq = str_to_seq(evt[EVENT_SEQUENCE]);
+            (*fp) << evt[EVENT_STR_DATA] << "\n";
+            ++index;
+        }
+    }
+    auto us = duration_cast<microseconds>(steady_clock::now() - st).count();
+    fp->flush();
+
+    service.close_service();
+    zmq_ctx_term(zctx);
+    printf("Replayed %d events in %d frames in %ld us; rate=%.0f events/sec\n",
+            index, frames, (long)us, us > 0 ? ((double)index * 1000000 / us) : 0.0);
+}
+
+
 int
-do_send(const string infile, int cnt, int pause)
+do_send(const string infile, int cnt, int pause, int rate)
 {
     typedef struct {
         string tag;
@@ -204,6 +298,9 @@ do_send(const string infile, int cnt, int pause)
     h = events_init_publisher(source);
     ASSERT(h != NULL, "failed to init publisher");
 
+    int print_chunk = rate > 0 ? rate : PRINT_CHUNK_SZ;
+    auto st = steady_clock::now();
+
     /* cnt = 0 as i/p implies forever */
 
     while(cnt >= 0) {
@@ -211,7 +308,7 @@ do_send(const string infile, int cnt, int pause)
         for(lst_t::const_iterator itc = lst.begin(); (cnt >= 0) && (itc != lst.end()); ++itc) {
             const evt_t &evt = *itc;
 
-            if ((++index % PRINT_CHUNK_SZ) == 0) {
+            if ((++index % print_chunk) == 0) {
                 printf("Sending index %d\n", index);
             }
 
@@ -222,6 +319,13 @@ do_send(const string infile, int cnt, int pause)
                 /* set to termninate */
                 cnt = -1;
             }
+            else if (rate > 0) {
+                /* Sleep until due time of next send */
+                auto due = st + microseconds(((int64_t)index * 1000000) / rate);
+                if (due > steady_clock::now()) {
+                    this_thread::sleep_until(due);
+                }
+            }
             else if (pause) {
                 /* Pause between two sends */
                 this_thread::sleep_for(chrono::milliseconds(pause));
@@ -229,8 +333,11 @@ do_send(const string infile, int cnt, int pause)
         }
     }
 
+    auto us = duration_cast<microseconds>(steady_clock::now() - st).count();
+
     events_deinit_publisher(h);
-    printf("Sent %d events\n", index);
+    printf("Sent %d events in %ld us; rate=%.0f events/sec\n", index, (long)us,
+            us > 0 ? ((double)index * 1000000 / us) : 0.0);
     return 0;
 }
 
@@ -244,18 +351,24 @@ int main(int argc, char **argv)
 {
     bool use_cache = false;
     int op = OP_INIT;
-    int cnt=0, pause=0;
-    string json_str_msg, outfile("STDOUT"), infile;
+    int cnt=0, pause=0, rate=0;
+    bool replay = false;
+    string json_str_msg, outfile("STDOUT"), infile, replay_from;
     event_subscribe_sources_t filter;
 
     for(;;)
     {
-        switch(getopt(argc, argv, "srn:p:i:o:f:c")) // note the colon (:) to indicate that 'b' has a parameter and is not a switch
+        switch(getopt(argc, argv, "srn:p:t:i:o:f:cj:")) // note the colon (:) to indicate that 'b' has a parameter and is not a switch
         {
         case 'c':
             use_cache = true;
             continue;
 
+        case 'j':
+            replay = true;
+            replay_from = optarg;
+            continue;
+
         case 's':
             op |= OP_SEND;
             continue;
@@ -272,6 +385,10 @@ int main(int argc, char **argv)
             pause = stoi(optarg);
             continue;
 
+        case 't':
+            rate = stoi(optarg);
+            continue;
+
         case 'i':
             infile = optarg;
             continue;
@@ -305,15 +422,18 @@ int main(int argc, char **argv)
     }
 
 
-    printf("op=%d n=%d pause=%d i=%s o=%s\n",
-            op, cnt, pause, infile.c_str(), outfile.c_str());
+    printf("op=%d n=%d pause=%d rate=%d i=%s o=%s\n",
+            op, cnt, pause, rate, infile.c_str(), outfile.c_str());
 
-    if (op == OP_SEND_RECV) {
+    if (replay) {
+        do_replay(replay_from, outfile);
+    }
+    else if (op == OP_SEND_RECV) {
         thread thr(&do_receive, filter, outfile, 0, 0, use_cache);
-        do_send(infile, cnt, pause);
+        do_send(infile, cnt, pause, rate);
     }
     else if (op == OP_SEND) {
-        do_send(infile, cnt, pause);
+        do_send(infile, cnt, pause, rate);
     }
     else if (op == OP_RECV) {
         do_receive(filter, outfile, cnt, pause, use_cache);